@@ -0,0 +1,287 @@
+/**
+ * @file bob/core/parallel.h
+ * @date Mon Oct 19 02:16:10 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Helpers to split loop computations across several threads.
+ *
+ * @warning The reference counting of blitz::Array's is not thread-safe
+ * (unless blitz is compiled with BZ_THREADSAFE). Worker functions should
+ * therefore never reference(), slice or copy-construct arrays which are
+ * shared with other threads. Instead, they should build their own views
+ * from the raw data, using blitz::neverDeleteData.
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#ifndef BOB_CORE_PARALLEL_H
+#define BOB_CORE_PARALLEL_H
+
+#include <vector>
+#include <cstddef>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
+#include <boost/shared_array.hpp>
+
+namespace bob { namespace core {
+  /**
+   * @ingroup CORE
+   * @{
+   */
+
+  /**
+   * @brief Returns the number of threads used by default for parallel
+   * computations, which is the number of hardware threads (at least 1).
+   */
+  size_t hardware_threads();
+
+  /**
+   * @brief Returns the number of threads that should be used to process
+   * n_objects, when n_threads are requested. If n_threads is 0, the number
+   * of hardware threads is requested. The returned value is never larger
+   * than n_objects, and always at least 1.
+   */
+  size_t thread_count(const size_t n_objects, const size_t n_threads);
+
+  /**
+   * @brief Splits n_objects into n_threads contiguous ranges
+   * [sbegins[i], sends[i]) of (almost) equal sizes.
+   */
+  void thread_split(const size_t n_objects, const size_t n_threads,
+    std::vector<size_t>& sbegins, std::vector<size_t>& sends);
+
+  namespace detail {
+    /**
+     * @brief Calls op(thread_index) from a thread, keeping track of any
+     * exception it may raise, so that it could be rethrown from the calling
+     * thread.
+     */
+    template <typename TOp> struct thread_guard {
+      TOp op;
+      const size_t ith;
+      boost::exception_ptr& error;
+
+      thread_guard(const TOp& op_, const size_t ith_,
+          boost::exception_ptr& error_):
+        op(op_), ith(ith_), error(error_) {}
+
+      void operator()() {
+        try {
+          op(ith);
+        }
+        catch (...) {
+          error = boost::current_exception();
+        }
+      }
+    };
+
+    /**
+     * @brief Runs op(0), ..., op(n_threads-1), each call in its own thread,
+     * and waits for all of them. The first exception raised by a thread is
+     * rethrown once all the threads have terminated.
+     */
+    template <typename TOp> void thread_run(const TOp& op,
+      const size_t n_threads)
+    {
+      if (n_threads <= 1) {
+        op((size_t)0);
+        return;
+      }
+      std::vector<boost::exception_ptr> errors(n_threads);
+      boost::shared_array<boost::thread> threads(new boost::thread[n_threads]);
+      // The calling thread processes the first part itself
+      for (size_t ith=1; ith<n_threads; ++ith) {
+        boost::thread t(thread_guard<TOp>(op, ith, errors[ith]));
+        threads[ith] = boost::move(t);
+      }
+      thread_guard<TOp>(op, 0, errors[0])();
+      for (size_t ith=1; ith<n_threads; ++ith) threads[ith].join();
+      for (size_t ith=0; ith<n_threads; ++ith)
+        if (errors[ith]) boost::rethrow_exception(errors[ith]);
+    }
+
+    /**
+     * @brief Calls op(thread_index, begin, end) on the static range of a
+     * given thread.
+     */
+    template <typename TOp> struct thread_range_worker {
+      TOp& op;
+      const std::vector<size_t>& sbegins;
+      const std::vector<size_t>& sends;
+
+      thread_range_worker(TOp& op_, const std::vector<size_t>& sbegins_,
+          const std::vector<size_t>& sends_):
+        op(op_), sbegins(sbegins_), sends(sends_) {}
+
+      void operator()(const size_t ith) const
+      { op(ith, sbegins[ith], sends[ith]); }
+    };
+
+    /**
+     * @brief Calls op(thread_index, block_index) for the blocks which are
+     * dynamically dispatched to a given thread.
+     */
+    template <typename TOp> struct thread_block_worker {
+      TOp& op;
+      const size_t n_blocks;
+      size_t& next_block;
+      boost::mutex& mutex;
+
+      thread_block_worker(TOp& op_, const size_t n_blocks_,
+          size_t& next_block_, boost::mutex& mutex_):
+        op(op_), n_blocks(n_blocks_), next_block(next_block_), mutex(mutex_)
+      {}
+
+      void operator()(const size_t ith) const {
+        while (true) {
+          size_t b;
+          {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if (next_block >= n_blocks) return;
+            b = next_block++;
+          }
+          op(ith, b);
+        }
+      }
+    };
+
+    /**
+     * @brief Calls op(thread_index, block_index) for the blocks which are
+     * dynamically dispatched to a given thread, and then
+     * op.reduce(thread_index, block_index) as soon as all the previous
+     * blocks have been reduced. When a call throws, the flag failed is set
+     * and the waiting threads are woken up: they skip the remaining blocks,
+     * so that the exception could be rethrown once all have terminated.
+     */
+    template <typename TOp> struct thread_reduce_worker {
+      TOp& op;
+      const size_t n_blocks;
+      size_t& next_block;
+      size_t& next_reduce;
+      bool& failed;
+      boost::mutex& mutex;
+      boost::condition_variable& condition;
+
+      thread_reduce_worker(TOp& op_, const size_t n_blocks_,
+          size_t& next_block_, size_t& next_reduce_, bool& failed_,
+          boost::mutex& mutex_, boost::condition_variable& condition_):
+        op(op_), n_blocks(n_blocks_), next_block(next_block_),
+        next_reduce(next_reduce_), failed(failed_), mutex(mutex_),
+        condition(condition_)
+      {}
+
+      void operator()(const size_t ith) const {
+        while (true) {
+          size_t b;
+          {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            if (failed || next_block >= n_blocks) return;
+            b = next_block++;
+          }
+          try {
+            op(ith, b);
+          }
+          catch (...) {
+            boost::lock_guard<boost::mutex> lock(mutex);
+            failed = true;
+            condition.notify_all();
+            throw;
+          }
+          // reduction in the order of the blocks
+          boost::unique_lock<boost::mutex> lock(mutex);
+          while (next_reduce != b && !failed) condition.wait(lock);
+          if (failed) return;
+          try {
+            op.reduce(ith, b);
+          }
+          catch (...) {
+            failed = true;
+            condition.notify_all();
+            throw;
+          }
+          ++next_reduce;
+          condition.notify_all();
+        }
+      }
+    };
+  }
+
+  /**
+   * @brief Splits a loop computation of the given size into contiguous
+   * ranges, one per thread. The functor is called as
+   * op(thread_index, begin, end), and should not modify any state shared
+   * between the threads (except disjoint parts of an output).
+   * If n_threads is 0, the number of hardware threads is used.
+   *
+   * @return The number of threads effectively used, so that per-thread
+   * results (indexed by thread_index) could be allocated before and
+   * reduced afterwards.
+   */
+  template <typename TOp> size_t thread_loop(TOp op, const size_t size,
+    const size_t n_threads=0)
+  {
+    const size_t n = thread_count(size, n_threads);
+    std::vector<size_t> sbegins, sends;
+    thread_split(size, n, sbegins, sends);
+    detail::thread_run(detail::thread_range_worker<TOp>(op, sbegins, sends), n);
+    return n;
+  }
+
+  /**
+   * @brief Processes n_blocks independent blocks with several threads. The
+   * blocks are dispatched in increasing order to the first available
+   * thread, and the functor is called as op(thread_index, block_index).
+   *
+   * The decomposition into blocks does not depend on the number of
+   * threads. Reducing per-block results in block order hence provides
+   * results which are reproducible, whatever the number of threads is.
+   *
+   * @return The number of threads effectively used.
+   */
+  template <typename TOp> size_t thread_blocks(TOp op, const size_t n_blocks,
+    const size_t n_threads=0)
+  {
+    const size_t n = thread_count(n_blocks, n_threads);
+    size_t next_block = 0;
+    boost::mutex mutex;
+    detail::thread_run(detail::thread_block_worker<TOp>(op, n_blocks,
+      next_block, mutex), n);
+    return n;
+  }
+
+  /**
+   * @brief Processes n_blocks blocks with several threads, as
+   * thread_blocks() does, and reduces their results in block order. The
+   * functor is called as op(thread_index, block_index), which should store
+   * the result of the block in the state of thread thread_index, and then
+   * as op.reduce(thread_index, block_index), which should add this result
+   * to the output. The calls to reduce() never overlap, and are made in
+   * increasing block order: the output hence does not depend on the number
+   * of threads.
+   *
+   * If a call throws, the other threads stop after their current block and
+   * the first exception is rethrown. The output is then only partially
+   * reduced.
+   *
+   * @return The number of threads effectively used.
+   */
+  template <typename TOp> size_t thread_reduce_blocks(TOp op,
+    const size_t n_blocks, const size_t n_threads=0)
+  {
+    const size_t n = thread_count(n_blocks, n_threads);
+    size_t next_block = 0;
+    size_t next_reduce = 0;
+    bool failed = false;
+    boost::mutex mutex;
+    boost::condition_variable condition;
+    detail::thread_run(detail::thread_reduce_worker<TOp>(op, n_blocks,
+      next_block, next_reduce, failed, mutex, condition), n);
+    return n;
+  }
+
+  /**
+   * @}
+   */
+}}
+
+#endif /* BOB_CORE_PARALLEL_H */
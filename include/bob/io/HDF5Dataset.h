@@ -384,6 +384,14 @@ namespace bob { namespace io { namespace detail { namespace hdf5 {
        */
       void read_buffer (size_t index, const bob::io::HDF5Type& dest, void* buffer);
 
+      /**
+       * Reads count consecutive elements, starting at the given index, into
+       * the given (user) buffer, which should be large enough to contain
+       * them.
+       */
+      void read_buffer (size_t index, size_t count,
+          const bob::io::HDF5Type& dest, void* buffer);
+
       /**
        * Writes the contents of a given buffer into the file. The area that the
        * data will occupy should have been selected beforehand.
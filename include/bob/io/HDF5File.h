@@ -375,6 +375,14 @@ namespace bob { namespace io {
       void read_buffer (const std::string& path, size_t pos,
           const HDF5Type& type, void* buffer) const;
 
+      /**
+       * Reads count consecutive objects, starting at position pos, from the
+       * file into a buffer, which should be large enough to hold count
+       * objects of the type described in "dest".
+       */
+      void read_buffer (const std::string& path, size_t pos, size_t count,
+          const HDF5Type& type, void* buffer) const;
+
       /**
        * writes the contents of a given buffer into the file. the area that the
        * data will occupy should have been selected beforehand.
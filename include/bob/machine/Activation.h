@@ -12,6 +12,7 @@
 
 #include <string>
 #include <boost/shared_ptr.hpp>
+#include <blitz/array.h>
 #include "bob/io/HDF5File.h"
 
 namespace bob { namespace machine {
@@ -45,6 +46,26 @@ namespace bob { namespace machine {
        */
       virtual double f_prime_from_f (double a) const =0;
 
+      /**
+       * Computes the activated values of a whole 2D array of inputs (e.g. a
+       * batch of samples), storing them into "a". Both arrays should have
+       * the same shape, and "a" may be "z" itself (in-place computation).
+       *
+       * The default implementation calls f() for each element. Derived
+       * classes should override it with a loop over the raw data, which
+       * avoids one virtual call per element.
+       */
+      virtual void f (const blitz::Array<double,2>& z,
+          blitz::Array<double,2>& a) const;
+
+      /**
+       * Computes the derivatives of a whole 2D array of activated values,
+       * storing them into "b". Same conventions as for the 2D variant of
+       * f() above.
+       */
+      virtual void f_prime_from_f (const blitz::Array<double,2>& a,
+          blitz::Array<double,2>& b) const;
+
       /**
        * Saves itself to an HDF5File
        */
@@ -98,6 +119,10 @@ namespace bob { namespace machine {
       virtual double f (double z) const;
       virtual double f_prime (double z) const;
       virtual double f_prime_from_f (double a) const;
+      virtual void f (const blitz::Array<double,2>& z,
+          blitz::Array<double,2>& a) const;
+      virtual void f_prime_from_f (const blitz::Array<double,2>& a,
+          blitz::Array<double,2>& b) const;
       virtual void save(bob::io::HDF5File&) const;
       virtual void load(bob::io::HDF5File&);
       virtual std::string unique_identifier() const;
@@ -117,6 +142,10 @@ namespace bob { namespace machine {
       virtual double f (double z) const;
       virtual double f_prime (double z) const;
       virtual double f_prime_from_f (double a) const;
+      virtual void f (const blitz::Array<double,2>& z,
+          blitz::Array<double,2>& a) const;
+      virtual void f_prime_from_f (const blitz::Array<double,2>& a,
+          blitz::Array<double,2>& b) const;
       double C() const;
       virtual void save(bob::io::HDF5File& f) const;
       virtual void load(bob::io::HDF5File&);
@@ -140,6 +169,10 @@ namespace bob { namespace machine {
       virtual double f (double z) const;
       virtual double f_prime (double z) const;
       virtual double f_prime_from_f (double a) const;
+      virtual void f (const blitz::Array<double,2>& z,
+          blitz::Array<double,2>& a) const;
+      virtual void f_prime_from_f (const blitz::Array<double,2>& a,
+          blitz::Array<double,2>& b) const;
       virtual void save(bob::io::HDF5File& f) const;
       virtual void load(bob::io::HDF5File&);
       virtual std::string unique_identifier() const;
@@ -159,6 +192,10 @@ namespace bob { namespace machine {
       virtual double f (double z) const;
       virtual double f_prime (double z) const;
       virtual double f_prime_from_f (double a) const;
+      virtual void f (const blitz::Array<double,2>& z,
+          blitz::Array<double,2>& a) const;
+      virtual void f_prime_from_f (const blitz::Array<double,2>& a,
+          blitz::Array<double,2>& b) const;
       double C() const;
       double M() const;
       virtual void save(bob::io::HDF5File& f) const;
@@ -184,6 +221,10 @@ namespace bob { namespace machine {
       virtual double f (double z) const;
       virtual double f_prime (double z) const;
       virtual double f_prime_from_f (double a) const;
+      virtual void f (const blitz::Array<double,2>& z,
+          blitz::Array<double,2>& a) const;
+      virtual void f_prime_from_f (const blitz::Array<double,2>& a,
+          blitz::Array<double,2>& b) const;
       virtual void save(bob::io::HDF5File& f) const;
       virtual void load(bob::io::HDF5File&);
       virtual std::string unique_identifier() const;
@@ -65,6 +65,12 @@ namespace bob { namespace machine {
       //! performs some checks before calling the forward_ method
       void forward (const blitz::Array<double,1>& input, double& output) const;
 
+      //! computes the BIC probability scores for each row of the given input, using n_threads threads (0: all hardware threads)
+      void forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 0) const;
+
+      //! performs some checks before calling the forward_ method on a set of difference vectors
+      void forward (const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads = 0) const;
+
       //! sets the IEC vectors of the given class
       void setIEC(bool clazz, const blitz::Array<double,1>& mean, const blitz::Array<double,1>& variances, bool copy_data = false);
 
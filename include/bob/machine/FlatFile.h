@@ -0,0 +1,221 @@
+/**
+ * @file bob/machine/FlatFile.h
+ * @date Mon Oct 19 02:42:23 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Flat binary storage of (large) machines, which can be memory-mapped
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#ifndef BOB_MACHINE_FLATFILE_H
+#define BOB_MACHINE_FLATFILE_H
+
+#include <blitz/array.h>
+#include <bob/core/check.h>
+#include <bob/core/array_copy.h>
+#include <boost/format.hpp>
+#include <boost/noncopyable.hpp>
+#include <stdexcept>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+namespace bob { namespace machine {
+/**
+ * @ingroup MACHINE
+ * @{
+ */
+
+namespace detail {
+  /**
+   * @brief Description of a named section of a flat file, i.e., a
+   * C-contiguous array of doubles of at most 4 dimensions.
+   */
+  struct FlatFileSection {
+    char name[64]; ///< The zero-terminated name of the section
+    uint64_t ndim; ///< The number of dimensions (0 for a scalar)
+    uint64_t shape[4]; ///< The extents of the array
+    uint64_t offset; ///< The position of the data from the start of the file
+  };
+}
+
+/**
+ * @brief A flat binary file, containing the parameters of a machine as a
+ * set of named sections, each of them being a C-contiguous array of doubles
+ * (stored with the byte order of the machine that wrote the file).
+ *
+ * The file starts with a header containing a magic string, the version of
+ * the format, a byte order mark, the machine type, the number of sections
+ * and the position of the section table. The data of each section is
+ * aligned on FlatFile::ALIGNMENT bytes, and the section table is stored at
+ * the end of the file.
+ *
+ * The file is mapped in memory (privately, i.e., copy-on-write), and the
+ * arrays returned by getArray() are views on the mapped data. Hence, the
+ * pages of a file opened by several processes are shared (until modified),
+ * and opening a file does not depend on its size. The views remain valid as
+ * long as the FlatFile object exists: machines loaded from a flat file
+ * should keep a (shared) pointer to it.
+ */
+class FlatFile: private boost::noncopyable {
+  public:
+    /**
+     * @brief The version of the format written by FlatFileWriter
+     */
+    static const uint32_t VERSION = 1;
+
+    /**
+     * @brief Alignment (in bytes) of the data of each section
+     */
+    static const uint64_t ALIGNMENT = 64;
+
+    /**
+     * @brief Maps the given file in memory
+     */
+    FlatFile(const std::string& filename);
+
+    /**
+     * @brief Unmaps the file. Views returned by getArray() are not valid
+     * anymore.
+     */
+    ~FlatFile();
+
+    /**
+     * @brief The name of the mapped file
+     */
+    const std::string& getFilename() const
+    { return m_filename; }
+
+    /**
+     * @brief The version of the format of the mapped file
+     */
+    uint32_t getVersion() const
+    { return m_version; }
+
+    /**
+     * @brief The type of the machine stored in this file (e.g. "GMMMachine")
+     */
+    const std::string& getType() const
+    { return m_type; }
+
+    /**
+     * @brief Checks that this file stores a machine of the given type, and
+     * throws otherwise
+     */
+    void checkType(const std::string& type) const;
+
+    /**
+     * @brief Tells if a section with the given name exists
+     */
+    bool contains(const std::string& name) const
+    { return m_sections.find(name) != m_sections.end(); }
+
+    /**
+     * @brief The names of the sections of this file
+     */
+    std::vector<std::string> getSectionNames() const;
+
+    /**
+     * @brief Returns a view on the data of the given section, which should
+     * have N dimensions.
+     *
+     * @warning The data is not copied: the view is only valid as long as
+     * this object exists.
+     */
+    template <int N> blitz::Array<double,N> getArray(const std::string& name) const {
+      const detail::FlatFileSection& s = section(name, N);
+      blitz::TinyVector<int,N> shape;
+      for (int i=0; i<N; ++i) shape(i) = (int)s.shape[i];
+      return blitz::Array<double,N>(reinterpret_cast<double*>(m_data + s.offset),
+        shape, blitz::neverDeleteData);
+    }
+
+    /**
+     * @brief Returns the value of the given scalar section
+     */
+    double get(const std::string& name) const {
+      const detail::FlatFileSection& s = section(name, 0);
+      return *reinterpret_cast<const double*>(m_data + s.offset);
+    }
+
+  private:
+    const detail::FlatFileSection& section(const std::string& name,
+      const uint64_t ndim) const;
+
+    std::string m_filename;
+    uint32_t m_version;
+    std::string m_type;
+    std::map<std::string, detail::FlatFileSection> m_sections;
+    char* m_data; ///< The mapped file
+    size_t m_size; ///< The size of the mapping
+};
+
+/**
+ * @brief Writes a flat binary file (see FlatFile). The data of each section
+ * is written as soon as it is set, and the section table when the writer is
+ * closed (or destroyed).
+ */
+class FlatFileWriter: private boost::noncopyable {
+  public:
+    /**
+     * @brief Creates (or truncates) the given file, to store a machine of
+     * the given type
+     */
+    FlatFileWriter(const std::string& filename, const std::string& type);
+
+    /**
+     * @brief Closes the file, if not already done
+     */
+    ~FlatFileWriter();
+
+    /**
+     * @brief Writes the given array as a new section
+     */
+    template <int N> void setArray(const std::string& name,
+      const blitz::Array<double,N>& array)
+    {
+      if (N > 4) {
+        boost::format m("cannot write section '%s' with %d dimensions to flat file '%s' (at most 4 are supported)");
+        m % name % N % m_filename;
+        throw std::runtime_error(m.str());
+      }
+      detail::FlatFileSection& s = newSection(name, N);
+      for (int i=0; i<N; ++i) s.shape[i] = array.extent(i);
+      if (bob::core::array::isCZeroBaseContiguous(array))
+        write(array.data(), array.numElements());
+      else {
+        const blitz::Array<double,N> tmp = bob::core::array::ccopy(array);
+        write(tmp.data(), tmp.numElements());
+      }
+    }
+
+    /**
+     * @brief Writes the given value as a new (scalar) section
+     */
+    void set(const std::string& name, const double value);
+
+    /**
+     * @brief Writes the section table and closes the file
+     */
+    void close();
+
+  private:
+    detail::FlatFileSection& newSection(const std::string& name,
+      const uint64_t ndim);
+    void write(const double* data, const size_t size);
+
+    std::string m_filename;
+    std::string m_type;
+    std::ofstream m_file;
+    std::vector<detail::FlatFileSection> m_sections;
+};
+
+/**
+ * @}
+ */
+}}
+
+#endif /* BOB_MACHINE_FLATFILE_H */
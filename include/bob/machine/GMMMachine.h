@@ -17,6 +17,7 @@
 #include <bob/machine/Gaussian.h>
 #include <bob/machine/GMMStats.h>
 #include <bob/io/HDF5File.h>
+#include <bob/machine/FlatFile.h>
 #include <iostream>
 #include <boost/shared_ptr.hpp>
 #include <vector>
@@ -304,6 +305,18 @@ class GMMMachine: public Machine<blitz::Array<double,1>, double>
      */
     void load(bob::io::HDF5File& config);
 
+    /**
+     * Save to a flat binary file, as a set of (C x D) matrices of means,
+     * variances and variance thresholds, and a vector of weights
+     */
+    void save(bob::machine::FlatFileWriter& config) const;
+
+    /**
+     * Load from a flat binary file. The parameters are copied into the
+     * Gaussians of this machine.
+     */
+    void load(const bob::machine::FlatFile& config);
+
     /**
      * Load/Reload mean/variance supervector in cache
      */
@@ -110,6 +110,44 @@ namespace bob{ namespace machine {
         const bob::machine::GaborJetSimilarity& jet_similarity_function
       ) const;
 
+      //! computes the similarities of a probe graph to each of the graphs of a gallery
+      void similarities(
+        const blitz::Array<double,3>& gallery_graph_jets,
+        const blitz::Array<double,2>& probe_graph_jets,
+        const bob::machine::GaborJetSimilarity& jet_similarity_function,
+        blitz::Array<double,1>& similarities,
+        const size_t n_threads = 0
+      ) const;
+
+      //! computes the similarities of a probe graph to each of the graphs of a gallery
+      void similarities(
+        const blitz::Array<double,4>& gallery_graph_jets,
+        const blitz::Array<double,3>& probe_graph_jets,
+        const bob::machine::GaborJetSimilarity& jet_similarity_function,
+        blitz::Array<double,1>& similarities,
+        const size_t n_threads = 0
+      ) const;
+
+      //! finds the graphs of a gallery that are the most similar to a probe graph
+      void search(
+        const blitz::Array<double,3>& gallery_graph_jets,
+        const blitz::Array<double,2>& probe_graph_jets,
+        const bob::machine::GaborJetSimilarity& jet_similarity_function,
+        blitz::Array<int,1>& indices,
+        blitz::Array<double,1>& similarities,
+        const size_t n_threads = 0
+      ) const;
+
+      //! finds the graphs of a gallery that are the most similar to a probe graph
+      void search(
+        const blitz::Array<double,4>& gallery_graph_jets,
+        const blitz::Array<double,3>& probe_graph_jets,
+        const bob::machine::GaborJetSimilarity& jet_similarity_function,
+        blitz::Array<int,1>& indices,
+        blitz::Array<double,1>& similarities,
+        const size_t n_threads = 0
+      ) const;
+
       //! saves this machine to file
       void save(bob::io::HDF5File& file) const;
 
@@ -50,6 +50,14 @@ namespace bob { namespace machine {
       //! returns the disparity vector estimated during the last call of similarity; only valid for disparity types
       blitz::TinyVector<double,2> disparity() const {return m_disparity;}
 
+      //! returns the type of this Gabor jet similarity function
+      SimilarityType type() const {return m_type;}
+
+      //! \brief The similarity between two Gabor jets given by their raw data, i.e., jet_length absolute values followed by jet_length phases (phases are not used by SCALAR_PRODUCT and CANBERRA).
+      //! The disparity-like similarity functions use the given buffers of size jet_length, and write the estimated disparity to the given vector.
+      //! This function does not modify this object, so that it can be called concurrently from several threads with different buffers.
+      double similarity_(const double* jet1, const double* jet2, const int jet_length, double* confidences, double* phase_differences, blitz::TinyVector<double,2>& disparity) const;
+
       //! \brief saves the parameters of this Gabor jet similarity to file
       void save(bob::io::HDF5File& file) const;
 
@@ -65,10 +73,10 @@ namespace bob { namespace machine {
 
       // initializes the internal memory to be used for disparity-like Gabor jet similarities
       void init();
-      // computes confidences from the given Gabor jets
-      void compute_confidences(const blitz::Array<double,2>& jet1, const blitz::Array<double,2>& jet2) const;
-      // computes the disparity using the m_confidences and m_phase_differences values
-      void compute_disparity() const;
+      // computes confidences and phase differences from the given Gabor jets
+      void compute_confidences(const double* jet1, const double* jet2, const int jet_length, double* confidences, double* phase_differences) const;
+      // computes the disparity using the given confidences and phase differences
+      void compute_disparity(const double* confidences, const double* phase_differences, blitz::TinyVector<double,2>& disparity) const;
 
       mutable blitz::TinyVector<double,2> m_disparity;
 
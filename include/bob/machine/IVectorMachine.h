@@ -14,6 +14,8 @@
 #include "GMMMachine.h"
 #include "GMMStats.h"
 #include <bob/io/HDF5File.h>
+#include <bob/machine/FlatFile.h>
+#include <boost/shared_ptr.hpp>
 
 namespace bob { namespace machine {
 /**
@@ -63,6 +65,12 @@ class IVectorMachine: public bob::machine::Machine<bob::machine::GMMStats, blitz
      */
     IVectorMachine(bob::io::HDF5File& config);
 
+    /**
+     * @brief Starts a new IVectorMachine from a (memory-mapped) flat file.
+     * @see load(const boost::shared_ptr<const bob::machine::FlatFile>)
+     */
+    IVectorMachine(const boost::shared_ptr<const bob::machine::FlatFile> config);
+
     /**
      * @brief Destructor
      */
@@ -100,6 +108,22 @@ class IVectorMachine: public bob::machine::Machine<bob::machine::GMMStats, blitz
      */
     void load(bob::io::HDF5File& config);
 
+    /**
+     * @brief Saves model to a flat binary file, including the cached
+     * products of \f$T\f$ and \f$\Sigma\f$ if a UBM is set.
+     */
+    void save(bob::machine::FlatFileWriter& config) const;
+
+    /**
+     * @brief Loads data from a (memory-mapped) flat file, without copying
+     * \f$T\f$, \f$\Sigma\f$ and the cached products: the machine uses
+     * views on the mapped file, and keeps a pointer to it. The pages of the
+     * file are hence shared by all the processes that load it. If the file
+     * does not contain the cached products (or if they do not match the
+     * current UBM), they are recomputed.
+     */
+    void load(const boost::shared_ptr<const bob::machine::FlatFile> config);
+
     /**
      * @brief Returns the UBM
      */
@@ -205,6 +229,13 @@ class IVectorMachine: public bob::machine::Machine<bob::machine::GMMStats, blitz
      */
     void precompute();
 
+    /**
+     * @brief Returns the cached \f$T_{c}^{T} \Sigma_{c}^{-1} T_{c}\f$ of each
+     * Gaussian component c (C x rt x rt), as updated by precompute()
+     */
+    const blitz::Array<double,3>& getTctSigmacInvTc() const
+    { return m_cache_Tct_sigmacInv_Tc; }
+
     /**
      * @brief Computes \f$(Id + \sum_{c=1}^{C} N_{i,j,c} T^{T} \Sigma_{c}^{-1} T)\f$
      * @warning No check is perform
@@ -269,6 +300,9 @@ class IVectorMachine: public bob::machine::Machine<bob::machine::GMMStats, blitz
     blitz::Array<double,3> m_cache_Tct_sigmacInv;
     blitz::Array<double,3> m_cache_Tct_sigmacInv_Tc;
 
+    ///< The flat file the parameters might be mapped from
+    boost::shared_ptr<const bob::machine::FlatFile> m_flat_file;
+
     mutable blitz::Array<double,1> m_tmp_d;
     mutable blitz::Array<double,1> m_tmp_t1;
     mutable blitz::Array<double,1> m_tmp_t2;
@@ -19,6 +19,7 @@
 
 #include <bob/io/HDF5File.h>
 #include <boost/shared_ptr.hpp>
+#include <vector>
 
 namespace bob { namespace machine {
 /**
@@ -229,6 +230,20 @@ class FABase
      */
     void estimateX(const bob::machine::GMMStats& gmm_stats, blitz::Array<double,1>& x) const;
 
+    /**
+     * @brief Estimates the session offsets Ux of several GMM statistics,
+     * considering the LPT assumption. The products
+     * U_{c}^T.Sigma_{c}^-1.U_{c} are computed once for all the statistics,
+     * which are then processed by blocks in parallel.
+     *
+     * @param gmm_stats The GMM statistics of each session
+     * @param Ux The session offsets, one per row (size: #sessions x CD)
+     * @param n_threads The number of threads to use (0 for the number of
+     *   hardware threads)
+     */
+    void estimateUx(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& gmm_stats,
+      blitz::Array<double,2>& Ux, const size_t n_threads=0) const;
+
     /**
      * @brief Compute and put U^{T}.Sigma^{-1} matrix in cache
      * @warning Should only be used by the trainer for efficiency reason,
@@ -500,6 +515,14 @@ class JFABase
     void estimateX(const bob::machine::GMMStats& gmm_stats, blitz::Array<double,1>& x) const
     { m_base.estimateX(gmm_stats, x); }
 
+    /**
+     * @brief Estimates the session offsets Ux of several GMM statistics
+     * (one per row of Ux), considering the LPT assumption
+     */
+    void estimateUx(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& gmm_stats,
+      blitz::Array<double,2>& Ux, const size_t n_threads=0) const
+    { m_base.estimateUx(gmm_stats, Ux, n_threads); }
+
     /**
      * @brief Precompute (put U^{T}.Sigma^{-1} matrix in cache)
      * @warning Should only be used by the trainer for efficiency reason,
@@ -701,6 +724,14 @@ class ISVBase
     void estimateX(const bob::machine::GMMStats& gmm_stats, blitz::Array<double,1>& x) const
     { m_base.estimateX(gmm_stats, x); }
 
+    /**
+     * @brief Estimates the session offsets Ux of several GMM statistics
+     * (one per row of Ux), considering the LPT assumption
+     */
+    void estimateUx(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& gmm_stats,
+      blitz::Array<double,2>& Ux, const size_t n_threads=0) const
+    { m_base.estimateUx(gmm_stats, Ux, n_threads); }
+
     /**
      * @brief Precompute (put U^{T}.Sigma^{-1} matrix in cache)
      * @warning Should only be used by the trainer for efficiency reason,
@@ -869,6 +900,12 @@ class JFAMachine: public Machine<bob::machine::GMMStats, double>
      */
     void setZ(const blitz::Array<double,1>& z);
 
+    /**
+     * @brief Returns the mean supervector of the client model m + Vy + Dz
+     */
+    const blitz::Array<double,1>& getMeanSupervector() const
+    { return m_cache_mVyDz; }
+
     /**
      * @brief Returns the JFABase
      */
@@ -1072,6 +1109,12 @@ class ISVMachine: public Machine<bob::machine::GMMStats, double>
      */
     void setZ(const blitz::Array<double,1>& z);
 
+    /**
+     * @brief Returns the mean supervector of the client model m + Dz
+     */
+    const blitz::Array<double,1>& getMeanSupervector() const
+    { return m_cache_mDz; }
+
     /**
      * @brief Returns the ISVBase
      */
@@ -1151,6 +1194,44 @@ class ISVMachine: public Machine<bob::machine::GMMStats, double>
 };
 
 
+/**
+ * @brief Computes the scores of several JFA client models against several
+ * probes. The session offset Ux of each probe is estimated once, and shared
+ * by all the models. The scores are then computed by linear scoring (with
+ * frame-length normalisation), the probes being processed by batches.
+ *
+ * @warning All the models should share the same JFABase.
+ *
+ * @param models The client models
+ * @param probes The GMM statistics of each probe
+ * @param[out] scores The scores, <tt>scores[m, p]</tt> being the score of
+ *   model @c m against probe @c p (size: #models x #probes)
+ * @param n_threads The number of threads to use (0 for the number of
+ *   hardware threads)
+ */
+void jfaScoring(const std::vector<boost::shared_ptr<const bob::machine::JFAMachine> >& models,
+  const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads=0);
+
+/**
+ * @brief Computes the scores of several ISV client models against several
+ * probes. The session offset Ux of each probe is estimated once, and shared
+ * by all the models. The scores are then computed by linear scoring (with
+ * frame-length normalisation), the probes being processed by batches.
+ *
+ * @warning All the models should share the same ISVBase.
+ *
+ * @param models The client models
+ * @param probes The GMM statistics of each probe
+ * @param[out] scores The scores, <tt>scores[m, p]</tt> being the score of
+ *   model @c m against probe @c p (size: #models x #probes)
+ * @param n_threads The number of threads to use (0 for the number of
+ *   hardware threads)
+ */
+void isvScoring(const std::vector<boost::shared_ptr<const bob::machine::ISVMachine> >& models,
+  const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads=0);
+
 /**
  * @}
  */
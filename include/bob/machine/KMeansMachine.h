@@ -159,6 +159,51 @@ class KMeansMachine: public Machine<blitz::Array<double,1>, double> {
     void getClosestMean(const blitz::Array<double,1>& x, 
       size_t &closest_mean, double &min_distance) const;
     
+    /**
+     * Calculate, for each data sample (row) of X, the index of the closest
+     * mean and its (Square Euclidean) distance from the sample.
+     * The distances are computed on blocks of samples, using the expansion
+     * |x-m|^2 = |x|^2 - 2 x.m + |m|^2, so that a single matrix product is
+     * required per block. Blocks are processed by n_threads threads (0 means
+     * as many threads as hardware threads).
+     * @param X The data samples (one per row)
+     * @param closest_means (output) The index of the closest mean of each sample
+     * @param min_distances (output) The distance of each sample from its closest mean
+     * @param n_threads The number of threads to use
+     */
+    void getClosestMeans(const blitz::Array<double,2>& X,
+      blitz::Array<size_t,1>& closest_means,
+      blitz::Array<double,1>& min_distances, const size_t n_threads=0) const;
+
+    /**
+     * Same as above, but also outputs, for each sample, a lower bound of the
+     * (non-squared) Euclidean distance between the sample and all the means
+     * but the closest one. This initializes the pruning of
+     * updateClosestMeans().
+     */
+    void getClosestMeans(const blitz::Array<double,2>& X,
+      blitz::Array<size_t,1>& closest_means,
+      blitz::Array<double,1>& min_distances,
+      blitz::Array<double,1>& lower_bounds, const size_t n_threads=0) const;
+
+    /**
+     * Update the closest means of the data samples of X, after the means
+     * moved from previous_means to their current values. The closest_means
+     * and lower_bounds arrays should contain the outputs of the previous
+     * call to getClosestMeans() or updateClosestMeans() for the same
+     * samples, when the means were previous_means.
+     * Samples for which the closest mean provably did not change are pruned
+     * using the triangle inequality bounds of Hamerly ("Making k-means even
+     * faster", 2010): only the distance to their closest mean is computed.
+     * The results are the same as the ones of getClosestMeans(), but the
+     * computational cost quickly decreases as the means converge.
+     */
+    void updateClosestMeans(const blitz::Array<double,2>& X,
+      const blitz::Array<double,2>& previous_means,
+      blitz::Array<size_t,1>& closest_means,
+      blitz::Array<double,1>& min_distances,
+      blitz::Array<double,1>& lower_bounds, const size_t n_threads=0) const;
+
     /**
      * Output the minimum (Square Euclidean) distance between the input and 
      * one of the means
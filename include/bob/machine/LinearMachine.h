@@ -124,6 +124,41 @@ namespace bob { namespace machine {
       void forward (const blitz::Array<double,1>& input,
           blitz::Array<double,1>& output) const;
 
+      /**
+       * Forwards a set of input vectors (one per row) through the network,
+       * and outputs the projected vectors (one per row). The input
+       * subtraction and division factors are folded into the weights and
+       * biases, so that all the vectors are projected at once, by a single
+       * matrix product, followed by the activation function.
+       *
+       * The input and output are NOT checked for compatibility each time. It
+       * is your responsibility to do it.
+       */
+      void forward_ (const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& output) const;
+
+      /**
+       * Forwards a set of input vectors (one per row) through the network,
+       * and outputs the projected vectors (one per row).
+       *
+       * The input and output are checked for compatibility each time the
+       * forward method is applied.
+       */
+      void forward (const blitz::Array<double,2>& input,
+          blitz::Array<double,2>& output) const;
+
+      /**
+       * Forwards a set of input vectors (one per row) through the network,
+       * and outputs the projected vectors (one per row) in single precision.
+       * Computations are carried out in double precision, by blocks of
+       * vectors.
+       *
+       * The input and output are checked for compatibility each time the
+       * forward method is applied.
+       */
+      void forward (const blitz::Array<double,2>& input,
+          blitz::Array<float,2>& output) const;
+
       /**
        * Resizes the machine. If either the input or output increases in size,
        * the weights and other factors should be considered uninitialized. If
@@ -167,12 +202,13 @@ namespace bob { namespace machine {
        * efficiency reasons.
        */
       inline blitz::Array<double, 1>& updateInputSubtraction()  
-      { return m_input_sub; }
+      { m_cache_valid = false; return m_input_sub; }
 
       /**
        * Sets all input subtraction values to a specific value.
        */
-      inline void setInputSubtraction(double v) { m_input_sub = v; }
+      inline void setInputSubtraction(double v)
+      { m_input_sub = v; updateCache(); }
 
       /**
        * Returns the input division factor
@@ -193,13 +229,14 @@ namespace bob { namespace machine {
        * efficiency reasons.
        */
       inline blitz::Array<double, 1>& updateInputDivision()  
-      { return m_input_div; }
+      { m_cache_valid = false; return m_input_div; }
 
 
       /**
        * Sets all input division values to a specific value.
        */
-      inline void setInputDivision(double v) { m_input_div = v; }
+      inline void setInputDivision(double v)
+      { m_input_div = v; updateCache(); }
 
       /**
        * Returns the current weight representation. Each column should be
@@ -224,12 +261,12 @@ namespace bob { namespace machine {
        * efficiency reasons.
        */
       inline blitz::Array<double, 2>& updateWeights()  
-      { return m_weight; }
+      { m_cache_valid = false; return m_weight; }
 
       /**
        * Sets all weights to a single specific value.
        */
-      inline void setWeights(double v) { m_weight = v; }
+      inline void setWeights(double v) { m_weight = v; updateCache(); }
 
       /**
        * Returns the biases of this classifier.
@@ -247,7 +284,7 @@ namespace bob { namespace machine {
       /**
        * Sets all output bias values to a specific value.
        */
-      inline void setBiases(double v) { m_bias = v; }
+      inline void setBiases(double v) { m_bias = v; updateCache(); }
 
       /**
        * Returns the currently set activation function
@@ -261,6 +298,19 @@ namespace bob { namespace machine {
 
     private: //representation
 
+      /**
+       * Folds the input subtraction and division factors into the weights
+       * and biases used by the 2D forward methods.
+       */
+      void updateCache();
+
+      /**
+       * Computes the folded weights and biases
+       */
+      void foldWeights(blitz::Array<double,2>& weight,
+          blitz::Array<double,1>& bias) const;
+
+
       typedef double (*actfun_t)(double); ///< activation function type
 
       blitz::Array<double, 1> m_input_sub; ///< input subtraction
@@ -270,6 +320,9 @@ namespace bob { namespace machine {
       boost::shared_ptr<Activation> m_activation; ///< currently set activation type
 
       mutable blitz::Array<double, 1> m_buffer; ///< a buffer for speed
+      blitz::Array<double, 2> m_cache_weight; ///< weights divided by input_div
+      blitz::Array<double, 1> m_cache_bias; ///< biases minus projected input_sub
+      bool m_cache_valid; ///< false if the parameters were updated in place
   
   };
 
@@ -19,6 +19,86 @@ namespace bob { namespace machine {
  * @{
  */
 
+/**
+ * @brief Linear scoring of many test statistics against a fixed set of
+ * client models.
+ *
+ * The model-side matrix A, whose rows are (m - ubm_mean) / ubm_variance, is
+ * computed once at construction time, and reused by each call to score().
+ * The score matrix is then computed by tiles of (models x test statistics),
+ * which are processed in parallel. The test-side supervectors
+ * sumPx - n * (ubm_mean + channel_offset) are only built for one tile and
+ * one block of the supervector at a time, so that the memory required
+ * besides A and the scores does not depend on the number of test
+ * statistics.
+ */
+class LinearScorer {
+  public:
+    /**
+     * @brief Constructor from the mean supervectors of the client models
+     * and the mean and variance supervectors of the world model.
+     */
+    LinearScorer(const std::vector<blitz::Array<double,1> >& models,
+      const blitz::Array<double,1>& ubm_mean,
+      const blitz::Array<double,1>& ubm_variance);
+
+    /**
+     * @brief Constructor from the client models and the world model
+     */
+    LinearScorer(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+      const bob::machine::GMMMachine& ubm);
+
+    /**
+     * @brief Returns the number of client models
+     */
+    size_t getNModels() const { return m_n_models; }
+
+    /**
+     * @brief Returns the length of the supervectors
+     */
+    size_t getSupervectorLength() const { return m_ubm_mean.extent(0); }
+
+    /**
+     * @brief Computes the scores of all the client models against the given
+     * test statistics.
+     *
+     * @param test_stats    list of accumulate statistics for each test trial
+     * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
+     * @param[out] scores   2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+     * @param n_threads     number of threads to use (0 for the number of hardware threads)
+     * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
+     */
+    void score(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+      const bool frame_length_normalisation, blitz::Array<double,2>& scores,
+      const size_t n_threads=0) const;
+
+    /**
+     * @brief Computes the scores of all the client models against the given
+     * test statistics, taking the channel offset of each test trial
+     * (for JFA/ISV for instance) into account.
+     */
+    void score(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+      const std::vector<blitz::Array<double,1> >& test_channelOffset,
+      const bool frame_length_normalisation, blitz::Array<double,2>& scores,
+      const size_t n_threads=0) const;
+
+  private:
+    void resize(const size_t n_models, const blitz::Array<double,1>& ubm_mean,
+      const blitz::Array<double,1>& ubm_variance);
+    void setModel(const size_t m, const blitz::Array<double,1>& model,
+      const blitz::Array<double,1>& ubm_variance);
+    void score_(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+      const std::vector<blitz::Array<double,1> >* test_channelOffset,
+      const bool frame_length_normalisation, blitz::Array<double,2>& scores,
+      const size_t n_threads) const;
+
+    size_t m_n_models;
+    blitz::Array<double,1> m_ubm_mean;
+    /// Columns of A, by blocks of the supervector: m_A[b] is the C-contiguous
+    /// (n_models x block length) matrix of the b-th block of the supervector.
+    std::vector<blitz::Array<double,2> > m_A;
+};
+
 /**
  * Compute a matrix of scores using linear scoring.
  *
@@ -31,19 +111,21 @@ namespace bob { namespace machine {
  * @param test_channelOffset  list of channel offset if any (for JFA/ISA for instance)
  * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
  * @param[out] scores 2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+ * @param n_threads     number of threads to use (0 for the number of hardware threads)
  * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
+ * @see LinearScorer, to reuse the model-side computations across several calls
  */
 void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double, 1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double,2>& scores);
+                   blitz::Array<double,2>& scores, const size_t n_threads=0);
 void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double,2>& scores);
+                   blitz::Array<double,2>& scores, const size_t n_threads=0);
 
 /**
  * Compute a matrix of scores using linear scoring.
@@ -55,13 +137,15 @@ void linearScoring(const std::vector<blitz::Array<double,1> >& models,
  * @param test_stats  list of accumulate statistics for each test trial
  * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
  * @param[out] scores 2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+ * @param n_threads     number of threads to use (0 for the number of hardware threads)
  * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
+ * @see LinearScorer, to reuse the model-side computations across several calls
  */
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
                    const bob::machine::GMMMachine& ubm,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double,2>& scores);
+                   blitz::Array<double,2>& scores, const size_t n_threads=0);
 /**
  * Compute a matrix of scores using linear scoring.
  *
@@ -73,14 +157,16 @@ void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMa
  * @param test_channelOffset  list of channel offset if any (for JFA/ISA for instance)
  * @param frame_length_normalisation   perform a normalisation by the number of feature vectors
  * @param[out] scores 2D matrix of scores, <tt>scores[m, s]</tt> is the score for model @c m against statistics @c s
+ * @param n_threads     number of threads to use (0 for the number of hardware threads)
  * @warning the output scores matrix should have the correct size (number of models x number of test_stats)
+ * @see LinearScorer, to reuse the model-side computations across several calls
  */
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
                    const bob::machine::GMMMachine& ubm,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double, 1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double,2>& scores);
+                   blitz::Array<double,2>& scores, const size_t n_threads=0);
 
 /**
  * Compute a score using linear scoring.
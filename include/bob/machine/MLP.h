@@ -159,7 +159,9 @@ namespace bob { namespace machine {
        * Forwards data through the network, outputs the values of each output
        * neuron. This variant will take a number of inputs in one single input
        * matrix with inputs arranged row-wise (i.e., every row contains an
-       * individual input).
+       * individual input). Each layer is computed for all the inputs at
+       * once, with a single matrix product (in which the biases are fused)
+       * followed by the activation of the whole layer output.
        *
        * The input and output are NOT checked for compatibility each time. It
        * is your responsibility to do it.
@@ -15,7 +15,10 @@
 #include "Machine.h"
 #include <blitz/array.h>
 #include <bob/io/HDF5File.h>
+#include <bob/machine/FlatFile.h>
+#include <boost/shared_ptr.hpp>
 #include <map>
+#include <vector>
 #include <iostream>
 #include <stdexcept>
 
@@ -69,6 +72,11 @@ class PLDABase
      * @param config HDF5 configuration file
      */
     PLDABase(bob::io::HDF5File& config);
+    /**
+     * @brief Starts a new PLDABase from a (memory-mapped) flat file.
+     * @param config The flat file
+     */
+    PLDABase(const boost::shared_ptr<const bob::machine::FlatFile> config);
 
     /**
      * @brief Just to virtualize the destructor
@@ -107,6 +115,20 @@ class PLDABase
      * @param config HDF5 configuration file
      */
     void save(bob::io::HDF5File& config) const;
+    /**
+     * @brief Loads data from a (memory-mapped) flat file. The matrices
+     * (including the precomputed ones) are not copied: the machine uses
+     * views on the mapped file, and keeps a pointer to it, so that the
+     * pages of the file are shared by all the processes that load it.
+     * @param config The flat file
+     */
+    void load(const boost::shared_ptr<const bob::machine::FlatFile> config);
+    /**
+     * @brief Saves an existing machine to a flat binary file, including
+     * the precomputed members.
+     * @param config The flat file writer
+     */
+    void save(bob::machine::FlatFileWriter& config) const;
 
     /** 
      * @brief Resizes the PLDABase. 
@@ -401,6 +423,9 @@ class PLDABase
      */
     std::map<size_t, double> m_cache_loglike_constterm;
 
+    /// The flat file the parameters might be mapped from
+    boost::shared_ptr<const bob::machine::FlatFile> m_flat_file;
+
     // working arrays
     mutable blitz::Array<double,1> m_tmp_d_1; ///< Cache vector of size dim_d
     mutable blitz::Array<double,1> m_tmp_d_2; ///< Cache vector of size dim_d
@@ -703,6 +728,31 @@ class PLDAMachine: public Machine<blitz::Array<double,1>, double>
     void resizeTmp();
 };
 
+/**
+ * @brief Computes the log likelihood ratio scores of many probes (one
+ * sample each) against many enrolled PLDAMachine's.\n
+ * For a single probe sample \f$x\f$, the score against a model enrolled
+ * with \f$n\f$ samples is a quadratic form of
+ * \f$u = F^T \beta (x - \mu)\f$:\n
+ * \f$s = c_{m} + w_{m}^T \gamma_{n+1} u + \frac{1}{2} u^T (\gamma_{n+1} - \gamma_{1}) u\f$\n
+ * where \f$w_{m}\f$ is the weighted sum of the model. The whole score
+ * matrix is hence obtained with two matrix-matrix products and rank-1 terms,
+ * computed by several threads over blocks of probes.\n
+ * The caches of the machines and of the PLDABase are only read: missing
+ * \f$\gamma_a\f$ matrices are computed locally.
+ *
+ * @param machines The enrolled models, which should all share the same
+ *   PLDABase
+ * @param probes The probe samples, one per row (size P x dim_d)
+ * @param scores The output scores, <tt>scores[p,m]</tt> is the score of
+ *   probe @c p against model @c m (size P x M)
+ * @param n_threads The number of threads to use (0 means the number of
+ *   hardware threads)
+ */
+void pldaScoring(const std::vector<boost::shared_ptr<const PLDAMachine> >& machines,
+  const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+  const size_t n_threads=0);
+
 /**
  * @}
  */
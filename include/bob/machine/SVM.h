@@ -338,6 +338,68 @@ namespace bob { namespace machine {
         (const blitz::Array<double,1>& input,
          blitz::Array<double,1>& probabilities) const;
 
+      /**
+       * Predicts the classes of several inputs at once. The inputs are
+       * arranged row-wise and should have **at least** inputSize() columns.
+       * The output array "labels" should have as many entries as the number
+       * of input rows. The rows are processed by n_threads threads (0 means
+       * as many threads as hardware threads are available).
+       *
+       * For LINEAR kernels, the support vectors of each decision function are
+       * collapsed into a single weight vector when the model is loaded. The
+       * decision values are then obtained with a single matrix product,
+       * instead of one kernel evaluation per support vector. The results are
+       * hence only identical to the ones of predictClass() up to rounding
+       * errors.
+       */
+      void predictClass(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, const size_t n_threads=0) const;
+
+      /**
+       * Predicts the classes of several inputs at once. Same as above, but
+       * does not check the input and output arrays.
+       */
+      void predictClass_(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, const size_t n_threads=0) const;
+
+      /**
+       * Predicts the classes and scores of several inputs at once. The output
+       * array "scores" has one row per input, with the same layout as for
+       * the single input variant of predictClassAndScores(). See
+       * predictClass() for the processing of the inputs.
+       */
+      void predictClassAndScores(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>& scores,
+          const size_t n_threads=0) const;
+
+      /**
+       * Predicts the classes and scores of several inputs at once. Same as
+       * above, but does not check the input and output arrays.
+       */
+      void predictClassAndScores_(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>& scores,
+          const size_t n_threads=0) const;
+
+      /**
+       * Predicts the classes and probabilities of several inputs at once, but
+       * only if the model supports it. Otherwise, throws a run-time
+       * exception. The output array "probabilities" should have one row per
+       * input and numberOfClasses() columns. The rows are processed by
+       * n_threads threads (0 means as many threads as hardware threads are
+       * available).
+       */
+      void predictClassAndProbabilities(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>& probabilities,
+          const size_t n_threads=0) const;
+
+      /**
+       * Predicts the classes and probabilities of several inputs at once.
+       * Same as above, but does not check the input and output arrays.
+       */
+      void predictClassAndProbabilities_(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>& probabilities,
+          const size_t n_threads=0) const;
+
       /**
        * Saves the current model state to a file. With this variant, the model
        * is saved on simpler libsvm model file that does not include the
@@ -365,13 +427,23 @@ namespace bob { namespace machine {
        */
       void reset();
 
+      /**
+       * Predictions for several inputs at once, common to all the 2D
+       * variants. The "outputs" array, if not null, is filled with the
+       * probabilities if "probabilities" is set, with the scores otherwise.
+       */
+      void predictMany_(const blitz::Array<double,2>& input,
+          blitz::Array<int,1>& labels, blitz::Array<double,2>* outputs,
+          const bool probabilities, const size_t n_threads) const;
+
     private: //representation
 
       boost::shared_ptr<svm_model> m_model; ///< libsvm model pointer
-      mutable boost::shared_array<svm_node> m_input_cache; ///< cache
       size_t m_input_size; ///< vector size expected as input for the SVM's
       blitz::Array<double,1> m_input_sub; ///< scaling: subtraction
       blitz::Array<double,1> m_input_div; ///< scaling: division
+      blitz::Array<double,2> m_linear_weight; ///< LINEAR kernels: one weight vector per decision function (empty otherwise)
+      blitz::Array<double,1> m_linear_bias; ///< LINEAR kernels: minus rho of each decision function
 
   };
 
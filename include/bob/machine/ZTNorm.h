@@ -11,6 +11,8 @@
 #define BOB_MACHINE_ZTNORM_H
 
 #include <blitz/array.h>
+#include <string>
+#include <bob/io/HDF5File.h>
 
 namespace bob { namespace machine {
 /**
@@ -18,6 +20,144 @@ namespace bob { namespace machine {
  * @{
  */
 
+/**
+ * @brief ZT-Norm engine based on sufficient statistics.
+ *
+ * The Z-Norm statistics (mean and standard deviation of the scores of each
+ * model against the Z-Norm probes) and the T-Norm statistics (mean and
+ * standard deviation of the Z-normalised scores of each probe against the
+ * T-Norm models) are computed once, from blocks of raw scores which are
+ * appended one after the other, and cached. The raw scores of the probes
+ * against the models are then normalised by tiles, each tile being
+ * processed in parallel, without any temporary of the size of the score
+ * matrix. This allows to normalise score matrices which do not fit in
+ * memory, reading them from and writing them to HDF5 files.
+ *
+ * If no Z-Norm (resp. T-Norm) statistics are appended, Z-Norm (resp.
+ * T-Norm) is not applied.
+ */
+class ZTNorm {
+  public:
+    /**
+     * @brief Constructor, without any statistics
+     */
+    ZTNorm();
+
+    /**
+     * @brief Removes all the statistics
+     */
+    void reset();
+
+    /**
+     * @brief Computes and appends the Z-Norm statistics of a block of
+     * models.
+     *
+     * @param rawscores_zprobes_vs_models  raw scores of the next models
+     *   (rows) against all the Z-Norm probes (columns)
+     * @param n_threads  number of threads to use (0 for the number of
+     *   hardware threads)
+     */
+    void appendZStatistics(const blitz::Array<double,2>& rawscores_zprobes_vs_models,
+      const size_t n_threads=0);
+
+    /**
+     * @brief Computes the statistics of the T-Norm models against the
+     * Z-Norm probes, which are used to Z-normalise the T-Norm scores.
+     * If this method is not called, the T-Norm scores are not Z-normalised
+     * (plain T-Norm). This clears the T-Norm statistics computed so far.
+     *
+     * @param rawscores_zprobes_vs_tmodels  raw scores of the T-Norm models
+     *   (rows) against the Z-Norm probes (columns)
+     * @param mask_zprobes_vs_tmodels_istruetrial  true for the pairs of
+     *   T-Norm model and Z-Norm probe of the same identity, which are
+     *   excluded from the statistics
+     * @param n_threads  number of threads to use (0 for the number of
+     *   hardware threads)
+     */
+    void setTModelsStatistics(const blitz::Array<double,2>& rawscores_zprobes_vs_tmodels,
+      const blitz::Array<bool,2>& mask_zprobes_vs_tmodels_istruetrial,
+      const size_t n_threads=0);
+    void setTModelsStatistics(const blitz::Array<double,2>& rawscores_zprobes_vs_tmodels,
+      const size_t n_threads=0);
+
+    /**
+     * @brief Computes and appends the T-Norm statistics of a block of
+     * probes.
+     *
+     * @param rawscores_probes_vs_tmodels  raw scores of all the T-Norm
+     *   models (rows) against the next probes (columns)
+     * @param n_threads  number of threads to use (0 for the number of
+     *   hardware threads)
+     */
+    void appendTStatistics(const blitz::Array<double,2>& rawscores_probes_vs_tmodels,
+      const size_t n_threads=0);
+
+    /**
+     * @brief Returns the Z-Norm means/standard deviations of each model
+     * (standard deviations close to zero are replaced by 1)
+     */
+    const blitz::Array<double,1>& getZMeans() const { return m_z_mean; }
+    const blitz::Array<double,1>& getZStds() const { return m_z_std; }
+
+    /**
+     * @brief Returns the T-Norm means/standard deviations of each probe
+     * (standard deviations close to zero are replaced by 1)
+     */
+    const blitz::Array<double,1>& getTMeans() const { return m_t_mean; }
+    const blitz::Array<double,1>& getTStds() const { return m_t_std; }
+
+    /**
+     * @brief Normalises a tile of the raw scores of the probes against the
+     * models.
+     *
+     * @param rawscores_probes_vs_models  raw scores of a tile
+     * @param[out] normalizedscores  normalised scores, which should have the
+     *   same size as the tile (and may be the same array)
+     * @param first_model  index of the first model (row) of the tile
+     * @param first_probe  index of the first probe (column) of the tile
+     * @param n_threads  number of threads to use (0 for the number of
+     *   hardware threads)
+     * @exception std::runtime_error the tile is out of the range of the
+     *   available statistics
+     */
+    void normalize(const blitz::Array<double,2>& rawscores_probes_vs_models,
+      blitz::Array<double,2>& normalizedscores, const size_t first_model=0,
+      const size_t first_probe=0, const size_t n_threads=0) const;
+
+    /**
+     * @brief Normalises the raw scores of the probes against the models
+     * stored in an HDF5 file, and appends the normalised scores to another
+     * HDF5 dataset. The scores are read, normalised and written by blocks
+     * of models.
+     *
+     * @param rawscores_file  file containing the raw scores
+     * @param rawscores_path  dataset of the raw scores, which is either a
+     *   2D array, or a list of 1D arrays (one per model)
+     * @param normalized_file  file to write the normalised scores into
+     * @param normalized_path  dataset to which the normalised scores of
+     *   each model are appended
+     * @param block_size  number of models which are processed at once
+     * @param n_threads  number of threads to use (0 for the number of
+     *   hardware threads)
+     */
+    void normalize(bob::io::HDF5File& rawscores_file,
+      const std::string& rawscores_path, bob::io::HDF5File& normalized_file,
+      const std::string& normalized_path, const size_t block_size=256,
+      const size_t n_threads=0) const;
+
+  private:
+    void setTModelsStatistics_(const blitz::Array<double,2>& rawscores_zprobes_vs_tmodels,
+      const blitz::Array<bool,2>* mask_zprobes_vs_tmodels_istruetrial,
+      const size_t n_threads);
+
+    blitz::Array<double,1> m_z_mean;
+    blitz::Array<double,1> m_z_std;
+    blitz::Array<double,1> m_tmodels_mean;
+    blitz::Array<double,1> m_tmodels_std;
+    blitz::Array<double,1> m_t_mean;
+    blitz::Array<double,1> m_t_std;
+};
+
 /**
  * Normalise raw scores with ZT-Norm
  *
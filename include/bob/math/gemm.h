@@ -0,0 +1,73 @@
+/**
+ * @file bob/math/gemm.h
+ * @date Mon Oct 19 02:16:10 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief This file defines matrix-matrix and matrix-vector products of
+ * double precision blitz arrays, which rely on the BLAS library.
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#ifndef BOB_MATH_GEMM_H
+#define BOB_MATH_GEMM_H
+
+#include <blitz/array.h>
+
+namespace bob { namespace math {
+/**
+ * @ingroup MATH
+ * @{
+ */
+
+/**
+ * @brief Performs the matrix multiplication C = alpha*op(A)*op(B) + beta*C
+ * using the BLAS dgemm function, op(X) being X or its transpose X^T.
+ * Contrary to prod(), this function is meant for large matrices.
+ *
+ * Arrays which are (transposed) row slices of C-contiguous arrays are
+ * directly passed to BLAS, others are copied first.
+ *
+ * @warning C should not overlap with A or B.
+ *
+ * @param A The A matrix (size MxK, or KxM if transA is set)
+ * @param B The B matrix (size KxN, or NxK if transB is set)
+ * @param C The resulting matrix (size MxN)
+ * @param transA Whether A should be transposed
+ * @param transB Whether B should be transposed
+ * @param alpha The scaling factor of the product
+ * @param beta The scaling factor of the initial content of C
+ */
+void gemm(const blitz::Array<double,2>& A, const blitz::Array<double,2>& B,
+  blitz::Array<double,2>& C, const bool transA=false, const bool transB=false,
+  const double alpha=1., const double beta=0.);
+void gemm_(const blitz::Array<double,2>& A, const blitz::Array<double,2>& B,
+  blitz::Array<double,2>& C, const bool transA=false, const bool transB=false,
+  const double alpha=1., const double beta=0.);
+
+/**
+ * @brief Performs the matrix-vector multiplication y = alpha*op(A)*x +
+ * beta*y using the BLAS dgemv function, op(A) being A or its transpose A^T.
+ *
+ * @warning y should not overlap with A or x.
+ *
+ * @param A The A matrix (size MxN, or NxM if transA is set)
+ * @param x The x vector (size N)
+ * @param y The resulting vector (size M)
+ * @param transA Whether A should be transposed
+ * @param alpha The scaling factor of the product
+ * @param beta The scaling factor of the initial content of y
+ */
+void gemv(const blitz::Array<double,2>& A, const blitz::Array<double,1>& x,
+  blitz::Array<double,1>& y, const bool transA=false, const double alpha=1.,
+  const double beta=0.);
+void gemv_(const blitz::Array<double,2>& A, const blitz::Array<double,1>& x,
+  blitz::Array<double,1>& y, const bool transA=false, const double alpha=1.,
+  const double beta=0.);
+
+/**
+ * @}
+ */
+}}
+
+#endif /* BOB_MATH_GEMM_H */
@@ -32,11 +32,26 @@ namespace bob { namespace trainer {
    *   T. Minka, Unpublished draft, 2003 (revision in 2007),
    *   http://research.microsoft.com/en-us/um/people/minka/papers/logreg/
    *   2/ FoCal, http://www.dsp.sun.ac.za/~nbrummer/focal/
+   *
+   * The training samples are normalized on the fly, without any copy of the
+   * training set, and the gradient and curvature of the objective are
+   * computed by several threads on fixed blocks of samples, such that the
+   * results do not depend on the number of threads. Instead of the
+   * conjugate gradient, the L-BFGS algorithm can be used as well.
    */
   class CGLogRegTrainer
   {
     public: //api
 
+      /**
+       * The optimization algorithms which can be used for the training
+       */
+      typedef enum {
+        CONJUGATE_GRADIENT=0, ///< conjugate gradient, as in FoCal
+        LBFGS ///< limited memory BFGS (using libLBFGS)
+      }
+      Solver;
+
       /**
        * Default constructor.
        * @param prior The synthetic prior. It should be in the range ]0.,1.[
@@ -87,6 +102,8 @@ namespace bob { namespace trainer {
       size_t getMaxIterations() const { return m_max_iterations; }
       double getLambda() const { return m_lambda; }
       bool getNorm() const { return m_mean_std_norm; }
+      Solver getSolver() const { return m_solver; }
+      size_t getNThreads() const { return m_n_threads; }
 
       /**
        * Setters
@@ -106,6 +123,18 @@ namespace bob { namespace trainer {
       void setLambda(const double lambda)
       { m_lambda = lambda; }
       void setNorm(const bool mean_std_norm) { m_mean_std_norm = mean_std_norm; }
+      /**
+       * Sets the optimization algorithm. With L-BFGS, the convergence
+       * threshold is the one of the norm of the gradient of the (average)
+       * objective, relative to the norm of the weights.
+       */
+      void setSolver(const Solver solver) { m_solver = solver; }
+      /**
+       * Sets the number of threads used to compute the gradient and the
+       * curvature of the objective (0 means as many threads as hardware
+       * threads)
+       */
+      void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
 
       /**
        * Trains the LinearMachine to perform Linear Logistic Regression
@@ -120,6 +149,8 @@ namespace bob { namespace trainer {
       size_t m_max_iterations;
       double m_lambda;
       bool m_mean_std_norm;
+      Solver m_solver;
+      size_t m_n_threads;
   };
 
   /**
@@ -16,6 +16,7 @@
 #include <blitz/array.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/random.hpp>
+#include <boost/cstdint.hpp>
 
 namespace bob { namespace trainer {
   /**
@@ -30,6 +31,10 @@ namespace bob { namespace trainer {
    * different classes, filling up user containers.
    *
    * Data shufflers are particular useful for training neural networks.
+   *
+   * Mini-batches can also be drawn in advance by a background thread (see
+   * startPrefetching() and next()), such that the training thread does not
+   * wait for them.
    */
   class DataShuffler {
 
@@ -54,7 +59,9 @@ namespace bob { namespace trainer {
       virtual ~DataShuffler();
 
       /**
-       * Assignment. This will also copy seeds set on the other shuffler.
+       * Assignment. This will also copy seeds set on the other shuffler. The
+       * background thread of this shuffler, if any, is stopped, and the one
+       * of the other shuffler is not copied.
        */
       DataShuffler& operator= (const DataShuffler& other);
 
@@ -66,7 +73,8 @@ namespace bob { namespace trainer {
           blitz::Array<double,1>& stddev) const;
 
       /**
-       * Set automatic standard normalization.
+       * Set automatic standard normalization. This stops the background
+       * thread, if any, as the data is normalized in place.
        */
       void setAutoStdNorm(bool s);
 
@@ -118,14 +126,47 @@ namespace bob { namespace trainer {
       void operator() (blitz::Array<double,2>& data,
           blitz::Array<double,2>& target);
 
+      /**
+       * Starts a background thread, which draws mini-batches of batch_size
+       * samples (as operator() does) into a ring of n_buffers preallocated
+       * buffers, ahead of the calls to next(). The random number generator
+       * of the background thread is seeded with the given seed, such that
+       * the sequence of mini-batches is the same as the one obtained by
+       * calling operator() repeatedly with a boost::mt19937 seeded with the
+       * same value. Any previous background thread is stopped.
+       */
+      void startPrefetching(size_t batch_size, boost::uint32_t seed,
+          size_t n_buffers=2);
+
+      /**
+       * Stops the background thread, if any
+       */
+      void stopPrefetching();
+
+      /**
+       * Tells if mini-batches are drawn by a background thread
+       */
+      bool isPrefetching() const { return (bool)m_prefetcher; }
+
+      /**
+       * Gets the next mini-batch drawn by the background thread, waiting
+       * for it if required. The data and target matrices are views on an
+       * internal buffer (no copy is involved), which are valid until the
+       * next call to next(), startPrefetching() or stopPrefetching().
+       */
+      void next(blitz::Array<double,2>& data, blitz::Array<double,2>& target);
+
     private: //representation
 
+      struct Prefetcher; ///< state of the background thread
+
       std::vector<blitz::Array<double,2> > m_data;
       std::vector<blitz::Array<double,1> > m_target;
       std::vector<boost::uniform_int<size_t> > m_range;
       bool m_do_stdnorm; ///< should we apply standard normalization
       blitz::Array<double,1> m_mean; ///< mean to be used for std. norm.
       blitz::Array<double,1> m_stddev; ///< std.dev for std. norm.
+      boost::shared_ptr<Prefetcher> m_prefetcher; ///< background thread, if any
 
   };
 
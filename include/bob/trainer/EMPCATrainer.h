@@ -13,6 +13,7 @@
 #define BOB_TRAINER_EMPCA_TRAINER_H
 
 #include "EMTrainer.h"
+#include <bob/trainer/HDF5Sampler.h>
 #include <bob/machine/LinearMachine.h>
 #include <blitz/array.h>
 
@@ -42,6 +43,11 @@ namespace bob { namespace trainer {
  *  - \f$\mu\f$ is the mean of the data (dimension \f$f\f$)\n
  *  - \f$\epsilon\f$ is the noise of the data (dimension \f$f\f$)
  *      Gaussian with zero-mean and covariance matrix \f$\sigma^2 Id\f$
+ *
+ * The E-step does not keep the posterior of each latent variable, but only
+ * the sufficient statistics of the M-step. They are computed on chunks of
+ * samples with matrix-matrix products, by several threads (see
+ * setNThreads()), and the data can be streamed from an HDF5Sampler.
  */
 class EMPCATrainer: public EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >
 {
@@ -97,17 +103,56 @@ class EMPCATrainer: public EMTrainer<bob::machine::LinearMachine, blitz::Array<d
       const blitz::Array<double,2>& ar);
     
     /**
-     * @brief Calculates and saves statistics across the dataset, and saves
-     * these as m_z_{first,second}_order.
+     * @brief Initializes the trainer as above, by streaming the data of the
+     * given sampler to compute its mean (and its covariance, if the log
+     * likelihood is computed).
+     */
+    void initialize(bob::machine::LinearMachine& machine,
+      HDF5Sampler& sampler);
+
+    /**
+     * @brief Calculates the sufficient statistics across the dataset:
+     * \f$\sum_{i} (t_{i}-\mu) E(x_{i})^T\f$, \f$\sum_{i} E(x_{i} x_{i}^T)\f$
+     * and \f$\sum_{i} ||t_{i}-\mu||^2\f$.
      * 
-     * The statistics will be used in the mStep() that follows.
+     * The statistics will be used in the mStep() that follows. The chunks
+     * of samples are processed by several threads, and their statistics are
+     * added in order, such that they do not depend on the number of threads.
      */
     virtual void eStep(bob::machine::LinearMachine& machine, 
       const blitz::Array<double,2>& ar);
 
+    /**
+     * @brief Calculates the sufficient statistics as above, by streaming the
+     * data of the given sampler. If the block size of the sampler is a
+     * multiple of 1024, the statistics are exactly the ones of the
+     * in-memory E-step.
+     */
+    void eStep(bob::machine::LinearMachine& machine, HDF5Sampler& sampler);
+
+    using EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >::train;
+
+    /**
+     * @brief Trains the linear machine by streaming the data of the given
+     * sampler at each E-step, such that the data never has to be stored in
+     * memory.
+     */
+    void train(bob::machine::LinearMachine& machine, HDF5Sampler& sampler);
+
+    using EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >::resume;
+
+    /**
+     * @brief Resumes the training of the linear machine from a checkpoint
+     * file, by streaming the data of the given sampler at each E-step (see
+     * EMTrainer::resume()).
+     */
+    void resume(bob::machine::LinearMachine& machine, HDF5Sampler& sampler,
+      const std::string& filename);
+
     /**
      * @brief Performs a maximization step to update the parameters of the
-     * factor analysis model.
+     * factor analysis model, from the statistics of the last E-step (the
+     * data is not used).
      */
     virtual void mStep(bob::machine::LinearMachine& machine,
        const blitz::Array<double,2>& ar);
@@ -128,23 +173,44 @@ class EMPCATrainer: public EMTrainer<bob::machine::LinearMachine, blitz::Array<d
      */
     double getSigma2() const { return m_sigma2; }
 
+    /**
+     * @brief Sets the number of threads used by the E-step (0 means as many
+     * threads as hardware threads)
+     */
+    void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
+
+    /**
+     * @brief Gets the number of threads used by the E-step
+     */
+    size_t getNThreads() const { return m_n_threads; }
+
+  protected:
+    /**
+     * @brief Saves/restores \f$\sigma^2\f$ and the statistics of the E-step
+     * to/from a checkpoint. \f$W^T W\f$ and \f$inv(M)\f$ are recomputed from
+     * the restored machine.
+     */
+    virtual bool saveAccumulators(bob::io::HDF5File& file) const;
+    virtual void loadAccumulators(bob::machine::LinearMachine& machine,
+      bob::io::HDF5File& file);
+
   private: //representation
     blitz::Array<double,2> m_S; /// Covariance of the training data (required only if we need to compute the log likelihood)
-    blitz::Array<double,2> m_z_first_order; /// Current mean of the \f$z_{n}\f$ latent variable
-    blitz::Array<double,3> m_z_second_order; /// Current covariance of the \f$z_{n}\f$ latent variable
+    blitz::Array<double,2> m_XZ; /// Sum of \f$(t_{n}-\mu) E(z_{n})^T\f$ over the samples
+    blitz::Array<double,2> m_ZZ; /// Sum of the second order moments \f$E(z_{n} z_{n}^T)\f$ of the latent variable
+    double m_sum_sq; /// Sum of \f$||t_{n}-\mu||^2\f$ over the samples
+    size_t m_n_samples; /// Number of samples of the last E-step
     blitz::Array<double,2> m_inW; /// The matrix product \f$W^T W\f$
     blitz::Array<double,2> m_invM; /// The matrix \f$inv(M)\f$, where \f$M = W^T W + \sigma^2 Id\f$
     double m_sigma2; /// The variance \f$sigma^2\f$ of the noise epsilon of the probabilistic model
     double m_f_log2pi; /// The constant \f$n_{features} log(2*\pi)\f$ used during the likelihood computation
+    size_t m_n_threads; /// The number of threads used by the E-step
 
     // Working arrays
     mutable blitz::Array<double,2> m_tmp_dxf; /// size dimensionality x n_features
-    mutable blitz::Array<double,1> m_tmp_d; /// size dimensionality
-    mutable blitz::Array<double,1> m_tmp_f; /// size n_features
     mutable blitz::Array<double,2> m_tmp_dxd_1; /// size dimensionality x dimensionality
     mutable blitz::Array<double,2> m_tmp_dxd_2; /// size dimensionality x dimensionality
     mutable blitz::Array<double,2> m_tmp_fxd_1; /// size n_features x dimensionality 
-    mutable blitz::Array<double,2> m_tmp_fxd_2; /// size n_features x dimensionality 
     mutable blitz::Array<double,2> m_tmp_fxf_1; /// size n_features x n_features
     mutable blitz::Array<double,2> m_tmp_fxf_2; /// size n_features x n_features
 
@@ -153,13 +219,25 @@ class EMPCATrainer: public EMTrainer<bob::machine::LinearMachine, blitz::Array<d
      * @brief Initializes/resizes the (array) members
      */
     void initMembers(const bob::machine::LinearMachine& machine, 
-      const blitz::Array<double,2>& ar);
+      const size_t n_features);
     /**
      * @brief Computes the mean and the variance (if required) of the training
      * data
      */
     void computeMeanVariance(bob::machine::LinearMachine& machine, 
       const blitz::Array<double,2>& ar);
+    void computeMeanVariance(bob::machine::LinearMachine& machine, 
+      HDF5Sampler& sampler);
+    /**
+     * @brief Resets the statistics of the E-step, and computes the product
+     * \f$inv(M) W^T\f$ used to estimate the latent variables
+     */
+    void initEStep(const bob::machine::LinearMachine& machine);
+    /**
+     * @brief Adds the terms of the second order moments which do not depend
+     * on the samples, once all of them have been processed
+     */
+    void finalizeEStep();
     /**
      * @brief Random initialization of \f$W\f$ and \f$sigma^2\f$. 
      * W is the projection matrix (from the LinearMachine)
@@ -180,14 +258,12 @@ class EMPCATrainer: public EMTrainer<bob::machine::LinearMachine, blitz::Array<d
      * @brief M-Step (part 1): Computes the new estimate of \f$W\f$ using the
      * new estimated statistics.
      */
-    void updateW(bob::machine::LinearMachine& machine,
-       const blitz::Array<double,2>& ar);
+    void updateW(bob::machine::LinearMachine& machine);
     /**
      * @brief M-Step (part 2): Computes the new estimate of \f$\sigma^2\f$ using
      * the new estimated statistics.
      */
-    void updateSigma2(bob::machine::LinearMachine& machine,
-       const blitz::Array<double,2>& ar);
+    void updateSigma2(bob::machine::LinearMachine& machine);
 };
 
 /**
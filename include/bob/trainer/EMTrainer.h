@@ -16,10 +16,17 @@
 #include "Trainer.h"
 
 #include <limits>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdio>
 #include <bob/core/check.h>
 #include <bob/core/logging.h>
+#include <bob/io/HDF5File.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/random.hpp>
+#include <boost/format.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 
 namespace bob { namespace trainer {
@@ -28,6 +35,20 @@ namespace bob { namespace trainer {
    * @{
    */
   
+  /**
+   * @brief Telemetry of an iteration of the EM algorithm. Iteration 0
+   * corresponds to the E-step which follows the initialization (without
+   * M-step).
+   */
+  struct EMIteration {
+    size_t iteration; ///< Index of the iteration
+    double e_step_time; ///< Wall time of the E-step (in seconds)
+    double m_step_time; ///< Wall time of the M-step (in seconds)
+    double likelihood_time; ///< Wall time of computeLikelihood() (in seconds)
+    double average_output; ///< Output of computeLikelihood() (NaN if not computed)
+    double delta; ///< Relative change of the average output (NaN if not available)
+  };
+
   /**
    * @brief This class implements the general Expectation-maximization algorithm.
    * @details See Section 9.3 of Bishop, "Pattern recognition and machine learning", 2006
@@ -53,6 +74,8 @@ namespace bob { namespace trainer {
         m_convergence_threshold = other.m_convergence_threshold;
         m_max_iterations = other.m_max_iterations;
         m_rng = other.m_rng;
+        m_checkpoint_filename = other.m_checkpoint_filename;
+        m_checkpoint_period = other.m_checkpoint_period;
       }
       return *this;
     }
@@ -109,55 +132,28 @@ namespace bob { namespace trainer {
       // Initialization
       initialize(machine, sampler);
       // Do the Expectation-Maximization algorithm
-      double average_output_previous;
-      double average_output = - std::numeric_limits<double>::max();
-      
-      // - eStep
-      eStep(machine, sampler);
-   
-      if(m_compute_likelihood)
-        average_output = computeLikelihood(machine);
-
-      // - iterates...
-      for(size_t iter=0; ; ++iter) {
-        
-        // - saves average output from last iteration
-        average_output_previous = average_output;
-       
-        // - mStep
-        mStep(machine, sampler);
-        
-        // - eStep
-        eStep(machine, sampler);
-   
-        // - Computes log likelihood if required
-        if(m_compute_likelihood) {
-          average_output = computeLikelihood(machine);
-        
-          bob::core::info << "# Iteration " << iter+1 << ": " 
-            << average_output_previous << " -> " 
-            << average_output << std::endl;
-        
-          // - Terminates if converged (and likelihood computation is set)
-          if(fabs((average_output_previous - average_output)/average_output_previous) <= m_convergence_threshold) {
-            bob::core::info << "# EM terminated: likelihood converged" << std::endl;
-            break;
-          }
-        }
-        else
-          bob::core::info << "# Iteration " << iter+1 << std::endl;
-        
-        // - Terminates if maximum number of iterations has been reached
-        if(m_max_iterations > 0 && iter+1 >= m_max_iterations) {
-          bob::core::info << "# EM terminated: maximum number of iterations reached." << std::endl;
-          break;
-        }
-      }
-
+      iterate(machine, sampler, EStep(*this, machine, sampler));
       // Finalization
       finalize(machine, sampler);
     }
 
+    /**
+     * @brief Resumes the training of a machine from a checkpoint file (see
+     * setCheckpoint()). The trainer is initialized with the sampler, then
+     * the machine, the accumulators and the telemetry are restored from the
+     * checkpoint, and the EM iterations continue from the saved one. The
+     * trainer should be configured as for the interrupted training.
+     */
+    void resume(T_machine& machine, const T_sampler& sampler,
+      const std::string& filename)
+    {
+      bob::core::info << "# " << name() << ": resuming from '" << filename
+        << "'" << std::endl;
+      initialize(machine, sampler);
+      iterate(machine, sampler, EStep(*this, machine, sampler), filename);
+      finalize(machine, sampler);
+    }
+
     /**
      * @brief This method is called before the EM algorithm to initialize 
      * variables.
@@ -236,11 +232,151 @@ namespace bob { namespace trainer {
     const boost::shared_ptr<boost::mt19937> getRng() const
     { return m_rng; }
 
+    /**
+     * @brief Saves a checkpoint to the given HDF5 file every period
+     * iterations, from which the training could be resumed (see resume()).
+     * A checkpoint contains the machine, the accumulators of the trainer
+     * (see saveAccumulators()), the state of the random number generator
+     * and the telemetry. The file is written under
+     * a temporary name and then renamed, such that an interruption while
+     * writing does not corrupt the previous checkpoint. A period of 0
+     * disables the checkpoints.
+     */
+    void setCheckpoint(const std::string& filename, const size_t period)
+    { m_checkpoint_filename = filename; m_checkpoint_period = period; }
+
+    /**
+     * @brief Gets the file to which the checkpoints are saved
+     */
+    const std::string& getCheckpointFilename() const
+    { return m_checkpoint_filename; }
+
+    /**
+     * @brief Gets the number of iterations between two checkpoints (0 if
+     * disabled)
+     */
+    size_t getCheckpointPeriod() const
+    { return m_checkpoint_period; }
+
+    /**
+     * @brief Gets the telemetry of the iterations of the last (or current)
+     * training, including the iterations restored from a checkpoint
+     */
+    const std::vector<EMIteration>& getTelemetry() const
+    { return m_telemetry; }
+
   protected:
+    /**
+     * @brief Saves the accumulators computed by the last E-step to the
+     * current group of the given file, such that the training could be
+     * resumed without performing this E-step again. Returns false if this
+     * is not supported by the trainer (default), in which case the E-step is
+     * performed again when resuming.
+     */
+    virtual bool saveAccumulators(bob::io::HDF5File& file) const
+    { return false; }
+
+    /**
+     * @brief Restores the accumulators saved by saveAccumulators(), once the
+     * trainer has been initialized and the machine restored.
+     */
+    virtual void loadAccumulators(T_machine& machine, bob::io::HDF5File& file)
+    {}
+
+    /**
+     * @brief Runs the iterations of the EM algorithm, once the trainer has
+     * been initialized. Each E-step is performed by calling e_step(), and
+     * each M-step by calling mStep(machine, sampler). This allows trainers
+     * which stream their data (instead of passing it as a sampler) to share
+     * the EM loop. If a checkpoint file is given, the iterations continue
+     * from the state saved in this file.
+     */
+    template <typename T_estep>
+    void iterate(T_machine& machine, const T_sampler& sampler,
+      const T_estep& e_step, const std::string& checkpoint="")
+    {
+      // Do the Expectation-Maximization algorithm
+      double average_output_previous;
+      double average_output = - std::numeric_limits<double>::max();
+      size_t first_iter = 0;
+
+      if (checkpoint.empty()) {
+        m_telemetry.clear();
+        // - eStep
+        EMIteration stats = newIteration(0);
+        expectation(machine, e_step, stats);
+        if(m_compute_likelihood)
+          average_output = stats.average_output;
+        m_telemetry.push_back(stats);
+      }
+      else {
+        bool accumulators_loaded;
+        first_iter = loadCheckpoint(machine, checkpoint, average_output,
+          accumulators_loaded);
+        // - eStep, if the accumulators could not be restored
+        if (!accumulators_loaded) {
+          EMIteration stats = newIteration(first_iter);
+          expectation(machine, e_step, stats);
+        }
+        bob::core::info << "# Resuming after iteration " << first_iter
+          << std::endl;
+      }
+
+      // - iterates...
+      for(size_t iter=first_iter; ; ++iter) {
+        EMIteration stats = newIteration(iter+1);
+        
+        // - saves average output from last iteration
+        average_output_previous = average_output;
+       
+        // - mStep
+        const boost::posix_time::ptime start =
+          boost::posix_time::microsec_clock::universal_time();
+        mStep(machine, sampler);
+        stats.m_step_time = elapsed(start);
+        
+        // - eStep and log likelihood if required
+        expectation(machine, e_step, stats);
+   
+        if(m_compute_likelihood) {
+          average_output = stats.average_output;
+          stats.delta = fabs((average_output_previous - average_output)/average_output_previous);
+          m_telemetry.push_back(stats);
+        
+          bob::core::info << "# Iteration " << iter+1 << ": " 
+            << average_output_previous << " -> " 
+            << average_output << std::endl;
+        
+          // - Terminates if converged (and likelihood computation is set)
+          if(stats.delta <= m_convergence_threshold) {
+            bob::core::info << "# EM terminated: likelihood converged" << std::endl;
+            break;
+          }
+        }
+        else {
+          m_telemetry.push_back(stats);
+          bob::core::info << "# Iteration " << iter+1 << std::endl;
+        }
+        
+        // - Terminates if maximum number of iterations has been reached
+        if(m_max_iterations > 0 && iter+1 >= m_max_iterations) {
+          bob::core::info << "# EM terminated: maximum number of iterations reached." << std::endl;
+          break;
+        }
+
+        // - Saves a checkpoint if required
+        if(m_checkpoint_period > 0 && (iter+1) % m_checkpoint_period == 0)
+          saveCheckpoint(machine, iter+1, average_output);
+      }
+    }
+
     bool m_compute_likelihood; ///< whether lilelihood is computed during the EM loop or not
     double m_convergence_threshold; ///< convergence threshold
     size_t m_max_iterations; ///< maximum number of EM iterations
     boost::shared_ptr<boost::mt19937> m_rng; ///< The random number generator for the inialization
+    std::string m_checkpoint_filename; ///< file to which the checkpoints are saved
+    size_t m_checkpoint_period; ///< number of iterations between two checkpoints
+    std::vector<EMIteration> m_telemetry; ///< telemetry of the iterations
 
     /**
      * @brief Protected constructor to be called in the constructor of derived
@@ -251,9 +387,156 @@ namespace bob { namespace trainer {
       m_compute_likelihood(compute_likelihood), 
       m_convergence_threshold(convergence_threshold), 
       m_max_iterations(max_iterations),
-      m_rng(new boost::mt19937())
+      m_rng(new boost::mt19937()),
+      m_checkpoint_period(0)
+    {
+    }
+
+  private:
+    /**
+     * @brief Returns an empty telemetry record
+     */
+    static EMIteration newIteration(const size_t iteration)
+    {
+      EMIteration stats;
+      stats.iteration = iteration;
+      stats.e_step_time = 0.;
+      stats.m_step_time = 0.;
+      stats.likelihood_time = 0.;
+      stats.average_output = std::numeric_limits<double>::quiet_NaN();
+      stats.delta = std::numeric_limits<double>::quiet_NaN();
+      return stats;
+    }
+
+    /**
+     * @brief Returns the wall time elapsed since start (in seconds)
+     */
+    static double elapsed(const boost::posix_time::ptime& start)
+    {
+      return (boost::posix_time::microsec_clock::universal_time() - start)
+        .total_microseconds() / 1e6;
+    }
+
+    /**
+     * @brief Performs an E-step, and computes the likelihood if required,
+     * recording the times into stats
+     */
+    template <typename T_estep>
+    void expectation(T_machine& machine, const T_estep& e_step,
+      EMIteration& stats)
+    {
+      boost::posix_time::ptime start =
+        boost::posix_time::microsec_clock::universal_time();
+      e_step();
+      stats.e_step_time = elapsed(start);
+      if(m_compute_likelihood) {
+        start = boost::posix_time::microsec_clock::universal_time();
+        stats.average_output = computeLikelihood(machine);
+        stats.likelihood_time = elapsed(start);
+      }
+    }
+
+    /**
+     * @brief Saves the state of the training after the given iteration to
+     * the checkpoint file
+     */
+    void saveCheckpoint(const T_machine& machine, const size_t iteration,
+      const double average_output) const
+    {
+      const std::string tmp_filename = m_checkpoint_filename + ".tmp";
+      {
+        bob::io::HDF5File file(tmp_filename, 'w');
+        file.set("iteration", static_cast<uint64_t>(iteration));
+        file.set("average_output", average_output);
+        std::ostringstream rng;
+        rng << *m_rng;
+        file.set("rng", rng.str());
+        file.createGroup("machine");
+        file.cd("machine");
+        machine.save(file);
+        file.cd("..");
+        file.createGroup("accumulators");
+        file.cd("accumulators");
+        file.set("saved", saveAccumulators(file) ? 1 : 0);
+        file.cd("..");
+        file.createGroup("telemetry");
+        file.cd("telemetry");
+        const int n = m_telemetry.size();
+        blitz::Array<uint64_t,1> iterations(n);
+        blitz::Array<double,2> values(n, 5);
+        for (int i=0; i<n; ++i) {
+          iterations(i) = m_telemetry[i].iteration;
+          values(i,0) = m_telemetry[i].e_step_time;
+          values(i,1) = m_telemetry[i].m_step_time;
+          values(i,2) = m_telemetry[i].likelihood_time;
+          values(i,3) = m_telemetry[i].average_output;
+          values(i,4) = m_telemetry[i].delta;
+        }
+        file.setArray("iteration", iterations);
+        file.setArray("values", values);
+      }
+      if (std::rename(tmp_filename.c_str(), m_checkpoint_filename.c_str()) != 0) {
+        boost::format m("%s: cannot rename checkpoint file '%s' to '%s'");
+        m % name() % tmp_filename % m_checkpoint_filename;
+        throw std::runtime_error(m.str());
+      }
+      bob::core::info << "# Checkpoint saved to '" << m_checkpoint_filename
+        << "' after iteration " << iteration << std::endl;
+    }
+
+    /**
+     * @brief Restores the state of the training from a checkpoint file, and
+     * returns the index of the last iteration performed
+     */
+    size_t loadCheckpoint(T_machine& machine, const std::string& filename,
+      double& average_output, bool& accumulators_loaded)
     {
+      bob::io::HDF5File file(filename, 'r');
+      const size_t iteration = file.read<uint64_t>("iteration");
+      average_output = file.read<double>("average_output");
+      if (file.contains("rng")) {
+        std::istringstream rng(file.read<std::string>("rng"));
+        rng >> *m_rng;
+      }
+      file.cd("machine");
+      machine.load(file);
+      file.cd("..");
+      file.cd("telemetry");
+      blitz::Array<uint64_t,1> iterations = file.readArray<uint64_t,1>("iteration");
+      blitz::Array<double,2> values = file.readArray<double,2>("values");
+      file.cd("..");
+      m_telemetry.clear();
+      for (int i=0; i<iterations.extent(0); ++i) {
+        EMIteration stats = newIteration(iterations(i));
+        stats.e_step_time = values(i,0);
+        stats.m_step_time = values(i,1);
+        stats.likelihood_time = values(i,2);
+        stats.average_output = values(i,3);
+        stats.delta = values(i,4);
+        m_telemetry.push_back(stats);
+      }
+      file.cd("accumulators");
+      accumulators_loaded = file.read<int>("saved") != 0;
+      if (accumulators_loaded) loadAccumulators(machine, file);
+      file.cd("..");
+      return iteration;
     }
+
+  private:
+    /**
+     * @brief Performs an E-step on the sampler given to train()
+     */
+    struct EStep {
+      EMTrainer& trainer;
+      T_machine& machine;
+      const T_sampler& sampler;
+
+      EStep(EMTrainer& trainer_, T_machine& machine_,
+          const T_sampler& sampler_):
+        trainer(trainer_), machine(machine_), sampler(sampler_) {}
+
+      void operator()() const { trainer.eStep(machine, sampler); }
+    };
   };
 
   /**
@@ -17,6 +17,7 @@
 
 #include <vector>
 #include <bob/machine/LinearMachine.h>
+#include <bob/trainer/ScatterAccumulator.h>
 
 namespace bob { namespace trainer {
 
@@ -137,6 +138,24 @@ namespace bob { namespace trainer {
           blitz::Array<double,1>& eigen_values,
           const std::vector<blitz::Array<double,2> >& X) const;
 
+      /**
+       * @brief Trains the LinearMachine to perform Fisher/LDA discrimination,
+       * from the statistics of the classes accumulated beforehand (see
+       * ScatterAccumulator), such that the data never has to be stored in
+       * memory at once. The classes without any sample are ignored.
+       */
+      void train(bob::machine::LinearMachine& machine,
+          const ScatterAccumulator& accumulator) const;
+
+      /**
+       * @brief Trains the LinearMachine to perform Fisher/LDA discrimination
+       * from the accumulated statistics, as above, and also returns the
+       * eigen values.
+       */
+      void train(bob::machine::LinearMachine& machine,
+          blitz::Array<double,1>& eigen_values,
+          const ScatterAccumulator& accumulator) const;
+
       /**
        * @brief Returns the expected size of the output given the data.
        *
@@ -146,7 +165,22 @@ namespace bob { namespace trainer {
        */
       size_t output_size(const std::vector<blitz::Array<double,2> >& X) const;
 
+      /**
+       * @brief Returns the expected size of the output given the accumulated
+       * statistics.
+       */
+      size_t output_size(const ScatterAccumulator& accumulator) const;
+
     private:
+      /**
+       * @brief Computes the eigen vectors/values of Sw^-1 * Sb and updates
+       * the machine
+       */
+      void trainFromScatters(bob::machine::LinearMachine& machine,
+          blitz::Array<double,1>& eigen_values, blitz::Array<double,2>& Sw,
+          blitz::Array<double,2>& Sb, const blitz::Array<double,1>& preMean,
+          const size_t n_outputs) const;
+
       bool m_use_pinv; ///< use the 'pinv' method for LDA
       bool m_strip_to_rank; ///< return rank or full matrix
   };
@@ -15,6 +15,8 @@
 #include "EMTrainer.h"
 #include <bob/machine/GMMMachine.h>
 #include <bob/machine/GMMStats.h>
+#include <bob/trainer/HDF5Sampler.h>
+#include <vector>
 #include <limits>
 
 namespace bob { namespace trainer {
@@ -64,10 +66,34 @@ class GMMTrainer: public EMTrainer<bob::machine::GMMMachine, blitz::Array<double
      * 
      * The statistics, m_ss, will be used in the mStep() that follows.
      * Implements EMTrainer::eStep(double &)
+     *
+     * The data is split into chunks of fixed size, which are processed by
+     * several threads (see setNThreads()), each of them using its own copy
+     * of the GMM. The statistics of the chunks are summed in the order of
+     * the chunks, such that the results do not depend on the number of
+     * threads.
      */
     virtual void eStep(bob::machine::GMMMachine& gmm,
       const blitz::Array<double,2>& data);
 
+    /**
+     * @brief Calculates the statistics as above, by streaming the data of
+     * the given sampler. The block size of the sampler should be a multiple
+     * of the size of the chunks of the E-step (1024), in which case the
+     * statistics are exactly the ones of the in-memory E-step.
+     */
+    void eStep(bob::machine::GMMMachine& gmm, HDF5Sampler& sampler);
+
+    using EMTrainer<bob::machine::GMMMachine, blitz::Array<double,2> >::train;
+
+    /**
+     * @brief Trains the GMM by streaming the data of the given sampler at
+     * each E-step, such that the data never has to be stored in memory.
+     * The GMM is the same as the one obtained by training with all the data
+     * at once.
+     */
+    void train(bob::machine::GMMMachine& gmm, HDF5Sampler& sampler);
+
     /**
      * @brief Computes the likelihood using current estimates of the latent
      * variables
@@ -113,8 +139,26 @@ class GMMTrainer: public EMTrainer<bob::machine::GMMMachine, blitz::Array<double
      * E-step
      */
     void setGMMStats(const bob::machine::GMMStats& stats); 
+
+    /**
+     * @brief Sets the number of threads used by the E-step (0 means as many
+     * threads as hardware threads)
+     */
+    void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
+
+    /**
+     * @brief Gets the number of threads used by the E-step
+     */
+    size_t getNThreads() const { return m_n_threads; }
      
   protected:
+    /**
+     * @brief Saves/restores the sufficient statistics to/from a checkpoint
+     */
+    virtual bool saveAccumulators(bob::io::HDF5File& file) const;
+    virtual void loadAccumulators(bob::machine::GMMMachine& gmm,
+      bob::io::HDF5File& file);
+
     /**
      * These are the sufficient statistics, calculated during the
      * E-step and used during the M-step
@@ -143,6 +187,30 @@ class GMMTrainer: public EMTrainer<bob::machine::GMMMachine, blitz::Array<double
      * because of numerical issue. This threshold is used to avoid such divisions.
      */
     double m_mean_var_update_responsibilities_threshold;
+
+    /**
+     * The number of threads used by the E-step
+     */
+    size_t m_n_threads;
+
+  private:
+    /**
+     * @brief Creates the GMMs and statistics used by the threads of the
+     * E-step
+     */
+    void createWorkspace(const bob::machine::GMMMachine& gmm,
+      const size_t n_threads,
+      std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& gmms,
+      std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats) const;
+
+    /**
+     * @brief Adds the statistics of the given data to total, by chunks
+     * which are processed by several threads
+     */
+    void accStatistics(const blitz::Array<double,2>& data,
+      std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& gmms,
+      std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      bob::machine::GMMStats& total) const;
 };
 
 /**
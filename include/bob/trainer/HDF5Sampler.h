@@ -0,0 +1,167 @@
+/**
+ * @file bob/trainer/HDF5Sampler.h
+ * @date Mon Oct 19 02:52:55 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Streams the samples of a list of HDF5 files by blocks, reading
+ * ahead on a background thread
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#ifndef BOB_TRAINER_HDF5SAMPLER_H
+#define BOB_TRAINER_HDF5SAMPLER_H
+
+#include <blitz/array.h>
+#include <bob/io/HDF5File.h>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
+#include <string>
+#include <vector>
+
+namespace bob { namespace trainer {
+/**
+ * @ingroup TRAINER
+ * @{
+ */
+
+/**
+ * @brief A sampler which streams the samples (i.e. the rows) of 2D datasets
+ * of double precision values, stored at the same path of a list of HDF5
+ * files, by blocks of a fixed number of samples.
+ *
+ * The samples of all the files are concatenated, and each pass over the
+ * data (see reset() and next()) provides consecutive blocks of
+ * getBlockSize() samples (except for the last one), whatever the
+ * boundaries between the files are. The blocks are read ahead by a
+ * background thread into a ring of buffers, such that at most n_buffers
+ * blocks are in memory at once.
+ *
+ * This allows to train machines (e.g. with the KMeansTrainer or the
+ * GMMTrainer) on data sets which do not fit in memory.
+ *
+ * @warning The HDF5 library might not be thread-safe: other HDF5 files
+ * should not be accessed while a pass over the data is in progress.
+ */
+class HDF5Sampler: private boost::noncopyable {
+  public:
+    /**
+     * @brief Opens the given files to determine their number of samples.
+     * The files are read again at each pass over the data.
+     *
+     * @param filenames The HDF5 files to read the samples from
+     * @param path The path of the 2D dataset in each file
+     * @param block_size The number of samples of each block
+     * @param n_buffers The number of blocks which are kept in memory (the
+     *   one being processed, and the ones read ahead)
+     */
+    HDF5Sampler(const std::vector<std::string>& filenames,
+      const std::string& path="/array", const size_t block_size=65536,
+      const size_t n_buffers=2);
+
+    /**
+     * @brief Stops the background thread
+     */
+    ~HDF5Sampler();
+
+    /**
+     * @brief The HDF5 files to read the samples from
+     */
+    const std::vector<std::string>& getFilenames() const
+    { return m_filenames; }
+
+    /**
+     * @brief The path of the dataset in each file
+     */
+    const std::string& getPath() const
+    { return m_path; }
+
+    /**
+     * @brief The total number of samples
+     */
+    size_t getNSamples() const
+    { return m_offsets.back(); }
+
+    /**
+     * @brief The dimensionality of the samples
+     */
+    size_t getNInputs() const
+    { return m_n_inputs; }
+
+    /**
+     * @brief The number of samples of each block
+     */
+    size_t getBlockSize() const
+    { return m_block_size; }
+
+    /**
+     * @brief The number of blocks of a pass over the data
+     */
+    size_t getNBlocks() const
+    { return (getNSamples() + m_block_size - 1) / m_block_size; }
+
+    /**
+     * @brief Starts a new pass over the data, from the first block. The
+     * background thread immediately starts to read the first blocks.
+     */
+    void reset();
+
+    /**
+     * @brief Gets the next block of the current pass (starting a new pass if
+     * required), and returns false if there is no more block.
+     * The block is a view on an internal buffer, which is valid until the
+     * next call to next(), reset() or read().
+     */
+    bool next(blitz::Array<double,2>& block);
+
+    /**
+     * @brief Reads the sample at the given index (random access). This
+     * stops the current pass over the data, if any.
+     */
+    void read(const size_t index, blitz::Array<double,1>& sample);
+
+  private:
+    /**
+     * @brief Reads the given rows into the given buffer (called from the
+     * background thread)
+     */
+    void readRows(const size_t begin, const size_t end, double* buffer,
+      size_t& file_index, boost::shared_ptr<bob::io::HDF5File>& file) const;
+
+    /**
+     * @brief Reads all the blocks of a pass (background thread)
+     */
+    void produce();
+
+    /**
+     * @brief Stops the background thread, if running
+     */
+    void stop();
+
+    std::vector<std::string> m_filenames;
+    std::string m_path;
+    size_t m_block_size;
+    size_t m_n_inputs;
+    std::vector<size_t> m_offsets; ///< first sample of each file (and total)
+
+    // state of a pass over the data
+    std::vector<std::vector<double> > m_buffers;
+    boost::shared_ptr<boost::thread> m_thread;
+    boost::mutex m_mutex;
+    boost::condition_variable m_condition;
+    size_t m_produced; ///< number of blocks read by the background thread
+    size_t m_released; ///< number of blocks released by the consumer
+    size_t m_next; ///< index of the next block returned by next()
+    bool m_started; ///< is a pass in progress?
+    bool m_stop; ///< should the background thread stop?
+    boost::exception_ptr m_error; ///< error raised by the background thread
+};
+
+/**
+ * @}
+ */
+}}
+
+#endif /* BOB_TRAINER_HDF5SAMPLER_H */
@@ -66,6 +66,9 @@ class IVectorTrainer: public bob::trainer::EMTrainer<bob::machine::IVectorMachin
      * - m_acc_Snormij (only if update_sigma is enabled)
      *
      * These statistics will be used in the mStep() that follows.
+     * The utterances are processed by blocks, such that the accumulation
+     * over the Gaussian components is performed by matrix products, and
+     * the utterances of a block are processed in parallel.
      */
     virtual void eStep(bob::machine::IVectorMachine& ivector,
       const std::vector<bob::machine::GMMStats>& data);
@@ -139,9 +142,31 @@ class IVectorTrainer: public bob::trainer::EMTrainer<bob::machine::IVectorMachin
     { bob::core::array::assertSameShape(acc, m_acc_Snormij);
       m_acc_Snormij = acc; }
 
+    /**
+     * @brief Sets the number of threads used by the E-step and the M-step
+     * (0 means as many threads as hardware threads). The results do not
+     * depend on the number of threads.
+     */
+    void setNThreads(const size_t n_threads)
+    { m_n_threads = n_threads; }
+
+    /**
+     * @brief Gets the number of threads used by the E-step and the M-step
+     */
+    size_t getNThreads() const
+    { return m_n_threads; }
+
   protected:
+    /**
+     * @brief Saves/restores the accumulators to/from a checkpoint
+     */
+    virtual bool saveAccumulators(bob::io::HDF5File& file) const;
+    virtual void loadAccumulators(bob::machine::IVectorMachine& ivector,
+      bob::io::HDF5File& file);
+
     // Attributes
     bool m_update_sigma;
+    size_t m_n_threads;
 
     // Acccumulators
     blitz::Array<double,3> m_acc_Nij_wij2;
@@ -149,15 +174,6 @@ class IVectorTrainer: public bob::trainer::EMTrainer<bob::machine::IVectorMachin
     blitz::Array<double,1> m_acc_Nij;
     blitz::Array<double,2> m_acc_Snormij;
 
-    // Working arrays
-    mutable blitz::Array<double,1> m_tmp_wij;
-    mutable blitz::Array<double,2> m_tmp_wij2;
-    mutable blitz::Array<double,1> m_tmp_d1;
-    mutable blitz::Array<double,1> m_tmp_t1;
-    mutable blitz::Array<double,2> m_tmp_dd1;
-    mutable blitz::Array<double,2> m_tmp_dt1;
-    mutable blitz::Array<double,2> m_tmp_tt1;
-    mutable blitz::Array<double,2> m_tmp_tt2;
 };
 
 /**
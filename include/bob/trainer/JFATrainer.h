@@ -80,6 +80,54 @@ class FABaseTrainer
     void resetXYZ();
 
 
+    /**
+     * @brief Working arrays of a thread: caches for the current identity
+     * (or session), temporary arrays and the accumulators of the current
+     * block of identities (stored as flat C-contiguous arrays).
+     */
+    struct Workspace {
+      blitz::Array<double,2> IdPlusVProd_i;
+      blitz::Array<double,1> Fn_y_i;
+      blitz::Array<double,2> IdPlusUProd_ih;
+      blitz::Array<double,1> Fn_x_ih;
+      blitz::Array<double,1> IdPlusDProd_i;
+      blitz::Array<double,1> Fn_z_i;
+
+      blitz::Array<double,2> tmp_ruru;
+      blitz::Array<double,2> tmp_rvrv;
+      blitz::Array<double,1> tmp_ru;
+      blitz::Array<double,1> tmp_rv;
+      blitz::Array<double,1> tmp_CD;
+      blitz::Array<double,1> tmp_CD_b;
+
+      std::vector<double> acc_A1;
+      std::vector<double> acc_A2;
+    };
+
+    /**
+     * @brief A step which processes a single identity, given the workspace
+     * of the calling thread
+     */
+    typedef void (FABaseTrainer::*IdentityStep)(Workspace& ws,
+      const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id);
+
+    /**
+     * @brief Sets the number of threads used to process the identities
+     * (0 means as many threads as hardware threads). The results do not
+     * depend on the number of threads.
+     */
+    void setNThreads(const size_t n_threads)
+    { m_n_threads = n_threads; }
+
+    /**
+     * @brief Gets the number of threads used to process the identities
+     */
+    size_t getNThreads() const
+    { return m_n_threads; }
+
+
     /**** Y and V functions ****/
     /**
      * @brief Computes Vt * diag(sigma)^-1
@@ -93,22 +141,34 @@ class FABaseTrainer
      * @brief Computes (I+Vt*diag(sigma)^-1*Ni*V)^-1 which occurs in the y 
      * estimation for the given person
      */
-    void computeIdPlusVProd_i(const size_t id);
+    void computeIdPlusVProd_i(Workspace& ws, const size_t id) const;
     /**
      * @brief Computes sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h}) 
      * which occurs in the y estimation of the given person
      */
-    void computeFn_y_i(const bob::machine::FABase& m,
+    void computeFn_y_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id) const;
+    /**
+     * @brief Updates y_i (of the current person) with the cache values 
+     * ws.IdPlusVprod_i, m_VtSigmaInv and ws.Fn_y_i
+     */
+    void updateY_i(Workspace& ws, const size_t id);
+    /**
+     * @brief Estimates y_i of the given person
+     */
+    void estimateY_i(Workspace& ws, const bob::machine::FABase& m,
       const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
       const size_t id);
     /**
-     * @brief Updates y_i (of the current person) and the accumulators to
-     * compute V with the cache values m_cache_IdPlusVprod_i, m_VtSigmaInv and
-     * m_cache_Fn_y_i
+     * @brief Adds the contribution of the given person to the accumulators
+     * of the workspace to compute V
      */
-    void updateY_i(const size_t id);
+    void accumulateV_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id);
     /**
-     * @brief Updates y and the accumulators to compute V 
+     * @brief Updates y
      */
     void updateY(const bob::machine::FABase& m,
       const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& stats);
@@ -137,19 +197,33 @@ class FABaseTrainer
      * @brief Computes (I+Ut*diag(sigma)^-1*Ni*U)^-1 which occurs in the x 
      * estimation
      */
-    void computeIdPlusUProd_ih(const boost::shared_ptr<bob::machine::GMMStats>& stats);
+    void computeIdPlusUProd_ih(Workspace& ws,
+      const boost::shared_ptr<bob::machine::GMMStats>& stats) const;
     /**
      * @brief Computes sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
      * which occurs in the y estimation of the given person
      */
-    void computeFn_x_ih(const bob::machine::FABase& m, 
-      const boost::shared_ptr<bob::machine::GMMStats>& stats, const size_t id);
+    void computeFn_x_ih(Workspace& ws, const bob::machine::FABase& m, 
+      const boost::shared_ptr<bob::machine::GMMStats>& stats,
+      const size_t id) const;
     /**
-     * @brief Updates x_ih (of the current person/session) and the 
-     * accumulators to compute U with the cache values m_cache_IdPlusVprod_i, 
-     * m_VtSigmaInv and m_cache_Fn_y_i
+     * @brief Updates x_ih (of the current person/session) with the cache
+     * values ws.IdPlusUProd_ih, m_UtSigmaInv and ws.Fn_x_ih
      */
-    void updateX_ih(const size_t id, const size_t h);
+    void updateX_ih(Workspace& ws, const size_t id, const size_t h);
+    /**
+     * @brief Estimates x_ih of all the sessions of the given person
+     */
+    void estimateX_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id);
+    /**
+     * @brief Adds the contribution of all the sessions of the given person
+     * to the accumulators of the workspace to compute U
+     */
+    void accumulateU_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id);
     /**
      * @brief Updates x
      */
@@ -180,21 +254,34 @@ class FABaseTrainer
      * @brief Computes (I+diag(d)t*diag(sigma)^-1*Ni*diag(d))^-1 which occurs
      * in the z estimation for the given person
      */
-    void computeIdPlusDProd_i(const size_t id);
+    void computeIdPlusDProd_i(Workspace& ws, const size_t id) const;
     /**
      * @brief Computes sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
      * which occurs in the y estimation of the given person
      */
-    void computeFn_z_i(const bob::machine::FABase& m,
-      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats, const size_t id);
+    void computeFn_z_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id) const;
+    /**
+     * @brief Updates z_i (of the current person) with the cache values
+     * ws.IdPlusDProd_i, m_DtSigmaInv and ws.Fn_z_i
+     */
+    void updateZ_i(Workspace& ws, const size_t id);
     /**
-     * @brief Updates z_i (of the current person) and the accumulators to 
-     * compute D with the cache values m_cache_IdPlusDProd_i, m_VtSigmaInv
-     * and m_cache_Fn_z_i
+     * @brief Estimates z_i of the given person
      */
-    void updateZ_i(const size_t id);
+    void estimateZ_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id);
     /**
-     * @brief Updates z and the accumulators to compute D
+     * @brief Adds the contribution of the given person to the accumulators
+     * of the workspace to compute D
+     */
+    void accumulateD_i(Workspace& ws, const bob::machine::FABase& m,
+      const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      const size_t id);
+    /**
+     * @brief Updates z
      */
     void updateZ(const bob::machine::FABase& m,
       const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& stats);
@@ -297,11 +384,24 @@ class FABaseTrainer
 
 
   private:
+    /**
+     * @brief Processes the identities in parallel with the given step, by
+     * blocks of consecutive identities. If acc_A1 and acc_A2 are given,
+     * the accumulators of the workspaces are set to zero before each
+     * block, and added to acc_A1 and acc_A2 (which should be C-contiguous)
+     * in the order of the blocks.
+     */
+    void processIdentities(IdentityStep step, const bob::machine::FABase& m,
+      const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& stats,
+      double* acc_A1=0, const size_t size_A1=0,
+      double* acc_A2=0, const size_t size_A2=0);
+
     size_t m_Nid; // Number of identities 
     size_t m_dim_C; // Number of Gaussian components of the UBM GMM
     size_t m_dim_D; // Dimensionality of the feature space
     size_t m_dim_ru; // Rank of the U subspace
     size_t m_dim_rv; // Rank of the V subspace
+    size_t m_n_threads; // Number of threads (0 for the number of hardware threads)
 
     std::vector<blitz::Array<double,2> > m_x; // matrix x of speaker factors for eigenchannels U, for each client
     std::vector<blitz::Array<double,1> > m_y; // vector y of spealer factors for eigenvoices V, for each client
@@ -318,31 +418,22 @@ class FABaseTrainer
     blitz::Array<double,1> m_acc_D_A1;
     blitz::Array<double,1> m_acc_D_A2;
 
-    // Cache/Precomputation
+    // Cache/Precomputation (shared by the threads)
     blitz::Array<double,2> m_cache_VtSigmaInv; // Vt * diag(sigma)^-1
     blitz::Array<double,3> m_cache_VProd; // first dimension is the Gaussian id
-    blitz::Array<double,2> m_cache_IdPlusVProd_i;
-    blitz::Array<double,1> m_cache_Fn_y_i;
 
     blitz::Array<double,2> m_cache_UtSigmaInv; // Ut * diag(sigma)^-1
     blitz::Array<double,3> m_cache_UProd; // first dimension is the Gaussian id
-    blitz::Array<double,2> m_cache_IdPlusUProd_ih;
-    blitz::Array<double,1> m_cache_Fn_x_ih;
 
     blitz::Array<double,1> m_cache_DtSigmaInv; // Dt * diag(sigma)^-1
     blitz::Array<double,1> m_cache_DProd; // supervector length dimension
-    blitz::Array<double,1> m_cache_IdPlusDProd_i;
-    blitz::Array<double,1> m_cache_Fn_z_i;
 
-    // Working arrays
+    // Working arrays, one workspace per thread
+    std::vector<Workspace> m_workspaces;
     mutable blitz::Array<double,2> m_tmp_ruru;
     mutable blitz::Array<double,2> m_tmp_ruD;
     mutable blitz::Array<double,2> m_tmp_rvrv;
     mutable blitz::Array<double,2> m_tmp_rvD;
-    mutable blitz::Array<double,1> m_tmp_rv;
-    mutable blitz::Array<double,1> m_tmp_ru;
-    mutable blitz::Array<double,1> m_tmp_CD;
-    mutable blitz::Array<double,1> m_tmp_CD_b;
 };
 
 
@@ -470,6 +561,20 @@ class JFATrainer
       const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& features,
       const size_t n_iter);
 
+    /**
+     * @brief Sets the number of threads used to process the identities
+     * (0 means as many threads as hardware threads). The results do not
+     * depend on the number of threads.
+     */
+    void setNThreads(const size_t n_threads)
+    { m_base_trainer.setNThreads(n_threads); }
+
+    /**
+     * @brief Gets the number of threads used to process the identities
+     */
+    size_t getNThreads() const
+    { return m_base_trainer.getNThreads(); }
+
     /** 
      * @brief Sets the Random Number Generator
      */
@@ -632,6 +737,30 @@ class ISVTrainer: public EMTrainer<bob::machine::ISVBase, std::vector<std::vecto
       const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& features,
       const size_t n_iter);
 
+    /**
+     * @brief Enrols several clients at once, given the statistics of the
+     * sessions of each client. The clients are processed in parallel, and
+     * the z speaker factor of client i is stored in row i of z, which
+     * should have as many columns as the supervector length of the machine.
+     */
+    void enrol(const bob::machine::ISVBase& machine,
+      const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& features,
+      const size_t n_iter, blitz::Array<double,2>& z);
+
+    /**
+     * @brief Sets the number of threads used to process the identities
+     * (0 means as many threads as hardware threads). The results do not
+     * depend on the number of threads.
+     */
+    void setNThreads(const size_t n_threads)
+    { m_base_trainer.setNThreads(n_threads); }
+
+    /**
+     * @brief Gets the number of threads used to process the identities
+     */
+    size_t getNThreads() const
+    { return m_base_trainer.getNThreads(); }
+
     /**
      * @brief Get the x speaker factors
      */
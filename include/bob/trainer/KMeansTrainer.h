@@ -11,6 +11,7 @@
 
 #include <bob/machine/KMeansMachine.h>
 #include <bob/trainer/EMTrainer.h>
+#include <bob/trainer/HDF5Sampler.h>
 #include <boost/version.hpp>
 
 namespace bob { namespace trainer {
@@ -37,7 +38,8 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
       RANDOM_NO_DUPLICATE
 #if BOOST_VERSION >= 104700
       ,
-      KMEANS_PLUS_PLUS
+      KMEANS_PLUS_PLUS,
+      KMEANS_PARALLEL
 #endif
     }   
     InitializationMethod;
@@ -89,6 +91,15 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
      * @brief Initialise the means randomly. 
      * Data is split into as many chunks as there are means, 
      * then each mean is set to a random example within each chunk.
+     * With KMEANS_PLUS_PLUS, the distance of each sample to its closest
+     * mean is updated with the last chosen mean only, such that the cost is
+     * linear in the number of means.
+     * With KMEANS_PARALLEL, the k-means|| algorithm of Bahmani et al.
+     * ("Scalable k-means++", 2012) is used: a few rounds sample many
+     * candidates at once (see setKMeansParallelRounds() and
+     * setKMeansParallelOversampling()), which are then weighted by the
+     * number of samples they are the closest to, and reclustered with a
+     * weighted k-means++.
      */
     virtual void initialize(bob::machine::KMeansMachine& kMeansMachine,
       const blitz::Array<double,2>& sampler);
@@ -98,12 +109,48 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
      * - zeroeth and first order statistics
      * - average (Square Euclidean) distance from the closest mean 
      * Implements EMTrainer::eStep(double &)
+     * The statistics of the means are accumulated by several threads (see
+     * setNThreads()), each of them owning the accumulators of a range of
+     * means, such that they do not depend on the number of threads.
+     * In the mini-batch mode (see setMiniBatchSize()), the statistics are
+     * only accumulated over a mini-batch of random samples.
      */
     virtual void eStep(bob::machine::KMeansMachine& kmeans,
       const blitz::Array<double,2>& data);
+
+    /**
+     * @brief Initialise the means randomly as above, by reading the
+     * selected samples from the given sampler. The k-means++
+     * and k-means|| initializations are not supported, as they require the
+     * data to be in memory.
+     */
+    void initialize(bob::machine::KMeansMachine& kmeans, HDF5Sampler& sampler);
+
+    /**
+     * @brief Accumulates the statistics as above, by streaming the data of
+     * the given sampler. The pruning is not used (it would require bounds
+     * for all the samples). If the block size of the sampler is a multiple
+     * of 256, the statistics are exactly the ones of the in-memory E-step.
+     * The mini-batch mode is not supported.
+     */
+    void eStep(bob::machine::KMeansMachine& kmeans, HDF5Sampler& sampler);
+
+    using EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::train;
+
+    /**
+     * @brief Trains the k-means machine by streaming the data of the given
+     * sampler at each E-step, such that the data never has to be stored in
+     * memory.
+     */
+    void train(bob::machine::KMeansMachine& kmeans, HDF5Sampler& sampler);
     
     /**
      * @brief Updates the mean based on the statistics from the E-step.
+     * In the mini-batch mode, each mean is moved towards the mean of the
+     * samples of the mini-batch it is the closest to, with a learning rate
+     * which is the inverse of the number of samples it has been assigned to
+     * since the initialization (Sculley, "Web-scale k-means clustering",
+     * 2010).
      */
     virtual void mStep(bob::machine::KMeansMachine& kmeans, 
       const blitz::Array<double,2>&);
@@ -147,6 +194,75 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
      */
     InitializationMethod getInitializationMethod() const { return m_initialization_method; }
   
+    /**
+     * @brief Enables the pruning of the distance computations in the E-step,
+     * using triangle inequality bounds (see
+     * bob::machine::KMeansMachine::updateClosestMeans()). The bounds are
+     * kept from one E-step to the next one, which should hence be called
+     * with the same data samples (as done by train()).
+     */
+    void setPruning(const bool pruning) { m_pruning = pruning; }
+
+    /**
+     * @brief Tells if the pruning of the distance computations is enabled
+     */
+    bool getPruning() const { return m_pruning; }
+
+    /**
+     * @brief Sets the number of sampling rounds of the k-means||
+     * initialization (5 by default)
+     */
+    void setKMeansParallelRounds(const size_t n_rounds)
+    { m_kmeans_parallel_rounds = n_rounds; }
+
+    /**
+     * @brief Gets the number of sampling rounds of the k-means||
+     * initialization
+     */
+    size_t getKMeansParallelRounds() const
+    { return m_kmeans_parallel_rounds; }
+
+    /**
+     * @brief Sets the oversampling factor of the k-means|| initialization,
+     * i.e., the expected number of candidates sampled at each round divided
+     * by the number of means (2 by default)
+     */
+    void setKMeansParallelOversampling(const double oversampling);
+
+    /**
+     * @brief Gets the oversampling factor of the k-means|| initialization
+     */
+    double getKMeansParallelOversampling() const
+    { return m_kmeans_parallel_oversampling; }
+
+    /**
+     * @brief Sets the number of random samples of the mini-batches used by
+     * each E-step (0, the default, disables the mini-batch mode and uses all
+     * the samples). As the average min distance is then computed on a
+     * mini-batch, the training usually stops after the maximum number of
+     * iterations.
+     */
+    void setMiniBatchSize(const size_t mini_batch_size)
+    { m_mini_batch_size = mini_batch_size; }
+
+    /**
+     * @brief Gets the number of samples of the mini-batches (0 if the
+     * mini-batch mode is disabled)
+     */
+    size_t getMiniBatchSize() const { return m_mini_batch_size; }
+
+    /**
+     * @brief Sets the number of threads used by the initialization and the
+     * E-step (0 means as many threads as hardware threads)
+     */
+    void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
+
+    /**
+     * @brief Gets the number of threads used by the initialization and the
+     * E-step
+     */
+    size_t getNThreads() const { return m_n_threads; }
+
     /**
      * @brief Returns the internal statistics. Useful to parallelize the E-step
      */
@@ -162,6 +278,13 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
 
 
   protected:
+    /**
+     * @brief Saves/restores the statistics accumulators to/from a checkpoint
+     */
+    virtual bool saveAccumulators(bob::io::HDF5File& file) const;
+    virtual void loadAccumulators(bob::machine::KMeansMachine& kmeans,
+      bob::io::HDF5File& file);
+
     /**
      * @brief The initialization method
      * Check that there is no duplicated means during the random initialization
@@ -191,6 +314,33 @@ class KMeansTrainer: public EMTrainer<bob::machine::KMeansMachine, blitz::Array<
      * equation 9.4, Bishop, "Pattern recognition and machine learning", 2006
      */
     blitz::Array<double,2> m_firstOrderStats;
+
+    /**
+     * @brief Pruning of the distance computations, and its state: closest
+     * means and lower bounds of the samples, means of the last E-step
+     */
+    bool m_pruning;
+    blitz::Array<size_t,1> m_closest_means;
+    blitz::Array<double,1> m_lower_bounds;
+    blitz::Array<double,2> m_previous_means;
+
+    /**
+     * @brief Parameters of the k-means|| initialization
+     */
+    size_t m_kmeans_parallel_rounds;
+    double m_kmeans_parallel_oversampling;
+
+    /**
+     * @brief Size of the mini-batches (0 if disabled), and number of samples
+     * assigned to each mean since the initialization
+     */
+    size_t m_mini_batch_size;
+    blitz::Array<double,1> m_mini_batch_counts;
+
+    /**
+     * @brief The number of threads used by the initialization and the E-step
+     */
+    size_t m_n_threads;
 };
 
 /**
@@ -14,6 +14,7 @@
 
 #include <bob/trainer/GMMTrainer.h>
 #include <limits>
+#include <vector>
 
 namespace bob { namespace trainer {
 /**
@@ -80,6 +81,12 @@ class MAP_GMMTrainer: public GMMTrainer
      */
     bool setPriorGMM(boost::shared_ptr<bob::machine::GMMMachine> prior_gmm);
 
+    /**
+     * @brief Returns the GMM used as a prior for MAP adaptation
+     */
+    boost::shared_ptr<bob::machine::GMMMachine> getPriorGMM() const
+    { return m_prior_gmm; }
+
     /**
      * @brief Performs a maximum a posteriori (MAP) update of the GMM
      * parameters using the accumulated statistics in m_ss and the
@@ -97,6 +104,33 @@ class MAP_GMMTrainer: public GMMTrainer
     void setT3MAP(const double alpha) { m_T3_adaptation = true; m_T3_alpha = alpha; }
     void unsetT3MAP() { m_T3_adaptation = false; }
 
+    /**
+     * @brief Enrols several client models at once, by adapting the means
+     * of the prior GMM to the sufficient statistics of each client.
+     * The adapted mean supervector of the i-th client is written to the
+     * i-th row of supervectors, which should be of size
+     * n_clients x (n_gaussians*n_inputs), e.g. for linear scoring.
+     * This is equivalent to train() with a single iteration and only the
+     * means being updated (the weights and variances of the prior GMM are
+     * kept). The clients are processed by several threads, which share
+     * the (read-only) prior GMM.
+     * @param n_threads The number of threads to use (0: number of hardware
+     *   threads)
+     */
+    void enrol(const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+      blitz::Array<double,2>& supervectors, const size_t n_threads=0) const;
+
+    /**
+     * @brief Enrols several client models at once, given the features of
+     * each client (one feature per row). The sufficient statistics of each
+     * client are accumulated against the prior GMM in per-thread buffers,
+     * before the means are adapted as above.
+     * @param n_threads The number of threads to use (0: number of hardware
+     *   threads)
+     */
+    void enrol(const std::vector<blitz::Array<double,2> >& features,
+      blitz::Array<double,2>& supervectors, const size_t n_threads=0) const;
+
   protected:
 
     /**
@@ -121,6 +155,17 @@ class MAP_GMMTrainer: public GMMTrainer
     bool m_T3_adaptation;
 
   private:
+    /**
+     * @brief Enrols the clients described by their features (if the
+     * features vector is not empty) or by their statistics, given as raw
+     * C-contiguous data. No check is performed.
+     */
+    void enrol_(const std::vector<const double*>& features,
+      const std::vector<size_t>& n_samples,
+      const std::vector<const double*>& n,
+      const std::vector<const double*>& sumPx,
+      blitz::Array<double,2>& supervectors, const size_t n_threads) const;
+
     /// cache to avoid re-allocation
     mutable blitz::Array<double,1> m_cache_alpha;
     mutable blitz::Array<double,1> m_cache_ml_weights;
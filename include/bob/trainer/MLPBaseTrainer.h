@@ -165,6 +165,21 @@ namespace bob { namespace trainer {
        */
       inline void setTrainBiases(bool v) { m_train_bias = v; }
 
+      /**
+       * @brief Gets the number of threads used by the forward and backward
+       * steps (0 means as many threads as hardware threads)
+       */
+      size_t getNThreads() const { return m_n_threads; }
+
+      /**
+       * @brief Sets the number of threads used by the forward and backward
+       * steps. Each batch is split into (at most 16) blocks of samples,
+       * depending only on the batch size, and the derivatives of the blocks
+       * are summed with a tree reduction: the results do not depend on the
+       * number of threads.
+       */
+      void setNThreads(size_t n_threads) { m_n_threads = n_threads; }
+
       /**
        * @brief Checks if a given machine is compatible with my inner settings.
        */
@@ -296,6 +311,7 @@ namespace bob { namespace trainer {
       boost::shared_ptr<bob::trainer::Cost> m_cost; ///< cost function to be minimized
       bool m_train_bias; ///< shall we be training biases? (default: true)
       size_t m_H; ///< number of hidden layers on the target machine
+      size_t m_n_threads; ///< number of threads (0 means hardware threads)
 
       std::vector<blitz::Array<double,2> > m_deriv; ///< derivatives of the cost wrt. the weights
       std::vector<blitz::Array<double,1> > m_deriv_bias; ///< derivatives of the cost wrt. the biases
@@ -303,6 +319,7 @@ namespace bob { namespace trainer {
       /// buffers that are dependent on the batch_size
       std::vector<blitz::Array<double,2> > m_error; ///< error (+deltas)
       std::vector<blitz::Array<double,2> > m_output; ///< layer output
+      std::vector<std::vector<double> > m_partial_deriv; ///< derivatives summed over each block of samples
   };
 
   /**
@@ -122,6 +122,18 @@ class PLDATrainer: public EMTrainer<bob::machine::PLDABase,
     bool getUseSumSecondOrder() const 
     { return m_use_sum_second_order; }
 
+    /**
+     * @brief Sets the number of threads used by the E- and M-steps (0 means
+     * as many threads as hardware threads). The results do not depend on
+     * the number of threads.
+     */
+    void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
+    /**
+     * @brief Gets the number of threads used by the E- and M-steps
+     */
+    size_t getNThreads() const
+    { return m_n_threads; }
+
     /**
      * @brief This enum defines different methods for initializing the \f$F\f$ 
      * subspace
@@ -227,6 +239,14 @@ class PLDATrainer: public EMTrainer<bob::machine::PLDABase,
     void enrol(bob::machine::PLDAMachine& plda_machine, 
       const blitz::Array<double,2>& ar) const;
 
+  protected:
+    /**
+     * @brief Saves/restores the statistics of the latent variables to/from a checkpoint
+     */
+    virtual bool saveAccumulators(bob::io::HDF5File& file) const;
+    virtual void loadAccumulators(bob::machine::PLDABase& machine,
+      bob::io::HDF5File& file);
+
   private: 
     //representation
     size_t m_dim_d; ///< Dimensionality of the input features
@@ -262,14 +282,13 @@ class PLDATrainer: public EMTrainer<bob::machine::PLDABase,
     std::map<size_t,blitz::Array<double,2> > m_cache_zeta; ///< \f$\zeta_{a} = \alpha + \eta^T \gamma_{a} \eta\f$
     std::map<size_t,blitz::Array<double,2> > m_cache_iota; ///< \f$\iota_{a} = -\gamma_{a} \eta\f$
 
+    size_t m_n_threads; ///< Number of threads (0 means hardware threads)
+
     // Working arrays
     mutable blitz::Array<double,1> m_tmp_nf_1; ///< vector of dimension dim_f
-    mutable blitz::Array<double,1> m_tmp_nf_2; ///< vector of dimension dim_f
-    mutable blitz::Array<double,1> m_tmp_ng_1; ///< vector of dimension dim_f
     mutable blitz::Array<double,1> m_tmp_D_1; ///< vector of dimension dim_d 
     mutable blitz::Array<double,1> m_tmp_D_2; ///< vector of dimension dim_d
     mutable blitz::Array<double,2> m_tmp_nfng_nfng; ///< matrix of dimension (dim_f+dim_g)x(dim_f+dim_g)
-    mutable blitz::Array<double,2> m_tmp_D_nfng_1; ///< matrix of dimension (dim_d)x(dim_f+dim_g)
     mutable blitz::Array<double,2> m_tmp_D_nfng_2; ///< matrix of dimension (dim_d)x(dim_f+dim_g)
 
     // internal methods
@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <bob/machine/SVM.h>
+#include <blitz/array.h>
 
 namespace bob { namespace trainer {
   /**
@@ -20,11 +21,88 @@ namespace bob { namespace trainer {
    * @{
    */
 
+  /**
+   * The normalized samples of a training set for an SVM, together with their
+   * pairwise inner products, which are computed once with a (blocked)
+   * matrix product. They allow to train several machines on the same data
+   * (e.g. for a grid search over the cost and the kernel parameters) with
+   * libsvm's precomputed kernels: the kernel matrix is derived from the
+   * inner products at each training, without any access to the features.
+   *
+   * The memory required is quadratic in the number of samples.
+   */
+  class SVMGramMatrix {
+
+    public: //api
+
+      /**
+       * Normalizes the samples of each class (one per row of each array)
+       * column-wise, and computes their inner products with n_threads
+       * threads (0 means as many threads as hardware threads).
+       */
+      SVMGramMatrix(const std::vector<blitz::Array<double,2> >& data,
+          const blitz::Array<double,1>& input_subtract,
+          const blitz::Array<double,1>& input_division,
+          const size_t n_threads=0);
+
+      /**
+       * Same as above, without normalization of the samples
+       */
+      SVMGramMatrix(const std::vector<blitz::Array<double,2> >& data,
+          const size_t n_threads=0);
+
+      size_t getNSamples() const { return m_samples.extent(0); }
+      size_t getNFeatures() const { return m_samples.extent(1); }
+      size_t getNClasses() const { return m_class_sizes.size(); }
+
+      /**
+       * The number of samples of each class. The samples of the classes are
+       * stored one after the other.
+       */
+      const std::vector<size_t>& getClassSizes() const { return m_class_sizes; }
+
+      /**
+       * The highest (1-based) index of a non-zero feature, which is used by
+       * libsvm to set a default gamma
+       */
+      int getMaxIndex() const { return m_max_index; }
+
+      /**
+       * The normalized samples (one per row)
+       */
+      const blitz::Array<double,2>& getSamples() const { return m_samples; }
+
+      /**
+       * The inner products between all the normalized samples
+       */
+      const blitz::Array<double,2>& getInnerProducts() const
+      { return m_inner_products; }
+
+      const blitz::Array<double,1>& getInputSubtraction() const
+      { return m_input_sub; }
+      const blitz::Array<double,1>& getInputDivision() const
+      { return m_input_div; }
+
+    private: //representation
+
+      void initialize(const std::vector<blitz::Array<double,2> >& data,
+          const size_t n_threads);
+
+      blitz::Array<double,1> m_input_sub; ///< input subtraction
+      blitz::Array<double,1> m_input_div; ///< input division
+      blitz::Array<double,2> m_samples; ///< normalized samples
+      blitz::Array<double,2> m_inner_products; ///< the (linear) Gram matrix
+      std::vector<size_t> m_class_sizes; ///< number of samples per class
+      int m_max_index; ///< highest index of a non-zero feature
+
+  };
+
   /**
    * This class emulates the behavior of the command line utility called
    * svm-train, from libsvm. These bindings do not support:
    *
-   * * Precomputed Kernels
+   * * Precomputed Kernels given by the user (the kernel can however be
+   *   computed from the inner products of an SVMGramMatrix)
    * * Regression Problems
    * * Different weights for every label (-wi option in svm-train)
    *
@@ -78,6 +156,30 @@ namespace bob { namespace trainer {
          const blitz::Array<double,1>& input_subtract,
          const blitz::Array<double,1>& input_division) const;
 
+      /**
+       * Trains a new machine on the samples of the given SVMGramMatrix, using
+       * a kernel matrix precomputed from their inner products. The returned
+       * machine uses the kernel of this trainer (and not a precomputed one),
+       * as well as the normalization of the SVMGramMatrix.
+       */
+      boost::shared_ptr<bob::machine::SupportVector> train
+        (const SVMGramMatrix& gram) const;
+
+      /**
+       * Sets the number of threads used to train the one-vs-one
+       * sub-problems of multi-class C_SVC and NU_SVC machines (0 means as
+       * many threads as hardware threads). Each thread uses its own kernel
+       * cache of getCacheSizeInMB() MB. The sub-problems are trained
+       * sequentially by libsvm if probability estimates are requested. The
+       * results do not depend on the number of threads.
+       */
+      void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
+
+      /**
+       * Gets the number of threads used to train the one-vs-one sub-problems
+       */
+      size_t getNThreads() const { return m_n_threads; }
+
       /**
        * Getters and setters for all parameters
        */
@@ -122,6 +224,7 @@ namespace bob { namespace trainer {
     private: //representation
 
       svm_parameter m_param; ///< training parametrization for libsvm
+      size_t m_n_threads; ///< number of threads for the sub-problems
       
   };
 
@@ -0,0 +1,190 @@
+/**
+ * @file bob/trainer/ScatterAccumulator.h
+ * @date Mon Oct 19 03:30:35 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Accumulates the per-class statistics (counts, means and within-class
+ * scatter) used by the FisherLDATrainer, the WCCNTrainer and the
+ * WhiteningTrainer, block by block
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#ifndef BOB_TRAINER_SCATTERACCUMULATOR_H
+#define BOB_TRAINER_SCATTERACCUMULATOR_H
+
+#include <blitz/array.h>
+#include <bob/io/HDF5File.h>
+#include <bob/trainer/HDF5Sampler.h>
+
+namespace bob { namespace trainer {
+/**
+ * @ingroup TRAINER
+ * @{
+ */
+
+/**
+ * @brief Accumulates the number of samples and the mean of each class, and
+ * the within-class scatter \f$S_w = \sum_{k} \sum_{n \in C_k}
+ * (x_n-m_k)(x_n-m_k)^T\f$, from blocks of samples given in any order.
+ *
+ * The samples of a class can be split into several blocks, possibly
+ * accumulated by different accumulators, which are then merged: the
+ * statistics of two sets of samples of the same class are combined
+ * exactly (Chan et al., "Updating formulae and a pairwise algorithm for
+ * computing sample variances", 1979). Only one scatter matrix is kept for
+ * all the classes, such that the memory used does not depend on the number
+ * of samples, and grows only with the number of classes times the
+ * dimensionality.
+ *
+ * Each block is processed by several threads (see setNThreads()), by
+ * chunks of samples whose statistics are combined in order, such that the
+ * results do not depend on the number of threads.
+ */
+class ScatterAccumulator {
+  public:
+    /**
+     * @brief Creates an empty accumulator for samples of the given
+     * dimensionality
+     */
+    ScatterAccumulator(const size_t n_features=0);
+
+    /**
+     * @brief Loads an accumulator from a configuration file
+     */
+    ScatterAccumulator(bob::io::HDF5File& config);
+
+    /**
+     * @brief Copy constructor
+     */
+    ScatterAccumulator(const ScatterAccumulator& other);
+
+    /**
+     * @brief Destructor
+     */
+    virtual ~ScatterAccumulator();
+
+    /**
+     * @brief Assignment operator
+     */
+    ScatterAccumulator& operator=(const ScatterAccumulator& other);
+
+    /**
+     * @brief Equal to
+     */
+    bool operator==(const ScatterAccumulator& other) const;
+
+    /**
+     * @brief Not equal to
+     */
+    bool operator!=(const ScatterAccumulator& other) const;
+
+    /**
+     * @brief Similar to
+     */
+    bool is_similar_to(const ScatterAccumulator& other,
+      const double r_epsilon=1e-5, const double a_epsilon=1e-8) const;
+
+    /**
+     * @brief Removes all the statistics, and sets the dimensionality of the
+     * samples
+     */
+    void reset(const size_t n_features);
+
+    /**
+     * @brief Adds a block of samples (one per row) of the given class. The
+     * classes do not need to be accumulated in order.
+     */
+    void accumulate(const size_t class_id, const blitz::Array<double,2>& block);
+
+    /**
+     * @brief Adds all the samples of the given sampler to the given class,
+     * by streaming its blocks
+     */
+    void accumulate(const size_t class_id, HDF5Sampler& sampler);
+
+    /**
+     * @brief Adds the statistics of another accumulator (e.g. filled by
+     * another process, or with another part of the data)
+     */
+    void merge(const ScatterAccumulator& other);
+
+    /**
+     * @brief Computes the within-class scatter Sw, the between-class scatter
+     * \f$S_b = \sum_{k} N_k (m-m_k)(m-m_k)^T\f$ and the overall mean m, as
+     * bob::math::scatters() does with all the samples at once
+     */
+    void scatters(blitz::Array<double,2>& Sw, blitz::Array<double,2>& Sb,
+      blitz::Array<double,1>& m) const;
+
+    /**
+     * @brief The dimensionality of the samples
+     */
+    size_t getNFeatures() const { return m_n_features; }
+
+    /**
+     * @brief The number of classes which have at least one sample
+     */
+    size_t getNClasses() const;
+
+    /**
+     * @brief The total number of samples
+     */
+    double getNSamples() const { return blitz::sum(m_counts); }
+
+    /**
+     * @brief The number of samples of each class (indexed by the class
+     * identifiers, from 0 to the largest one)
+     */
+    const blitz::Array<double,1>& getCounts() const { return m_counts; }
+
+    /**
+     * @brief The mean of each class (one per row)
+     */
+    const blitz::Array<double,2>& getMeans() const { return m_means; }
+
+    /**
+     * @brief The within-class scatter
+     */
+    const blitz::Array<double,2>& getScatter() const { return m_scatter; }
+
+    /**
+     * @brief Sets the number of threads used to accumulate a block (0 means
+     * as many threads as hardware threads)
+     */
+    void setNThreads(const size_t n_threads) { m_n_threads = n_threads; }
+
+    /**
+     * @brief Gets the number of threads used to accumulate a block
+     */
+    size_t getNThreads() const { return m_n_threads; }
+
+    /**
+     * @brief Loads the statistics from a configuration file
+     */
+    void load(bob::io::HDF5File& config);
+
+    /**
+     * @brief Saves the statistics to a configuration file
+     */
+    void save(bob::io::HDF5File& config) const;
+
+  private:
+    /**
+     * @brief Adds the given class (with no sample) if it does not exist yet
+     */
+    void addClass(const size_t class_id);
+
+    size_t m_n_features;
+    blitz::Array<double,1> m_counts; ///< number of samples of each class
+    blitz::Array<double,2> m_means; ///< mean of each class
+    blitz::Array<double,2> m_scatter; ///< within-class scatter
+    size_t m_n_threads;
+};
+
+/**
+ * @}
+ */
+}}
+
+#endif /* BOB_TRAINER_SCATTERACCUMULATOR_H */
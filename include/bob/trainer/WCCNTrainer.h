@@ -12,6 +12,7 @@
 
 #include "Trainer.h"
 #include <bob/machine/LinearMachine.h>
+#include <bob/trainer/ScatterAccumulator.h>
 #include <blitz/array.h>
 
 namespace bob { namespace trainer {
@@ -79,7 +80,22 @@ class WCCNTrainer: public Trainer<bob::machine::LinearMachine, std::vector<blitz
     virtual void train(bob::machine::LinearMachine& machine, 
         const std::vector<blitz::Array<double, 2> >& data);
 
+    /**
+     * @brief Trains the LinearMachine to perform the WCCN, from the
+     * statistics of the classes accumulated beforehand (see
+     * ScatterAccumulator), such that the data never has to be stored in
+     * memory at once. The classes without any sample are ignored.
+     */
+    void train(bob::machine::LinearMachine& machine, 
+        const ScatterAccumulator& accumulator);
+
   private: //representation
+    /**
+     * @brief Computes the Cholesky decomposition of the inverse of the
+     * normalized within-class scatter and updates the machine
+     */
+    void trainFromScatter(bob::machine::LinearMachine& machine,
+        blitz::Array<double,2>& Sw, const size_t n_classes) const;
 };
 
 /**
@@ -11,6 +11,7 @@
 
 #include "Trainer.h"
 #include <bob/machine/LinearMachine.h>
+#include <bob/trainer/ScatterAccumulator.h>
 #include <blitz/array.h>
 
 namespace bob { namespace trainer {
@@ -74,7 +75,23 @@ class WhiteningTrainer: public Trainer<bob::machine::LinearMachine, blitz::Array
     virtual void train(bob::machine::LinearMachine& machine, 
         const blitz::Array<double,2>& data);
 
+    /**
+     * @brief Trains the LinearMachine to perform the Whitening, from the
+     * statistics accumulated beforehand (see ScatterAccumulator), such that
+     * the data never has to be stored in memory at once. The covariance is
+     * the one of all the accumulated samples, whatever their class is.
+     */
+    void train(bob::machine::LinearMachine& machine, 
+        const ScatterAccumulator& accumulator);
+
   private: //representation
+    /**
+     * @brief Computes the Cholesky decomposition of the inverse covariance
+     * matrix and updates the machine
+     */
+    void trainFromCovariance(bob::machine::LinearMachine& machine,
+        const blitz::Array<double,1>& mean,
+        const blitz::Array<double,2>& cov) const;
 };
 
 /**
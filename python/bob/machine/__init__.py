@@ -19,5 +19,31 @@ def ztnorm_same_value(vect_a, vect_b):
       sameMatrix[j, i] = (vect_a[j] == vect_b[i])
   return sameMatrix
 
+def hdf5_to_flat(hdf5_filename, flat_filename, machine_type):
+  """Converts a machine stored in an HDF5 file to a flat binary file.
+
+     hdf5_filename The HDF5 file to read the machine from
+     flat_filename The flat binary file to write
+     machine_type The type of the machine (GMMMachine, IVectorMachine or PLDABase)
+  """
+  from .. import io
+  machine = machine_type(io.HDF5File(hdf5_filename))
+  machine.save_flat(flat_filename)
+
+def flat_to_hdf5(flat_filename, hdf5_filename):
+  """Converts a machine stored in a flat binary file to an HDF5 file.
+
+     flat_filename The flat binary file to read the machine from
+     hdf5_filename The HDF5 file to write
+  """
+  from .. import io
+  types = {'GMMMachine': GMMMachine, 'IVectorMachine': IVectorMachine, 'PLDABase': PLDABase}
+  machine_type = FlatFile(flat_filename).type
+  if machine_type not in types:
+    raise RuntimeError("unsupported machine type '%s' in flat file '%s'" % (machine_type, flat_filename))
+  machine = types[machine_type]()
+  machine.load_flat(flat_filename)
+  machine.save(io.HDF5File(hdf5_filename, 'w'))
+
 __all__ = [k for k in dir() if not k.startswith('_')]
 if 'k' in locals(): del k
@@ -201,6 +201,22 @@ def test_2d_ndarray():
     assert is_close(op.f_prime(x), Y_f_prime.flat[k])
     assert is_close(op.f_prime_from_f(x), Y_f_prime_from_f.flat[k])
 
+def test_2d_all_activations():
+
+  X = numpy.random.rand(6, 5) - 0.5
+  for op in (IdentityActivation(), LinearActivation(2.), \
+      HyperbolicTangentActivation(), MultipliedHyperbolicTangentActivation(), \
+      LogisticActivation()):
+
+    # whole arrays are processed at once, also when they are not contiguous
+    for A in (X, X.T):
+      Y_f = op.f(A)
+      Y_f_prime_from_f = op.f_prime_from_f(Y_f)
+      for k in range(A.shape[0]):
+        for l in range(A.shape[1]):
+          assert is_close(op.f(A[k,l]), Y_f[k,l])
+          assert is_close(op.f_prime_from_f(Y_f[k,l]), Y_f_prime_from_f[k,l])
+
 def test_3d_ndarray():
 
   C = numpy.random.rand()
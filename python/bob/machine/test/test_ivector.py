@@ -11,6 +11,7 @@
 
 import unittest
 import bob, numpy, numpy.linalg, numpy.random
+import os, tempfile
 
 
 ### Test class inspired by an implementation of Chris McCool
@@ -154,3 +155,52 @@ class IVectorTests(unittest.TestCase):
     wij = mc.forward(gs)
     self.assertTrue(numpy.allclose(wij_ref, wij, 1e-5))
 
+
+  def test02_flat(self):
+    # Ubm
+    ubm = bob.machine.GMMMachine(2,3)
+    ubm.weights = numpy.array([0.4,0.6])
+    ubm.means = numpy.array([[1.,7,4],[4,5,3]])
+    ubm.variances = numpy.array([[0.5,1.,1.5],[1.,1.5,2.]])
+
+    gs = bob.machine.GMMStats(2,3)
+    gs.t = 1
+    gs.n = numpy.array([0.4, 0.6], numpy.float64)
+    gs.sum_px = numpy.array([[1., 2., 3.], [2., 4., 3.]], numpy.float64)
+
+    m = bob.machine.IVectorMachine(ubm, 2)
+    m.t = numpy.array([[1.,2],[4,1],[0,3],[5,8],[7,10],[11,1]])
+    m.sigma = numpy.array([1.,2.,1.,3.,2.,4.])
+
+    # Saves the UBM and the machine to flat files, and maps them
+    ubm_filename = str(tempfile.mkstemp(".flat")[1])
+    filename = str(tempfile.mkstemp(".flat")[1])
+    ubm.save_flat(ubm_filename)
+    m.save_flat(filename)
+    ubm_mapped = bob.machine.GMMMachine()
+    ubm_mapped.load_flat(ubm_filename)
+    self.assertTrue(ubm_mapped == ubm)
+    m_mapped = bob.machine.IVectorMachine()
+    m_mapped.ubm = ubm_mapped
+    m_mapped.load_flat(filename)
+    self.assertTrue(m_mapped == m)
+    self.assertTrue(numpy.allclose(m_mapped.forward(gs), m.forward(gs), 1e-10))
+
+    # Modifying the mapped machine does not modify the file
+    m_mapped.sigma = numpy.array([2.,2.,1.,3.,2.,4.])
+    m_mapped2 = bob.machine.IVectorMachine()
+    m_mapped2.ubm = ubm
+    m_mapped2.load_flat(filename)
+    self.assertTrue(m_mapped2 == m)
+
+    # Conversions from and to HDF5
+    hdf5_filename = str(tempfile.mkstemp(".hdf5")[1])
+    bob.machine.flat_to_hdf5(ubm_filename, hdf5_filename)
+    self.assertTrue(bob.machine.GMMMachine(bob.io.HDF5File(hdf5_filename)) == ubm)
+    bob.machine.hdf5_to_flat(hdf5_filename, ubm_filename, bob.machine.GMMMachine)
+    self.assertEqual(bob.machine.FlatFile(ubm_filename).type, 'GMMMachine')
+
+    del m_mapped, m_mapped2
+    os.unlink(ubm_filename)
+    os.unlink(filename)
+    os.unlink(hdf5_filename)
@@ -372,3 +372,60 @@ class FATest(unittest.TestCase):
 
     # Clean-up
     os.unlink(filename)
+
+  def test05_batch_scoring(self):
+
+    # Creates a UBM and random subspaces
+    numpy.random.seed(5)
+    ubm = bob.machine.GMMMachine(4,3)
+    ubm.weights = numpy.array([0.1, 0.2, 0.3, 0.4], 'float64')
+    ubm.means = numpy.random.randn(4,3)
+    ubm.variances = numpy.random.rand(4,3) + 0.5
+    jfa_base = bob.machine.JFABase(ubm,2,2)
+    jfa_base.u = numpy.random.randn(12,2)
+    jfa_base.v = numpy.random.randn(12,2)
+    jfa_base.d = numpy.random.rand(12)
+    isv_base = bob.machine.ISVBase(ubm,2)
+    isv_base.u = numpy.random.randn(12,2)
+    isv_base.d = numpy.random.rand(12)
+
+    # Creates the client models
+    jfa_models = []
+    isv_models = []
+    for i in range(5):
+      m = bob.machine.JFAMachine(jfa_base)
+      m.y = numpy.random.randn(2)
+      m.z = numpy.random.randn(12)
+      jfa_models.append(m)
+      m = bob.machine.ISVMachine(isv_base)
+      m.z = numpy.random.randn(12)
+      isv_models.append(m)
+
+    # Creates the probes (more than a block of statistics)
+    probes = []
+    for i in range(40):
+      gs = bob.machine.GMMStats(4,3)
+      gs.n = numpy.random.rand(4) * 10
+      gs.sum_px = numpy.random.randn(4,3) * 10
+      gs.t = int(gs.n.sum()) + 1
+      probes.append(gs)
+
+    # Ux of all the probes at once
+    ux = isv_base.estimate_ux(probes, 3)
+    self.assertEqual(ux.shape, (40, 12))
+    ux_ref = numpy.ndarray((12,), numpy.float64)
+    for p in range(40):
+      isv_models[0].estimate_ux(probes[p], ux_ref)
+      self.assertTrue(numpy.allclose(ux[p,:], ux_ref, 1e-10, 1e-10))
+
+    # Scores of all the models against all the probes
+    for (scoring, models) in ((bob.machine.jfa_scoring, jfa_models), (bob.machine.isv_scoring, isv_models)):
+      ref_scores = numpy.array([[m.forward(p) for p in probes] for m in models])
+      for n_threads in (1, 4):
+        scores = scoring(models, probes, n_threads)
+        self.assertTrue(numpy.allclose(scores, ref_scores, 1e-10, 1e-10))
+
+    # The models should share the same base
+    other = bob.machine.ISVMachine(bob.machine.ISVBase(isv_base))
+    other.z = numpy.random.randn(12)
+    self.assertRaises(RuntimeError, bob.machine.isv_scoring, isv_models + [other], probes)
@@ -73,3 +73,20 @@ class KMeansMachineTest(unittest.TestCase):
 
     # Clean-up
     os.unlink(filename)
+
+  def test02_get_closest_means(self):
+    # Batched search of the closest means
+    numpy.random.seed(0)
+    means = numpy.random.randn(7, 4)
+    data = numpy.random.randn(600, 4) * 2.
+    km = bob.machine.KMeansMachine(7, 4)
+    km.means = means
+
+    for n_threads in (1, 3):
+      (indices, distances) = km.get_closest_means(data, n_threads)
+      self.assertEqual( indices.shape, (600,) )
+      self.assertEqual( distances.shape, (600,) )
+      for k in range(data.shape[0]):
+        (index, dist) = km.get_closest_mean(data[k,:])
+        self.assertEqual( indices[k], index )
+        self.assertTrue( equals(distances[k], dist, 1e-10) )
@@ -227,3 +227,30 @@ class MachineTest(unittest.TestCase):
     self.assertTrue( m1 != m6 )
     self.assertFalse( m1.is_similar_to(m6) )
 
+
+  def test05_BatchForward(self):
+
+    # Tests the 2D forward against the projection of each sample
+    numpy.random.seed(0)
+    m = bob.machine.LinearMachine(numpy.random.randn(5, 3))
+    m.input_subtract = numpy.random.randn(5)
+    m.input_divide = numpy.random.rand(5) + 0.5
+    m.biases = numpy.random.randn(3)
+    m.activation = bob.machine.HyperbolicTangentActivation()
+
+    data = numpy.random.randn(2500, 5)
+    output = m(data)
+    self.assertEqual(output.shape, (2500, 3))
+    for i in range(data.shape[0]):
+      self.assertTrue ( numpy.allclose(output[i,:], m(data[i,:]), rtol=0, atol=1e-10) )
+
+    # float32 output
+    output32 = numpy.ndarray((2500, 3), 'float32')
+    m(data, output32)
+    self.assertTrue ( numpy.allclose(output32, output, rtol=0, atol=1e-6) )
+
+    # new parameters are taken into account
+    m.input_subtract = numpy.random.randn(5)
+    output = m(data)
+    for i in range(data.shape[0]):
+      self.assertTrue ( numpy.allclose(output[i,:], m(data[i,:]), rtol=0, atol=1e-10) )
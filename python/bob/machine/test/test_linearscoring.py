@@ -126,3 +126,37 @@ class LinearScoringTest(unittest.TestCase):
     self.assertTrue(abs(score - ref_scores_11[1,1]) < 1e-7)
     score = bob.machine.linear_scoring(model2.mean_supervector, ubm.mean_supervector, ubm.variance_supervector, stats3, test_channeloffset[2], True)
     self.assertTrue(abs(score - ref_scores_11[1,2]) < 1e-7)
+
+  def test02_LinearScorer(self):
+    # Many statistics and supervectors longer than a block, to process
+    # several tiles of scores and several blocks of the supervectors
+    numpy.random.seed(3)
+    C = 1000; D = 3
+    ubm = bob.machine.GMMMachine(C, D)
+    ubm.means = numpy.random.randn(C, D)
+    ubm.variances = numpy.random.rand(C, D) + 0.5
+    models = [numpy.random.randn(C*D) for i in range(3)]
+    stats = []
+    for i in range(150):
+      s = bob.machine.GMMStats(C, D)
+      s.n = numpy.random.rand(C)
+      s.sum_px = numpy.random.randn(C, D)
+      s.t = int(s.n.sum()) + 1
+      stats.append(s)
+    offsets = [numpy.random.randn(C*D) for s in stats]
+
+    scorer = bob.machine.LinearScorer(models, ubm.mean_supervector, ubm.variance_supervector)
+    self.assertEqual(scorer.n_models, 3)
+    self.assertEqual(scorer.supervector_length, C*D)
+    for normalise in (False, True):
+      ref_scores = numpy.array([[bob.machine.linear_scoring(m, ubm.mean_supervector, ubm.variance_supervector, s, numpy.zeros((C*D,)), normalise) for s in stats] for m in models])
+      ref_scores_o = numpy.array([[bob.machine.linear_scoring(m, ubm.mean_supervector, ubm.variance_supervector, s, o, normalise) for (s, o) in zip(stats, offsets)] for m in models])
+      for n_threads in (1, 4):
+        scores = scorer(stats, [], normalise, n_threads)
+        self.assertTrue(numpy.allclose(scores, ref_scores, rtol=1e-10, atol=1e-8))
+        scores = scorer(stats, offsets, normalise, n_threads)
+        self.assertTrue(numpy.allclose(scores, ref_scores_o, rtol=1e-10, atol=1e-8))
+      # The scorer is reused, and results do not depend on the number of threads
+      self.assertTrue((scorer(stats, offsets, normalise, 1) == scorer(stats, offsets, normalise, 3)).all())
+      scores = bob.machine.linear_scoring(models, ubm.mean_supervector, ubm.variance_supervector, stats, offsets, normalise, 2)
+      self.assertTrue(numpy.allclose(scores, ref_scores_o, rtol=1e-10, atol=1e-8))
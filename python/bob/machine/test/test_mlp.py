@@ -139,6 +139,25 @@ def test_100in_100_10_4out():
 
   X = numpy.random.rand(20,100)
   assert numpy.allclose(m(X), pymac.forward(X), rtol=1e-10, atol=1e-15)
+def test_batch_forward():
+
+  m = MLP((10,7,5,3))
+  m.hidden_activation = LogisticActivation()
+  m.randomize()
+  m.input_subtract = numpy.random.rand(10)
+  m.input_divide = 0.5 + numpy.random.rand(10)
+
+  # the batch forward matches the one of individual samples
+  X = numpy.random.rand(25,10)
+  Y = m(X)
+  for k,x in enumerate(X):
+    assert numpy.allclose(Y[k], m(x), rtol=1e-10, atol=1e-15)
+
+  # also with a non C-contiguous input
+  Y2 = numpy.zeros((25,3), 'float64')
+  m.forward(numpy.asfortranarray(X), Y2)
+  assert numpy.allclose(Y, Y2, rtol=1e-10, atol=1e-15)
+
 def test_resize():
     
   m = MLP((2,3,5,1))
@@ -313,6 +313,25 @@ class PLDAMachineTest(unittest.TestCase):
     self.assertTrue(m_loaded.has_log_like_const_term(3))
     self.assertTrue(abs(m_loaded.get_add_log_like_const_term(3) - constTerm3) < 1e-10)
 
+    # Saves to a flat file, maps it and compares to original
+    flat_filename = str(tempfile.mkstemp(".flat")[1])
+    m.save_flat(flat_filename)
+    m_mapped = bob.machine.PLDABase()
+    m_mapped.load_flat(flat_filename)
+    self.assertTrue(m_mapped == m)
+    self.assertTrue(m_mapped.has_gamma(3))
+    self.assertTrue(equals(m_mapped.get_gamma(3), gamma3_ref, 1e-10))
+    self.assertTrue(abs(m_mapped.get_add_log_like_const_term(3) - constTerm3) < 1e-10)
+    flat_file = bob.machine.FlatFile(flat_filename)
+    self.assertEqual(flat_file.type, 'PLDABase')
+    self.assertTrue('Ft_beta' in flat_file)
+    del flat_file
+    # Converts it back to HDF5
+    bob.machine.flat_to_hdf5(flat_filename, filename)
+    self.assertTrue(bob.machine.PLDABase(bob.io.HDF5File(filename)) == m)
+    del m_mapped
+    os.unlink(flat_filename)
+
     # Compares the values loaded with the former ones when copying
     m_copy = bob.machine.PLDABase(m_loaded)
     self.assertTrue(m_loaded == m_copy)
@@ -559,3 +578,36 @@ class PLDAMachineTest(unittest.TestCase):
     # and [x3] separately
     llr_ref = -4.43695386675
     self.assertTrue(abs((llX - (llY + llZ)) - llr_ref) < 1e-10)
+
+  def test06_plda_scoring(self):
+    # Defines base machine
+    mb = bob.machine.PLDABase(C_dim_d, C_dim_f, C_dim_g)
+    mb.mu = numpy.random.randn(C_dim_d)
+    mb.f = C_F
+    mb.g = C_G
+    mb.sigma = 0.01 * numpy.ones((C_dim_d,), 'float64')
+
+    # Enrols models with different numbers of samples
+    machines = []
+    for n in (1, 3, 3, 0):
+      m = bob.machine.PLDAMachine(mb)
+      if n > 0:
+        x = numpy.random.randn(n, C_dim_d) - mb.mu
+        m.n_samples = n
+        m.weighted_sum = numpy.dot(mb.__ft_beta__, x.T).sum(axis=1)
+        m.w_sum_xit_beta_xi = -0.5 * sum([numpy.dot(xi, numpy.dot(mb.__beta__, xi)) for xi in x])
+        m.log_likelihood = m.compute_log_likelihood(x + mb.mu, False)
+      machines.append(m)
+
+    # Scores many probes against the models at once
+    probes = numpy.random.randn(11, C_dim_d)
+    for n_threads in (1, 4):
+      scores = bob.machine.plda_scoring(machines, probes, n_threads)
+      self.assertEqual(scores.shape, (11, len(machines)))
+      for p in range(probes.shape[0]):
+        for i, m in enumerate(machines):
+          self.assertTrue(abs(scores[p,i] - m.forward(probes[p,:])) < 1e-8)
+
+    # The caches of the machines are not modified
+    for m in machines:
+      self.assertFalse(m.has_gamma(4))
@@ -282,3 +282,46 @@ class SvmTest(unittest.TestCase):
     pred_label = machine.predict_classes(data)
 
     self.assertEqual(pred_label, expected_iris_predictions)
+
+  @utils.libsvm_available
+  def test08_batch_linear(self):
+
+    #trains a 3-class linear SVM: batch predictions use collapsed weights
+    labels, data = bob.machine.SVMFile(IRIS_DATA).read_all()
+    classes = [numpy.vstack([k for i,k in enumerate(data) if labels[i] == c])
+        for c in (1, 2, 3)]
+    data = numpy.vstack(data)
+
+    trainer = bob.trainer.SVMTrainer(
+        kernel_type=bob.machine.svm_kernel_type.LINEAR)
+    machine = trainer.train(classes)
+    self.assertEqual(machine.kernel_type, bob.machine.svm_kernel_type.LINEAR)
+    machine.input_subtract = 0.1 * numpy.arange(machine.shape[0])
+    machine.input_divide = 1. + 0.5 * numpy.arange(machine.shape[0])
+
+    pred_lab_values = [machine.predict_class_and_scores(k) for k in data]
+    for n_threads in (1, 3):
+      pred_labels, pred_scores = machine.predict_classes_and_scores(data,
+          n_threads)
+      self.assertEqual(tuple([k[0] for k in pred_lab_values]), pred_labels)
+      self.assertTrue( numpy.all(abs(numpy.vstack([k[1] for k in
+        pred_lab_values]) - numpy.vstack(pred_scores)) < 1e-10) )
+      self.assertEqual(pred_labels, machine.predict_classes(data, n_threads))
+
+  @utils.libsvm_available
+  def test09_batch_threads(self):
+
+    #multi-threaded predictions are identical to the single-threaded ones
+    machine = bob.machine.SupportVector(HEART_MACHINE)
+    labels, data = bob.machine.SVMFile(HEART_DATA).read_all()
+    data = numpy.vstack(data)
+
+    pred_labels, pred_probs = machine.predict_classes_and_probabilities(data,
+        1)
+    pred_labels4, pred_probs4 = machine.predict_classes_and_probabilities(
+        data, 4)
+    self.assertEqual(pred_labels, pred_labels4)
+    self.assertTrue( numpy.all(numpy.vstack(pred_probs) ==
+      numpy.vstack(pred_probs4)) )
+    self.assertEqual(expected_heart_predictions,
+        machine.predict_classes(data, 4))
@@ -10,6 +10,7 @@
 """
 
 import os, sys
+import tempfile
 import unittest
 import numpy
 import bob
@@ -124,3 +125,41 @@ class ZTNormTest(unittest.TestCase):
     empty = numpy.zeros(shape=(0,0), dtype=numpy.float64)
     zA = bob.machine.ztnorm(my_A, my_B, empty, empty)
     self.assertTrue((abs(zA - zA_py) < 1e-7).all())
+
+  def test05_ztnorm_engine(self):
+    my_A = bob.io.load(F("ztnorm_eval_eval.mat"))
+    my_B = bob.io.load(F("ztnorm_znorm_eval.mat"))
+    my_C = bob.io.load(F("ztnorm_eval_tnorm.mat"))
+    my_D = bob.io.load(F("ztnorm_znorm_tnorm.mat"))
+    mask = numpy.zeros(my_D.shape, 'bool')
+    mask[0,1] = True
+    mask[1,0] = True
+    ref_scores = bob.machine.ztnorm(my_A, my_B, my_C, my_D, mask)
+
+    # Statistics computed from blocks of models and of probes
+    ztnorm = bob.machine.ZTNorm()
+    for i in range(0, my_B.shape[0], 3):
+      ztnorm.append_z_statistics(my_B[i:i+3,:], 2)
+    ztnorm.set_tmodels_statistics(my_D, mask)
+    for j in range(0, my_C.shape[1], 4):
+      ztnorm.append_t_statistics(my_C[:,j:j+4], 2)
+    self.assertEqual(ztnorm.z_means.shape, (my_A.shape[0],))
+    self.assertEqual(ztnorm.t_means.shape, (my_A.shape[1],))
+
+    # Normalisation by tiles
+    scores = numpy.ndarray(my_A.shape, 'float64')
+    for i in range(0, my_A.shape[0], 5):
+      for j in range(0, my_A.shape[1], 7):
+        scores[i:i+5,j:j+7] = ztnorm.normalize(my_A[i:i+5,j:j+7], i, j, 3)
+    self.assertTrue((abs(scores - ref_scores) < 1e-10).all())
+    self.assertRaises(RuntimeError, ztnorm.normalize, my_A, 1, 0)
+
+    # Normalisation from and to HDF5 files
+    raw_filename = str(tempfile.mkstemp(".hdf5")[1])
+    norm_filename = str(tempfile.mkstemp(".hdf5")[1])
+    bob.io.HDF5File(raw_filename, 'w').set('scores', my_A)
+    ztnorm.normalize_file(bob.io.HDF5File(raw_filename), 'scores', bob.io.HDF5File(norm_filename, 'w'), 'scores', 4)
+    scores = bob.io.HDF5File(norm_filename).read('scores')
+    self.assertTrue((abs(scores - ref_scores) < 1e-10).all())
+    os.unlink(raw_filename)
+    os.unlink(norm_filename)
@@ -89,3 +89,17 @@ class BICTrainerAndMachineTest(unittest.TestCase):
     self.assertAlmostEqual(machine(self.eval_data(0)), 0.)
     # while a positive vector should give a positive result
     self.assertTrue(machine(self.eval_data(1)) > 0.)
+
+  def test_batch(self):
+    # Tests that scoring a set of vectors at once gives the same results
+    intra_data, extra_data = self.training_data()
+    numpy.random.seed(0)
+    probes = numpy.random.randn(1000, 5) * 5.
+
+    for machine, trainer in ((bob.machine.BICMachine(), bob.trainer.BICTrainer()),
+                             (bob.machine.BICMachine(False), bob.trainer.BICTrainer(2,2))):
+      trainer.train(machine, intra_data, extra_data)
+      reference = numpy.array([machine(probe) for probe in probes])
+      self.assertTrue(equals(machine(probes), reference, 1e-10))
+      self.assertTrue(equals(machine.forward(probes, n_threads=1), reference, 1e-10))
+      self.assertTrue(equals(machine.forward_(probes, n_threads=3), reference, 1e-10))
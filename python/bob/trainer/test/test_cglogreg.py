@@ -143,3 +143,32 @@ class CGLogRegTest(unittest.TestCase):
       self.assertTrue( abs(machine(test2) - res2) < 1e-3 )
 
 
+
+  def test03_cglogreg_threads_lbfgs(self):
+
+    pos1 = bob.io.load(bob.test.utils.datafile('positives_isv.hdf5', 'bob.trainer.test', 'data'))
+    neg1 = bob.io.load(bob.test.utils.datafile('negatives_isv.hdf5', 'bob.trainer.test', 'data'))
+
+    pos2 = bob.io.load(bob.test.utils.datafile('positives_lda.hdf5', 'bob.trainer.test', 'data'))
+    neg2 = bob.io.load(bob.test.utils.datafile('negatives_lda.hdf5', 'bob.trainer.test', 'data'))
+
+    negatives = numpy.vstack((neg1, neg2)).T
+    positives = numpy.vstack((pos1, pos2)).T
+
+    # The results do not depend on the number of threads
+    T = bob.trainer.CGLogRegTrainer(0.5, 1e-10, 10000, 1., True)
+    T.n_threads = 1
+    machine1 = T.train(negatives, positives)
+    T.n_threads = 4
+    machine2 = T.train(negatives, positives)
+    self.assertTrue( (machine1.weights == machine2.weights).all() )
+    self.assertTrue( (machine1.biases == machine2.biases).all() )
+
+    # L-BFGS reaches the same optimum as the conjugate gradient
+    T.solver = bob.trainer.CGLogRegTrainer.LBFGS
+    self.assertEqual( T.solver, bob.trainer.CGLogRegTrainer.LBFGS )
+    T.convergence_threshold = 1e-8
+    T.max_iterations = 0
+    machine3 = T.train(negatives, positives)
+    self.assertTrue( (abs(machine3.weights - machine1.weights) < 1e-3).all() )
+    self.assertTrue( (abs(machine3.biases - machine1.biases) < 1e-3).all() )
@@ -8,6 +8,7 @@
 """Test trainer package
 """
 import os, sys
+import tempfile
 import unittest
 import bob
 import random
@@ -248,3 +249,164 @@ class GMMTest(unittest.TestCase):
     
     for i in range(0, 2):
       self.assertTrue((ar[i+1] == machine.means[i, :]).all())
+
+  def test08_gmm_MAP_enrol(self):
+
+    # Enrols several clients at once, and compares to the models obtained
+    # by adapting the prior GMM to each client separately
+
+    ar = bob.io.load(F('dataforMAP.hdf5'))
+
+    n_gaussians = 5
+    n_inputs = 45
+    prior_gmm = bob.machine.GMMMachine(n_gaussians, n_inputs)
+    prior_gmm.means = bob.io.load(F('meansAfterML.hdf5'))
+    prior_gmm.variances = bob.io.load(F('variancesAfterML.hdf5'))
+    prior_gmm.weights = bob.io.load(F('weightsAfterML.hdf5'))
+    prior_gmm.set_variance_thresholds(0.001)
+
+    map_gmmtrainer = bob.trainer.MAP_GMMTrainer(4., True, False, False, 0.001)
+    map_gmmtrainer.max_iterations = 1
+    map_gmmtrainer.set_prior_gmm(prior_gmm)
+
+    clients = [ar[0:5,:], ar[5:15,:], ar[15:,:], ar[::3,:]]
+    supervectors_ref = []
+    stats = []
+    for data in clients:
+      gmm = bob.machine.GMMMachine(n_gaussians, n_inputs)
+      gmm.set_variance_thresholds(0.001)
+      map_gmmtrainer.train(gmm, data)
+      supervectors_ref.append(gmm.mean_supervector)
+      s = bob.machine.GMMStats(n_gaussians, n_inputs)
+      prior_gmm.acc_statistics(data, s)
+      stats.append(s)
+    supervectors_ref = numpy.vstack(supervectors_ref)
+
+    for n_threads in (1, 3):
+      supervectors = map_gmmtrainer.enrol(clients, n_threads=n_threads)
+      self.assertEqual(supervectors.shape, (len(clients), n_gaussians * n_inputs))
+      self.assertTrue(equals(supervectors, supervectors_ref, 1e-10))
+      self.assertTrue(equals(map_gmmtrainer.enrol(stats, n_threads), supervectors_ref, 1e-10))
+
+  def test09_gmm_ML_threads(self):
+
+    # The E-step is split into chunks, whose statistics are summed in a
+    # fixed order: the results should not depend on the number of threads
+
+    ar = bob.io.load(F('dataNormalized.hdf5'))
+    ar = numpy.vstack([ar, ar[::-1,:] * 0.9, ar * 1.1])
+
+    gmms = []
+    for n_threads in (1, 2, 5):
+      gmm = bob.machine.GMMMachine(5, 45)
+      gmm.means = bob.io.load(F('meansAfterKMeans.hdf5')).astype('float64')
+      gmm.variances = bob.io.load(F('variancesAfterKMeans.hdf5')).astype('float64')
+      gmm.weights = numpy.exp(bob.io.load(F('weightsAfterKMeans.hdf5')).astype('float64'))
+      gmm.set_variance_thresholds(0.001)
+
+      ml_gmmtrainer = bob.trainer.ML_GMMTrainer(True, True, True, 0.001)
+      ml_gmmtrainer.max_iterations = 5
+      ml_gmmtrainer.n_threads = n_threads
+      self.assertEqual(ml_gmmtrainer.n_threads, n_threads)
+      ml_gmmtrainer.train(gmm, ar)
+      gmms.append(gmm)
+
+    self.assertTrue(gmms[0] == gmms[1])
+    self.assertTrue(gmms[0] == gmms[2])
+
+  def test10_gmm_ML_sampler(self):
+
+    # Streaming the data from several HDF5 files by blocks (multiple of 1024
+    # samples) gives the same GMM as training with all the data in memory
+
+    ar = bob.io.load(F('dataNormalized.hdf5'))
+    ar = numpy.vstack([ar, ar[::-1,:] * 0.9, ar * 1.1])
+    bounds = [0, ar.shape[0] // 3, ar.shape[0] // 2, ar.shape[0]]
+    filenames = []
+    for i in range(len(bounds)-1):
+      filenames.append(str(tempfile.mkstemp(".hdf5")[1]))
+      bob.io.save(ar[bounds[i]:bounds[i+1],:], filenames[-1])
+
+    sampler = bob.trainer.HDF5Sampler(filenames, '/array', 1024)
+    self.assertEqual(sampler.n_samples, ar.shape[0])
+    self.assertEqual(sampler.n_inputs, ar.shape[1])
+    blocks = []
+    block = sampler.next()
+    while block is not None:
+      blocks.append(block)
+      block = sampler.next()
+    self.assertEqual(len(blocks), sampler.n_blocks)
+    self.assertTrue((numpy.vstack(blocks) == ar).all())
+    self.assertTrue((sampler.read(bounds[1]) == ar[bounds[1],:]).all())
+
+    gmms = []
+    for data in (ar, sampler):
+      gmm = bob.machine.GMMMachine(5, 45)
+      gmm.means = bob.io.load(F('meansAfterKMeans.hdf5')).astype('float64')
+      gmm.variances = bob.io.load(F('variancesAfterKMeans.hdf5')).astype('float64')
+      gmm.weights = numpy.exp(bob.io.load(F('weightsAfterKMeans.hdf5')).astype('float64'))
+      gmm.set_variance_thresholds(0.001)
+
+      ml_gmmtrainer = bob.trainer.ML_GMMTrainer(True, True, True, 0.001)
+      ml_gmmtrainer.max_iterations = 5
+      ml_gmmtrainer.train(gmm, data)
+      gmms.append(gmm)
+
+    self.assertTrue(gmms[0] == gmms[1])
+
+    del sampler
+    for filename in filenames:
+      os.unlink(filename)
+
+  def test11_gmm_ML_checkpoint(self):
+
+    # Training resumed from a checkpoint gives the same GMM as an
+    # uninterrupted training, and keeps the telemetry of all the iterations
+
+    ar = bob.io.load(F('dataNormalized.hdf5'))
+
+    def new_gmm():
+      gmm = bob.machine.GMMMachine(5, 45)
+      gmm.means = bob.io.load(F('meansAfterKMeans.hdf5')).astype('float64')
+      gmm.variances = bob.io.load(F('variancesAfterKMeans.hdf5')).astype('float64')
+      gmm.weights = numpy.exp(bob.io.load(F('weightsAfterKMeans.hdf5')).astype('float64'))
+      gmm.set_variance_thresholds(0.001)
+      return gmm
+
+    def new_trainer(max_iterations):
+      ml_gmmtrainer = bob.trainer.ML_GMMTrainer(True, True, True, 0.001)
+      ml_gmmtrainer.convergence_threshold = 1e-12
+      ml_gmmtrainer.max_iterations = max_iterations
+      return ml_gmmtrainer
+
+    # Uninterrupted training
+    gmm_ref = new_gmm()
+    trainer = new_trainer(6)
+    trainer.train(gmm_ref, ar)
+    telemetry_ref = trainer.telemetry
+    self.assertEqual([t.iteration for t in telemetry_ref], list(range(7)))
+    self.assertTrue(numpy.isnan(telemetry_ref[0].delta))
+    for t in telemetry_ref[1:]:
+      self.assertTrue(t.e_step_time >= 0. and t.m_step_time >= 0.)
+      self.assertFalse(numpy.isnan(t.delta))
+
+    # Training interrupted after 4 iterations, with a checkpoint every 2
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    gmm = new_gmm()
+    trainer = new_trainer(4)
+    trainer.set_checkpoint(filename, 2)
+    self.assertEqual(trainer.checkpoint_filename, filename)
+    self.assertEqual(trainer.checkpoint_period, 2)
+    trainer.train(gmm, ar)
+
+    # Resumes from the checkpoint (after iteration 2)
+    gmm = new_gmm()
+    trainer = new_trainer(6)
+    trainer.resume(gmm, ar, filename)
+    self.assertTrue(gmm == gmm_ref)
+    telemetry = trainer.telemetry
+    self.assertEqual([t.iteration for t in telemetry], list(range(7)))
+    for (t, t_ref) in zip(telemetry, telemetry_ref):
+      self.assertEqual(t.average_output, t_ref.average_output)
+
+    os.unlink(filename)
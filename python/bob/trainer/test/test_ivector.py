@@ -361,3 +361,43 @@ class IVectorTests(unittest.TestCase):
       self.assertTrue(numpy.allclose(t_ref[it], m.t, 1e-5))
       self.assertTrue(numpy.allclose(sigma_ref[it], m.sigma, 1e-5))
 
+
+  def test03_trainer_n_threads(self):
+    # Random statistics of more utterances than the size of the blocks of
+    # the E-step
+    numpy.random.seed(0)
+    dim_c = 4
+    dim_d = 3
+    ubm = bob.machine.GMMMachine(dim_c,dim_d)
+    ubm.weights = numpy.array([0.1,0.2,0.3,0.4])
+    ubm.means = numpy.random.randn(dim_c,dim_d)
+    ubm.variances = numpy.random.uniform(0.5,2.,(dim_c,dim_d))
+    data = []
+    for i in range(150):
+      gs = bob.machine.GMMStats(dim_c,dim_d)
+      gs.t = 10
+      gs.n = numpy.random.uniform(0.,5.,(dim_c,))
+      gs.sum_px = numpy.random.randn(dim_c,dim_d) * gs.n.reshape(dim_c,1)
+      gs.sum_pxx = numpy.random.uniform(1.,10.,(dim_c,dim_d)) * gs.n.reshape(dim_c,1)
+      data.append(gs)
+
+    t = numpy.random.randn(dim_c*dim_d,2)
+    sigma = ubm.variance_supervector.copy()
+    results = []
+    for n_threads in (1, 4):
+      m = bob.machine.IVectorMachine(ubm, 2)
+      trainer = bob.trainer.IVectorTrainer(update_sigma=True)
+      trainer.n_threads = n_threads
+      self.assertEqual(trainer.n_threads, n_threads)
+      trainer.initialize(m, data)
+      m.t = t
+      m.sigma = sigma
+      for it in range(2):
+        trainer.e_step(m, data)
+        trainer.m_step(m, data)
+      results.append((m.t.copy(), m.sigma.copy(), trainer.acc_nij_wij2.copy()))
+
+    # The results do not depend on the number of threads
+    self.assertTrue((results[0][0] == results[1][0]).all())
+    self.assertTrue((results[0][1] == results[1][1]).all())
+    self.assertTrue((results[0][2] == results[1][2]).all())
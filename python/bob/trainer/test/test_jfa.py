@@ -318,3 +318,45 @@ class FATrainerTest(unittest.TestCase):
     
     self.assertTrue( numpy.allclose(u1, u2, eps) )
     self.assertTrue( numpy.allclose(d1, d2, eps) )
+
+  def test08_ISVTrainAndEnrolThreads(self):
+    # Training with several threads, on more identities than the size of
+    # the blocks processed by each thread, gives the same results as with
+    # a single thread
+    numpy.random.seed(0)
+    ubm = bob.machine.GMMMachine(2,3)
+    ubm.mean_supervector = UBM_MEAN
+    ubm.variance_supervector = UBM_VAR
+    stats = []
+    for i in range(40):
+      client = []
+      for h in range(1 + i % 3):
+        gs = bob.machine.GMMStats(2,3)
+        gs.n = numpy.random.uniform(0.1, 1., (2,))
+        gs.sum_px = numpy.random.uniform(0., 1., (2,3))
+        client.append(gs)
+      stats.append(client)
+
+    results = []
+    for n_threads in (1, 4):
+      mb = bob.machine.ISVBase(ubm,2)
+      t = bob.trainer.ISVTrainer(10, 4.)
+      t.n_threads = n_threads
+      self.assertEqual(t.n_threads, n_threads)
+      t.initialize(mb, stats)
+      mb.u = M_u
+      for i in range(3):
+        t.e_step(mb, stats)
+        t.m_step(mb, stats)
+      results.append((mb.u.copy(), t.acc_u_a1.copy(), t.acc_u_a2.copy()))
+    for k in range(3):
+      self.assertTrue( (results[0][k] == results[1][k]).all() )
+
+    # Enrolling several clients at once is the same as enrolling them one
+    # after the other
+    z = t.enrol(mb, stats[:20], 5)
+    self.assertEqual(z.shape, (20, 6))
+    m = bob.machine.ISVMachine(mb)
+    for i in range(20):
+      t.enrol(m, stats[i], 5)
+      self.assertTrue( numpy.allclose(m.z, z[i], 1e-10) )
@@ -8,6 +8,7 @@
 """Test K-Means algorithm
 """
 import os, sys
+import tempfile
 import unittest
 import bob
 import random
@@ -185,3 +186,164 @@ class KMeansTest(unittest.TestCase):
     trainer.train(machine, data)
     self.assertFalse( numpy.isnan(machine.means).any())
 
+
+  def test04_kmeans_pruning(self):
+
+    # The pruning of the distance computations and the number of threads
+    # do not change the trained means
+    (arStd,std) = NormalizeStdArray(F("faithful.torch3.hdf5"))
+
+    means = []
+    for (pruning, n_threads) in ((False, 1), (True, 1), (True, 4)):
+      machine = bob.machine.KMeansMachine(3, 2)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.rng = bob.core.random.mt19937(5489)
+      trainer.max_iterations = 50
+      trainer.pruning = pruning
+      trainer.n_threads = n_threads
+      self.assertEqual( trainer.pruning, pruning )
+      trainer.train(machine, arStd)
+      means.append(machine.means)
+
+    self.assertTrue(equals(means[0], means[1], 1e-8))
+    self.assertTrue(equals(means[0], means[2], 1e-8))
+
+  def test05_kmeans_sampler(self):
+
+    # Streaming the data from several HDF5 files by blocks (multiple of 256
+    # samples) gives the same means as training with all the data in memory
+    (arStd,std) = NormalizeStdArray(F("faithful.torch3.hdf5"))
+    arStd = numpy.vstack([arStd] * 4)
+    filenames = []
+    for part in (arStd[:300,:], arStd[300:,:]):
+      filenames.append(str(tempfile.mkstemp(".hdf5")[1]))
+      bob.io.save(part, filenames[-1])
+    sampler = bob.trainer.HDF5Sampler(filenames, '/array', 256)
+
+    means = []
+    for data in (arStd, sampler):
+      machine = bob.machine.KMeansMachine(3, 2)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.rng = bob.core.random.mt19937(5489)
+      trainer.max_iterations = 50
+      trainer.train(machine, data)
+      means.append(machine.means)
+
+    self.assertTrue((means[0] == means[1]).all())
+
+    del sampler
+    for filename in filenames:
+      os.unlink(filename)
+
+  def test06_kmeans_checkpoint(self):
+
+    # Training resumed from a checkpoint gives the same means as an
+    # uninterrupted training, and restores the state of the random generator
+    (arStd,std) = NormalizeStdArray(F("faithful.torch3.hdf5"))
+
+    def new_trainer(max_iterations, seed):
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.rng = bob.core.random.mt19937(seed)
+      trainer.convergence_threshold = 1e-12
+      trainer.max_iterations = max_iterations
+      return trainer
+
+    # Uninterrupted training
+    machine_ref = bob.machine.KMeansMachine(3, 2)
+    trainer_ref = new_trainer(6, 5489)
+    trainer_ref.train(machine_ref, arStd)
+
+    # Training interrupted after 4 iterations, with a checkpoint every 2
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    trainer = new_trainer(4, 5489)
+    trainer.set_checkpoint(filename, 2)
+    trainer.train(bob.machine.KMeansMachine(3, 2), arStd)
+
+    # Resumes from the checkpoint (after iteration 2), with another seed
+    machine = bob.machine.KMeansMachine(3, 2)
+    trainer = new_trainer(6, 42)
+    trainer.resume(machine, arStd, filename)
+    os.unlink(filename)
+
+    self.assertTrue((machine.means == machine_ref.means).all())
+    self.assertTrue(trainer.rng == trainer_ref.rng)
+
+  def test07_kmeans_threads(self):
+
+    # The statistics of the E-step and the k-means++ initialization do not
+    # depend on the number of threads
+    (arStd,std) = NormalizeStdArray(F("faithful.torch3.hdf5"))
+    means = []
+    for n_threads in (1, 4):
+      machine = bob.machine.KMeansMachine(3, 2)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.rng = bob.core.random.mt19937(5489)
+      if hasattr(bob.trainer.KMeansTrainer, 'KMEANS_PLUS_PLUS'):
+        trainer.initialization_method = bob.trainer.KMeansTrainer.KMEANS_PLUS_PLUS
+      trainer.n_threads = n_threads
+      trainer.train(machine, arStd)
+      means.append(machine.means)
+
+    self.assertTrue((means[0] == means[1]).all())
+
+  if hasattr(bob.trainer.KMeansTrainer, 'KMEANS_PARALLEL'):
+    def test08_kmeans_parallel(self):
+
+      # The k-means|| initialization selects one mean in each cluster of
+      # well separated clusters
+      data = bob.io.load(F("samplesFrom2G_f64.hdf5"))
+      machine = bob.machine.KMeansMachine(2, 1)
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.rng = bob.core.random.mt19937(5489)
+      trainer.initialization_method = bob.trainer.KMeansTrainer.KMEANS_PARALLEL
+      trainer.kmeans_parallel_rounds = 3
+      trainer.kmeans_parallel_oversampling = 1.5
+      self.assertEqual( trainer.kmeans_parallel_rounds, 3 )
+      self.assertEqual( trainer.kmeans_parallel_oversampling, 1.5 )
+      trainer.initialize(machine, data)
+      self.assertTrue(machine.get_mean(0)[0] * machine.get_mean(1)[0] < 0)
+
+  def test09_kmeans_mini_batch(self):
+
+    # The mini-batch mode converges towards the means of the clusters
+    data = bob.io.load(F("samplesFrom2G_f64.hdf5"))
+    machine = bob.machine.KMeansMachine(2, 1)
+    trainer = bob.trainer.KMeansTrainer()
+    trainer.rng = bob.core.random.mt19937(5489)
+    trainer.mini_batch_size = 20
+    trainer.max_iterations = 50
+    trainer.convergence_threshold = 0
+    self.assertEqual( trainer.mini_batch_size, 20 )
+    trainer.train(machine, data)
+
+    means = numpy.sort(machine.means[:,0])
+    self.assertTrue(equals(means, numpy.array([-10.,10.]), 5e-1))
+
+  def test10_kmeans_mini_batch_checkpoint(self):
+
+    # The mini-batches are drawn with the random generator of the trainer,
+    # which is restored by resume(): a resumed training gives the same means
+    # as an uninterrupted one
+    data = bob.io.load(F("samplesFrom2G_f64.hdf5"))
+
+    def new_trainer(max_iterations, seed):
+      trainer = bob.trainer.KMeansTrainer()
+      trainer.rng = bob.core.random.mt19937(seed)
+      trainer.mini_batch_size = 20
+      trainer.max_iterations = max_iterations
+      trainer.convergence_threshold = 0
+      return trainer
+
+    machine_ref = bob.machine.KMeansMachine(2, 1)
+    new_trainer(6, 5489).train(machine_ref, data)
+
+    filename = str(tempfile.mkstemp(".hdf5")[1])
+    trainer = new_trainer(4, 5489)
+    trainer.set_checkpoint(filename, 2)
+    trainer.train(bob.machine.KMeansMachine(2, 1), data)
+
+    machine = bob.machine.KMeansMachine(2, 1)
+    new_trainer(6, 42).resume(machine, data, filename)
+    os.unlink(filename)
+
+    self.assertTrue((machine.means == machine_ref.means).all())
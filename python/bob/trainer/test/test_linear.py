@@ -8,10 +8,15 @@
 """Test trainers for the LinearMachine
 """
 
+import os
 import numpy
+import nose.tools
+import tempfile
 
 from ...machine import LinearMachine
-from .. import PCATrainer, FisherLDATrainer, WhiteningTrainer, EMPCATrainer, WCCNTrainer
+from ...io import save, HDF5File
+from ...core.random import mt19937
+from .. import PCATrainer, FisherLDATrainer, WhiteningTrainer, EMPCATrainer, WCCNTrainer, HDF5Sampler, ScatterAccumulator
 
 def test_pca_settings():
 
@@ -355,6 +360,105 @@ def test_ppca():
   llh2 = T.compute_likelihood(m)
   assert abs(exp_llh2 - llh2) < 2e-4
 
+def test_ppca_threads_sampler():
+
+  # The statistics of the chunks are added in order: the trained machine
+  # does not depend on the number of threads, and streaming the data by
+  # blocks of a multiple of 1024 samples gives the same machine
+  numpy.random.seed(0)
+  ar = numpy.dot(numpy.random.randn(5000, 4), numpy.random.randn(4, 12))
+  ar += 0.1 * numpy.random.randn(5000, 12) + 3.
+
+  filenames = []
+  for i, (begin, end) in enumerate(((0, 1500), (1500, 5000))):
+    filenames.append(str(tempfile.mkstemp(".hdf5")[1]))
+    save(ar[begin:end,:], filenames[-1])
+  sampler = HDF5Sampler(filenames, '/array', 2048)
+
+  machines = []
+  for n_threads, data in ((1, ar), (4, ar), (4, sampler)):
+    T = EMPCATrainer(1e-6, 20, False)
+    T.rng = mt19937(1)
+    T.n_threads = n_threads
+    m = LinearMachine(12, 4)
+    T.train(m, data)
+    machines.append((m, T.sigma2))
+
+  del sampler
+  for filename in filenames:
+    os.unlink(filename)
+
+  for m, sigma2 in machines[1:]:
+    assert m == machines[0][0]
+    assert sigma2 == machines[0][1]
+
+def test_ppca_sampler_size():
+
+  # The mean and the covariance of the data require at least two samples
+  filename = str(tempfile.mkstemp(".hdf5")[1])
+  save(numpy.ones((1, 3), 'float64'), filename)
+  sampler = HDF5Sampler([filename], '/array', 1024)
+  nose.tools.assert_raises(RuntimeError, EMPCATrainer().train,
+      LinearMachine(3, 2), sampler)
+  del sampler
+  os.unlink(filename)
+
+def test_ppca_checkpoint():
+
+  # Training resumed from a checkpoint gives the same machine as an
+  # uninterrupted training: sigma2, the statistics of the last E-step and
+  # the state of the random generator are restored, instead of the ones of
+  # the initialization
+  numpy.random.seed(0)
+  ar = numpy.dot(numpy.random.randn(500, 4), numpy.random.randn(4, 12))
+  ar += 0.1 * numpy.random.randn(500, 12) + 3.
+
+  def new_trainer(max_iterations):
+    T = EMPCATrainer(1e-6, max_iterations, False)
+    T.rng = mt19937(1)
+    return T
+
+  # Uninterrupted training
+  m_ref = LinearMachine(12, 4)
+  T_ref = new_trainer(6)
+  T_ref.train(m_ref, ar)
+
+  # Training interrupted after 4 iterations, with a checkpoint every 2
+  filename = str(tempfile.mkstemp(".hdf5")[1])
+  T = new_trainer(4)
+  T.set_checkpoint(filename, 2)
+  T.train(LinearMachine(12, 4), ar)
+
+  # Resumes from the checkpoint (after iteration 2), with another seed
+  m = LinearMachine(12, 4)
+  T = new_trainer(6)
+  T.rng = mt19937(2)
+  T.resume(m, ar, filename)
+
+  assert m == m_ref
+  assert T.sigma2 == T_ref.sigma2
+  assert T.rng == T_ref.rng
+  assert [t.iteration for t in T.telemetry] == list(range(7))
+
+  # Same with the data streamed from an HDF5 file
+  data_filename = str(tempfile.mkstemp(".hdf5")[1])
+  save(ar, data_filename)
+  sampler = HDF5Sampler([data_filename], '/array', 1024)
+  T = new_trainer(4)
+  T.set_checkpoint(filename, 2)
+  T.train(LinearMachine(12, 4), sampler)
+  m = LinearMachine(12, 4)
+  T = new_trainer(6)
+  T.rng = mt19937(2)
+  T.resume(m, sampler, filename)
+  del sampler
+  os.unlink(data_filename)
+  os.unlink(filename)
+
+  assert m == m_ref
+  assert T.sigma2 == T_ref.sigma2
+  assert T.rng == T_ref.rng
+
 def test_whitening_initialization():
 
   # Constructors and comparison operators
@@ -459,3 +563,62 @@ def test_wccn_train():
   assert numpy.allclose(m2.input_subtract, mean_ref, eps, eps)
   assert numpy.allclose(m2.weights, weight_ref, eps, eps)
   assert numpy.allclose(s2, sample_wccn_ref, eps, eps)
+
+def test_scatter_accumulator():
+
+  # The statistics of the classes are accumulated by blocks, in any order,
+  # by two accumulators which are then merged: the trained machines are the
+  # ones obtained with all the data in memory
+  numpy.random.seed(0)
+  data = [numpy.random.randn(n, 6) + numpy.random.randn(6) for n in (1200, 700, 2500)]
+
+  filename = str(tempfile.mkstemp(".hdf5")[1])
+  save(data[2], filename)
+  sampler = HDF5Sampler([filename], '/array', 1000)
+
+  acc1 = ScatterAccumulator(6)
+  acc2 = ScatterAccumulator(6)
+  acc2.n_threads = 4
+  acc1.accumulate(1, data[1])
+  acc1.accumulate(0, data[0][:500,:])
+  acc2.accumulate(0, data[0][500:,:])
+  acc2.accumulate(2, sampler)
+  acc1.merge(acc2)
+
+  del sampler
+  os.unlink(filename)
+
+  assert acc1.n_classes == 3
+  assert acc1.n_samples == 4400
+  assert numpy.allclose(acc1.counts, [1200, 700, 2500])
+  for k in range(3):
+    assert numpy.allclose(acc1.means[k,:], data[k].mean(axis=0), 1e-10, 1e-10)
+
+  # Saves and reloads the statistics
+  filename = str(tempfile.mkstemp(".hdf5")[1])
+  acc1.save(HDF5File(filename, 'w'))
+  acc = ScatterAccumulator(HDF5File(filename))
+  os.unlink(filename)
+  assert acc == acc1
+
+  eps = 1e-8
+  m_ref, eig_ref = FisherLDATrainer().train(data)
+  m, eig = FisherLDATrainer().train(acc)
+  assert numpy.allclose(eig, eig_ref, eps, eps)
+  assert numpy.allclose(abs(m.weights), abs(m_ref.weights), eps, eps)
+  assert numpy.allclose(m.input_subtract, m_ref.input_subtract, eps, eps)
+
+  m_ref = WCCNTrainer().train(data)
+  m = WCCNTrainer().train(acc)
+  assert numpy.allclose(m.weights, m_ref.weights, eps, eps)
+
+  m_ref = WhiteningTrainer().train(numpy.vstack(data))
+  m = WhiteningTrainer().train(acc)
+  assert numpy.allclose(m.weights, m_ref.weights, eps, eps)
+  assert numpy.allclose(m.input_subtract, m_ref.input_subtract, eps, eps)
+
+  # The whitening requires at least two samples
+  acc = ScatterAccumulator(6)
+  nose.tools.assert_raises(RuntimeError, WhiteningTrainer().train, acc)
+  acc.accumulate(0, data[0][:1,:])
+  nose.tools.assert_raises(RuntimeError, WhiteningTrainer().train, acc)
@@ -168,6 +168,47 @@ def test_20in_10_5_3out():
   python_check_gradient(machine, cost, True, BATCH_SIZE)
   cxx_vs_python_check_gradient(machine, cost, True, BATCH_SIZE)
 
+def test_20in_10_5_3out_large_batch():
+
+  # the batch is split into several blocks of samples
+  machine = MLP((20, 10, 5, 3))
+  machine.hidden_activation = HyperbolicTangentActivation()
+  machine.output_activation = HyperbolicTangentActivation()
+  machine.randomize()
+
+  BATCH_SIZE = 300
+  cost = SquareError(machine.output_activation)
+
+  cxx_vs_python_check_gradient(machine, cost, True, BATCH_SIZE)
+
+def test_n_threads():
+
+  machine = MLP((20, 10, 5, 3))
+  machine.randomize()
+
+  BATCH_SIZE = 300
+  cost = CrossEntropyLoss(machine.output_activation)
+  X = numpy.random.rand(BATCH_SIZE, 20)
+  T = numpy.random.rand(BATCH_SIZE, 3)
+
+  trainer1 = MLPBaseTrainer(BATCH_SIZE, cost, machine)
+  trainer1.n_threads = 1
+  trainer1.forward_step(machine, X)
+  trainer1.backward_step(machine, X, T)
+
+  trainer4 = MLPBaseTrainer(BATCH_SIZE, cost, machine)
+  trainer4.n_threads = 4
+  assert MLPBaseTrainer(trainer4).n_threads == 4
+  trainer4.forward_step(machine, X)
+  trainer4.backward_step(machine, X, T)
+
+  # the results do not depend on the number of threads
+  for k in range(len(machine.weights)):
+    assert numpy.all(trainer1.output[k] == trainer4.output[k])
+    assert numpy.all(trainer1.error[k] == trainer4.error[k])
+    assert numpy.all(trainer1.derivatives[k] == trainer4.derivatives[k])
+    assert numpy.all(trainer1.bias_derivatives[k] == trainer4.bias_derivatives[k])
+
 def test_cost_setup():
   
   machine = MLP((1, 2))
@@ -732,3 +732,37 @@ class PLDATrainerTest(unittest.TestCase):
     self.assertFalse( t1 == t2 )
     self.assertTrue(  t1 != t2 )
     self.assertFalse( t1.is_similar_to(t2) )
+
+  def test05_plda_EM_threads(self):
+
+    # Identities with different numbers of samples, such that the E- and
+    # M-steps process several chunks of identities
+    D = 6
+    nf = 2
+    ng = 3
+    numpy.random.seed(0)
+    l = [numpy.random.randn(2 + (i % 3), D) + numpy.random.randn(D) for i in range(240)]
+
+    def train(n_threads, use_sum_second_order):
+      t = bob.trainer.PLDATrainer(3, use_sum_second_order)
+      t.n_threads = n_threads
+      t.rng.seed(37)
+      m = bob.machine.PLDABase(D,nf,ng)
+      t.train(m, l)
+      return (t, m)
+
+    (t1, m1) = train(1, True)
+    for (n_threads, use_sum) in ((4, True), (4, False)):
+      (t2, m2) = train(n_threads, use_sum)
+      self.assertEqual(t2.n_threads, n_threads)
+      self.assertTrue( (m1.f == m2.f).all() )
+      self.assertTrue( (m1.g == m2.g).all() )
+      self.assertTrue( (m1.sigma == m2.sigma).all() )
+      self.assertTrue( (t1.z_second_order_sum == t2.z_second_order_sum).all() )
+      for (z1, z2) in zip(t1.z_first_order, t2.z_first_order):
+        self.assertTrue( (z1 == z2).all() )
+
+    # The second order statistics of each sample sum up to their sum
+    (t2, m2) = train(4, False)
+    z2_sum = sum(z.sum(axis=0) for z in t2.z_second_order)
+    self.assertTrue( numpy.allclose(z2_sum, t2.z_second_order_sum) )
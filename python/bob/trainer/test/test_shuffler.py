@@ -220,3 +220,28 @@ class DataShufflerTest(unittest.TestCase):
     back_mean, back_stddev = shuffle.stdnorm()
     self.assertTrue( abs( (back_mean   - prev_mean  ).sum() ) < 1e-10)
     self.assertTrue( abs( (back_stddev - prev_stddev).sum() ) < 1e-10)
+
+  def test06_Prefetching(self):
+
+    # Mini-batches drawn by the background thread are the same as the ones
+    # drawn synchronously with a random generator seeded with the same value
+    shuffle = bob.trainer.DataShuffler([self.set1, self.set2, self.set3],
+        [self.target1, self.target2, self.target3])
+    shuffle.auto_stdnorm = True
+    self.assertFalse( shuffle.prefetching )
+
+    N = 25
+    rng = bob.core.random.mt19937(32)
+    expected = [shuffle(rng, N) for k in range(10)]
+
+    shuffle.start_prefetching(N, 32, 3)
+    self.assertTrue( shuffle.prefetching )
+    for (data, target) in expected:
+      [data2, target2] = shuffle.next()
+      self.assertTrue( (data == data2).all() )
+      self.assertTrue( (target == target2).all() )
+
+    # changing the normalization stops the background thread
+    shuffle.auto_stdnorm = False
+    self.assertFalse( shuffle.prefetching )
+    self.assertRaises(RuntimeError, shuffle.next)
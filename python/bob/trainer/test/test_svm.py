@@ -136,3 +136,54 @@ class SvmTrainingTest(unittest.TestCase):
     curr_scores = numpy.array(curr_scores)
     prev_scores = numpy.array(prev_scores)
     #self.assertTrue( numpy.all(abs(curr_scores-prev_scores) < 1e-8) )
+
+  @utils.libsvm_available
+  def test04_training_gram(self):
+
+    # Trains machines from the inner products of the samples, which are
+    # computed once for all the values of the cost
+    f = bob.machine.SVMFile(HEART_DATA)
+    labels, data = f.read_all()
+    neg = numpy.vstack([k for i,k in enumerate(data) if labels[i] < 0])
+    pos = numpy.vstack([k for i,k in enumerate(data) if labels[i] > 0])
+
+    gram = bob.trainer.SVMGramMatrix((pos, neg))
+    self.assertEqual(gram.n_samples, pos.shape[0] + neg.shape[0])
+    self.assertEqual(gram.n_classes, 2)
+    samples = numpy.vstack((pos, neg))
+    self.assertTrue( numpy.all(abs(gram.inner_products - \
+      numpy.dot(samples, samples.T)) < 1e-8) )
+
+    for cost in (0.1, 1., 10.):
+      trainer = bob.trainer.SVMTrainer(cost=cost)
+      machine = trainer.train((pos, neg))
+      gram_machine = trainer.train(gram)
+      self.assertEqual(machine.kernel_type, gram_machine.kernel_type)
+      self.assertEqual(machine.gamma, gram_machine.gamma)
+      self.assertEqual(machine.shape, gram_machine.shape)
+
+      labels, scores = machine.predict_classes_and_scores(data)
+      gram_labels, gram_scores = gram_machine.predict_classes_and_scores(data)
+      self.assertEqual(labels, gram_labels)
+      self.assertTrue( numpy.all(abs(numpy.array(scores) - \
+        numpy.array(gram_scores)) < 1e-6) )
+
+  @utils.libsvm_available
+  def test05_multiclass_threads(self):
+
+    # The one-vs-one sub-problems trained in parallel give the machine
+    # trained by libsvm
+    numpy.random.seed(0)
+    data = [numpy.random.randn(40, 4) + 2 * k for k in range(4)]
+    samples = numpy.vstack(data)
+
+    for train in (lambda t: t.train(data), lambda t: t.train(bob.trainer.SVMGramMatrix(data))):
+      outputs = []
+      for n_threads in (1, 4):
+        trainer = bob.trainer.SVMTrainer()
+        trainer.n_threads = n_threads
+        machine = train(trainer)
+        outputs.append(machine.predict_classes_and_scores(samples))
+      self.assertEqual(outputs[0][0], outputs[1][0])
+      self.assertTrue( numpy.all(abs(numpy.array(outputs[0][1]) - \
+        numpy.array(outputs[1][1])) < 1e-10) )
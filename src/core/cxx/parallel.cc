@@ -0,0 +1,39 @@
+/**
+ * @file core/cxx/parallel.cc
+ * @date Mon Oct 19 02:16:10 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Helpers to split loop computations across several threads.
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <bob/core/parallel.h>
+#include <algorithm>
+
+size_t bob::core::hardware_threads()
+{
+  const size_t n = boost::thread::hardware_concurrency();
+  return (n > 0 ? n : 1);
+}
+
+size_t bob::core::thread_count(const size_t n_objects, const size_t n_threads)
+{
+  const size_t n = (n_threads > 0 ? n_threads : hardware_threads());
+  return std::max((size_t)1, std::min(n, n_objects));
+}
+
+void bob::core::thread_split(const size_t n_objects, const size_t n_threads,
+  std::vector<size_t>& sbegins, std::vector<size_t>& sends)
+{
+  sbegins.resize(n_threads);
+  sends.resize(n_threads);
+  // The first (n_objects % n_threads) ranges get one more object
+  const size_t n_min = n_objects / n_threads;
+  const size_t n_extra = n_objects % n_threads;
+  for (size_t ith=0, sbegin=0; ith<n_threads; ++ith) {
+    sbegins[ith] = sbegin;
+    sbegin += n_min + (ith < n_extra ? 1 : 0);
+    sends[ith] = sbegin;
+  }
+}
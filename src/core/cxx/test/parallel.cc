@@ -0,0 +1,115 @@
+/**
+ * @file core/cxx/test/parallel.cc
+ * @date Mon Oct 19 02:16:10 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Test the helpers used to split loops across several threads
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE Core-parallel Tests
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <bob/core/parallel.h>
+#include <stdexcept>
+#include <vector>
+
+struct fill_range {
+  std::vector<size_t>& out;
+  fill_range(std::vector<size_t>& out_): out(out_) {}
+  void operator()(size_t ith, size_t begin, size_t end) const {
+    for (size_t i=begin; i<end; ++i) out[i] = i*i;
+  }
+};
+
+struct fill_block {
+  std::vector<size_t>& out;
+  fill_block(std::vector<size_t>& out_): out(out_) {}
+  void operator()(size_t ith, size_t b) const { out[b] = b+1; }
+};
+
+struct ordered_blocks {
+  std::vector<size_t>& last;
+  std::vector<size_t>& out;
+  const size_t fail_block;
+  const size_t fail_reduce;
+  ordered_blocks(std::vector<size_t>& last_, std::vector<size_t>& out_,
+      size_t fail_block_=(size_t)-1, size_t fail_reduce_=(size_t)-1):
+    last(last_), out(out_), fail_block(fail_block_), fail_reduce(fail_reduce_)
+  {}
+  void operator()(size_t ith, size_t b) const {
+    if (b == fail_block) throw std::runtime_error("expected failure");
+    last[ith] = b;
+  }
+  void reduce(size_t ith, size_t b) const {
+    if (b == fail_reduce) throw std::runtime_error("expected failure");
+    out.push_back(last[ith]);
+  }
+};
+
+struct throw_range {
+  void operator()(size_t ith, size_t begin, size_t end) const {
+    if (begin <= 5 && 5 < end) throw std::runtime_error("expected failure");
+  }
+};
+
+BOOST_AUTO_TEST_SUITE( test_setup )
+
+BOOST_AUTO_TEST_CASE( test_split )
+{
+  std::vector<size_t> b, e;
+  bob::core::thread_split(10, 3, b, e);
+  BOOST_REQUIRE_EQUAL(b.size(), 3);
+  BOOST_CHECK_EQUAL(b[0], 0); BOOST_CHECK_EQUAL(e[0], 4);
+  BOOST_CHECK_EQUAL(b[1], 4); BOOST_CHECK_EQUAL(e[1], 7);
+  BOOST_CHECK_EQUAL(b[2], 7); BOOST_CHECK_EQUAL(e[2], 10);
+  BOOST_CHECK_EQUAL(bob::core::thread_count(2, 8), 2);
+  BOOST_CHECK_EQUAL(bob::core::thread_count(0, 8), 1);
+  BOOST_CHECK(bob::core::thread_count(1000, 0) >= 1);
+}
+
+BOOST_AUTO_TEST_CASE( test_loop )
+{
+  for (size_t n_threads=1; n_threads<=5; ++n_threads) {
+    std::vector<size_t> out(101, 0);
+    bob::core::thread_loop(fill_range(out), out.size(), n_threads);
+    for (size_t i=0; i<out.size(); ++i) BOOST_CHECK_EQUAL(out[i], i*i);
+
+    std::vector<size_t> blocks(17, 0);
+    bob::core::thread_blocks(fill_block(blocks), blocks.size(), n_threads);
+    for (size_t i=0; i<blocks.size(); ++i) BOOST_CHECK_EQUAL(blocks[i], i+1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_reduce )
+{
+  for (size_t n_threads=1; n_threads<=5; ++n_threads) {
+    std::vector<size_t> last(n_threads), out;
+    bob::core::thread_reduce_blocks(ordered_blocks(last, out), 23, n_threads);
+    BOOST_REQUIRE_EQUAL(out.size(), 23);
+    for (size_t i=0; i<out.size(); ++i) BOOST_CHECK_EQUAL(out[i], i);
+  }
+}
+
+BOOST_AUTO_TEST_CASE( test_exception )
+{
+  BOOST_CHECK_THROW(bob::core::thread_loop(throw_range(), 10, 4),
+    std::runtime_error);
+
+  // the threads waiting for a failed block should not wait forever
+  for (size_t n_threads=1; n_threads<=5; ++n_threads) {
+    std::vector<size_t> last(n_threads), out;
+    BOOST_CHECK_THROW(bob::core::thread_reduce_blocks(
+      ordered_blocks(last, out, 5), 23, n_threads), std::runtime_error);
+    BOOST_CHECK(out.size() <= 5);
+    out.clear();
+    BOOST_CHECK_THROW(bob::core::thread_reduce_blocks(
+      ordered_blocks(last, out, (size_t)-1, 7), 23, n_threads),
+      std::runtime_error);
+    BOOST_CHECK_EQUAL(out.size(), 7);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
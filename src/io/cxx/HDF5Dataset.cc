@@ -491,6 +491,48 @@ void bob::io::detail::hdf5::Dataset::read_buffer (size_t index, const bob::io::H
   if (status < 0) throw status_error("H5Dread", status);
 }
 
+void bob::io::detail::hdf5::Dataset::read_buffer (size_t index, size_t count,
+    const bob::io::HDF5Type& dest, void* buffer) {
+
+  //finds compatibility type
+  std::vector<bob::io::HDF5Descriptor>::iterator it = find_type_index(m_descr, dest);
+
+  //if we cannot find a compatible type, we throw
+  if (it == m_descr.end()) {
+    boost::format m("trying to read or write `%s' at `%s' that only accepts `%s'");
+    m % dest.str() % url() % m_descr[0].type.str();
+    throw std::runtime_error(m.str());
+  }
+
+  //checks indexing
+  if (index + count > it->size) {
+    boost::format m("trying to access elements %d to %d in Dataset '%s' that only contains %d elements");
+    m % index % (index + count) % url() % it->size;
+    throw std::runtime_error(m.str());
+  }
+
+  if (!count) return;
+
+  //the memory space contains count elements of the given type
+  bob::io::HDF5Shape shape(it->type.shape());
+  shape >>= 1;
+  shape[0] = count;
+  set_memspace(m_memspace, shape);
+
+  it->hyperslab_start[0] = index;
+  bob::io::HDF5Shape hyperslab_count(it->hyperslab_count);
+  hyperslab_count[0] = count;
+
+  herr_t status = H5Sselect_hyperslab(*m_filespace, H5S_SELECT_SET,
+      it->hyperslab_start.get(), 0, hyperslab_count.get(), 0);
+  if (status < 0) throw status_error("H5Sselect_hyperslab", status);
+
+  status = H5Dread(*m_id, *it->type.htype(),
+      *m_memspace, *m_filespace, H5P_DEFAULT, buffer);
+
+  if (status < 0) throw status_error("H5Dread", status);
+}
+
 void bob::io::detail::hdf5::Dataset::write_buffer (size_t index, const bob::io::HDF5Type& dest,
     const void* buffer) {
 
@@ -158,6 +158,11 @@ void bob::io::HDF5File::read_buffer (const std::string& path, size_t pos,
   (*m_cwd)[path]->read_buffer(pos, type, buffer);
 }
 
+void bob::io::HDF5File::read_buffer (const std::string& path, size_t pos,
+    size_t count, const bob::io::HDF5Type& type, void* buffer) const {
+  (*m_cwd)[path]->read_buffer(pos, count, type, buffer);
+}
+
 void bob::io::HDF5File::write_buffer (const std::string& path,
     size_t pos, const bob::io::HDF5Type& type, const void* buffer) {
   if (!m_file->writeable()) {
@@ -9,11 +9,103 @@
 
 #include <cmath>
 #include <boost/make_shared.hpp>
+#include "bob/core/assert.h"
+#include "bob/core/check.h"
 #include "bob/machine/Activation.h"
 #include "bob/machine/ActivationRegistry.h"
 
+/**
+ * Maps all elements of z through op() into a. C-contiguous arrays are
+ * processed as flat buffers, with an inlined op(), so that the compiler can
+ * vectorize the loop.
+ */
+template <typename TOp> static void apply2d(const TOp& op,
+    const blitz::Array<double,2>& z, blitz::Array<double,2>& a) {
+  bob::core::array::assertSameShape(z, a);
+  if (bob::core::array::isCContiguous(z) && bob::core::array::isCContiguous(a)) {
+    const double* z_ = z.data();
+    double* a_ = a.data();
+    const int n = z.numElements();
+    for (int i=0; i<n; ++i) a_[i] = op(z_[i]);
+    return;
+  }
+  for (int k=0; k<z.extent(0); ++k)
+    for (int l=0; l<z.extent(1); ++l)
+      a(a.lbound(0)+k, a.lbound(1)+l) = op(z(z.lbound(0)+k, z.lbound(1)+l));
+}
+
+/**
+ * Element-wise operations used by the 2D variants of the activations
+ */
+struct virtual_f_op {
+  const bob::machine::Activation& act;
+  virtual_f_op(const bob::machine::Activation& act_): act(act_) {}
+  inline double operator()(double z) const { return act.f(z); }
+};
+
+struct virtual_f_prime_from_f_op {
+  const bob::machine::Activation& act;
+  virtual_f_prime_from_f_op(const bob::machine::Activation& act_): act(act_) {}
+  inline double operator()(double a) const { return act.f_prime_from_f(a); }
+};
+
+struct identity_op {
+  inline double operator()(double z) const { return z; }
+};
+
+struct constant_op {
+  const double C;
+  constant_op(double C_): C(C_) {}
+  inline double operator()(double) const { return C; }
+};
+
+struct linear_op {
+  const double C;
+  linear_op(double C_): C(C_) {}
+  inline double operator()(double z) const { return C * z; }
+};
+
+struct tanh_op {
+  inline double operator()(double z) const { return std::tanh(z); }
+};
+
+struct tanh_prime_op {
+  inline double operator()(double a) const { return 1. - (a*a); }
+};
+
+struct mult_tanh_op {
+  const double C;
+  const double M;
+  mult_tanh_op(double C_, double M_): C(C_), M(M_) {}
+  inline double operator()(double z) const { return C * std::tanh(M * z); }
+};
+
+struct mult_tanh_prime_op {
+  const double C;
+  const double M;
+  mult_tanh_prime_op(double C_, double M_): C(C_), M(M_) {}
+  inline double operator()(double a) const
+  { return C * M * (1. - (a/C)*(a/C)); }
+};
+
+struct logistic_op {
+  inline double operator()(double z) const { return 1. / ( 1. + std::exp(-z) ); }
+};
+
+struct logistic_prime_op {
+  inline double operator()(double a) const { return a * (1. - a); }
+};
+
 namespace bob { namespace machine {
 
+  void Activation::f (const blitz::Array<double,2>& z,
+      blitz::Array<double,2>& a) const
+  { apply2d(virtual_f_op(*this), z, a); }
+
+  void Activation::f_prime_from_f (const blitz::Array<double,2>& a,
+      blitz::Array<double,2>& b) const
+  { apply2d(virtual_f_prime_from_f_op(*this), a, b); }
+
   IdentityActivation::~IdentityActivation() {}
 
   double IdentityActivation::f (double z) const { return z; }
@@ -22,6 +114,14 @@ namespace bob { namespace machine {
 
   double IdentityActivation::f_prime_from_f (double) const { return 1.; }
 
+  void IdentityActivation::f (const blitz::Array<double,2>& z,
+      blitz::Array<double,2>& a) const
+  { apply2d(identity_op(), z, a); }
+
+  void IdentityActivation::f_prime_from_f (const blitz::Array<double,2>& a,
+      blitz::Array<double,2>& b) const
+  { apply2d(constant_op(1.), a, b); }
+
   void IdentityActivation::save(bob::io::HDF5File& f) const {
     f.set("id", unique_identifier());
   }
@@ -47,6 +147,14 @@ namespace bob { namespace machine {
 
   double LinearActivation::f_prime_from_f (double a) const { return m_C; }
 
+  void LinearActivation::f (const blitz::Array<double,2>& z,
+      blitz::Array<double,2>& a) const
+  { apply2d(linear_op(m_C), z, a); }
+
+  void LinearActivation::f_prime_from_f (const blitz::Array<double,2>& a,
+      blitz::Array<double,2>& b) const
+  { apply2d(constant_op(m_C), a, b); }
+
   double LinearActivation::C() const { return m_C; }
 
   void LinearActivation::save(bob::io::HDF5File& f) const {
@@ -76,6 +184,14 @@ namespace bob { namespace machine {
 
   double HyperbolicTangentActivation::f_prime_from_f (double a) const { return (1. - (a*a)); }
 
+  void HyperbolicTangentActivation::f (const blitz::Array<double,2>& z,
+      blitz::Array<double,2>& a) const
+  { apply2d(tanh_op(), z, a); }
+
+  void HyperbolicTangentActivation::f_prime_from_f
+    (const blitz::Array<double,2>& a, blitz::Array<double,2>& b) const
+  { apply2d(tanh_prime_op(), a, b); }
+
   void HyperbolicTangentActivation::save(bob::io::HDF5File& f) const {
     f.set("id", unique_identifier());
   }
@@ -103,6 +219,14 @@ namespace bob { namespace machine {
   double MultipliedHyperbolicTangentActivation::f_prime_from_f (double a) const
   { return m_C * m_M * (1. - std::pow(a/m_C,2)); }
 
+  void MultipliedHyperbolicTangentActivation::f
+    (const blitz::Array<double,2>& z, blitz::Array<double,2>& a) const
+  { apply2d(mult_tanh_op(m_C, m_M), z, a); }
+
+  void MultipliedHyperbolicTangentActivation::f_prime_from_f
+    (const blitz::Array<double,2>& a, blitz::Array<double,2>& b) const
+  { apply2d(mult_tanh_prime_op(m_C, m_M), a, b); }
+
   double MultipliedHyperbolicTangentActivation::C() const { return m_C; }
 
   double MultipliedHyperbolicTangentActivation::M() const { return m_M; }
@@ -137,6 +261,14 @@ namespace bob { namespace machine {
 
   double LogisticActivation::f_prime_from_f (double a) const { return a * (1. - a); }
 
+  void LogisticActivation::f (const blitz::Array<double,2>& z,
+      blitz::Array<double,2>& a) const
+  { apply2d(logistic_op(), z, a); }
+
+  void LogisticActivation::f_prime_from_f (const blitz::Array<double,2>& a,
+      blitz::Array<double,2>& b) const
+  { apply2d(logistic_prime_op(), a, b); }
+
   void LogisticActivation::save(bob::io::HDF5File& f) const {
     f.set("id", unique_identifier());
   }
@@ -17,8 +17,120 @@
 
 #include <bob/machine/BICMachine.h>
 #include <bob/math/linear.h>
+#include <bob/math/gemm.h>
 #include <bob/core/assert.h>
 #include <bob/core/check.h>
+#include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <algorithm>
+
+namespace {
+
+  /// Number of difference vectors which are scored at once
+  static const size_t BIC_BLOCK_SIZE = 256;
+
+  /**
+   * Computes the BIC or IEC scores of a block of difference vectors.
+   * The differences to the class means and their projections are stored
+   * in per-thread buffers, the projections being computed with a GEMM.
+   */
+  struct BICScoreBlock {
+    const blitz::Array<double,2>& m_input;
+    const blitz::Array<double,1>& m_mu_I;
+    const blitz::Array<double,1>& m_mu_E;
+    const blitz::Array<double,1>& m_lambda_I;
+    const blitz::Array<double,1>& m_lambda_E;
+    const blitz::Array<double,2>* m_Phi_I;
+    const blitz::Array<double,2>* m_Phi_E;
+    const double m_rho_I, m_rho_E;
+    const bool m_use_DFFS;
+    std::vector<std::vector<double> >& m_diff;
+    std::vector<std::vector<double> >& m_proj;
+    std::vector<std::vector<double> >& m_scores;
+    blitz::Array<double,1>& m_output;
+
+    BICScoreBlock(const blitz::Array<double,2>& input,
+        const blitz::Array<double,1>& mu_I, const blitz::Array<double,1>& mu_E,
+        const blitz::Array<double,1>& lambda_I, const blitz::Array<double,1>& lambda_E,
+        const blitz::Array<double,2>* Phi_I, const blitz::Array<double,2>* Phi_E,
+        const double rho_I, const double rho_E, const bool use_DFFS,
+        std::vector<std::vector<double> >& diff,
+        std::vector<std::vector<double> >& proj,
+        std::vector<std::vector<double> >& scores,
+        blitz::Array<double,1>& output):
+      m_input(input), m_mu_I(mu_I), m_mu_E(mu_E),
+      m_lambda_I(lambda_I), m_lambda_E(lambda_E),
+      m_Phi_I(Phi_I), m_Phi_E(Phi_E), m_rho_I(rho_I), m_rho_E(rho_E),
+      m_use_DFFS(use_DFFS), m_diff(diff), m_proj(proj), m_scores(scores),
+      m_output(output)
+    {}
+
+    /**
+     * Adds sign times the Mahalanobis distance (and the DFFS) of the rows of
+     * x to the given class to the scores
+     */
+    void distance(const double* x, const int n, const int D,
+        const blitz::Array<double,1>& mu, const blitz::Array<double,2>& Phi,
+        const blitz::Array<double,1>& lambda, const double rho,
+        const double sign, const size_t ith, double* scores) const
+    {
+      const int K = Phi.extent(1);
+      blitz::Array<double,2> diff(&m_diff[ith][0], blitz::shape(n, D),
+        blitz::neverDeleteData);
+      blitz::Array<double,2> proj(&m_proj[ith][0], blitz::shape(n, K),
+        blitz::neverDeleteData);
+      for (int i=0; i<n; ++i)
+        for (int d=0; d<D; ++d)
+          diff(i,d) = x[i*D+d] - mu(d);
+      bob::math::gemm_(diff, Phi, proj, false, false, 1., 0.);
+
+      for (int i=0; i<n; ++i) {
+        double mahalanobis = 0., sum_proj = 0.;
+        for (int k=0; k<K; ++k) {
+          const double p2 = proj(i,k) * proj(i,k);
+          mahalanobis += p2 / lambda(k);
+          sum_proj += p2;
+        }
+        if (m_use_DFFS) {
+          double sum_diff = 0.;
+          for (int d=0; d<D; ++d) sum_diff += diff(i,d) * diff(i,d);
+          mahalanobis += (sum_diff - sum_proj) / rho;
+        }
+        scores[i] += sign * mahalanobis;
+      }
+    }
+
+    void operator()(const size_t ith, const size_t b) const {
+      const int N = m_input.extent(0);
+      const int D = m_input.extent(1);
+      const int r0 = (int)(b * BIC_BLOCK_SIZE);
+      const int n = std::min(N, r0 + (int)BIC_BLOCK_SIZE) - r0;
+      const double* x = m_input.data() + r0*D;
+      double* scores = &m_scores[ith][0];
+
+      if (m_Phi_I) {
+        std::fill(scores, scores + n, 0.);
+        distance(x, n, D, m_mu_E, *m_Phi_E, m_lambda_E, m_rho_E, 1., ith, scores);
+        distance(x, n, D, m_mu_I, *m_Phi_I, m_lambda_I, m_rho_I, -1., ith, scores);
+        const double norm = m_Phi_E->extent(1) + m_Phi_I->extent(1);
+        for (int i=0; i<n; ++i) m_output(r0+i) = scores[i] / norm;
+      }
+      else {
+        // forward without projection
+        for (int i=0; i<n; ++i) {
+          double score = 0.;
+          for (int d=0; d<D; ++d) {
+            const double dE = x[i*D+d] - m_mu_E(d);
+            const double dI = x[i*D+d] - m_mu_I(d);
+            score += dE * dE / m_lambda_E(d) - dI * dI / m_lambda_I(d);
+          }
+          m_output(r0+i) = score / D;
+        }
+      }
+    }
+  };
+
+}
 
 /**
  * Initializes an empty BIC Machine
@@ -347,3 +459,81 @@ void bob::machine::BICMachine::forward(const blitz::Array<double,1>& input, doub
   forward_(input, output);
 }
 
+
+/**
+ * Computes the BIC or IEC scores for each row of the given input matrix.
+ * The difference vectors are processed by blocks, whose projections are
+ * computed with a matrix-matrix product. The blocks are distributed over
+ * several threads; no internal storage of the machine is modified, so that
+ * this method might be called concurrently.
+ * No sanity checks of input and output shape are performed.
+ *
+ * @param  input      The (difference) vectors, one per row.
+ * @param  output     The vector that will contain one score per row of input afterwards.
+ * @param  n_threads  The number of threads to use (0: number of hardware threads)
+ */
+void bob::machine::BICMachine::forward_(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const{
+  const int N = input.extent(0);
+  if (N == 0) return;
+
+  // raw data of the input and of the projection matrices is accessed
+  blitz::Array<double,2> input_copy;
+  const blitz::Array<double,2>* x = &input;
+  if (!bob::core::array::isCZeroBaseContiguous(input)){
+    input_copy.reference(bob::core::array::ccopy(input));
+    x = &input_copy;
+  }
+  blitz::Array<double,2> Phi_I_copy, Phi_E_copy;
+  const blitz::Array<double,2>* Phi_I = 0;
+  const blitz::Array<double,2>* Phi_E = 0;
+  size_t max_K = 0;
+  if (m_project_data){
+    Phi_I = &m_Phi_I;
+    Phi_E = &m_Phi_E;
+    if (!bob::core::array::isCZeroBaseContiguous(m_Phi_I)){
+      Phi_I_copy.reference(bob::core::array::ccopy(m_Phi_I));
+      Phi_I = &Phi_I_copy;
+    }
+    if (!bob::core::array::isCZeroBaseContiguous(m_Phi_E)){
+      Phi_E_copy.reference(bob::core::array::ccopy(m_Phi_E));
+      Phi_E = &Phi_E_copy;
+    }
+    max_K = std::max(m_Phi_I.extent(1), m_Phi_E.extent(1));
+  }
+
+  // output elements are written one by one
+  blitz::Array<double,1> out;
+  const bool direct_use = bob::core::array::isZeroBase(output);
+  if (direct_use) out.reference(output);
+  else out.resize(N);
+
+  const size_t n_blocks = (N + BIC_BLOCK_SIZE - 1) / BIC_BLOCK_SIZE;
+  const size_t n = bob::core::thread_count(n_blocks, n_threads);
+  const size_t D = input.extent(1);
+  std::vector<std::vector<double> > diff(n, std::vector<double>(m_project_data ? BIC_BLOCK_SIZE * D : 0));
+  std::vector<std::vector<double> > proj(n, std::vector<double>(BIC_BLOCK_SIZE * max_K));
+  std::vector<std::vector<double> > scores(n, std::vector<double>(BIC_BLOCK_SIZE));
+
+  bob::core::thread_blocks(BICScoreBlock(*x, m_mu_I, m_mu_E, m_lambda_I,
+    m_lambda_E, Phi_I, Phi_E, m_rho_I, m_rho_E, m_use_DFFS, diff, proj,
+    scores, out), n_blocks, n);
+
+  if (!direct_use) output = out;
+}
+
+/**
+ * Computes the BIC or IEC scores for each row of the given input matrix.
+ * Sanity checks of input and output shape are performed.
+ *
+ * @param  input      The (difference) vectors, one per row.
+ * @param  output     The vector that will contain one score per row of input afterwards.
+ * @param  n_threads  The number of threads to use (0: number of hardware threads)
+ */
+void bob::machine::BICMachine::forward(const blitz::Array<double,2>& input, blitz::Array<double,1>& output, const size_t n_threads) const{
+  // perform some checks
+  bob::core::array::assertSameDimensionLength(input.extent(1), m_mu_E.extent(0));
+  bob::core::array::assertSameDimensionLength(output.extent(0), input.extent(0));
+
+  // call the actual method
+  forward_(input, output, n_threads);
+}
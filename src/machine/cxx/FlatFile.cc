@@ -0,0 +1,292 @@
+/**
+ * @file machine/cxx/FlatFile.cc
+ * @date Mon Oct 19 02:42:23 2026 +0000
+ * @author agent <agent@local>
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <bob/machine/FlatFile.h>
+#include <cstring>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+  /// The magic string at the beginning of each flat file
+  static const char FLAT_FILE_MAGIC[8] = {'B', 'O', 'B', 'F', 'L', 'A', 'T', '\0'};
+  /// Byte order mark, used to detect files written on another architecture
+  static const uint32_t FLAT_FILE_BYTE_ORDER = 0x01020304;
+
+  /**
+   * The header of a flat file
+   */
+  struct FlatFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    char type[64];
+    uint64_t n_sections;
+    uint64_t table_offset;
+  };
+
+  /// Size of the header, including padding
+  static const uint64_t FLAT_FILE_HEADER_SIZE =
+    ((sizeof(FlatFileHeader) + bob::machine::FlatFile::ALIGNMENT - 1) /
+     bob::machine::FlatFile::ALIGNMENT) * bob::machine::FlatFile::ALIGNMENT;
+
+  /// Number of elements of the given section
+  uint64_t numElements(const bob::machine::detail::FlatFileSection& s) {
+    uint64_t n = 1;
+    for (uint64_t i=0; i<s.ndim; ++i) n *= s.shape[i];
+    return n;
+  }
+
+  /// Copies a string into a fixed-size, zero-terminated buffer
+  void copyName(char* dst, const size_t size, const std::string& src,
+      const std::string& filename) {
+    if (src.size() >= size) {
+      boost::format m("name '%s' is too long to be stored in flat file '%s' (at most %d characters are supported)");
+      m % src % filename % (size-1);
+      throw std::runtime_error(m.str());
+    }
+    std::memset(dst, 0, size);
+    std::memcpy(dst, src.c_str(), src.size());
+  }
+
+}
+
+const uint32_t bob::machine::FlatFile::VERSION;
+const uint64_t bob::machine::FlatFile::ALIGNMENT;
+
+bob::machine::FlatFile::FlatFile(const std::string& filename):
+  m_filename(filename),
+  m_version(0),
+  m_data(0),
+  m_size(0)
+{
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    boost::format m("cannot open flat file '%s': %s");
+    m % filename % std::strerror(errno);
+    throw std::runtime_error(m.str());
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || (uint64_t)st.st_size < FLAT_FILE_HEADER_SIZE) {
+    ::close(fd);
+    boost::format m("flat file '%s' is too short or cannot be read");
+    m % filename;
+    throw std::runtime_error(m.str());
+  }
+  m_size = st.st_size;
+  // a private (copy-on-write) mapping shares the pages with other processes,
+  // and allows the machines to modify their parameters in place
+  void* data = ::mmap(0, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    boost::format m("cannot map flat file '%s' in memory: %s");
+    m % filename % std::strerror(errno);
+    throw std::runtime_error(m.str());
+  }
+  m_data = static_cast<char*>(data);
+
+  try {
+    FlatFileHeader header;
+    std::memcpy(&header, m_data, sizeof(FlatFileHeader));
+    if (std::memcmp(header.magic, FLAT_FILE_MAGIC, sizeof(FLAT_FILE_MAGIC)) != 0) {
+      boost::format m("file '%s' is not a flat machine file");
+      m % filename;
+      throw std::runtime_error(m.str());
+    }
+    if (header.byte_order != FLAT_FILE_BYTE_ORDER) {
+      boost::format m("flat file '%s' was written on an architecture with a different byte order");
+      m % filename;
+      throw std::runtime_error(m.str());
+    }
+    if (header.version == 0 || header.version > VERSION) {
+      boost::format m("flat file '%s' has version %u, but only versions up to %u are supported");
+      m % filename % header.version % VERSION;
+      throw std::runtime_error(m.str());
+    }
+    m_version = header.version;
+    header.type[sizeof(header.type)-1] = '\0';
+    m_type = header.type;
+
+    const uint64_t table_size = header.n_sections * sizeof(detail::FlatFileSection);
+    if (header.table_offset < FLAT_FILE_HEADER_SIZE ||
+        header.table_offset + table_size > m_size) {
+      boost::format m("flat file '%s' is truncated (section table is missing)");
+      m % filename;
+      throw std::runtime_error(m.str());
+    }
+    for (uint64_t i=0; i<header.n_sections; ++i) {
+      detail::FlatFileSection s;
+      std::memcpy(&s, m_data + header.table_offset + i * sizeof(detail::FlatFileSection),
+        sizeof(detail::FlatFileSection));
+      s.name[sizeof(s.name)-1] = '\0';
+      if (s.ndim > 4 || s.offset % ALIGNMENT != 0 ||
+          s.offset + numElements(s) * sizeof(double) > header.table_offset) {
+        boost::format m("section '%s' of flat file '%s' is corrupted");
+        m % s.name % filename;
+        throw std::runtime_error(m.str());
+      }
+      m_sections[s.name] = s;
+    }
+  }
+  catch (...) {
+    ::munmap(m_data, m_size);
+    throw;
+  }
+}
+
+bob::machine::FlatFile::~FlatFile()
+{
+  ::munmap(m_data, m_size);
+}
+
+void bob::machine::FlatFile::checkType(const std::string& type) const
+{
+  if (m_type != type) {
+    boost::format m("flat file '%s' contains a machine of type '%s', but a '%s' was expected");
+    m % m_filename % m_type % type;
+    throw std::runtime_error(m.str());
+  }
+}
+
+std::vector<std::string> bob::machine::FlatFile::getSectionNames() const
+{
+  std::vector<std::string> names;
+  for (std::map<std::string, detail::FlatFileSection>::const_iterator
+      it=m_sections.begin(); it!=m_sections.end(); ++it)
+    names.push_back(it->first);
+  return names;
+}
+
+const bob::machine::detail::FlatFileSection&
+bob::machine::FlatFile::section(const std::string& name,
+  const uint64_t ndim) const
+{
+  std::map<std::string, detail::FlatFileSection>::const_iterator it =
+    m_sections.find(name);
+  if (it == m_sections.end()) {
+    boost::format m("flat file '%s' has no section '%s'");
+    m % m_filename % name;
+    throw std::runtime_error(m.str());
+  }
+  if (it->second.ndim != ndim) {
+    boost::format m("section '%s' of flat file '%s' has %d dimensions, but %d were expected");
+    m % name % m_filename % it->second.ndim % ndim;
+    throw std::runtime_error(m.str());
+  }
+  return it->second;
+}
+
+
+bob::machine::FlatFileWriter::FlatFileWriter(const std::string& filename,
+    const std::string& type):
+  m_filename(filename),
+  m_type(type),
+  m_file(filename.c_str(), std::ios::binary | std::ios::trunc | std::ios::out)
+{
+  if (!m_file) {
+    boost::format m("cannot open flat file '%s' for writing");
+    m % filename;
+    throw std::runtime_error(m.str());
+  }
+  // checks the type early; the header is written when closing the file
+  char dummy[64];
+  copyName(dummy, sizeof(dummy), type, filename);
+  const std::vector<char> padding(FLAT_FILE_HEADER_SIZE, 0);
+  m_file.write(&padding[0], padding.size());
+}
+
+bob::machine::FlatFileWriter::~FlatFileWriter()
+{
+  if (m_file.is_open()) {
+    try {
+      close();
+    }
+    catch (...) {
+      // destructors should not throw
+    }
+  }
+}
+
+bob::machine::detail::FlatFileSection&
+bob::machine::FlatFileWriter::newSection(const std::string& name,
+  const uint64_t ndim)
+{
+  if (!m_file.is_open()) {
+    boost::format m("flat file '%s' has already been closed");
+    m % m_filename;
+    throw std::runtime_error(m.str());
+  }
+  for (size_t i=0; i<m_sections.size(); ++i) {
+    if (name == m_sections[i].name) {
+      boost::format m("section '%s' has already been written to flat file '%s'");
+      m % name % m_filename;
+      throw std::runtime_error(m.str());
+    }
+  }
+  // aligns the data of the new section
+  const uint64_t position = m_file.tellp();
+  const uint64_t offset = ((position + FlatFile::ALIGNMENT - 1) /
+    FlatFile::ALIGNMENT) * FlatFile::ALIGNMENT;
+  const std::vector<char> padding(offset - position + 1, 0);
+  m_file.write(&padding[0], offset - position);
+
+  detail::FlatFileSection s;
+  std::memset(&s, 0, sizeof(detail::FlatFileSection));
+  copyName(s.name, sizeof(s.name), name, m_filename);
+  s.ndim = ndim;
+  s.offset = offset;
+  m_sections.push_back(s);
+  return m_sections.back();
+}
+
+void bob::machine::FlatFileWriter::write(const double* data, const size_t size)
+{
+  m_file.write(reinterpret_cast<const char*>(data), size * sizeof(double));
+  if (!m_file) {
+    boost::format m("cannot write to flat file '%s'");
+    m % m_filename;
+    throw std::runtime_error(m.str());
+  }
+}
+
+void bob::machine::FlatFileWriter::set(const std::string& name,
+  const double value)
+{
+  newSection(name, 0);
+  write(&value, 1);
+}
+
+void bob::machine::FlatFileWriter::close()
+{
+  if (!m_file.is_open()) return;
+
+  FlatFileHeader header;
+  std::memset(&header, 0, sizeof(FlatFileHeader));
+  std::memcpy(header.magic, FLAT_FILE_MAGIC, sizeof(FLAT_FILE_MAGIC));
+  header.version = FlatFile::VERSION;
+  header.byte_order = FLAT_FILE_BYTE_ORDER;
+  copyName(header.type, sizeof(header.type), m_type, m_filename);
+  header.n_sections = m_sections.size();
+  header.table_offset = m_file.tellp();
+
+  // section table, then header
+  if (!m_sections.empty())
+    m_file.write(reinterpret_cast<const char*>(&m_sections[0]),
+      m_sections.size() * sizeof(detail::FlatFileSection));
+  m_file.seekp(0);
+  m_file.write(reinterpret_cast<const char*>(&header), sizeof(FlatFileHeader));
+  m_file.close();
+  if (!m_file) {
+    boost::format m("cannot write to flat file '%s'");
+    m % m_filename;
+    throw std::runtime_error(m.str());
+  }
+}
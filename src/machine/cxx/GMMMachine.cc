@@ -403,6 +403,28 @@ void bob::machine::GMMMachine::load(bob::io::HDF5File& config) {
   initCache();
 }
 
+void bob::machine::GMMMachine::save(bob::machine::FlatFileWriter& config) const {
+  blitz::Array<double,2> buffer(m_n_gaussians, m_n_inputs);
+  getMeans(buffer);
+  config.setArray("means", buffer);
+  getVariances(buffer);
+  config.setArray("variances", buffer);
+  getVarianceThresholds(buffer);
+  config.setArray("variance_thresholds", buffer);
+  config.setArray("weights", m_weights);
+}
+
+void bob::machine::GMMMachine::load(const bob::machine::FlatFile& config) {
+  config.checkType("GMMMachine");
+  const blitz::Array<double,2> means = config.getArray<2>("means");
+  resize(means.extent(0), means.extent(1));
+  // thresholds are set first, as setting the variances applies them
+  setVarianceThresholds(config.getArray<2>("variance_thresholds"));
+  setMeans(means);
+  setVariances(config.getArray<2>("variances"));
+  setWeights(config.getArray<1>("weights"));
+}
+
 void bob::machine::GMMMachine::updateCacheSupervectors() const
 {
   m_cache_mean_supervector.resize(m_n_gaussians*m_n_inputs);
@@ -9,8 +9,139 @@
  */
 
 #include <bob/machine/GaborGraphMachine.h>
+#include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
+#include <boost/format.hpp>
+#include <algorithm>
 #include <complex>
 
+namespace {
+
+  /// Number of gallery graphs which are compared at once
+  static const size_t GABOR_GRAPH_BLOCK_SIZE = 256;
+
+  /**
+   * Computes the similarities of a probe graph to a block of graphs of a
+   * contiguous gallery, in which each jet occupies jet_size values (the
+   * jet_length absolute values, possibly followed by the phases).
+   * For the scalar product, the similarities of the block are obtained with a
+   * single matrix-vector product with the probe graph, whose phases have been
+   * zeroed. Otherwise, the jet similarities are computed with per-thread
+   * buffers, so that the similarity function is not modified.
+   */
+  struct GaborGraphSimilarityBlock {
+    const double* m_gallery;
+    const blitz::Array<double,2>& m_probe;
+    const int m_n_graphs, m_n_nodes, m_jet_size, m_jet_length;
+    const bob::machine::GaborJetSimilarity& m_function;
+    std::vector<std::vector<double> >& m_buffers;
+    double* m_similarities;
+
+    GaborGraphSimilarityBlock(const double* gallery,
+        const blitz::Array<double,2>& probe, const int n_graphs,
+        const int n_nodes, const int jet_size, const int jet_length,
+        const bob::machine::GaborJetSimilarity& function,
+        std::vector<std::vector<double> >& buffers, double* similarities):
+      m_gallery(gallery), m_probe(probe), m_n_graphs(n_graphs),
+      m_n_nodes(n_nodes), m_jet_size(jet_size), m_jet_length(jet_length),
+      m_function(function), m_buffers(buffers), m_similarities(similarities)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      const int g0 = (int)(b * GABOR_GRAPH_BLOCK_SIZE);
+      const int n = std::min(m_n_graphs, g0 + (int)GABOR_GRAPH_BLOCK_SIZE) - g0;
+      const int graph_size = m_n_nodes * m_jet_size;
+
+      if (m_function.type() == bob::machine::GaborJetSimilarity::SCALAR_PRODUCT){
+        // m_probe is a (graph_size x 1) column
+        const blitz::Array<double,2> G(const_cast<double*>(m_gallery) + g0 * graph_size,
+          blitz::shape(n, graph_size), blitz::neverDeleteData);
+        blitz::Array<double,2> S(m_similarities + g0, blitz::shape(n, 1),
+          blitz::neverDeleteData);
+        bob::math::gemm_(G, m_probe, S, false, false, 1. / m_n_nodes, 0.);
+        return;
+      }
+
+      double* confidences = &m_buffers[ith][0];
+      double* phase_differences = confidences + m_jet_length;
+      blitz::TinyVector<double,2> disparity;
+      const double* probe = m_probe.data();
+      for (int g = g0; g < g0 + n; ++g){
+        const double* graph = m_gallery + g * graph_size;
+        double similarity = 0.;
+        for (int i = 0; i < m_n_nodes; ++i){
+          similarity += m_function.similarity_(graph + i * m_jet_size,
+            probe + i * m_jet_size, m_jet_length, confidences,
+            phase_differences, disparity);
+        }
+        m_similarities[g] = similarity / m_n_nodes;
+      }
+    }
+  };
+
+  /**
+   * Computes the similarities of the probe graph to all graphs of the
+   * gallery, using several threads
+   */
+  void gallery_similarities(const double* gallery, const double* probe,
+    const int n_graphs, const int n_nodes, const int jet_size,
+    const int jet_length, const bob::machine::GaborJetSimilarity& function,
+    double* similarities, const size_t n_threads)
+  {
+    if (n_graphs == 0) return;
+
+    blitz::Array<double,2> probe_(n_nodes * jet_size, 1);
+    std::copy(probe, probe + n_nodes * jet_size, probe_.data());
+    if (function.type() == bob::machine::GaborJetSimilarity::SCALAR_PRODUCT){
+      // only the absolute values are used by the scalar product
+      for (int i = 0; i < n_nodes; ++i)
+        for (int j = jet_length; j < jet_size; ++j)
+          probe_(i * jet_size + j, 0) = 0.;
+    }
+
+    const size_t n_blocks = (n_graphs + GABOR_GRAPH_BLOCK_SIZE - 1) / GABOR_GRAPH_BLOCK_SIZE;
+    const size_t n = bob::core::thread_count(n_blocks, n_threads);
+    std::vector<std::vector<double> > buffers(n, std::vector<double>(2 * jet_length));
+    bob::core::thread_blocks(GaborGraphSimilarityBlock(gallery, probe_,
+      n_graphs, n_nodes, jet_size, jet_length, function, buffers,
+      similarities), n_blocks, n);
+  }
+
+  /// Orders indices by decreasing similarity (and increasing index)
+  struct GreaterSimilarity {
+    const blitz::Array<double,1>& m_similarities;
+    GreaterSimilarity(const blitz::Array<double,1>& similarities): m_similarities(similarities) {}
+    bool operator()(const int i, const int j) const {
+      return m_similarities(i) > m_similarities(j) || (m_similarities(i) == m_similarities(j) && i < j);
+    }
+  };
+
+  /**
+   * Writes the indices of the indices.extent(0) largest similarities, with
+   * their similarity values, in decreasing order of similarity
+   */
+  void best(const blitz::Array<double,1>& all_similarities,
+    blitz::Array<int,1>& indices, blitz::Array<double,1>& similarities)
+  {
+    const int k = indices.extent(0);
+    if (k > all_similarities.extent(0)){
+      boost::format m("cannot search the %d most similar graphs in a gallery of %d graphs");
+      m % k % all_similarities.extent(0);
+      throw std::runtime_error(m.str());
+    }
+    bob::core::array::assertSameDimensionLength(similarities.extent(0), k);
+    std::vector<int> order(all_similarities.extent(0));
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), GreaterSimilarity(all_similarities));
+    for (int i = 0; i < k; ++i){
+      indices(indices.lbound(0) + i) = order[i];
+      similarities(similarities.lbound(0) + i) = all_similarities(order[i]);
+    }
+  }
+
+}
+
 /**
  * Generates Gabor graph machine that generates grid graphs which will be placed according to the given eye positions
  * @param lefteye  Position of the left eye
@@ -305,6 +436,119 @@ double bob::machine::GaborGraphMachine::similarity(
 }
 
 
+/**
+ * Computes the similarities of the given probe graph to each of the graphs of the gallery.
+ * The gallery graphs are processed in blocks by several threads.
+ * @param gallery_graph_jets  The contiguous gallery of graphs, containing absolute values of Gabor jets only
+ * @param probe_graph_jets  The probe graph to compare
+ * @param jet_similarity_function  The similarity function to be used for comparison of two corresponding Gabor jets
+ * @param similarities  The similarities of the probe graph to each gallery graph
+ * @param n_threads  The number of threads to use (0: number of hardware threads)
+ */
+void bob::machine::GaborGraphMachine::similarities(
+  const blitz::Array<double,3>& gallery_graph_jets,
+  const blitz::Array<double,2>& probe_graph_jets,
+  const bob::machine::GaborJetSimilarity& jet_similarity_function,
+  blitz::Array<double,1>& similarities,
+  const size_t n_threads
+) const
+{
+  if (jet_similarity_function.type() >= bob::machine::GaborJetSimilarity::DISPARITY)
+    throw std::runtime_error("Disparity similarity (and its derivatives) need Gabor jets including phases");
+  bob::core::array::assertCZeroBaseContiguous(gallery_graph_jets);
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(1), probe_graph_jets.extent(0));
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(2), probe_graph_jets.extent(1));
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(0), similarities.extent(0));
+
+  blitz::Array<double,2> probe = bob::core::array::ccopy(probe_graph_jets);
+  blitz::Array<double,1> result(similarities.extent(0));
+  gallery_similarities(gallery_graph_jets.data(), probe.data(),
+    gallery_graph_jets.extent(0), gallery_graph_jets.extent(1),
+    gallery_graph_jets.extent(2), gallery_graph_jets.extent(2),
+    jet_similarity_function, result.data(), n_threads);
+  similarities = result;
+}
+
+/**
+ * Computes the similarities of the given probe graph to each of the graphs of the gallery.
+ * The gallery graphs are processed in blocks by several threads.
+ * @param gallery_graph_jets  The contiguous gallery of graphs, containing absolute values and phases of Gabor jets
+ * @param probe_graph_jets  The probe graph to compare
+ * @param jet_similarity_function  The similarity function to be used for comparison of two corresponding Gabor jets
+ * @param similarities  The similarities of the probe graph to each gallery graph
+ * @param n_threads  The number of threads to use (0: number of hardware threads)
+ */
+void bob::machine::GaborGraphMachine::similarities(
+  const blitz::Array<double,4>& gallery_graph_jets,
+  const blitz::Array<double,3>& probe_graph_jets,
+  const bob::machine::GaborJetSimilarity& jet_similarity_function,
+  blitz::Array<double,1>& similarities,
+  const size_t n_threads
+) const
+{
+  bob::core::array::assertCZeroBaseContiguous(gallery_graph_jets);
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(1), probe_graph_jets.extent(0));
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(2), 2);
+  bob::core::array::assertSameDimensionLength(probe_graph_jets.extent(1), 2);
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(3), probe_graph_jets.extent(2));
+  bob::core::array::assertSameDimensionLength(gallery_graph_jets.extent(0), similarities.extent(0));
+
+  blitz::Array<double,3> probe = bob::core::array::ccopy(probe_graph_jets);
+  blitz::Array<double,1> result(similarities.extent(0));
+  gallery_similarities(gallery_graph_jets.data(), probe.data(),
+    gallery_graph_jets.extent(0), gallery_graph_jets.extent(1),
+    2 * gallery_graph_jets.extent(3), gallery_graph_jets.extent(3),
+    jet_similarity_function, result.data(), n_threads);
+  similarities = result;
+}
+
+/**
+ * Finds the graphs of the gallery that are the most similar to the given probe graph.
+ * @param gallery_graph_jets  The contiguous gallery of graphs, containing absolute values of Gabor jets only
+ * @param probe_graph_jets  The probe graph to compare
+ * @param jet_similarity_function  The similarity function to be used for comparison of two corresponding Gabor jets
+ * @param indices  The indices of the most similar gallery graphs, sorted by decreasing similarity; its length defines the number of graphs to find
+ * @param similarities  The similarities of the probe graph to the gallery graphs given by indices
+ * @param n_threads  The number of threads to use (0: number of hardware threads)
+ */
+void bob::machine::GaborGraphMachine::search(
+  const blitz::Array<double,3>& gallery_graph_jets,
+  const blitz::Array<double,2>& probe_graph_jets,
+  const bob::machine::GaborJetSimilarity& jet_similarity_function,
+  blitz::Array<int,1>& indices,
+  blitz::Array<double,1>& similarities,
+  const size_t n_threads
+) const
+{
+  blitz::Array<double,1> all_similarities(gallery_graph_jets.extent(0));
+  this->similarities(gallery_graph_jets, probe_graph_jets, jet_similarity_function, all_similarities, n_threads);
+  best(all_similarities, indices, similarities);
+}
+
+/**
+ * Finds the graphs of the gallery that are the most similar to the given probe graph.
+ * @param gallery_graph_jets  The contiguous gallery of graphs, containing absolute values and phases of Gabor jets
+ * @param probe_graph_jets  The probe graph to compare
+ * @param jet_similarity_function  The similarity function to be used for comparison of two corresponding Gabor jets
+ * @param indices  The indices of the most similar gallery graphs, sorted by decreasing similarity; its length defines the number of graphs to find
+ * @param similarities  The similarities of the probe graph to the gallery graphs given by indices
+ * @param n_threads  The number of threads to use (0: number of hardware threads)
+ */
+void bob::machine::GaborGraphMachine::search(
+  const blitz::Array<double,4>& gallery_graph_jets,
+  const blitz::Array<double,3>& probe_graph_jets,
+  const bob::machine::GaborJetSimilarity& jet_similarity_function,
+  blitz::Array<int,1>& indices,
+  blitz::Array<double,1>& similarities,
+  const size_t n_threads
+) const
+{
+  blitz::Array<double,1> all_similarities(gallery_graph_jets.extent(0));
+  this->similarities(gallery_graph_jets, probe_graph_jets, jet_similarity_function, all_similarities, n_threads);
+  best(all_similarities, indices, similarities);
+}
+
+
 void bob::machine::GaborGraphMachine::save(bob::io::HDF5File& file) const{
   file.setArray("NodePositions", m_node_positions);
 }
@@ -45,22 +45,11 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,1>
   bob::core::array::assertCZeroBaseContiguous(jet2);
   bob::core::array::assertSameShape(jet1,jet2);
 
-  switch (m_type){
-    case SCALAR_PRODUCT:
-      // normalized scalar product
-      return std::inner_product(jet1.begin(), jet1.end(), jet2.begin(), 0.);
-    case CANBERRA:{
-      // Canberra similarity
-      double sim = 0.;
-      unsigned size = jet1.shape()[0];
-      for (unsigned j = size; j--;){
-        sim += 1. - std::abs(jet1(j) - jet2(j)) / (jet1(j) + jet2(j));
-      }
-      return sim / size;
-    }
-    default:
-      throw std::runtime_error("Disparity similarity (and its derivatives) need Gabor jets including phases");
-  }
+  if (m_type >= DISPARITY)
+    throw std::runtime_error("Disparity similarity (and its derivatives) need Gabor jets including phases");
+
+  blitz::TinyVector<double,2> disparity;
+  return similarity_(jet1.data(), jet2.data(), jet1.extent(0), 0, 0, disparity);
 }
 
 
@@ -75,11 +64,32 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
   bob::core::array::assertCZeroBaseContiguous(jet2);
   bob::core::array::assertSameShape(jet1,jet2);
 
+  return similarity_(jet1.data(), jet2.data(), jet1.extent(1), &m_confidences[0], &m_phase_differences[0], m_disparity);
+}
+
+
+double bob::machine::GaborJetSimilarity::similarity_(const double* jet1, const double* jet2, const int jet_length, double* confidences, double* phase_differences, blitz::TinyVector<double,2>& disparity) const{
+  switch (m_type){
+    case SCALAR_PRODUCT:
+      // normalized scalar product
+      return std::inner_product(jet1, jet1 + jet_length, jet2, 0.);
+    case CANBERRA:{
+      // Canberra similarity
+      double sim = 0.;
+      for (int j = jet_length; j--;){
+        sim += 1. - std::abs(jet1[j] - jet2[j]) / (jet1[j] + jet2[j]);
+      }
+      return sim / jet_length;
+    }
+    default:
+      break;
+  }
+
   // compute confidence vectors
-  compute_confidences(jet1, jet2);
+  compute_confidences(jet1, jet2, jet_length, confidences, phase_differences);
 
   // now, compute the disparity
-  compute_disparity();
+  compute_disparity(confidences, phase_differences, disparity);
 
   const std::vector<blitz::TinyVector<double,2> >& kernels = m_gwt.kernelFrequencies();
 
@@ -87,8 +97,8 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
     case DISPARITY:{
       // compute the similarity using the estimated disparity
       double sum = 0.;
-      for (int j = m_confidences.size(); j--;){
-        sum += m_confidences[j] * cos(m_phase_differences[j] - m_disparity[0] * kernels[j][0] - m_disparity[1] * kernels[j][1]);
+      for (int j = jet_length; j--;){
+        sum += confidences[j] * cos(phase_differences[j] - disparity[0] * kernels[j][0] - disparity[1] * kernels[j][1]);
       }
       return sum;
     } // DISPARITY
@@ -96,22 +106,22 @@ double bob::machine::GaborJetSimilarity::operator()(const blitz::Array<double,2>
     case PHASE_DIFF:{
       // compute the similarity using the estimated disparity
       double sum = 0.;
-      for (int j = m_phase_differences.size(); j--;){
-        sum += cos(m_phase_differences[j] - m_disparity[0] * kernels[j][0] - m_disparity[1] * kernels[j][1]);
+      for (int j = jet_length; j--;){
+        sum += cos(phase_differences[j] - disparity[0] * kernels[j][0] - disparity[1] * kernels[j][1]);
       }
-      return sum / jet1.shape()[1];
+      return sum / jet_length;
     } // PHASE_DIFF
 
     case PHASE_DIFF_PLUS_CANBERRA:{
       // compute the similarity using the estimated disparity
       double sum = 0.;
-      for (int j = m_phase_differences.size(); j--;){
+      for (int j = jet_length; j--;){
         // add disparity term
-        sum += cos(m_phase_differences[j] - m_disparity[0] * kernels[j][0] - m_disparity[1] * kernels[j][1]);
+        sum += cos(phase_differences[j] - disparity[0] * kernels[j][0] - disparity[1] * kernels[j][1]);
         // add Canberra term
-        sum += 1. - std::abs(jet1(0,j) - jet2(0,j)) / (jet1(0,j) + jet2(0,j));
+        sum += 1. - std::abs(jet1[j] - jet2[j]) / (jet1[j] + jet2[j]);
       }
-      return sum / (2. * jet1.shape()[1]);
+      return sum / (2. * jet_length);
     }
 
     default:
@@ -128,29 +138,30 @@ static double adjustPhase(double phase){
   return phase - (2.*M_PI)*round(phase / (2.*M_PI));
 }
 
-void bob::machine::GaborJetSimilarity::compute_confidences(const blitz::Array<double,2>& jet1, const blitz::Array<double,2>& jet2) const{
+void bob::machine::GaborJetSimilarity::compute_confidences(const double* jet1, const double* jet2, const int jet_length, double* confidences, double* phase_differences) const{
   // first, fill confidence and phase difference vectors
-  for (int j = m_confidences.size(); j--;){
-    m_confidences[j] = jet1(0,j) * jet2(0,j);
-    m_phase_differences[j] = adjustPhase(jet1(1,j) - jet2(1,j));
+  // (absolute values are stored first, followed by the phases)
+  for (int j = jet_length; j--;){
+    confidences[j] = jet1[j] * jet2[j];
+    phase_differences[j] = adjustPhase(jet1[jet_length+j] - jet2[jet_length+j]);
   }
 }
 
-void bob::machine::GaborJetSimilarity::compute_disparity() const{
+void bob::machine::GaborJetSimilarity::compute_disparity(const double* confidences, const double* phase_differences, blitz::TinyVector<double,2>& disparity) const{
   // approximate the disparity from the phase differences
   double gamma_x_x = 0., gamma_x_y = 0., gamma_y_y = 0., phi_x = 0., phi_y = 0.;
   // initialize the disparity with 0
-  m_disparity = 0.;
+  disparity = 0.;
 
   const std::vector<blitz::TinyVector<double,2> >& kernels = m_gwt.kernelFrequencies();
   // iterate backwards through the vector to start with the lowest frequency wavelets
-  for (int j = m_confidences.size()-1, level = m_gwt.numberOfScales()-1; level >= 0; --level){
+  for (int j = m_gwt.numberOfKernels()-1, level = m_gwt.numberOfScales()-1; level >= 0; --level){
     for (int direction = m_gwt.numberOfDirections()-1; direction >= 0; --direction, --j){
       double
           kjx = kernels[j][1],
           kjy = kernels[j][0],
-          conf = m_confidences[j],
-          diff = m_phase_differences[j];
+          conf = confidences[j],
+          diff = phase_differences[j];
 
       // totalize gamma matrix
       gamma_x_x += kjx * kjx * conf;
@@ -159,7 +170,7 @@ void bob::machine::GaborJetSimilarity::compute_disparity() const{
 
       // totalize phi vector
       // estimate the number of cycles that we are off
-      double nL = round((diff - m_disparity[1] * kjx - m_disparity[0] * kjy) / (2.*M_PI));
+      double nL = round((diff - disparity[1] * kjx - disparity[0] * kjy) / (2.*M_PI));
       // totalize corrected phi vector elements
       phi_x += (diff - nL * 2. * M_PI) * conf * kjx;
       phi_y += (diff - nL * 2. * M_PI) * conf * kjy;
@@ -167,8 +178,8 @@ void bob::machine::GaborJetSimilarity::compute_disparity() const{
 
     // re-calculate disparity as d=\Gamma^{-1}\Phi of the (low frequency) wavelet scales that we used up to now
     double gamma_det = gamma_x_x * gamma_y_y - sqr(gamma_x_y);
-    m_disparity[1] = (gamma_y_y * phi_x - gamma_x_y * phi_y) / gamma_det;
-    m_disparity[0] = (gamma_x_x * phi_y - gamma_x_y * phi_x) / gamma_det;
+    disparity[1] = (gamma_y_y * phi_x - gamma_x_y * phi_y) / gamma_det;
+    disparity[0] = (gamma_x_x * phi_y - gamma_x_y * phi_x) / gamma_det;
 
   } // for level
 }
@@ -39,6 +39,11 @@ bob::machine::IVectorMachine::IVectorMachine(bob::io::HDF5File& config)
   load(config);
 }
 
+bob::machine::IVectorMachine::IVectorMachine(const boost::shared_ptr<const bob::machine::FlatFile> config)
+{
+  load(config);
+}
+
 bob::machine::IVectorMachine::~IVectorMachine() {
 }
 
@@ -59,6 +64,42 @@ void bob::machine::IVectorMachine::load(bob::io::HDF5File& config)
   resizePrecompute();
 }
 
+void bob::machine::IVectorMachine::save(bob::machine::FlatFileWriter& config) const
+{
+  config.setArray("T", m_T);
+  config.setArray("sigma", m_sigma);
+  config.set("variance_threshold", m_variance_threshold);
+  if (m_ubm)
+  {
+    config.setArray("Tct_sigmacInv", m_cache_Tct_sigmacInv);
+    config.setArray("Tct_sigmacInv_Tc", m_cache_Tct_sigmacInv_Tc);
+  }
+}
+
+void bob::machine::IVectorMachine::load(const boost::shared_ptr<const bob::machine::FlatFile> config)
+{
+  config->checkType("IVectorMachine");
+  //uses views on the mapped data
+  m_T.reference(config->getArray<2>("T"));
+  m_rt = m_T.extent(1);
+  m_sigma.reference(config->getArray<1>("sigma"));
+  m_variance_threshold = config->get("variance_threshold");
+  m_flat_file = config;
+
+  bool cached = config->contains("Tct_sigmacInv") && config->contains("Tct_sigmacInv_Tc");
+  if (cached)
+  {
+    m_cache_Tct_sigmacInv.reference(config->getArray<3>("Tct_sigmacInv"));
+    m_cache_Tct_sigmacInv_Tc.reference(config->getArray<3>("Tct_sigmacInv_Tc"));
+    if (m_ubm)
+      cached = m_cache_Tct_sigmacInv.extent(0) == (int)getDimC() &&
+               m_cache_Tct_sigmacInv.extent(1) == (int)m_rt &&
+               m_cache_Tct_sigmacInv.extent(2) == (int)getDimD();
+  }
+  if (cached) resizeTmp();
+  else resizePrecompute();
+}
+
 void bob::machine::IVectorMachine::resize(const size_t rt)
 {
   m_rt = rt;
@@ -8,10 +8,14 @@
 
 
 #include <bob/machine/JFAMachine.h>
+#include <bob/core/assert.h>
 #include <bob/core/array_copy.h>
 #include <bob/math/linear.h>
 #include <bob/math/inv.h>
 #include <bob/machine/LinearScoring.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
+#include <algorithm>
 #include <limits>
 
 
@@ -307,6 +311,168 @@ void bob::machine::FABase::estimateX(const bob::machine::GMMStats& gmm_stats, bl
   estimateX(m_tmp_IdPlusUSProdInv, m_tmp_Fn_x, x); // Estimates the value of x
 }
 
+namespace {
+
+  /// Number of sessions processed at once when estimating Ux
+  static const size_t FA_ESTIMATE_BLOCK_SIZE = 16;
+  /// Number of probes which are scored at once
+  static const size_t FA_SCORING_BATCH_SIZE = 512;
+
+  /**
+   * Computes U_{c}^T.Sigma_{c}^-1.U_{c} for a range of Gaussian components
+   */
+  struct FAUSProdRange {
+    const blitz::Array<double,2>& m_U;
+    const blitz::Array<double,1>& m_sigma;
+    const int m_dim_d;
+    blitz::Array<double,3>& m_USProd;
+
+    FAUSProdRange(const blitz::Array<double,2>& U,
+        const blitz::Array<double,1>& sigma, const int dim_d,
+        blitz::Array<double,3>& USProd):
+      m_U(U), m_sigma(sigma), m_dim_d(dim_d), m_USProd(USProd)
+    {}
+
+    void operator()(size_t, const size_t begin, const size_t end) const {
+      const int ru = m_U.extent(1);
+      for (int c=(int)begin; c<(int)end; ++c)
+        for (int i=0; i<ru; ++i)
+          for (int j=i; j<ru; ++j) {
+            double sum = 0.;
+            for (int d=c*m_dim_d; d<(c+1)*m_dim_d; ++d)
+              sum += m_U(d,i) * m_U(d,j) / m_sigma(d);
+            m_USProd(c,i,j) = sum;
+            m_USProd(c,j,i) = sum;
+          }
+    }
+  };
+
+  /**
+   * Estimates Ux for a block of sessions:
+   *   Ux = U.(Id + sum_c N_c.U_{c}^T.Sigma_{c}^-1.U_{c})^-1.U^T.Sigma^-1.Fn_x
+   * The products by U^T.Sigma^-1 and by U are computed for the whole block
+   * at once.
+   */
+  struct FAEstimateUxBlock {
+    const blitz::Array<double,2>& m_U;
+    const blitz::Array<double,2>& m_UtSigmaInv;
+    const blitz::Array<double,1>& m_mean;
+    const blitz::Array<double,3>& m_USProd;
+    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& m_stats;
+    std::vector<std::vector<double> >& m_fn_buffers;
+    std::vector<std::vector<double> >& m_ru_buffers;
+    std::vector<std::vector<double> >& m_ruru_buffers;
+    double* m_Ux;
+
+    FAEstimateUxBlock(const blitz::Array<double,2>& U,
+        const blitz::Array<double,2>& UtSigmaInv,
+        const blitz::Array<double,1>& mean,
+        const blitz::Array<double,3>& USProd,
+        const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats,
+        std::vector<std::vector<double> >& fn_buffers,
+        std::vector<std::vector<double> >& ru_buffers,
+        std::vector<std::vector<double> >& ruru_buffers,
+        double* Ux):
+      m_U(U), m_UtSigmaInv(UtSigmaInv), m_mean(mean), m_USProd(USProd),
+      m_stats(stats), m_fn_buffers(fn_buffers), m_ru_buffers(ru_buffers),
+      m_ruru_buffers(ruru_buffers), m_Ux(Ux)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      const int CD = m_U.extent(0);
+      const int ru = m_U.extent(1);
+      const int C = m_USProd.extent(0);
+      const int D = CD / C;
+      const int first = b * FA_ESTIMATE_BLOCK_SIZE;
+      const int n = std::min((int)m_stats.size(), first + (int)FA_ESTIMATE_BLOCK_SIZE) - first;
+
+      blitz::Array<double,2> Fn_x(&m_fn_buffers[ith][0], blitz::shape(n, CD),
+        blitz::neverDeleteData);
+      blitz::Array<double,2> UtSigmaInvFn_x(&m_ru_buffers[ith][0],
+        blitz::shape(n, ru), blitz::neverDeleteData);
+      blitz::Array<double,2> x(&m_ru_buffers[ith][n*ru], blitz::shape(n, ru),
+        blitz::neverDeleteData);
+      blitz::Array<double,2> IdPlusUSProd(&m_ruru_buffers[ith][0],
+        blitz::shape(ru, ru), blitz::neverDeleteData);
+      blitz::Array<double,2> IdPlusUSProdInv(&m_ruru_buffers[ith][ru*ru],
+        blitz::shape(ru, ru), blitz::neverDeleteData);
+
+      // Fn_x = N*(o - m) (Normalised first order statistics)
+      for (int t=0; t<n; ++t) {
+        const bob::machine::GMMStats& stats = *m_stats[first+t];
+        for (int c=0; c<C; ++c) {
+          const double n_c = stats.n(c);
+          for (int d=0; d<D; ++d)
+            Fn_x(t, c*D+d) = stats.sumPx(c,d) - m_mean(c*D+d) * n_c;
+        }
+      }
+      bob::math::gemm_(Fn_x, m_UtSigmaInv, UtSigmaInvFn_x, false, true);
+
+      for (int t=0; t<n; ++t) {
+        const bob::machine::GMMStats& stats = *m_stats[first+t];
+        // (Id + sum_{c=1..C} N_{i,h}.U_{c}^T.Sigma_{c}^-1.U_{c})^-1
+        IdPlusUSProd = 0.;
+        for (int c=0; c<C; ++c) {
+          const double n_c = stats.n(c);
+          for (int i=0; i<ru; ++i)
+            for (int j=0; j<ru; ++j)
+              IdPlusUSProd(i,j) += n_c * m_USProd(c,i,j);
+        }
+        for (int i=0; i<ru; ++i) IdPlusUSProd(i,i) += 1.;
+        bob::math::inv_(IdPlusUSProd, IdPlusUSProdInv);
+        // x = IdPlusUSProdInv * UtSigmaInv * Fn_x
+        for (int i=0; i<ru; ++i) {
+          double sum = 0.;
+          for (int j=0; j<ru; ++j)
+            sum += IdPlusUSProdInv(i,j) * UtSigmaInvFn_x(t,j);
+          x(t,i) = sum;
+        }
+      }
+
+      blitz::Array<double,2> Ux(m_Ux + first*CD, blitz::shape(n, CD),
+        blitz::neverDeleteData);
+      bob::math::gemm_(x, m_U, Ux, false, true);
+    }
+  };
+
+}
+
+void bob::machine::FABase::estimateUx(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& gmm_stats,
+  blitz::Array<double,2>& Ux, const size_t n_threads) const
+{
+  if (!m_ubm) throw std::runtime_error("No UBM was set in the JFA machine.");
+  const size_t n_sessions = gmm_stats.size();
+  const int dim_c = getDimC();
+  const int dim_d = getDimD();
+  const int dim_cd = getDimCD();
+  const int ru = getDimRu();
+  bob::core::array::assertCZeroBaseContiguous(Ux);
+  bob::core::array::assertSameDimensionLength(Ux.extent(0), n_sessions);
+  bob::core::array::assertSameDimensionLength(Ux.extent(1), dim_cd);
+  for (size_t t=0; t<n_sessions; ++t) {
+    bob::core::array::assertSameDimensionLength(gmm_stats[t]->sumPx.extent(0), dim_c);
+    bob::core::array::assertSameDimensionLength(gmm_stats[t]->sumPx.extent(1), dim_d);
+  }
+  if (n_sessions == 0) return;
+
+  // U_{c}^T.Sigma_{c}^-1.U_{c} for each Gaussian component
+  blitz::Array<double,3> USProd(dim_c, ru, ru);
+  bob::core::thread_loop(FAUSProdRange(m_U, m_cache_sigma, dim_d, USProd),
+    dim_c, n_threads);
+
+  const size_t n_blocks = (n_sessions + FA_ESTIMATE_BLOCK_SIZE - 1) / FA_ESTIMATE_BLOCK_SIZE;
+  const size_t n = bob::core::thread_count(n_blocks, n_threads);
+  std::vector<std::vector<double> > fn_buffers(n,
+    std::vector<double>(FA_ESTIMATE_BLOCK_SIZE * dim_cd));
+  std::vector<std::vector<double> > ru_buffers(n,
+    std::vector<double>(2 * FA_ESTIMATE_BLOCK_SIZE * ru));
+  std::vector<std::vector<double> > ruru_buffers(n,
+    std::vector<double>(2 * ru * ru));
+  bob::core::thread_blocks(FAEstimateUxBlock(m_U, m_cache_UtSigmaInv,
+    m_cache_mean, USProd, gmm_stats, fn_buffers, ru_buffers, ruru_buffers,
+    Ux.data()), n_blocks, n);
+}
+
 
 
 //////////////////// JFABase ////////////////////
@@ -790,3 +956,76 @@ void bob::machine::ISVMachine::forward_(const bob::machine::GMMStats& input,
             input, m_tmp_Ux, true);
 }
 
+
+/**
+ * Scores client models, which share the same FABase, against probes
+ */
+static void faScoring(const bob::machine::FABase& base,
+  const std::vector<blitz::Array<double,1> >& model_means,
+  const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads)
+{
+  const size_t n_probes = probes.size();
+  bob::core::array::assertZeroBase(scores);
+  bob::core::array::assertSameDimensionLength(scores.extent(0), model_means.size());
+  bob::core::array::assertSameDimensionLength(scores.extent(1), n_probes);
+  if (model_means.size() == 0 || n_probes == 0) return;
+
+  // The model-side of the linear scoring is computed once
+  bob::machine::LinearScorer scorer(model_means, base.getUbmMean(),
+    base.getUbmVariance());
+
+  // Ux is estimated once per probe, by batches of probes
+  blitz::Array<double,2> Ux;
+  for (size_t first=0; first<n_probes; first+=FA_SCORING_BATCH_SIZE) {
+    const size_t last = std::min(n_probes, first + FA_SCORING_BATCH_SIZE);
+    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >
+      batch(probes.begin() + first, probes.begin() + last);
+    Ux.resize(last - first, base.getDimCD());
+    base.estimateUx(batch, Ux, n_threads);
+    std::vector<blitz::Array<double,1> > offsets;
+    for (int t=0; t<Ux.extent(0); ++t)
+      offsets.push_back(Ux(t, blitz::Range::all()));
+    blitz::Array<double,2> batch_scores = scores(blitz::Range::all(),
+      blitz::Range(first, last-1));
+    scorer.score(batch, offsets, true, batch_scores, n_threads);
+  }
+}
+
+void bob::machine::jfaScoring(const std::vector<boost::shared_ptr<const bob::machine::JFAMachine> >& models,
+  const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads)
+{
+  if (models.empty()) {
+    bob::core::array::assertSameDimensionLength(scores.extent(0), 0);
+    return;
+  }
+  const boost::shared_ptr<bob::machine::JFABase> jfa_base = models[0]->getJFABase();
+  if (!jfa_base) throw std::runtime_error("No UBM was set in the JFA machine.");
+  std::vector<blitz::Array<double,1> > model_means;
+  for (size_t m=0; m<models.size(); ++m) {
+    if (models[m]->getJFABase() != jfa_base)
+      throw std::runtime_error("All the JFA machines should share the same JFABase.");
+    model_means.push_back(models[m]->getMeanSupervector());
+  }
+  faScoring(jfa_base->getBase(), model_means, probes, scores, n_threads);
+}
+
+void bob::machine::isvScoring(const std::vector<boost::shared_ptr<const bob::machine::ISVMachine> >& models,
+  const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& probes,
+  blitz::Array<double,2>& scores, const size_t n_threads)
+{
+  if (models.empty()) {
+    bob::core::array::assertSameDimensionLength(scores.extent(0), 0);
+    return;
+  }
+  const boost::shared_ptr<bob::machine::ISVBase> isv_base = models[0]->getISVBase();
+  if (!isv_base) throw std::runtime_error("No UBM was set in the JFA machine.");
+  std::vector<blitz::Array<double,1> > model_means;
+  for (size_t m=0; m<models.size(); ++m) {
+    if (models[m]->getISVBase() != isv_base)
+      throw std::runtime_error("All the ISV machines should share the same ISVBase.");
+    model_means.push_back(models[m]->getMeanSupervector());
+  }
+  faScoring(isv_base->getBase(), model_means, probes, scores, n_threads);
+}
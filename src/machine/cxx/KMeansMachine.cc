@@ -12,7 +12,12 @@
 #include <bob/core/assert.h>
 #include <bob/core/check.h>
 #include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
+#include <algorithm>
 #include <limits>
+#include <vector>
+#include <cmath>
 
 bob::machine::KMeansMachine::KMeansMachine():
   m_n_means(0), m_n_inputs(0), m_means(0,0),
@@ -150,6 +155,264 @@ double bob::machine::KMeansMachine::getMinDistance(const blitz::Array<double,1>&
   return min_distance;
 }
 
+namespace {
+
+  /**
+   * Number of samples processed at once by getClosestMeans()
+   */
+  static const size_t KMEANS_BLOCK_SIZE = 256;
+
+  /**
+   * Square Euclidean distance between two C-contiguous vectors
+   */
+  inline double squareDistance(const double* x, const double* y, const int d)
+  {
+    double acc = 0.;
+    for (int j=0; j<d; ++j) {
+      const double diff = x[j] - y[j];
+      acc += diff * diff;
+    }
+    return acc;
+  }
+
+  /**
+   * Finds the closest means of the samples of one block. If pruning is
+   * enabled, the samples for which the closest mean provably did not change
+   * are skipped (Hamerly's algorithm), and the other ones are gathered
+   * before the matrix product.
+   */
+  struct KMeansClosestBlock {
+    const double* m_X; ///< N x D samples
+    const double* m_means; ///< K x D means
+    const std::vector<double>& m_means_norm; ///< |m|^2 (K)
+    size_t* m_closest; ///< N closest means
+    double* m_distances; ///< N min distances
+    double* m_lower; ///< N lower bounds (may be null)
+    std::vector<std::vector<double> >& m_products; ///< per thread buffers
+    std::vector<std::vector<double> >& m_gathered; ///< per thread buffers
+    const int m_n_samples;
+    const int m_dim_d;
+    const int m_n_means;
+    // Pruning (the vectors are empty if disabled)
+    const std::vector<double>& m_half_separation; ///< 0.5 min_j |m_k-m_j|
+    const size_t m_max_shift_index; ///< mean which moved the most
+    const double m_max_shift; ///< largest shift of the means
+    const double m_second_max_shift; ///< second largest shift of the means
+
+    KMeansClosestBlock(const double* X, const double* means,
+        const std::vector<double>& means_norm, size_t* closest,
+        double* distances, double* lower,
+        std::vector<std::vector<double> >& products,
+        std::vector<std::vector<double> >& gathered, const int n_samples,
+        const int dim_d, const std::vector<double>& half_separation,
+        const size_t max_shift_index, const double max_shift,
+        const double second_max_shift):
+      m_X(X), m_means(means), m_means_norm(means_norm), m_closest(closest),
+      m_distances(distances), m_lower(lower), m_products(products),
+      m_gathered(gathered), m_n_samples(n_samples), m_dim_d(dim_d),
+      m_n_means(means_norm.size()), m_half_separation(half_separation),
+      m_max_shift_index(max_shift_index), m_max_shift(max_shift),
+      m_second_max_shift(second_max_shift)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t b) const
+    {
+      const int begin = b * KMEANS_BLOCK_SIZE;
+      const int end = std::min(m_n_samples, begin + (int)KMEANS_BLOCK_SIZE);
+      const bool pruning = !m_half_separation.empty();
+
+      // Selects the samples which require a full search
+      std::vector<int> rows;
+      rows.reserve(end - begin);
+      for (int i=begin; i<end; ++i) {
+        if (pruning) {
+          const size_t a = m_closest[i];
+          const double d = squareDistance(m_X + i*m_dim_d,
+            m_means + a*m_dim_d, m_dim_d);
+          const double l = m_lower[i] -
+            (a == m_max_shift_index ? m_second_max_shift : m_max_shift);
+          if (std::sqrt(d) <= std::max(m_half_separation[a], l)) {
+            m_distances[i] = d;
+            m_lower[i] = l;
+            continue;
+          }
+        }
+        rows.push_back(i);
+      }
+      const int n = rows.size();
+      if (n == 0) return;
+
+      // Products x.m of the selected samples with all the means
+      const double* x_ = m_X + begin*m_dim_d;
+      if (pruning) {
+        double* g_ = &m_gathered[ith][0];
+        for (int r=0; r<n; ++r)
+          std::copy(m_X + rows[r]*m_dim_d, m_X + (rows[r]+1)*m_dim_d,
+            g_ + r*m_dim_d);
+        x_ = g_;
+      }
+      const blitz::Array<double,2> x(const_cast<double*>(x_),
+        blitz::shape(n, m_dim_d), blitz::neverDeleteData);
+      const blitz::Array<double,2> means(const_cast<double*>(m_means),
+        blitz::shape(m_n_means, m_dim_d), blitz::neverDeleteData);
+      blitz::Array<double,2> products(&m_products[ith][0],
+        blitz::shape(n, m_n_means), blitz::neverDeleteData);
+      bob::math::gemm_(x, means, products, false, true);
+
+      // |x-m|^2 = |x|^2 - 2 x.m + |m|^2
+      const double* p_ = products.data();
+      for (int r=0; r<n; ++r, p_+=m_n_means) {
+        const double* x_r = x_ + r*m_dim_d;
+        double x_norm = 0.;
+        for (int j=0; j<m_dim_d; ++j) x_norm += x_r[j] * x_r[j];
+        double best = std::numeric_limits<double>::infinity();
+        double second = best;
+        size_t best_index = 0;
+        for (int k=0; k<m_n_means; ++k) {
+          const double d = x_norm - 2.*p_[k] + m_means_norm[k];
+          if (d < best) {
+            second = best;
+            best = d;
+            best_index = k;
+          }
+          else if (d < second) second = d;
+        }
+        const int i = rows[r];
+        m_closest[i] = best_index;
+        // The distance to the closest mean is computed directly, to avoid
+        // the cancellation errors of the expansion
+        m_distances[i] = squareDistance(x_r, m_means + best_index*m_dim_d,
+          m_dim_d);
+        if (m_lower) m_lower[i] = std::sqrt(std::max(second, 0.));
+      }
+    }
+  };
+
+  template <typename T>
+  blitz::Array<T,1> contiguousView(blitz::Array<T,1>& a)
+  {
+    if (bob::core::array::isCZeroBaseContiguous(a)) return a;
+    return bob::core::array::ccopy(a);
+  }
+
+}
+
+/**
+ * Common implementation of getClosestMeans() and updateClosestMeans().
+ * previous_means is null if pruning is disabled; lower_bounds is null if
+ * lower bounds are not requested.
+ */
+static void closestMeans(const blitz::Array<double,2>& means_,
+  const blitz::Array<double,2>& X_, const blitz::Array<double,2>* previous_means,
+  blitz::Array<size_t,1>& closest_means_, blitz::Array<double,1>& min_distances_,
+  blitz::Array<double,1>* lower_bounds_, const size_t n_threads)
+{
+  // Check arguments
+  bob::core::array::assertZeroBase(X_);
+  bob::core::array::assertSameDimensionLength(X_.extent(1), means_.extent(1));
+  bob::core::array::assertSameDimensionLength(closest_means_.extent(0), X_.extent(0));
+  bob::core::array::assertSameDimensionLength(min_distances_.extent(0), X_.extent(0));
+  if (lower_bounds_)
+    bob::core::array::assertSameDimensionLength(lower_bounds_->extent(0), X_.extent(0));
+  if (previous_means)
+    bob::core::array::assertSameShape(*previous_means, means_);
+
+  // Worker threads access the arrays through raw pointers
+  const blitz::Array<double,2> X = bob::core::array::isCZeroBaseContiguous(X_) ?
+    X_ : bob::core::array::ccopy(X_);
+  const blitz::Array<double,2> means = bob::core::array::isCZeroBaseContiguous(means_) ?
+    means_ : bob::core::array::ccopy(means_);
+  blitz::Array<size_t,1> closest_means = contiguousView(closest_means_);
+  blitz::Array<double,1> min_distances = contiguousView(min_distances_);
+  blitz::Array<double,1> lower_bounds;
+  if (lower_bounds_) lower_bounds.reference(contiguousView(*lower_bounds_));
+
+  const int n_samples = X.extent(0);
+  const int n_means = means.extent(0);
+  const int dim_d = means.extent(1);
+  const double* m_ = means.data();
+
+  std::vector<double> means_norm(n_means);
+  for (int k=0; k<n_means; ++k) {
+    double acc = 0.;
+    for (int j=0; j<dim_d; ++j) acc += m_[k*dim_d+j] * m_[k*dim_d+j];
+    means_norm[k] = acc;
+  }
+
+  // Hamerly's bounds: shifts of the means and half distances to the closest
+  // other mean
+  std::vector<double> half_separation;
+  size_t max_shift_index = 0;
+  double max_shift = 0., second_max_shift = 0.;
+  if (previous_means) {
+    const blitz::Array<double,2> prev = bob::core::array::ccopy(*previous_means);
+    for (int k=0; k<n_means; ++k) {
+      const double shift = std::sqrt(squareDistance(m_ + k*dim_d,
+        prev.data() + k*dim_d, dim_d));
+      if (shift > max_shift) {
+        second_max_shift = max_shift;
+        max_shift = shift;
+        max_shift_index = k;
+      }
+      else if (shift > second_max_shift) second_max_shift = shift;
+    }
+    half_separation.assign(n_means, std::numeric_limits<double>::infinity());
+    blitz::Array<double,2> products(n_means, n_means);
+    bob::math::gemm_(means, means, products, false, true);
+    for (int k=0; k<n_means; ++k)
+      for (int j=0; j<n_means; ++j) {
+        if (j == k) continue;
+        const double d = means_norm[k] + means_norm[j] - 2.*products(k,j);
+        half_separation[k] = std::min(half_separation[k],
+          0.5 * std::sqrt(std::max(d, 0.)));
+      }
+  }
+
+  // Per-thread buffers
+  const size_t n_blocks = (n_samples + KMEANS_BLOCK_SIZE - 1) / KMEANS_BLOCK_SIZE;
+  const size_t n_used = bob::core::thread_count(n_blocks, n_threads);
+  std::vector<std::vector<double> > products(n_used,
+    std::vector<double>(KMEANS_BLOCK_SIZE * std::max(n_means, 1)));
+  std::vector<std::vector<double> > gathered(previous_means ? n_used : 0,
+    std::vector<double>(KMEANS_BLOCK_SIZE * std::max(dim_d, 1)));
+
+  bob::core::thread_blocks(KMeansClosestBlock(X.data(), m_, means_norm,
+    closest_means.data(), min_distances.data(),
+    lower_bounds_ ? lower_bounds.data() : 0, products, gathered, n_samples,
+    dim_d, half_separation, max_shift_index, max_shift, second_max_shift),
+    n_blocks, n_threads);
+
+  if (closest_means.data() != closest_means_.data()) closest_means_ = closest_means;
+  if (min_distances.data() != min_distances_.data()) min_distances_ = min_distances;
+  if (lower_bounds_ && lower_bounds.data() != lower_bounds_->data())
+    *lower_bounds_ = lower_bounds;
+}
+
+void bob::machine::KMeansMachine::getClosestMeans(const blitz::Array<double,2>& X,
+  blitz::Array<size_t,1>& closest_means, blitz::Array<double,1>& min_distances,
+  const size_t n_threads) const
+{
+  closestMeans(m_means, X, 0, closest_means, min_distances, 0, n_threads);
+}
+
+void bob::machine::KMeansMachine::getClosestMeans(const blitz::Array<double,2>& X,
+  blitz::Array<size_t,1>& closest_means, blitz::Array<double,1>& min_distances,
+  blitz::Array<double,1>& lower_bounds, const size_t n_threads) const
+{
+  closestMeans(m_means, X, 0, closest_means, min_distances, &lower_bounds,
+    n_threads);
+}
+
+void bob::machine::KMeansMachine::updateClosestMeans(const blitz::Array<double,2>& X,
+  const blitz::Array<double,2>& previous_means,
+  blitz::Array<size_t,1>& closest_means, blitz::Array<double,1>& min_distances,
+  blitz::Array<double,1>& lower_bounds, const size_t n_threads) const
+{
+  closestMeans(m_means, X, &previous_means, closest_means, min_distances,
+    &lower_bounds, n_threads);
+}
+
 void bob::machine::KMeansMachine::getVariancesAndWeightsForEachClusterInit(blitz::Array<double,2>& variances, blitz::Array<double,1>& weights) const
 {
   // check arguments
@@ -13,8 +13,17 @@
 #include <boost/format.hpp>
 
 #include <bob/core/array_copy.h>
+#include <bob/core/check.h>
 #include <bob/machine/LinearMachine.h>
 #include <bob/math/linear.h>
+#include <bob/math/gemm.h>
+#include <algorithm>
+
+/**
+ * Number of vectors which are projected at once, when the output should be
+ * converted
+ */
+static const int LINEAR_BLOCK_SIZE = 1024;
 
 bob::machine::LinearMachine::LinearMachine(const blitz::Array<double,2>& weight)
   : m_input_sub(weight.extent(0)),
@@ -27,6 +36,7 @@ bob::machine::LinearMachine::LinearMachine(const blitz::Array<double,2>& weight)
   m_input_div = 1.0;
   m_bias = 0.0;
   m_weight.reference(bob::core::array::ccopy(weight));
+  updateCache();
 }
 
 bob::machine::LinearMachine::LinearMachine():
@@ -37,6 +47,7 @@ bob::machine::LinearMachine::LinearMachine():
   m_activation(boost::make_shared<bob::machine::IdentityActivation>()),
   m_buffer(0)
 {
+  updateCache();
 }
 
 bob::machine::LinearMachine::LinearMachine(size_t n_input, size_t n_output):
@@ -51,6 +62,7 @@ bob::machine::LinearMachine::LinearMachine(size_t n_input, size_t n_output):
   m_input_div = 1.0;
   m_weight = 0.0;
   m_bias = 0.0;
+  updateCache();
 }
 
 bob::machine::LinearMachine::LinearMachine(const bob::machine::LinearMachine& other):
@@ -61,6 +73,7 @@ bob::machine::LinearMachine::LinearMachine(const bob::machine::LinearMachine& ot
   m_activation(other.m_activation),
   m_buffer(m_input_sub.shape())
 {
+  updateCache();
 }
 
 bob::machine::LinearMachine::LinearMachine (bob::io::HDF5File& config) {
@@ -79,6 +92,7 @@ bob::machine::LinearMachine& bob::machine::LinearMachine::operator=
     m_bias.reference(bob::core::array::ccopy(other.m_bias));
     m_activation = other.m_activation;
     m_buffer.resize(m_input_sub.shape());
+    updateCache();
   }
   return *this;
 }
@@ -128,6 +142,8 @@ void bob::machine::LinearMachine::load (bob::io::HDF5File& config) {
     uint32_t act = config.read<uint32_t>("activation");
     m_activation = bob::machine::make_deprecated_activation(act);
   }
+
+  updateCache();
 }
 
 void bob::machine::LinearMachine::resize (size_t input, size_t output) {
@@ -136,6 +152,7 @@ void bob::machine::LinearMachine::resize (size_t input, size_t output) {
   m_buffer.resizeAndPreserve(input);
   m_weight.resizeAndPreserve(input, output);
   m_bias.resizeAndPreserve(output);
+  updateCache();
 }
 
 void bob::machine::LinearMachine::save (bob::io::HDF5File& config) const {
@@ -173,6 +190,97 @@ void bob::machine::LinearMachine::forward
   forward_(input, output);
 }
 
+void bob::machine::LinearMachine::foldWeights
+(blitz::Array<double,2>& weight, blitz::Array<double,1>& bias) const {
+  // (x - sub) / div . W + b = x . (W / div) + (b - (sub / div) . W)
+  weight.resize(m_weight.shape());
+  bias.resize(m_bias.shape());
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  weight = m_weight(i,j) / m_input_div(i);
+  bias = m_bias;
+  for (int k=0; k<m_weight.extent(0); ++k)
+    for (int l=0; l<m_weight.extent(1); ++l)
+      bias(l) -= m_input_sub(k) * weight(k,l);
+}
+
+void bob::machine::LinearMachine::updateCache() {
+  foldWeights(m_cache_weight, m_cache_bias);
+  m_cache_valid = true;
+}
+
+void bob::machine::LinearMachine::forward_
+(const blitz::Array<double,2>& input, blitz::Array<double,2>& output) const {
+  // Folded weights and biases, which are recomputed if the parameters were
+  // updated in place
+  blitz::Array<double,2> weight;
+  blitz::Array<double,1> bias;
+  if (m_cache_valid) {
+    weight.reference(m_cache_weight);
+    bias.reference(m_cache_bias);
+  }
+  else foldWeights(weight, bias);
+
+  // Writes directly into the output if possible
+  blitz::Array<double,2> out;
+  const bool direct_use = bob::core::array::isCZeroBaseContiguous(output);
+  if (direct_use) out.reference(output);
+  else out.resize(output.extent(0), output.extent(1));
+
+  for (int k=0; k<out.extent(0); ++k) out(k, blitz::Range::all()) = bias;
+  bob::math::gemm_(input, weight, out, false, false, 1., 1.);
+  m_activation->f(out, out);
+
+  if (!direct_use) output = out;
+}
+
+/**
+ * Checks the shapes of a set of input and output vectors
+ */
+template <typename T>
+static void check_forward_shapes(const blitz::Array<double,2>& weight,
+  const blitz::Array<double,2>& input, const blitz::Array<T,2>& output) {
+  if (weight.extent(0) != input.extent(1)) { //checks input dimension
+    boost::format m("mismatch on the input dimension: expected vectors of size %d, but you input ones with size = %d instead");
+    m % weight.extent(0) % input.extent(1);
+    throw std::runtime_error(m.str());
+  }
+  if (weight.extent(1) != output.extent(1)) { //checks output dimension
+    boost::format m("mismatch on the output dimension: expected vectors of size %d, but you input ones with size = %d instead");
+    m % weight.extent(1) % output.extent(1);
+    throw std::runtime_error(m.str());
+  }
+  if (input.extent(0) != output.extent(0)) { //checks the number of vectors
+    boost::format m("mismatch on the number of vectors: %d input vector(s), but %d output vector(s)");
+    m % input.extent(0) % output.extent(0);
+    throw std::runtime_error(m.str());
+  }
+}
+
+void bob::machine::LinearMachine::forward
+(const blitz::Array<double,2>& input, blitz::Array<double,2>& output) const {
+  check_forward_shapes(m_weight, input, output);
+  forward_(input, output);
+}
+
+void bob::machine::LinearMachine::forward
+(const blitz::Array<double,2>& input, blitz::Array<float,2>& output) const {
+  check_forward_shapes(m_weight, input, output);
+  const int n_vectors = input.extent(0);
+  const int lb = input.lbound(0);
+  const int lbo = output.lbound(0);
+  blitz::Array<double,2> buffer;
+  for (int first=0; first<n_vectors; first+=LINEAR_BLOCK_SIZE) {
+    const int n = std::min(LINEAR_BLOCK_SIZE, n_vectors - first);
+    if (buffer.extent(0) != n) buffer.resize(n, m_weight.extent(1));
+    const blitz::Array<double,2> input_block =
+      input(blitz::Range(lb+first, lb+first+n-1), blitz::Range::all());
+    forward_(input_block, buffer);
+    output(blitz::Range(lbo+first, lbo+first+n-1), blitz::Range::all()) =
+      blitz::cast<float>(buffer);
+  }
+}
+
 void bob::machine::LinearMachine::setWeights
 (const blitz::Array<double,2>& weight) {
   if (weight.extent(0) != m_input_sub.extent(0)) { //checks 1st dimension
@@ -186,6 +294,7 @@ void bob::machine::LinearMachine::setWeights
     throw std::runtime_error(m.str());
   }
   m_weight.reference(bob::core::array::ccopy(weight));
+  updateCache();
 }
 
 void bob::machine::LinearMachine::setBiases
@@ -196,6 +305,7 @@ void bob::machine::LinearMachine::setBiases
     throw std::runtime_error(m.str());
   }
   m_bias.reference(bob::core::array::ccopy(bias));
+  updateCache();
 }
 
 void bob::machine::LinearMachine::setInputSubtraction
@@ -206,6 +316,7 @@ void bob::machine::LinearMachine::setInputSubtraction
     throw std::runtime_error(m.str());
   }
   m_input_sub.reference(bob::core::array::ccopy(v));
+  updateCache();
 }
 
 void bob::machine::LinearMachine::setInputDivision
@@ -216,6 +327,7 @@ void bob::machine::LinearMachine::setInputDivision
     throw std::runtime_error(m.str());
   }
   m_input_div.reference(bob::core::array::ccopy(v));
+  updateCache();
 }
 
 void bob::machine::LinearMachine::setActivation (boost::shared_ptr<bob::machine::Activation> a) {
@@ -6,71 +6,218 @@
  * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
  */
 #include <bob/machine/LinearScoring.h>
-#include <bob/math/linear.h>
+#include <bob/core/assert.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
+#include <algorithm>
+#include <limits>
 
 namespace bob { namespace machine {
 
-namespace detail {
-
-  void linearScoring(const std::vector<blitz::Array<double,1> >& models,
-                     const blitz::Array<double,1>& ubm_mean,
-                     const blitz::Array<double,1>& ubm_variance,
-                     const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
-                     const std::vector<blitz::Array<double,1> >* test_channelOffset,
-                     const bool frame_length_normalisation,
-                     blitz::Array<double,2>& scores) 
-  {
-    int C = test_stats[0]->sumPx.extent(0);
-    int D = test_stats[0]->sumPx.extent(1);
-    int CD = C*D;
-    int Tt = test_stats.size();
-    int Tm = models.size();
-
-    // Check output size
-    bob::core::array::assertSameDimensionLength(scores.extent(0), models.size());
-    bob::core::array::assertSameDimensionLength(scores.extent(1), test_stats.size());
-
-    blitz::Array<double,2> A(Tm, CD);
-    blitz::Array<double,2> B(CD, Tt);
-
-    // 1) Compute A
-    for(int t=0; t<Tm; ++t) {
-      blitz::Array<double, 1> tmp = A(t, blitz::Range::all());
-      tmp = (models[t] - ubm_mean) / ubm_variance;
-    }
+namespace {
 
-    // 2) Compute B
-    if(test_channelOffset == 0) {
-      for(int t=0; t<Tt; ++t) 
-        for(int s=0; s<CD; ++s)
-          B(s, t) = test_stats[t]->sumPx(s/D, s%D) - (ubm_mean(s) * test_stats[t]->n(s/D));
-    }
-    else {
-      bob::core::array::assertSameDimensionLength((*test_channelOffset).size(), Tt);
-      
-      for(int t=0; t<Tt; ++t) {
-        bob::core::array::assertSameDimensionLength((*test_channelOffset)[t].extent(0), CD);
-        for(int s=0; s<CD; ++s) 
-          B(s, t) = test_stats[t]->sumPx(s/D, s%D) - (test_stats[t]->n(s/D) * (ubm_mean(s) + (*test_channelOffset)[t](s)));
+  /// Number of models and of test statistics in a tile of the score matrix
+  static const size_t LINEAR_SCORING_TILE_SIZE = 128;
+  /// Length of the blocks of the supervectors which are processed at once
+  static const size_t LINEAR_SCORING_BLOCK_SIZE = 2048;
+
+  /**
+   * Computes a (models x test statistics) tile of the score matrix.
+   * For each block of the supervector, the centered (and offset)
+   * statistics of the tile are gathered in a per-thread buffer, and
+   * multiplied with the corresponding block of A.
+   */
+  struct LinearScoringTile {
+    const std::vector<blitz::Array<double,2> >& m_A;
+    const blitz::Array<double,1>& m_ubm_mean;
+    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& m_stats;
+    const std::vector<blitz::Array<double,1> >* m_offsets;
+    const bool m_normalise;
+    const size_t m_n_models;
+    const size_t m_n_tests;
+    const size_t m_n_inputs;
+    std::vector<std::vector<double> >& m_b_buffers;
+    std::vector<std::vector<double> >& m_s_buffers;
+    blitz::Array<double,2>& m_scores;
+
+    LinearScoringTile(const std::vector<blitz::Array<double,2> >& A,
+        const blitz::Array<double,1>& ubm_mean,
+        const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats,
+        const std::vector<blitz::Array<double,1> >* offsets,
+        const bool normalise, const size_t n_inputs,
+        std::vector<std::vector<double> >& b_buffers,
+        std::vector<std::vector<double> >& s_buffers,
+        blitz::Array<double,2>& scores):
+      m_A(A), m_ubm_mean(ubm_mean), m_stats(stats), m_offsets(offsets),
+      m_normalise(normalise), m_n_models(scores.extent(0)),
+      m_n_tests(scores.extent(1)), m_n_inputs(n_inputs),
+      m_b_buffers(b_buffers), m_s_buffers(s_buffers), m_scores(scores)
+    {}
+
+    void operator()(const size_t ith, const size_t tile) const {
+      const size_t n_test_tiles = (m_n_tests + LINEAR_SCORING_TILE_SIZE - 1) / LINEAR_SCORING_TILE_SIZE;
+      const size_t m0 = (tile / n_test_tiles) * LINEAR_SCORING_TILE_SIZE;
+      const size_t t0 = (tile % n_test_tiles) * LINEAR_SCORING_TILE_SIZE;
+      const int n_m = (int)(std::min(m_n_models, m0 + LINEAR_SCORING_TILE_SIZE) - m0);
+      const int n_t = (int)(std::min(m_n_tests, t0 + LINEAR_SCORING_TILE_SIZE) - t0);
+
+      blitz::Array<double,2> S(&m_s_buffers[ith][0], blitz::shape(n_m, n_t),
+        blitz::neverDeleteData);
+      if (m_A.empty()) S = 0.;
+
+      size_t k0 = 0;
+      for (size_t b=0; b<m_A.size(); ++b) {
+        const int K = m_A[b].extent(1);
+        blitz::Array<double,2> B(&m_b_buffers[ith][0], blitz::shape(n_t, K),
+          blitz::neverDeleteData);
+        for (int t=0; t<n_t; ++t) {
+          const bob::machine::GMMStats& stats = *m_stats[t0+t];
+          const blitz::Array<double,1>* offset = m_offsets ? &(*m_offsets)[t0+t] : 0;
+          int c = k0 / m_n_inputs;
+          int d = k0 % m_n_inputs;
+          double n_c = stats.n(c);
+          for (int k=0; k<K; ++k) {
+            const int s = k0 + k;
+            double mean = m_ubm_mean(s);
+            if (offset) mean += (*offset)(s);
+            B(t,k) = stats.sumPx(c,d) - n_c * mean;
+            if (++d == (int)m_n_inputs) {
+              d = 0;
+              if (k+1 < K) n_c = stats.n(++c);
+            }
+          }
+        }
+        const blitz::Array<double,2> A(const_cast<double*>(m_A[b].data()) + m0*K,
+          blitz::shape(n_m, K), blitz::neverDeleteData);
+        bob::math::gemm_(A, B, S, false, true, 1., (b == 0 ? 0. : 1.));
+        k0 += K;
+      }
+
+      for (int t=0; t<n_t; ++t) {
+        double factor = 1.;
+        if (m_normalise) {
+          const double sum_N = m_stats[t0+t]->T;
+          if (sum_N <= std::numeric_limits<double>::epsilon() && sum_N >= -std::numeric_limits<double>::epsilon())
+            factor = 0.;
+          else
+            factor = 1. / sum_N;
+        }
+        for (int m=0; m<n_m; ++m)
+          m_scores(m0+m, t0+t) = factor * S(m,t);
       }
     }
+  };
 
-    // Apply the normalisation if needed
-    if(frame_length_normalisation) {
-      for(int t=0; t<Tt; ++t) {
-        double sum_N = test_stats[t]->T;
-        blitz::Array<double, 1> v_t = B(blitz::Range::all(),t);
+}
 
-        if (sum_N <= std::numeric_limits<double>::epsilon() && sum_N >= -std::numeric_limits<double>::epsilon())
-          v_t = 0;
-        else 
-          v_t /= sum_N;
-      }
+LinearScorer::LinearScorer(const std::vector<blitz::Array<double,1> >& models,
+    const blitz::Array<double,1>& ubm_mean,
+    const blitz::Array<double,1>& ubm_variance)
+{
+  resize(models.size(), ubm_mean, ubm_variance);
+  for (size_t m=0; m<models.size(); ++m)
+    setModel(m, models[m], ubm_variance);
+}
+
+LinearScorer::LinearScorer(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
+    const bob::machine::GMMMachine& ubm)
+{
+  const blitz::Array<double,1>& ubm_variance = ubm.getVarianceSupervector();
+  resize(models.size(), ubm.getMeanSupervector(), ubm_variance);
+  // Only one mean supervector of the models is copied at once
+  blitz::Array<double,1> model(m_ubm_mean.extent(0));
+  for (size_t m=0; m<models.size(); ++m) {
+    models[m]->getMeanSupervector(model);
+    setModel(m, model, ubm_variance);
+  }
+}
+
+void LinearScorer::resize(const size_t n_models,
+  const blitz::Array<double,1>& ubm_mean,
+  const blitz::Array<double,1>& ubm_variance)
+{
+  bob::core::array::assertSameShape(ubm_mean, ubm_variance);
+  m_n_models = n_models;
+  m_ubm_mean.resize(ubm_mean.extent(0));
+  m_ubm_mean = ubm_mean;
+  const size_t CD = ubm_mean.extent(0);
+  m_A.clear();
+  for (size_t k0=0; k0<CD; k0+=LINEAR_SCORING_BLOCK_SIZE)
+    m_A.push_back(blitz::Array<double,2>(n_models,
+      std::min(LINEAR_SCORING_BLOCK_SIZE, CD-k0)));
+}
+
+void LinearScorer::setModel(const size_t m, const blitz::Array<double,1>& model,
+  const blitz::Array<double,1>& ubm_variance)
+{
+  bob::core::array::assertSameShape(model, m_ubm_mean);
+  const int base_m = model.lbound(0);
+  const int base_v = ubm_variance.lbound(0);
+  int k0 = 0;
+  for (size_t b=0; b<m_A.size(); ++b) {
+    for (int k=0; k<m_A[b].extent(1); ++k, ++k0)
+      m_A[b]((int)m, k) = (model(base_m+k0) - m_ubm_mean(k0)) / ubm_variance(base_v+k0);
+  }
+}
+
+void LinearScorer::score(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+  const bool frame_length_normalisation, blitz::Array<double,2>& scores,
+  const size_t n_threads) const
+{
+  score_(test_stats, 0, frame_length_normalisation, scores, n_threads);
+}
+
+void LinearScorer::score(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+  const std::vector<blitz::Array<double,1> >& test_channelOffset,
+  const bool frame_length_normalisation, blitz::Array<double,2>& scores,
+  const size_t n_threads) const
+{
+  score_(test_stats, &test_channelOffset, frame_length_normalisation, scores, n_threads);
+}
+
+void LinearScorer::score_(const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
+  const std::vector<blitz::Array<double,1> >* test_channelOffset,
+  const bool frame_length_normalisation, blitz::Array<double,2>& scores,
+  const size_t n_threads) const
+{
+  const size_t CD = m_ubm_mean.extent(0);
+  const size_t Tt = test_stats.size();
+
+  // Check output size
+  bob::core::array::assertZeroBase(scores);
+  bob::core::array::assertSameDimensionLength(scores.extent(0), m_n_models);
+  bob::core::array::assertSameDimensionLength(scores.extent(1), Tt);
+  if (m_n_models == 0 || Tt == 0) return;
+
+  // Check the statistics and the channel offsets
+  const int D = test_stats[0]->sumPx.extent(1);
+  for (size_t t=0; t<Tt; ++t) {
+    bob::core::array::assertZeroBase(test_stats[t]->sumPx);
+    bob::core::array::assertZeroBase(test_stats[t]->n);
+    bob::core::array::assertSameDimensionLength(test_stats[t]->sumPx.extent(1), D);
+    bob::core::array::assertSameDimensionLength(test_stats[t]->sumPx.extent(0) * D, CD);
+  }
+  if (test_channelOffset) {
+    bob::core::array::assertSameDimensionLength(test_channelOffset->size(), Tt);
+    for (size_t t=0; t<Tt; ++t) {
+      bob::core::array::assertZeroBase((*test_channelOffset)[t]);
+      bob::core::array::assertSameDimensionLength((*test_channelOffset)[t].extent(0), CD);
     }
+  }
+
+  // Per-thread buffers for the statistics of a block and the scores of a tile
+  const size_t n_tiles =
+    ((m_n_models + LINEAR_SCORING_TILE_SIZE - 1) / LINEAR_SCORING_TILE_SIZE) *
+    ((Tt + LINEAR_SCORING_TILE_SIZE - 1) / LINEAR_SCORING_TILE_SIZE);
+  const size_t n = bob::core::thread_count(n_tiles, n_threads);
+  std::vector<std::vector<double> > b_buffers(n,
+    std::vector<double>(LINEAR_SCORING_TILE_SIZE * std::min(LINEAR_SCORING_BLOCK_SIZE, CD)));
+  std::vector<std::vector<double> > s_buffers(n,
+    std::vector<double>(LINEAR_SCORING_TILE_SIZE * LINEAR_SCORING_TILE_SIZE));
 
-    // 3) Compute LLR
-    bob::math::prod(A, B, scores);
-  } 
+  bob::core::thread_blocks(LinearScoringTile(m_A, m_ubm_mean, test_stats,
+    test_channelOffset, frame_length_normalisation, D, b_buffers, s_buffers,
+    scores), n_tiles, n);
 }
 
 
@@ -79,39 +226,27 @@ void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double,1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores)
+                   blitz::Array<double, 2>& scores, const size_t n_threads)
 {
-  detail::linearScoring(models, ubm_mean, ubm_variance, test_stats, &test_channelOffset, frame_length_normalisation, scores);
+  LinearScorer(models, ubm_mean, ubm_variance).score(test_stats, test_channelOffset, frame_length_normalisation, scores, n_threads);
 }
 
 void linearScoring(const std::vector<blitz::Array<double,1> >& models,
                    const blitz::Array<double,1>& ubm_mean, const blitz::Array<double,1>& ubm_variance,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores)
+                   blitz::Array<double, 2>& scores, const size_t n_threads)
 {
-  detail::linearScoring(models, ubm_mean, ubm_variance, test_stats, 0, frame_length_normalisation, scores);
+  LinearScorer(models, ubm_mean, ubm_variance).score(test_stats, frame_length_normalisation, scores, n_threads);
 }
 
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
                    const bob::machine::GMMMachine& ubm,
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores) 
+                   blitz::Array<double, 2>& scores, const size_t n_threads)
 {
-  int C = test_stats[0]->sumPx.extent(0);
-  int D = test_stats[0]->sumPx.extent(1);
-  int CD = C*D;
-  std::vector<blitz::Array<double,1> > models_b;
-  // Allocate and get the mean supervector
-  for(size_t i=0; i<models.size(); ++i) {
-    blitz::Array<double,1> mod(CD);
-    models[i]->getMeanSupervector(mod);
-    models_b.push_back(mod);
-  }
-  const blitz::Array<double,1>& ubm_mean = ubm.getMeanSupervector();
-  const blitz::Array<double,1>& ubm_variance = ubm.getVarianceSupervector();
-  detail::linearScoring(models_b, ubm_mean, ubm_variance, test_stats, 0, frame_length_normalisation, scores);
+  LinearScorer(models, ubm).score(test_stats, frame_length_normalisation, scores, n_threads);
 }
 
 void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMachine> >& models,
@@ -119,21 +254,9 @@ void linearScoring(const std::vector<boost::shared_ptr<const bob::machine::GMMMa
                    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& test_stats,
                    const std::vector<blitz::Array<double,1> >& test_channelOffset,
                    const bool frame_length_normalisation,
-                   blitz::Array<double, 2>& scores) 
+                   blitz::Array<double, 2>& scores, const size_t n_threads)
 {
-  int C = test_stats[0]->sumPx.extent(0);
-  int D = test_stats[0]->sumPx.extent(1);
-  int CD = C*D;
-  std::vector<blitz::Array<double,1> > models_b;
-  // Allocate and get the mean supervector
-  for(size_t i=0; i<models.size(); ++i) {
-    blitz::Array<double,1> mod(CD);
-    models[i]->getMeanSupervector(mod);
-    models_b.push_back(mod);
-  }
-  const blitz::Array<double,1>& ubm_mean = ubm.getMeanSupervector();
-  const blitz::Array<double,1>& ubm_variance = ubm.getVarianceSupervector();
-  detail::linearScoring(models_b, ubm_mean, ubm_variance, test_stats, &test_channelOffset, frame_length_normalisation, scores);
+  LinearScorer(models, ubm).score(test_stats, test_channelOffset, frame_length_normalisation, scores, n_threads);
 }
 
 
@@ -18,6 +18,7 @@
 #include <bob/core/assert.h>
 #include <bob/machine/MLP.h>
 #include <bob/math/linear.h>
+#include <bob/math/gemm.h>
 
 bob::machine::MLP::MLP (size_t input, size_t output):
   m_input_sub(input),
@@ -249,14 +250,49 @@ void bob::machine::MLP::forward (const blitz::Array<double,1>& input,
   forward_(input, output); 
 }
 
+/**
+ * Computes output = activation(input.weight + bias) for a batch of inputs. The
+ * biases are copied in the output first, and accumulated by the matrix
+ * product. The output array should be C-contiguous.
+ */
+static void forward_layer(const blitz::Array<double,2>& input,
+    const blitz::Array<double,2>& weight, const blitz::Array<double,1>& bias,
+    const bob::machine::Activation& activation, blitz::Array<double,2>& output) {
+  const int n_outputs = output.extent(1);
+  double* out = output.data();
+  for (int i=0; i<output.extent(0); ++i, out+=n_outputs)
+    for (int j=0; j<n_outputs; ++j) out[j] = bias(j);
+  bob::math::gemm_(input, weight, output, false, false, 1., 1.);
+  activation.f(output, output);
+}
+
 void bob::machine::MLP::forward_ (const blitz::Array<double,2>& input,
     blitz::Array<double,2>& output) {
 
-  blitz::Range all = blitz::Range::all();
-  for (int i=0; i<input.extent(0); ++i) {
-    blitz::Array<double,1> inref(input(i,all));
-    blitz::Array<double,1> outref(output(i,all));
-    forward_(inref, outref);
+  //normalizes all the inputs at once
+  const int n_samples = input.extent(0);
+  blitz::Array<double,2> buffer(n_samples, input.extent(1));
+  blitz::secondIndex j;
+  buffer = (input - m_input_sub(j)) / m_input_div(j);
+
+  //input -> hidden[0]; hidden[0] -> hidden[1], ..., hidden[N-2] -> hidden[N-1]
+  for (size_t k=1; k<m_weight.size(); ++k) {
+    blitz::Array<double,2> hidden(n_samples, m_weight[k-1].extent(1));
+    forward_layer(buffer, m_weight[k-1], m_bias[k-1], *m_hidden_activation,
+        hidden);
+    buffer.reference(hidden);
+  }
+
+  //hidden[N-1] -> output
+  if (bob::core::array::isCZeroBaseContiguous(output)) {
+    forward_layer(buffer, m_weight.back(), m_bias.back(), *m_output_activation,
+        output);
+  }
+  else {
+    blitz::Array<double,2> output_c(output.shape());
+    forward_layer(buffer, m_weight.back(), m_bias.back(), *m_output_activation,
+        output_c);
+    output = output_c;
   }
 }
 
@@ -11,8 +11,10 @@
 #include <bob/core/assert.h>
 #include <bob/core/check.h>
 #include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
 #include <bob/machine/PLDAMachine.h>
 #include <bob/math/linear.h>
+#include <bob/math/gemm.h>
 #include <bob/math/det.h>
 #include <bob/math/inv.h>
 
@@ -61,6 +63,10 @@ bob::machine::PLDABase::PLDABase(bob::io::HDF5File& config) {
   load(config);
 }
 
+bob::machine::PLDABase::PLDABase(const boost::shared_ptr<const bob::machine::FlatFile> config) {
+  load(config);
+}
+
 bob::machine::PLDABase::~PLDABase() {
 }
 
@@ -291,6 +297,97 @@ void bob::machine::PLDABase::save(bob::io::HDF5File& config) const
   config.set("logdet_sigma", m_cache_logdet_sigma);
 }
 
+void bob::machine::PLDABase::load(const boost::shared_ptr<const bob::machine::FlatFile> config) 
+{
+  config->checkType("PLDABase");
+  //uses views on the mapped data
+  m_F.reference(config->getArray<2>("F"));
+  m_G.reference(config->getArray<2>("G"));
+  m_dim_d = m_F.extent(0);
+  m_dim_f = m_F.extent(1);
+  m_dim_g = m_G.extent(1);
+  m_sigma.reference(config->getArray<1>("sigma"));
+  m_mu.reference(config->getArray<1>("mu"));
+  m_variance_threshold = config->get("variance_threshold");
+  m_cache_isigma.resize(m_dim_d);
+  precomputeISigma();
+  m_cache_alpha.reference(config->getArray<2>("alpha"));
+  m_cache_beta.reference(config->getArray<2>("beta"));
+  // gamma's and log likelihood constant terms (a-dependent terms)
+  // the values of a are stored as doubles
+  m_cache_gamma.clear();
+  if (config->contains("a_indices_gamma"))
+  {
+    const blitz::Array<double,1> a_indices = config->getArray<1>("a_indices_gamma");
+    for (int i=0; i<a_indices.extent(0); ++i)
+    {
+      const size_t a = (size_t)a_indices(i);
+      std::string str = "gamma_" + boost::lexical_cast<std::string>(a);
+      m_cache_gamma[a].reference(config->getArray<2>(str));
+    }
+  }
+  m_cache_loglike_constterm.clear();
+  if (config->contains("a_indices_loglikeconstterm"))
+  {
+    const blitz::Array<double,1> a_indices = config->getArray<1>("a_indices_loglikeconstterm");
+    const blitz::Array<double,1> values = config->getArray<1>("loglikeconstterm");
+    for (int i=0; i<a_indices.extent(0); ++i)
+      m_cache_loglike_constterm[(size_t)a_indices(i)] = values(i);
+  }
+  m_cache_Ft_beta.reference(config->getArray<2>("Ft_beta"));
+  m_cache_Gt_isigma.reference(config->getArray<2>("Gt_isigma"));
+  m_cache_logdet_alpha = config->get("logdet_alpha");
+  m_cache_logdet_sigma = config->get("logdet_sigma");
+  m_flat_file = config;
+  resizeTmp();
+}
+
+void bob::machine::PLDABase::save(bob::machine::FlatFileWriter& config) const 
+{
+  config.setArray("F", m_F);
+  config.setArray("G", m_G);
+  config.setArray("sigma", m_sigma);
+  config.setArray("mu", m_mu);
+  config.set("variance_threshold", m_variance_threshold);
+  config.setArray("alpha", m_cache_alpha);
+  config.setArray("beta", m_cache_beta);
+  // gamma's
+  if(m_cache_gamma.size() > 0)
+  {
+    blitz::Array<double, 1> a_indices(m_cache_gamma.size());
+    int i = 0;
+    for(std::map<size_t,blitz::Array<double,2> >::const_iterator 
+        it=m_cache_gamma.begin(); it!=m_cache_gamma.end(); ++it)
+    {
+      a_indices(i) = it->first;
+      std::string str = "gamma_" + boost::lexical_cast<std::string>(it->first);
+      config.setArray(str, it->second);
+      ++i;
+    }
+    config.setArray("a_indices_gamma", a_indices);
+  }
+  // log likelihood constant terms
+  if(m_cache_loglike_constterm.size() > 0)
+  {
+    blitz::Array<double, 1> a_indices(m_cache_loglike_constterm.size());
+    blitz::Array<double, 1> values(m_cache_loglike_constterm.size());
+    int i = 0;
+    for(std::map<size_t,double>::const_iterator 
+        it=m_cache_loglike_constterm.begin(); it!=m_cache_loglike_constterm.end(); ++it)
+    {
+      a_indices(i) = it->first;
+      values(i) = it->second;
+      ++i;
+    }
+    config.setArray("a_indices_loglikeconstterm", a_indices);
+    config.setArray("loglikeconstterm", values);
+  }
+  config.setArray("Ft_beta", m_cache_Ft_beta);
+  config.setArray("Gt_isigma", m_cache_Gt_isigma);
+  config.set("logdet_alpha", m_cache_logdet_alpha);
+  config.set("logdet_sigma", m_cache_logdet_sigma);
+}
+
 void bob::machine::PLDABase::resizeNoInit(const size_t dim_d, const size_t dim_f, 
     const size_t dim_g) 
 {
@@ -961,3 +1058,194 @@ void bob::machine::PLDAMachine::resizeTmp()
     m_tmp_nf_nf_1.resize(getDimF(), getDimF());
   }
 }
+
+
+/**
+ * @brief Gets the \f$\gamma_a\f$ matrix and the log likelihood constant
+ * term for a given \f$a\f$ (number of samples) from the PLDABase cache if
+ * they are available, or computes them locally otherwise.
+ */
+static const blitz::Array<double,2>& pldaGamma(
+  const bob::machine::PLDABase& base, const size_t a,
+  std::map<size_t, blitz::Array<double,2> >& gammas,
+  std::map<size_t, double>& constterms)
+{
+  std::map<size_t, blitz::Array<double,2> >::iterator it = gammas.find(a);
+  if (it != gammas.end()) return it->second;
+
+  blitz::Array<double,2>& gamma_a = gammas[a];
+  if (base.hasGamma(a))
+    gamma_a.reference(bob::core::array::ccopy(base.getGamma(a)));
+  else
+  {
+    gamma_a.resize(base.getDimF(), base.getDimF());
+    base.computeGamma(a, gamma_a);
+  }
+  if (base.hasLogLikeConstTerm(a))
+    constterms[a] = base.getLogLikeConstTerm(a);
+  else
+    constterms[a] = base.computeLogLikeConstTerm(a, gamma_a);
+  return gamma_a;
+}
+
+namespace {
+  /**
+   * @brief Scores a range of probes against all the enrolled models.
+   * All the arrays are C-contiguous and only read, the range of the output
+   * scores being written through a local view.
+   */
+  struct PLDAScoringRange {
+    const double* m_probes; ///< P x D probes
+    double* m_scores; ///< P x M scores
+    const blitz::Array<double,2>& m_Ft_beta; ///< F^T.beta (F x D)
+    const blitz::Array<double,1>& m_Ft_beta_mu; ///< F^T.beta.mu (F)
+    const blitz::Array<double,2>& m_Vt; ///< gamma_{a_m}.w_m (M x F)
+    /**
+     * 1/2 (gamma_a - gamma_1), for each distinct number of samples a (F x F)
+     */
+    const std::vector<blitz::Array<double,2> >& m_delta;
+    const std::vector<size_t>& m_group; ///< Index in m_delta of each model
+    const blitz::Array<double,1>& m_offset; ///< Probe independent terms (M)
+    const int m_dim_d;
+    const int m_dim_f;
+    const int m_n_models;
+
+    PLDAScoringRange(const double* probes, double* scores,
+        const blitz::Array<double,2>& Ft_beta,
+        const blitz::Array<double,1>& Ft_beta_mu,
+        const blitz::Array<double,2>& Vt,
+        const std::vector<blitz::Array<double,2> >& delta,
+        const std::vector<size_t>& group,
+        const blitz::Array<double,1>& offset):
+      m_probes(probes), m_scores(scores), m_Ft_beta(Ft_beta),
+      m_Ft_beta_mu(Ft_beta_mu), m_Vt(Vt), m_delta(delta), m_group(group),
+      m_offset(offset), m_dim_d(Ft_beta.extent(1)),
+      m_dim_f(Ft_beta.extent(0)), m_n_models(Vt.extent(0))
+    {
+    }
+
+    void operator()(const size_t ith, const size_t begin,
+      const size_t end) const
+    {
+      const int n = end - begin;
+      if (n == 0) return;
+      const blitz::Array<double,2> x(const_cast<double*>(m_probes + begin*m_dim_d),
+        blitz::shape(n, m_dim_d), blitz::neverDeleteData);
+      blitz::Array<double,2> s(m_scores + begin*m_n_models,
+        blitz::shape(n, m_n_models), blitz::neverDeleteData);
+
+      // u = F^T.beta.(x-mu)
+      blitz::Array<double,2> u(n, m_dim_f);
+      bob::math::gemm_(x, m_Ft_beta, u, false, true);
+      double* u_ = u.data();
+      for (int i=0; i<n; ++i)
+        for (int f=0; f<m_dim_f; ++f)
+          u_[i*m_dim_f+f] -= m_Ft_beta_mu(f);
+
+      // s = u^T.gamma_a.w
+      bob::math::gemm_(u, m_Vt, s, false, true);
+
+      // q_a = 1/2 u^T.(gamma_a - gamma_1).u, for each distinct a
+      const int n_groups = m_delta.size();
+      blitz::Array<double,2> q(n, n_groups);
+      blitz::Array<double,2> tmp(n, m_dim_f);
+      const double* tmp_ = tmp.data();
+      for (int g=0; g<n_groups; ++g)
+      {
+        bob::math::gemm_(u, m_delta[g], tmp);
+        for (int i=0; i<n; ++i)
+        {
+          double acc = 0.;
+          for (int f=0; f<m_dim_f; ++f)
+            acc += tmp_[i*m_dim_f+f] * u_[i*m_dim_f+f];
+          q(i,g) = acc;
+        }
+      }
+
+      // Adds the rank-1 terms
+      for (int i=0; i<n; ++i)
+      {
+        double* s_i = s.data() + i*m_n_models;
+        for (int m=0; m<m_n_models; ++m)
+          s_i[m] += q(i,(int)m_group[m]) + m_offset(m);
+      }
+    }
+  };
+}
+
+void bob::machine::pldaScoring(
+  const std::vector<boost::shared_ptr<const bob::machine::PLDAMachine> >& machines,
+  const blitz::Array<double,2>& probes, blitz::Array<double,2>& scores,
+  const size_t n_threads)
+{
+  // Checks inputs
+  bob::core::array::assertZeroBase(probes);
+  bob::core::array::assertZeroBase(scores);
+  bob::core::array::assertSameDimensionLength(scores.extent(0), probes.extent(0));
+  bob::core::array::assertSameDimensionLength(scores.extent(1), machines.size());
+  if (machines.size() == 0 || probes.extent(0) == 0) return;
+  const boost::shared_ptr<bob::machine::PLDABase> base = machines[0]->getPLDABase();
+  if (!base) throw std::runtime_error("No PLDABase set to this machine");
+  for (size_t m=1; m<machines.size(); ++m)
+    if (machines[m]->getPLDABase() != base)
+      throw std::runtime_error("All the PLDAMachine's should share the same PLDABase");
+  bob::core::array::assertSameDimensionLength(probes.extent(1), base->getDimD());
+
+  const int M = machines.size();
+  const int F = base->getDimF();
+
+  // Probe independent terms
+  std::map<size_t, blitz::Array<double,2> > gammas;
+  std::map<size_t, double> constterms;
+  const blitz::Array<double,2>& gamma_1 = pldaGamma(*base, 1, gammas, constterms);
+  const double l_1 = constterms[1];
+
+  std::map<size_t, size_t> a_groups;
+  std::vector<blitz::Array<double,2> > delta;
+  std::vector<size_t> group(M);
+  blitz::Array<double,2> Vt(M, F);
+  blitz::Array<double,1> offset(M);
+  blitz::Array<double,1> w(F), v(F);
+  for (int m=0; m<M; ++m)
+  {
+    const bob::machine::PLDAMachine& machine = *machines[m];
+    const size_t a = machine.getNSamples() + 1;
+    const blitz::Array<double,2>& gamma_a = pldaGamma(*base, a, gammas, constterms);
+    std::map<size_t, size_t>::const_iterator it = a_groups.find(a);
+    if (it == a_groups.end())
+    {
+      it = a_groups.insert(std::make_pair(a, delta.size())).first;
+      delta.push_back(blitz::Array<double,2>(F, F));
+      delta.back() = 0.5 * (gamma_a - gamma_1);
+    }
+    group[m] = it->second;
+
+    // v = gamma_a.w
+    if (machine.getNSamples() > 0) w = machine.getWeightedSum();
+    else w = 0.;
+    bob::math::prod(gamma_a, w, v);
+    Vt(m, blitz::Range::all()) = v;
+    offset(m) = constterms[a] - l_1 + machine.getWSumXitBetaXi() + 
+      0.5 * blitz::sum(w * v) - machine.getLogLikelihood();
+  }
+
+  // F^T.beta.mu
+  const blitz::Array<double,2> Ft_beta = bob::core::array::ccopy(base->getFtBeta());
+  blitz::Array<double,1> Ft_beta_mu(F);
+  bob::math::prod(Ft_beta, base->getMu(), Ft_beta_mu);
+
+  // Uses contiguous inputs and outputs, which can be split across threads
+  blitz::Array<double,2> probes_c;
+  if (bob::core::array::isCZeroBaseContiguous(probes)) probes_c.reference(probes);
+  else probes_c.reference(bob::core::array::ccopy(probes));
+  const bool scores_direct_use = bob::core::array::isCZeroBaseContiguous(scores);
+  blitz::Array<double,2> scores_c;
+  if (scores_direct_use) scores_c.reference(scores);
+  else scores_c.resize(scores.shape());
+
+  bob::core::thread_loop(PLDAScoringRange(probes_c.data(), scores_c.data(),
+    Ft_beta, Ft_beta_mu, Vt, delta, group, offset), probes_c.extent(0), 
+    n_threads);
+
+  if (!scores_direct_use) scores = scores_c;
+}
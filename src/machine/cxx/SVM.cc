@@ -15,13 +15,17 @@
 #include <boost/filesystem.hpp>
 #include <bob/machine/SVM.h>
 #include <bob/core/check.h>
+#include <bob/core/array_copy.h>
 #include <bob/core/logging.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <algorithm>
+#include <vector>
 
 static bool is_colon(char i) { return i == ':'; }
 
@@ -196,6 +200,18 @@ boost::shared_ptr<svm_model> bob::machine::svm_unpickle
   return retval;
 }
 
+/**
+ * Accumulates the (sparse) support vectors weighted by their coefficients
+ * into the dense weight vector w.
+ */
+static void add_support_vectors(const double* coef, svm_node* const* sv,
+    int n, double* w) {
+  for (int k=0; k<n; ++k) {
+    for (const svm_node* node = sv[k]; node->index != -1; ++node)
+      w[node->index-1] += coef[k] * node->value;
+  }
+}
+
 void bob::machine::SupportVector::reset() {
   //gets the expected size for the input from the SVM
   m_input_size = 0;
@@ -207,13 +223,49 @@ void bob::machine::SupportVector::reset() {
     }
   }
 
-  //create and reset cache
-  m_input_cache.reset(new svm_node[1 + m_input_size]);
-
   m_input_sub.resize(inputSize());
   m_input_sub = 0.0;
   m_input_div.resize(inputSize());
   m_input_div = 1.0;
+
+  //for linear kernels, the decision functions are collapsed into weights
+  m_linear_weight.resize(0, 0);
+  m_linear_bias.resize(0);
+  if (m_model->param.kernel_type != LINEAR) return;
+
+  const int svm_type = m_model->param.svm_type;
+  const bool classification = (svm_type == C_SVC || svm_type == NU_SVC);
+  const int nr_class = m_model->nr_class;
+  const int n_functions = classification ? (nr_class*(nr_class-1))/2 : 1;
+  if (n_functions <= 0) return;
+
+  m_linear_weight.resize(n_functions, m_input_size);
+  m_linear_weight = 0.;
+  m_linear_bias.resize(n_functions);
+  double* weight = m_linear_weight.data();
+
+  if (!classification) { //one-class and regression: a single function
+    add_support_vectors(m_model->sv_coef[0], m_model->SV, m_model->l, weight);
+    m_linear_bias(0) = -m_model->rho[0];
+    return;
+  }
+
+  //one-vs-one classification, in the order used by libsvm
+  std::vector<int> start(nr_class, 0);
+  for (int i=1; i<nr_class; ++i) start[i] = start[i-1] + m_model->nSV[i-1];
+
+  int p = 0;
+  for (int i=0; i<nr_class; ++i) {
+    for (int j=i+1; j<nr_class; ++j) {
+      double* w = weight + p*m_input_size;
+      add_support_vectors(m_model->sv_coef[j-1] + start[i],
+          m_model->SV + start[i], m_model->nSV[i], w);
+      add_support_vectors(m_model->sv_coef[i] + start[j],
+          m_model->SV + start[j], m_model->nSV[j], w);
+      m_linear_bias(p) = -m_model->rho[p];
+      ++p;
+    }
+  }
 }
 
 bob::machine::SupportVector::SupportVector(const std::string& model_file):
@@ -322,17 +374,17 @@ void bob::machine::SupportVector::setInputDivision(const blitz::Array<double,1>&
 }
 
 /**
- * Copies the user input to a locally pre-allocated cache. Apply normalization
- * at the same occasion.
+ * Copies the user input to a pre-allocated cache. Apply normalization at the
+ * same occasion. The cache is owned by the caller, so that concurrent
+ * predictions never share it.
  */
-static inline void copy(const blitz::Array<double,1>& input,
-    size_t cache_size, boost::shared_array<svm_node>& cache,
-    const blitz::Array<double,1>& sub, const blitz::Array<double,1>& div) {
+static inline void copy(const double* input, int stride,
+    size_t cache_size, svm_node* cache, const double* sub, const double* div) {
 
   size_t cur = 0; ///< currently used index
 
   for (size_t k=0; k<cache_size; ++k) {
-    double tmp = (input(k) - sub(k))/div(k);
+    double tmp = (input[k*stride] - sub[k])/div[k];
     if (!tmp) continue;
     cache[cur].index = k+1;
     cache[cur].value = tmp;
@@ -344,8 +396,10 @@ static inline void copy(const blitz::Array<double,1>& input,
 
 int bob::machine::SupportVector::predictClass_
 (const blitz::Array<double,1>& input) const {
-  copy(input, m_input_size, m_input_cache, m_input_sub, m_input_div);
-  int retval = round(svm_predict(m_model.get(), m_input_cache.get()));
+  std::vector<svm_node> cache(1 + m_input_size);
+  copy(input.data(), input.stride(0), m_input_size, &cache[0],
+      m_input_sub.data(), m_input_div.data());
+  int retval = round(svm_predict(m_model.get(), &cache[0]));
   return retval;
 }
 
@@ -364,12 +418,14 @@ int bob::machine::SupportVector::predictClass
 int bob::machine::SupportVector::predictClassAndScores_
 (const blitz::Array<double,1>& input,
  blitz::Array<double,1>& scores) const {
-  copy(input, m_input_size, m_input_cache, m_input_sub, m_input_div);
+  std::vector<svm_node> cache(1 + m_input_size);
+  copy(input.data(), input.stride(0), m_input_size, &cache[0],
+      m_input_sub.data(), m_input_div.data());
 #if LIBSVM_VERSION > 290
-  int retval = round(svm_predict_values(m_model.get(), m_input_cache.get(), scores.data()));
+  int retval = round(svm_predict_values(m_model.get(), &cache[0], scores.data()));
 #else
-  svm_predict_values(m_model.get(), m_input_cache.get(), scores.data());
-  int retval = round(svm_predict(m_model.get(), m_input_cache.get()));
+  svm_predict_values(m_model.get(), &cache[0], scores.data());
+  int retval = round(svm_predict(m_model.get(), &cache[0]));
 #endif
   return retval;
 }
@@ -402,8 +458,10 @@ int bob::machine::SupportVector::predictClassAndScores
 int bob::machine::SupportVector::predictClassAndProbabilities_
 (const blitz::Array<double,1>& input,
  blitz::Array<double,1>& probabilities) const {
-  copy(input, m_input_size, m_input_cache, m_input_sub, m_input_div);
-  int retval = round(svm_predict_probability(m_model.get(), m_input_cache.get(), probabilities.data()));
+  std::vector<svm_node> cache(1 + m_input_size);
+  copy(input.data(), input.stride(0), m_input_size, &cache[0],
+      m_input_sub.data(), m_input_div.data());
+  int retval = round(svm_predict_probability(m_model.get(), &cache[0], probabilities.data()));
   return retval;
 }
 
@@ -434,6 +492,277 @@ int bob::machine::SupportVector::predictClassAndProbabilities
   return predictClassAndProbabilities_(input, probabilities);
 }
 
+/**
+ * Returns the label predicted by libsvm from the decision values of a model,
+ * when these are computed without libsvm (see svm_predict_values()).
+ */
+static int decision_label(const svm_model* model, const double* dec,
+    std::vector<int>& votes) {
+  switch (model->param.svm_type) {
+    case ONE_CLASS:
+      return (dec[0] > 0) ? 1 : -1;
+    case EPSILON_SVR:
+    case NU_SVR:
+      return round(dec[0]);
+    default:
+      break;
+  }
+
+  const int nr_class = model->nr_class;
+  std::fill(votes.begin(), votes.end(), 0);
+  int p = 0;
+  for (int i=0; i<nr_class; ++i)
+    for (int j=i+1; j<nr_class; ++j)
+      ++votes[(dec[p++] > 0) ? i : j];
+
+  int vote_max_idx = 0;
+  for (int i=1; i<nr_class; ++i)
+    if (votes[i] > votes[vote_max_idx]) vote_max_idx = i;
+  return model->label[vote_max_idx];
+}
+
+namespace {
+
+  /**
+   * Predicts a range of (C-contiguous) inputs with libsvm. Each thread uses
+   * its own node cache.
+   */
+  struct SVMPredictRange {
+    const svm_model* m_model;
+    const double* m_input; ///< N x D inputs
+    int* m_labels; ///< N labels
+    double* m_outputs; ///< N x O scores or probabilities (may be null)
+    const size_t m_dim_d;
+    const size_t m_dim_o;
+    const double* m_sub;
+    const double* m_div;
+    const bool m_probabilities;
+
+    SVMPredictRange(const svm_model* model, const double* input, int* labels,
+        double* outputs, const size_t dim_d, const size_t dim_o,
+        const double* sub, const double* div, const bool probabilities):
+      m_model(model), m_input(input), m_labels(labels), m_outputs(outputs),
+      m_dim_d(dim_d), m_dim_o(dim_o), m_sub(sub), m_div(div),
+      m_probabilities(probabilities)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t begin,
+      const size_t end) const
+    {
+      std::vector<svm_node> cache(1 + m_dim_d);
+      for (size_t i=begin; i<end; ++i) {
+        copy(m_input + i*m_dim_d, 1, m_dim_d, &cache[0], m_sub, m_div);
+        if (!m_outputs) {
+          m_labels[i] = round(svm_predict(m_model, &cache[0]));
+          continue;
+        }
+        double* o = m_outputs + i*m_dim_o;
+        if (m_probabilities) {
+          m_labels[i] = round(svm_predict_probability(m_model, &cache[0], o));
+          continue;
+        }
+#if LIBSVM_VERSION > 290
+        m_labels[i] = round(svm_predict_values(m_model, &cache[0], o));
+#else
+        svm_predict_values(m_model, &cache[0], o);
+        m_labels[i] = round(svm_predict(m_model, &cache[0]));
+#endif
+      }
+    }
+  };
+
+  /**
+   * Predicts a range of (C-contiguous) inputs with a LINEAR kernel, using the
+   * collapsed weights of the decision functions (input normalization being
+   * folded into them).
+   */
+  struct SVMLinearRange {
+    const svm_model* m_model;
+    const double* m_input; ///< N x D inputs
+    int* m_labels; ///< N labels
+    double* m_scores; ///< N x P scores (may be null)
+    const blitz::Array<double,2>& m_weight; ///< P x D
+    const blitz::Array<double,1>& m_bias; ///< P
+    const int m_dim_d;
+    const int m_dim_p;
+
+    SVMLinearRange(const svm_model* model, const double* input, int* labels,
+        double* scores, const blitz::Array<double,2>& weight,
+        const blitz::Array<double,1>& bias):
+      m_model(model), m_input(input), m_labels(labels), m_scores(scores),
+      m_weight(weight), m_bias(bias), m_dim_d(weight.extent(1)),
+      m_dim_p(weight.extent(0))
+    {
+    }
+
+    void operator()(const size_t ith, const size_t begin,
+      const size_t end) const
+    {
+      const int n = end - begin;
+      if (n == 0) return;
+      const blitz::Array<double,2> x(const_cast<double*>(m_input + begin*m_dim_d),
+        blitz::shape(n, m_dim_d), blitz::neverDeleteData);
+      blitz::Array<double,2> s;
+      if (m_scores)
+        s.reference(blitz::Array<double,2>(m_scores + begin*m_dim_p,
+          blitz::shape(n, m_dim_p), blitz::neverDeleteData));
+      else
+        s.resize(n, m_dim_p);
+
+      // decision values: s = x.W^T + b
+      bob::math::gemm_(x, m_weight, s, false, true);
+      std::vector<int> votes(m_model->nr_class);
+      for (int i=0; i<n; ++i) {
+        double* s_i = s.data() + i*m_dim_p;
+        for (int p=0; p<m_dim_p; ++p) s_i[p] += m_bias(p);
+        m_labels[begin+i] = decision_label(m_model, s_i, votes);
+      }
+    }
+  };
+
+}
+
+void bob::machine::SupportVector::predictMany_
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>* outputs, const bool probabilities,
+ const size_t n_threads) const {
+
+  const int N = input.extent(0);
+  const int D = m_input_size;
+
+  // Worker threads access the rows from raw pointers: makes sure that the
+  // D first columns of the input are C-contiguous
+  blitz::Array<double,2> input_c;
+  if (bob::core::array::isCZeroBaseContiguous(input) && input.extent(1) == D)
+    input_c.reference(input);
+  else if (D > 0)
+    input_c.reference(bob::core::array::ccopy(input(blitz::Range::all(),
+      blitz::Range(input.lbound(1), input.lbound(1)+D-1))));
+  else
+    input_c.resize(N, 0);
+
+  blitz::Array<int,1> labels_c;
+  bool labels_direct_use = bob::core::array::isCZeroBaseContiguous(labels);
+  if (labels_direct_use) labels_c.reference(labels);
+  else labels_c.resize(N);
+
+  blitz::Array<double,2> outputs_c;
+  bool outputs_direct_use = true;
+  if (outputs) {
+    outputs_direct_use = bob::core::array::isCZeroBaseContiguous(*outputs);
+    if (outputs_direct_use) outputs_c.reference(*outputs);
+    else outputs_c.resize(outputs->shape());
+  }
+  double* outputs_ptr = outputs ? outputs_c.data() : 0;
+
+  if (m_linear_weight.extent(0) > 0 && !probabilities) {
+    // Folds the input normalization into the weights and biases:
+    // w.((x-sub)/div) + b = (w/div).x + (b - (w/div).sub)
+    const int P = m_linear_weight.extent(0);
+    blitz::Array<double,2> weight(P, D);
+    blitz::Array<double,1> bias(P);
+    for (int p=0; p<P; ++p) {
+      double b = m_linear_bias(p);
+      for (int k=0; k<D; ++k) {
+        weight(p,k) = m_linear_weight(p,k) / m_input_div(k);
+        b -= weight(p,k) * m_input_sub(k);
+      }
+      bias(p) = b;
+    }
+    bob::core::thread_loop(SVMLinearRange(m_model.get(), input_c.data(),
+      labels_c.data(), outputs_ptr, weight, bias), N, n_threads);
+  }
+  else {
+    const int O = outputs ? outputs->extent(1) : 0;
+    bob::core::thread_loop(SVMPredictRange(m_model.get(), input_c.data(),
+      labels_c.data(), outputs_ptr, D, O, m_input_sub.data(),
+      m_input_div.data(), probabilities), N, n_threads);
+  }
+
+  if (!labels_direct_use) labels = labels_c;
+  if (!outputs_direct_use) *outputs = outputs_c;
+}
+
+/**
+ * Checks the shape of the inputs and labels for the 2D prediction variants.
+ */
+static void check_many(const blitz::Array<double,2>& input,
+    const blitz::Array<int,1>& labels, size_t input_size) {
+  if ((size_t)input.extent(1) < input_size) {
+    boost::format s("input for this SVM should have **at least** %d columns, but you provided an array with %d columns instead");
+    s % input_size % input.extent(1);
+    throw std::runtime_error(s.str());
+  }
+  if (labels.extent(0) != input.extent(0)) {
+    boost::format s("output labels should have %d components (one per input row), but you provided an array with %d elements instead");
+    s % input.extent(0) % labels.extent(0);
+    throw std::runtime_error(s.str());
+  }
+}
+
+void bob::machine::SupportVector::predictClass_
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ const size_t n_threads) const {
+  predictMany_(input, labels, 0, false, n_threads);
+}
+
+void bob::machine::SupportVector::predictClass
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ const size_t n_threads) const {
+  check_many(input, labels, inputSize());
+  predictClass_(input, labels, n_threads);
+}
+
+void bob::machine::SupportVector::predictClassAndScores_
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>& scores, const size_t n_threads) const {
+  predictMany_(input, labels, &scores, false, n_threads);
+}
+
+void bob::machine::SupportVector::predictClassAndScores
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>& scores, const size_t n_threads) const {
+
+  check_many(input, labels, inputSize());
+
+  size_t N = outputSize();
+  size_t size = N < 2 ? 1 : (N*(N-1))/2;
+  if (scores.extent(0) != input.extent(0) || (size_t)scores.extent(1) != size) {
+    boost::format s("output scores for this SVM (%d classes) should be a %dx%d array, but you provided an array of shape %dx%d instead");
+    s % svm_get_nr_class(m_model.get()) % input.extent(0) % size % scores.extent(0) % scores.extent(1);
+    throw std::runtime_error(s.str());
+  }
+
+  predictClassAndScores_(input, labels, scores, n_threads);
+}
+
+void bob::machine::SupportVector::predictClassAndProbabilities_
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>& probabilities, const size_t n_threads) const {
+  predictMany_(input, labels, &probabilities, true, n_threads);
+}
+
+void bob::machine::SupportVector::predictClassAndProbabilities
+(const blitz::Array<double,2>& input, blitz::Array<int,1>& labels,
+ blitz::Array<double,2>& probabilities, const size_t n_threads) const {
+
+  check_many(input, labels, inputSize());
+
+  if (!supportsProbability()) {
+    throw std::runtime_error("this SVM does not support probabilities");
+  }
+
+  if (probabilities.extent(0) != input.extent(0) ||
+      (size_t)probabilities.extent(1) != numberOfClasses()) {
+    boost::format s("output probabilities for this SVM should be a %dx%d array, but you provided an array of shape %dx%d instead");
+    s % input.extent(0) % numberOfClasses() % probabilities.extent(0) % probabilities.extent(1);
+    throw std::runtime_error(s.str());
+  }
+
+  predictClassAndProbabilities_(input, labels, probabilities, n_threads);
+}
+
 void bob::machine::SupportVector::save(const std::string& filename) const {
   if (svm_save_model(filename.c_str(), m_model.get())) {
     boost::format s("cannot save SVM model to file '%s'");
@@ -9,11 +9,302 @@
 
 #include <bob/machine/ZTNorm.h>
 #include <bob/core/assert.h>
+#include <bob/core/parallel.h>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <stdexcept>
 #include <limits>
+#include <cmath>
 
 namespace bob { 
 namespace machine {
 
+namespace {
+
+  /// Constant to check if the std is close to 0.
+  static const double ZTNORM_EPS = std::numeric_limits<double>::min();
+
+  /**
+   * Computes the mean and the standard deviation of some rows of the
+   * scores, ignoring the masked scores if a mask is given.
+   */
+  struct ZTNormRowStatistics {
+    const blitz::Array<double,2>& m_scores;
+    const blitz::Array<bool,2>* m_mask;
+    blitz::Array<double,1>& m_mean;
+    blitz::Array<double,1>& m_std;
+    const int m_offset;
+
+    ZTNormRowStatistics(const blitz::Array<double,2>& scores,
+        const blitz::Array<bool,2>* mask, blitz::Array<double,1>& mean,
+        blitz::Array<double,1>& std, const int offset):
+      m_scores(scores), m_mask(mask), m_mean(mean), m_std(std),
+      m_offset(offset)
+    {}
+
+    void operator()(size_t, const size_t begin, const size_t end) const {
+      const int n = m_scores.extent(1);
+      for (int i=(int)begin; i<(int)end; ++i) {
+        double mean, std;
+        if (m_mask) {
+          // Impostor scores only
+          double sum = 0., sumsq = 0., count = 0.;
+          for (int j=0; j<n; ++j) {
+            if ((*m_mask)(i,j)) continue;
+            const double value = m_scores(i,j);
+            sum += value;
+            sumsq += value*value;
+            count += 1.;
+          }
+          mean = sum / count;
+          std = (count > 1 ? sqrt((sumsq - count * mean * mean) / (count - 1)) : 0.);
+        }
+        else {
+          double sum = 0.;
+          for (int j=0; j<n; ++j) sum += m_scores(i,j);
+          mean = sum / n;
+          double sumsq = 0.;
+          for (int j=0; j<n; ++j) sumsq += (m_scores(i,j) - mean) * (m_scores(i,j) - mean);
+          std = (n > 1 ? sqrt(sumsq / (n - 1)) : 0.);
+        }
+        m_mean(m_offset+i) = mean;
+        m_std(m_offset+i) = (std <= ZTNORM_EPS ? 1. : std);
+      }
+    }
+  };
+
+  /**
+   * Computes the mean and the standard deviation of some columns of the
+   * T-Norm scores, after their (optional) Z-normalisation.
+   */
+  struct ZTNormColumnStatistics {
+    const blitz::Array<double,2>& m_scores;
+    const blitz::Array<double,1>& m_tmodels_mean;
+    const blitz::Array<double,1>& m_tmodels_std;
+    blitz::Array<double,1>& m_mean;
+    blitz::Array<double,1>& m_std;
+    const int m_offset;
+
+    ZTNormColumnStatistics(const blitz::Array<double,2>& scores,
+        const blitz::Array<double,1>& tmodels_mean,
+        const blitz::Array<double,1>& tmodels_std,
+        blitz::Array<double,1>& mean, blitz::Array<double,1>& std,
+        const int offset):
+      m_scores(scores), m_tmodels_mean(tmodels_mean),
+      m_tmodels_std(tmodels_std), m_mean(mean), m_std(std), m_offset(offset)
+    {}
+
+    double value(const int t, const int j) const {
+      if (m_tmodels_mean.extent(0) == 0) return m_scores(t,j);
+      return (m_scores(t,j) - m_tmodels_mean(t)) / m_tmodels_std(t);
+    }
+
+    void operator()(size_t, const size_t begin, const size_t end) const {
+      // Scores are traversed row by row, the statistics of the columns being
+      // accumulated in the output
+      const int n = m_scores.extent(0);
+      const int b = m_offset + (int)begin;
+      const int e = m_offset + (int)end;
+      for (int j=b; j<e; ++j) m_mean(j) = 0.;
+      for (int t=0; t<n; ++t)
+        for (int j=b; j<e; ++j) m_mean(j) += value(t, j-m_offset);
+      for (int j=b; j<e; ++j) {
+        m_mean(j) /= n;
+        m_std(j) = 0.;
+      }
+      for (int t=0; t<n; ++t)
+        for (int j=b; j<e; ++j) {
+          const double diff = value(t, j-m_offset) - m_mean(j);
+          m_std(j) += diff * diff;
+        }
+      for (int j=b; j<e; ++j) {
+        const double std = (n > 1 ? sqrt(m_std(j) / (n - 1)) : 0.);
+        m_std(j) = (std <= ZTNORM_EPS ? 1. : std);
+      }
+    }
+  };
+
+  /**
+   * Normalises some rows of a tile of raw scores.
+   */
+  struct ZTNormRows {
+    const blitz::Array<double,2>& m_scores;
+    const blitz::Array<double,1>& m_z_mean;
+    const blitz::Array<double,1>& m_z_std;
+    const blitz::Array<double,1>& m_t_mean;
+    const blitz::Array<double,1>& m_t_std;
+    const int m_first_model;
+    const int m_first_probe;
+    blitz::Array<double,2>& m_normalized;
+
+    ZTNormRows(const blitz::Array<double,2>& scores,
+        const blitz::Array<double,1>& z_mean, const blitz::Array<double,1>& z_std,
+        const blitz::Array<double,1>& t_mean, const blitz::Array<double,1>& t_std,
+        const int first_model, const int first_probe,
+        blitz::Array<double,2>& normalized):
+      m_scores(scores), m_z_mean(z_mean), m_z_std(z_std), m_t_mean(t_mean),
+      m_t_std(t_std), m_first_model(first_model), m_first_probe(first_probe),
+      m_normalized(normalized)
+    {}
+
+    void operator()(size_t, const size_t begin, const size_t end) const {
+      const int n = m_scores.extent(1);
+      const bool znorm = m_z_mean.extent(0) > 0;
+      const bool tnorm = m_t_mean.extent(0) > 0;
+      for (int i=(int)begin; i<(int)end; ++i) {
+        for (int j=0; j<n; ++j) {
+          double value = m_scores(i,j);
+          if (znorm)
+            value = (value - m_z_mean(m_first_model+i)) / m_z_std(m_first_model+i);
+          if (tnorm)
+            value = (value - m_t_mean(m_first_probe+j)) / m_t_std(m_first_probe+j);
+          m_normalized(i,j) = value;
+        }
+      }
+    }
+  };
+
+  /**
+   * Appends n values to the given array, keeping the previous ones
+   */
+  void extend(blitz::Array<double,1>& a, const int n) {
+    if (a.extent(0) == 0) a.resize(n);
+    else a.resizeAndPreserve(a.extent(0) + n);
+  }
+
+}
+
+ZTNorm::ZTNorm()
+{
+}
+
+void ZTNorm::reset()
+{
+  m_z_mean.resize(0);
+  m_z_std.resize(0);
+  m_tmodels_mean.resize(0);
+  m_tmodels_std.resize(0);
+  m_t_mean.resize(0);
+  m_t_std.resize(0);
+}
+
+void ZTNorm::appendZStatistics(const blitz::Array<double,2>& rawscores_zprobes_vs_models,
+  const size_t n_threads)
+{
+  bob::core::array::assertZeroBase(rawscores_zprobes_vs_models);
+  const int offset = m_z_mean.extent(0);
+  const int n_models = rawscores_zprobes_vs_models.extent(0);
+  if (n_models == 0) return;
+  extend(m_z_mean, n_models);
+  extend(m_z_std, n_models);
+  bob::core::thread_loop(ZTNormRowStatistics(rawscores_zprobes_vs_models, 0,
+    m_z_mean, m_z_std, offset), n_models, n_threads);
+}
+
+void ZTNorm::setTModelsStatistics(const blitz::Array<double,2>& rawscores_zprobes_vs_tmodels,
+  const blitz::Array<bool,2>& mask_zprobes_vs_tmodels_istruetrial,
+  const size_t n_threads)
+{
+  setTModelsStatistics_(rawscores_zprobes_vs_tmodels, &mask_zprobes_vs_tmodels_istruetrial, n_threads);
+}
+
+void ZTNorm::setTModelsStatistics(const blitz::Array<double,2>& rawscores_zprobes_vs_tmodels,
+  const size_t n_threads)
+{
+  setTModelsStatistics_(rawscores_zprobes_vs_tmodels, 0, n_threads);
+}
+
+void ZTNorm::setTModelsStatistics_(const blitz::Array<double,2>& rawscores_zprobes_vs_tmodels,
+  const blitz::Array<bool,2>* mask_zprobes_vs_tmodels_istruetrial,
+  const size_t n_threads)
+{
+  const blitz::Array<double,2>& D = rawscores_zprobes_vs_tmodels;
+  bob::core::array::assertZeroBase(D);
+  if (mask_zprobes_vs_tmodels_istruetrial) {
+    bob::core::array::assertZeroBase(*mask_zprobes_vs_tmodels_istruetrial);
+    bob::core::array::assertSameShape(*mask_zprobes_vs_tmodels_istruetrial, D);
+  }
+  m_t_mean.resize(0);
+  m_t_std.resize(0);
+  // Without any Z-Norm probe, the T-Norm scores are not Z-normalised
+  const int size_tnorm = (D.extent(1) > 0 ? D.extent(0) : 0);
+  m_tmodels_mean.resize(size_tnorm);
+  m_tmodels_std.resize(size_tnorm);
+  if (size_tnorm == 0) return;
+  bob::core::thread_loop(ZTNormRowStatistics(D, mask_zprobes_vs_tmodels_istruetrial,
+    m_tmodels_mean, m_tmodels_std, 0), size_tnorm, n_threads);
+}
+
+void ZTNorm::appendTStatistics(const blitz::Array<double,2>& rawscores_probes_vs_tmodels,
+  const size_t n_threads)
+{
+  const blitz::Array<double,2>& C = rawscores_probes_vs_tmodels;
+  bob::core::array::assertZeroBase(C);
+  if (m_tmodels_mean.extent(0) > 0)
+    bob::core::array::assertSameDimensionLength(C.extent(0), m_tmodels_mean.extent(0));
+  const int offset = m_t_mean.extent(0);
+  const int n_probes = C.extent(1);
+  if (n_probes == 0 || C.extent(0) == 0) return;
+  extend(m_t_mean, n_probes);
+  extend(m_t_std, n_probes);
+  bob::core::thread_loop(ZTNormColumnStatistics(C, m_tmodels_mean,
+    m_tmodels_std, m_t_mean, m_t_std, offset), n_probes, n_threads);
+}
+
+void ZTNorm::normalize(const blitz::Array<double,2>& rawscores_probes_vs_models,
+  blitz::Array<double,2>& normalizedscores, const size_t first_model,
+  const size_t first_probe, const size_t n_threads) const
+{
+  const blitz::Array<double,2>& A = rawscores_probes_vs_models;
+  bob::core::array::assertZeroBase(A);
+  bob::core::array::assertZeroBase(normalizedscores);
+  bob::core::array::assertSameShape(A, normalizedscores);
+
+  const size_t n_models = A.extent(0);
+  const size_t n_probes = A.extent(1);
+  if (m_z_mean.extent(0) > 0 && first_model + n_models > (size_t)m_z_mean.extent(0)) {
+    boost::format m("the tile of scores (models %d to %d) is out of the range of the Z-Norm statistics (%d models)");
+    m % first_model % (first_model + n_models) % m_z_mean.extent(0);
+    throw std::runtime_error(m.str());
+  }
+  if (m_t_mean.extent(0) > 0 && first_probe + n_probes > (size_t)m_t_mean.extent(0)) {
+    boost::format m("the tile of scores (probes %d to %d) is out of the range of the T-Norm statistics (%d probes)");
+    m % first_probe % (first_probe + n_probes) % m_t_mean.extent(0);
+    throw std::runtime_error(m.str());
+  }
+  if (n_models == 0 || n_probes == 0) return;
+
+  bob::core::thread_loop(ZTNormRows(A, m_z_mean, m_z_std, m_t_mean, m_t_std,
+    first_model, first_probe, normalizedscores), n_models, n_threads);
+}
+
+void ZTNorm::normalize(bob::io::HDF5File& rawscores_file,
+  const std::string& rawscores_path, bob::io::HDF5File& normalized_file,
+  const std::string& normalized_path, const size_t block_size,
+  const size_t n_threads) const
+{
+  if (block_size == 0)
+    throw std::runtime_error("the number of models of a block of scores should be strictly positive");
+
+  // Each model is read as a 1D array
+  const size_t n_models = rawscores_file.describe(rawscores_path)[0].size;
+  blitz::Array<double,2> block;
+  for (size_t first=0; first<n_models; first+=block_size) {
+    const int n = std::min(block_size, n_models - first);
+    for (int i=0; i<n; ++i) {
+      const blitz::Array<double,1> row = rawscores_file.readArray<double,1>(rawscores_path, first+i);
+      if (block.extent(0) != n || block.extent(1) != row.extent(0))
+        block.resize(n, row.extent(0));
+      block(i, blitz::Range::all()) = row;
+    }
+    normalize(block, block, first, 0, n_threads);
+    for (int i=0; i<n; ++i) {
+      const blitz::Array<double,1> row = block(i, blitz::Range::all());
+      normalized_file.appendArray(normalized_path, row);
+    }
+  }
+}
+
 namespace detail {
   void ztNorm(const blitz::Array<double,2>& rawscores_probes_vs_models,
               const blitz::Array<double,2>* rawscores_zprobes_vs_models,
@@ -35,17 +326,12 @@ namespace detail {
     int size_znorm = (B ? B->extent(1) : 0);
 
     // Check the inputs
-    bob::core::array::assertSameDimensionLength(A.extent(0), size_eval);
-    bob::core::array::assertSameDimensionLength(A.extent(1), size_enrol);
-
     if (B) {
-      bob::core::array::assertSameDimensionLength(B->extent(1), size_znorm);
       if (size_znorm > 0)
         bob::core::array::assertSameDimensionLength(B->extent(0), size_eval);
     }
 
     if (C) {
-      bob::core::array::assertSameDimensionLength(C->extent(0), size_tnorm);
       if (size_tnorm > 0)
         bob::core::array::assertSameDimensionLength(C->extent(1), size_enrol);
     }
@@ -63,88 +349,19 @@ namespace detail {
     bob::core::array::assertSameDimensionLength(scores.extent(0), size_eval);
     bob::core::array::assertSameDimensionLength(scores.extent(1), size_enrol);
 
-    // Declare needed IndexPlaceholder
-    blitz::firstIndex ii;
-    blitz::secondIndex jj;
-
-    // Constant to check if the std is close to 0. 
-    const double eps = std::numeric_limits<double>::min();
-    
-    // zA
-    blitz::Array<double,2> zA(A.shape());
-    if (B && size_znorm > 0) {
-      // Znorm  -->      zA  = (A - mean(B) ) / std(B)    [znorm on oringinal scores]
-      // mean(B)
-      blitz::Array<double,1> mean_B(blitz::mean(*B, jj));
-      // std(B)
-      blitz::Array<double,2> B2n(B->shape());
-      B2n = blitz::pow2((*B)(ii, jj) - mean_B(ii));
-      blitz::Array<double,1> std_B(B->extent(0));
-      if(size_znorm>1)
-        std_B = blitz::sqrt(blitz::sum(B2n, jj) / (size_znorm - 1));
-      else // 1 single value -> std = 0
-        std_B = 0; 
-      std_B = blitz::where( std_B <= eps, 1., std_B);
-
-      zA = (A(ii, jj) - mean_B(ii)) / std_B(ii);
-    }
-    else
-      zA = A;
-
-    blitz::Array<double,2> zC(size_tnorm, size_enrol);
-    if (D && size_tnorm > 0 && size_znorm > 0) {
-      blitz::Array<double,1> mean_Dimp(size_tnorm);
-      blitz::Array<double,1> std_Dimp(size_tnorm);
-
-      // Compute mean_Dimp and std_Dimp = D only with impostors
-      for (int i = 0; i < size_tnorm; ++i) {
-        double sum = 0;
-        double sumsq = 0;
-        double count = 0;
-        for (int j = 0; j < size_znorm; ++j) {
-          bool keep;
-          // The second part is never executed if mask_zprobes_vs_tmodels_istruetrial==NULL
-          keep = (mask_zprobes_vs_tmodels_istruetrial == NULL) || !(*mask_zprobes_vs_tmodels_istruetrial)(i, j); //tnorm_models_spk_ids(i) != znorm_tests_spk_ids(j);
-          
-          double value = keep * (*D)(i, j);
-          sum += value;
-          sumsq += value*value;
-          count += keep;
-        }
-
-        double mean = sum / count;
-        mean_Dimp(i) = mean;
-        if (count > 1)
-          std_Dimp(i) = sqrt((sumsq - count * mean * mean) / (count -1));
-        else // 1 single value -> std = 0
-          std_Dimp(i) = 0;
+    ZTNorm ztnorm;
+    if (B && size_znorm > 0)
+      ztnorm.appendZStatistics(*B);
+    if (C && size_tnorm > 0) {
+      if (D && size_znorm > 0) {
+        if (mask_zprobes_vs_tmodels_istruetrial)
+          ztnorm.setTModelsStatistics(*D, *mask_zprobes_vs_tmodels_istruetrial);
+        else
+          ztnorm.setTModelsStatistics(*D);
       }
-
-      // zC  = (C - mean(D)) / std(D)     [znorm the tnorm scores]
-      std_Dimp = blitz::where( std_Dimp <= eps, 1., std_Dimp);
-      zC = ((*C)(ii, jj) - mean_Dimp(ii)) / std_Dimp(ii);
-    }
-    else if (C && size_tnorm > 0)
-      zC = *C;
-
-    if (C && size_tnorm > 0)
-    {
-      blitz::Array<double,1> mean_zC(size_enrol);
-      blitz::Array<double,1> std_zC(size_enrol);
-      
-      // ztA = (zA - mean(zC)) / std(zC)  [ztnorm on eval scores]
-      mean_zC = blitz::mean(zC(jj, ii), jj);
-      if (size_tnorm > 1)
-        std_zC = sqrt(blitz::sum(pow(zC(jj, ii) - mean_zC(ii), 2) , jj) / (size_tnorm - 1));
-      else // 1 single value -> std = 0
-        std_zC = 0;
-      std_zC = blitz::where( std_zC <= eps, 1., std_zC);
-
-      // Normalised scores
-      scores = (zA(ii, jj) - mean_zC(jj)) /  std_zC(jj);
+      ztnorm.appendTStatistics(*C);
     }
-    else
-      scores = zA;
+    ztnorm.normalize(A, scores);
   }
 }
 
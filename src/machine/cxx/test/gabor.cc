@@ -110,4 +110,28 @@ BOOST_AUTO_TEST_CASE( test_gabor_graph_machine )
     double similarity = machine.similarity(graph, graph_jets, *sim_fcts[i]);
     BOOST_CHECK_CLOSE(similarity, 1., epsilon);
   }
+
+  // compare the graph with a gallery of modified graphs, in which the graph itself is stored at position 2
+  const int gallery_size = 5;
+  blitz::Array<double,4> gallery(gallery_size, graph.extent(0), 2, graph.extent(2));
+  blitz::Range all = blitz::Range::all();
+  for (int g = 0; g < gallery_size; ++g){
+    gallery(g,all,all,all) = graph_jets;
+    gallery(g,all,0,all) *= 1. - std::abs(g - 2) * 0.1 * (blitz::tensor::i % 3);
+    gallery(g,all,1,all) += std::abs(g - 2) * 0.2 * (blitz::tensor::j % 2);
+  }
+  blitz::Array<double,1> similarities(gallery_size);
+  blitz::Array<int,1> indices(2);
+  blitz::Array<double,1> best(2);
+  for (int i = sim_fcts.size(); i--;){
+    machine.similarities(gallery, graph, *sim_fcts[i], similarities, 2);
+    for (int g = 0; g < gallery_size; ++g){
+      blitz::Array<double,3> model = gallery(g,all,all,all);
+      BOOST_CHECK_SMALL(similarities(g) - machine.similarity(model, graph, *sim_fcts[i]), epsilon);
+    }
+    machine.search(gallery, graph, *sim_fcts[i], indices, best);
+    BOOST_CHECK_EQUAL(indices(0), 2);
+    BOOST_CHECK_CLOSE(best(0), 1., epsilon);
+    BOOST_CHECK_EQUAL(best(1), similarities(indices(1)));
+  }
 }
@@ -65,8 +65,22 @@ static void apply(boost::function<double (double)> function, bob::python::const_
   }
 }
 
+/**
+ * Scalar variants of the (overloaded) activation methods
+ */
+typedef double (bob::machine::Activation::*scalar_method_t)(double) const;
+static const scalar_method_t activation_f = &bob::machine::Activation::f;
+static const scalar_method_t activation_f_prime_from_f =
+  &bob::machine::Activation::f_prime_from_f;
+
 static object activation_f_ndarray_1(boost::shared_ptr<bob::machine::Activation> a, bob::python::const_ndarray arr, bob::python::ndarray retval) {
-  apply(boost::bind(&bob::machine::Activation::f, a, _1), arr, retval);
+  if (arr.type().nd == 2 && arr.type().is_compatible(retval.type())) {
+    //uses the 2D variant, which processes the whole array at once
+    blitz::Array<double,2> retval_ = retval.bz<double,2>();
+    a->f(arr.bz<double,2>(), retval_);
+    return retval.self();
+  }
+  apply(boost::bind(activation_f, a, _1), arr, retval);
   return retval.self();
 }
 
@@ -86,7 +100,13 @@ static object activation_f_prime_ndarray_2(boost::shared_ptr<bob::machine::Activ
 }
 
 static object activation_f_prime_from_f_ndarray_1(boost::shared_ptr<bob::machine::Activation> a, bob::python::const_ndarray arr, bob::python::ndarray retval) {
-  apply(boost::bind(&bob::machine::Activation::f_prime_from_f, a, _1), arr, retval);
+  if (arr.type().nd == 2 && arr.type().is_compatible(retval.type())) {
+    //uses the 2D variant, which processes the whole array at once
+    blitz::Array<double,2> retval_ = retval.bz<double,2>();
+    a->f_prime_from_f(arr.bz<double,2>(), retval_);
+    return retval.self();
+  }
+  apply(boost::bind(activation_f_prime_from_f, a, _1), arr, retval);
   return retval.self();
 }
 
@@ -100,16 +120,16 @@ void bind_machine_activation() {
       "Base class for activation functions", no_init)
     .def("f", &activation_f_ndarray_1, (arg("self"), arg("z"), arg("res")), "Computes the activated value, given an input array ``z``, placing results in ``res`` (and returning it)")
     .def("f", &activation_f_ndarray_2, (arg("self"), arg("z")), "Computes the activated value, given an input array ``z``. Returns a newly allocated array with the answers")
-    .def("f", &bob::machine::Activation::f, (arg("self"), arg("z")), "Computes the activated value, given an input ``z``") 
+    .def("f", activation_f, (arg("self"), arg("z")), "Computes the activated value, given an input ``z``") 
     .def("__call__", &activation_f_ndarray_1, (arg("self"), arg("z"), arg("res")), "Computes the activated value, given an input array ``z``, placing results in ``res`` (and returning it)")
     .def("__call__", &activation_f_ndarray_2, (arg("self"), arg("z")), "Computes the activated value, given an input array ``z``. Returns a newly allocated array with the same size as ``z``")
-    .def("__call__", &bob::machine::Activation::f, (arg("self"), arg("z")), "Computes the activated value, given an input ``z``") 
+    .def("__call__", activation_f, (arg("self"), arg("z")), "Computes the activated value, given an input ``z``") 
     .def("f_prime", &activation_f_prime_ndarray_1, (arg("self"), arg("z"), arg("res")), "Computes the derivative of the activated value, placing results in ``res`` (and returning it)")
     .def("f_prime", &activation_f_prime_ndarray_2, (arg("self"), arg("z")), "Computes the derivative of the activated value, given an input array ``z``. Returns a newly allocated array with the same size as ``z``")
     .def("f_prime", &bob::machine::Activation::f_prime, (arg("self"), arg("z")), "Computes the derivative of the activated value.")
     .def("f_prime_from_f", &activation_f_prime_from_f_ndarray_1, (arg("self"), arg("a"), arg("res")), "Computes the derivative of the activated value, given **the activated value** ``a``, placing results in ``res`` (and returning it)")
     .def("f_prime_from_f", &activation_f_prime_from_f_ndarray_2, (arg("self"), arg("z")), "Computes the derivative of the activated value, given **the activated value** ``a``. Returns a newly allocated array with the same size as ``a`` with the answer.")
-    .def("f_prime_from_f", &bob::machine::Activation::f_prime_from_f, (arg("self"), arg("a")), "Computes the derivative of the activation value, given **the activated value** ``a``.")
+    .def("f_prime_from_f", activation_f_prime_from_f, (arg("self"), arg("a")), "Computes the derivative of the activation value, given **the activated value** ``a``.")
     .def("save", &bob::machine::Activation::save, (arg("self"), arg("h5f")), 
        "Saves itself to a :py:class:`bob.io.HDF5File`")
     .def("load", &bob::machine::Activation::load, (arg("self"), arg("h5f")), 
@@ -7,22 +7,43 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <boost/python.hpp>
 #include <bob/machine/BICMachine.h>
 #include <bob/io/HDF5File.h>
 #include <bob/python/exception.h>
 
 
-static double bic_call_(const bob::machine::BICMachine& machine, bob::python::const_ndarray input){
+static boost::python::object bic_call_(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, const size_t n_threads){
+  if (input.type().nd == 2){
+    blitz::Array<double,2> input_ = input.bz<double,2>();
+    bob::python::ndarray output(bob::core::array::t_float64, input_.extent(0));
+    blitz::Array<double,1> output_ = output.bz<double,1>();
+    {
+      bob::python::no_gil unlock;
+      machine.forward_(input_, output_, n_threads);
+    }
+    return output.self();
+  }
   double o;
   machine.forward_(input.bz<double,1>(), o);
-  return o;
+  return boost::python::object(o);
 }
 
-static double bic_call(const bob::machine::BICMachine& machine, bob::python::const_ndarray input){
+static boost::python::object bic_call(const bob::machine::BICMachine& machine, bob::python::const_ndarray input, const size_t n_threads){
+  if (input.type().nd == 2){
+    blitz::Array<double,2> input_ = input.bz<double,2>();
+    bob::python::ndarray output(bob::core::array::t_float64, input_.extent(0));
+    blitz::Array<double,1> output_ = output.bz<double,1>();
+    {
+      bob::python::no_gil unlock;
+      machine.forward(input_, output_, n_threads);
+    }
+    return output.self();
+  }
   double o;
   machine.forward(input.bz<double,1>(), o);
-  return o;
+  return boost::python::object(o);
 }
 
 void bind_machine_bic(){
@@ -85,10 +106,13 @@ void bind_machine_bic(){
       &bic_call,
       (
           boost::python::arg("self"),
-          boost::python::arg("input")
+          boost::python::arg("input"),
+          boost::python::arg("n_threads") = 0
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The resulting value is returned as a single float value. "
+      "If input is a 2D array, each row is considered as one vector, and an array of scores is returned; "
+      "the rows are scored by blocks using n_threads threads (0: number of hardware threads). "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
       "No sanity checks of input and output are performed."
     )
@@ -98,11 +122,13 @@ void bind_machine_bic(){
       &bic_call_,
       (
           boost::python::arg("self"),
-          boost::python::arg("input")
+          boost::python::arg("input"),
+          boost::python::arg("n_threads") = 0
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
-      "No sanity checks of input are performed."
+      "No sanity checks of input are performed. "
+      "If input is a 2D array, each row is scored, using n_threads threads (0: number of hardware threads), and an array of scores is returned."
     )
 
     .def(
@@ -110,11 +136,13 @@ void bind_machine_bic(){
       &bic_call,
       (
           boost::python::arg("self"),
-          boost::python::arg("input")
+          boost::python::arg("input"),
+          boost::python::arg("n_threads") = 0
       ),
       "Computes the BIC or IEC score for the given input vector, which results of a comparison of two (facial) images. "
       "The score itself is the log-likelihood score of the given input vector belonging to the intrapersonal class. "
-      "Sanity checks of input shape are performed."
+      "Sanity checks of input shape are performed. "
+      "If input is a 2D array, each row is scored, using n_threads threads (0: number of hardware threads), and an array of scores is returned."
     )
 
     .add_property(
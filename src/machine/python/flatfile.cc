@@ -0,0 +1,35 @@
+/**
+ * @file machine/python/flatfile.cc
+ * @date Mon Oct 19 02:42:23 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Bindings for the flat binary files of machines
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <boost/python.hpp>
+#include <bob/python/ndarray.h>
+#include <bob/machine/FlatFile.h>
+#include <boost/shared_ptr.hpp>
+
+using namespace boost::python;
+
+static tuple py_section_names(const bob::machine::FlatFile& f)
+{
+  list l;
+  std::vector<std::string> names = f.getSectionNames();
+  for (size_t i=0; i<names.size(); ++i) l.append(names[i]);
+  return tuple(l);
+}
+
+void bind_machine_flatfile()
+{
+  class_<bob::machine::FlatFile, boost::shared_ptr<bob::machine::FlatFile>, boost::noncopyable>("FlatFile", "A flat binary file, which stores the parameters of a machine (GMMMachine, IVectorMachine or PLDABase) as a set of named and aligned arrays, and that is mapped in memory when opened. Such files are written and read by the save_flat() and load_flat() methods of the machines.", init<const std::string&>((arg("self"), arg("filename")), "Maps the given flat file in memory."))
+    .add_property("filename", make_function(&bob::machine::FlatFile::getFilename, return_value_policy<copy_const_reference>()), "The name of the mapped file")
+    .add_property("version", &bob::machine::FlatFile::getVersion, "The version of the format of the mapped file")
+    .add_property("type", make_function(&bob::machine::FlatFile::getType, return_value_policy<copy_const_reference>()), "The type of the machine stored in the mapped file")
+    .add_property("section_names", &py_section_names, "The names of the sections of the mapped file")
+    .def("__contains__", &bob::machine::FlatFile::contains, (arg("self"), arg("name")), "Tells if the mapped file contains a section with the given name")
+  ;
+}
@@ -11,6 +11,7 @@
 
 #include <boost/python.hpp>
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 
 #include <bob/ip/GaborWaveletTransform.h>
 #include <bob/machine/GaborGraphMachine.h>
@@ -86,6 +87,58 @@ static double bob_similarity(bob::machine::GaborGraphMachine& self, bob::python:
   }
 }
 
+static bob::python::ndarray bob_similarities(bob::machine::GaborGraphMachine& self, bob::python::const_ndarray gallery_graphs, bob::python::const_ndarray probe_graph, const bob::machine::GaborJetSimilarity& similarity_function, const size_t n_threads){
+  const bob::core::array::typeinfo& info = gallery_graphs.type();
+  bob::python::ndarray similarities(bob::core::array::t_float64, info.shape[0]);
+  blitz::Array<double,1> similarities_ = similarities.bz<double,1>();
+  switch (info.nd){
+    case 3:{ // Gabor graphs including jets without phases
+      blitz::Array<double,3> gallery = gallery_graphs.bz<double,3>();
+      blitz::Array<double,2> probe = probe_graph.bz<double,2>();
+      bob::python::no_gil unlock;
+      self.similarities(gallery, probe, similarity_function, similarities_, n_threads);
+      break;
+    }
+    case 4:{ // Gabor graphs including jets with phases
+      blitz::Array<double,4> gallery = gallery_graphs.bz<double,4>();
+      blitz::Array<double,3> probe = probe_graph.bz<double,3>();
+      bob::python::no_gil unlock;
+      self.similarities(gallery, probe, similarity_function, similarities_, n_threads);
+      break;
+    }
+    default:
+      PYTHON_ERROR(RuntimeError, "parameter `gallery_graph_jets' should be 3 or 4 dimensional, but you passed a " SIZE_T_FMT " dimensional array.", info.nd);
+  }
+  return similarities;
+}
+
+static boost::python::tuple bob_search(bob::machine::GaborGraphMachine& self, bob::python::const_ndarray gallery_graphs, bob::python::const_ndarray probe_graph, const bob::machine::GaborJetSimilarity& similarity_function, const int k, const size_t n_threads){
+  const bob::core::array::typeinfo& info = gallery_graphs.type();
+  bob::python::ndarray indices(bob::core::array::t_int32, k);
+  bob::python::ndarray similarities(bob::core::array::t_float64, k);
+  blitz::Array<int,1> indices_ = indices.bz<int,1>();
+  blitz::Array<double,1> similarities_ = similarities.bz<double,1>();
+  switch (info.nd){
+    case 3:{ // Gabor graphs including jets without phases
+      blitz::Array<double,3> gallery = gallery_graphs.bz<double,3>();
+      blitz::Array<double,2> probe = probe_graph.bz<double,2>();
+      bob::python::no_gil unlock;
+      self.search(gallery, probe, similarity_function, indices_, similarities_, n_threads);
+      break;
+    }
+    case 4:{ // Gabor graphs including jets with phases
+      blitz::Array<double,4> gallery = gallery_graphs.bz<double,4>();
+      blitz::Array<double,3> probe = probe_graph.bz<double,3>();
+      bob::python::no_gil unlock;
+      self.search(gallery, probe, similarity_function, indices_, similarities_, n_threads);
+      break;
+    }
+    default:
+      PYTHON_ERROR(RuntimeError, "parameter `gallery_graph_jets' should be 3 or 4 dimensional, but you passed a " SIZE_T_FMT " dimensional array.", info.nd);
+  }
+  return boost::python::make_tuple(indices, similarities);
+}
+
 static double bob_jet_sim(const bob::machine::GaborJetSimilarity& self, bob::python::const_ndarray jet1, bob::python::const_ndarray jet2){
   switch (jet1.type().nd){
     case 1:{
@@ -247,6 +300,22 @@ void bind_machine_gabor(){
       &bob_similarity,
       (boost::python::arg("self"), boost::python::arg("model_graph_jets"), boost::python::arg("probe_graph_jets"), boost::python::arg("jet_similarity_function")),
       "Computes the similarity between the given probe graph and the gallery, which might be a single graph or a collection of graphs"
+    )
+
+    .def(
+      "similarities",
+      &bob_similarities,
+      (boost::python::arg("self"), boost::python::arg("gallery_graph_jets"), boost::python::arg("probe_graph_jets"), boost::python::arg("jet_similarity_function"), boost::python::arg("n_threads") = 0),
+      "Computes the similarities between the given probe graph and each graph of the gallery, which is a contiguous 3D (without phases) or 4D (with phases) array of graphs. "
+      "The gallery is processed in blocks using n_threads threads (0: number of hardware threads), and the similarity function is not modified."
+    )
+
+    .def(
+      "search",
+      &bob_search,
+      (boost::python::arg("self"), boost::python::arg("gallery_graph_jets"), boost::python::arg("probe_graph_jets"), boost::python::arg("jet_similarity_function"), boost::python::arg("k") = 1, boost::python::arg("n_threads") = 0),
+      "Finds the k graphs of the gallery (see :py:meth:`similarities`) that are the most similar to the given probe graph. "
+      "Returns a tuple (indices, similarities) of the gallery graphs, sorted by decreasing similarity."
   );
 
 }
@@ -213,6 +213,19 @@ static void py_gmmmachine_accStatistics_(const bob::machine::GMMMachine& machine
   }
 }
 
+static void py_gmmmachine_save_flat(const bob::machine::GMMMachine& machine, const std::string& filename)
+{
+  bob::machine::FlatFileWriter config(filename, "GMMMachine");
+  machine.save(config);
+  config.close();
+}
+
+static void py_gmmmachine_load_flat(bob::machine::GMMMachine& machine, const std::string& filename)
+{
+  bob::machine::FlatFile config(filename);
+  machine.load(config);
+}
+
 void bind_machine_gmm()
 {
   class_<bob::machine::GMMStats, boost::shared_ptr<bob::machine::GMMStats> >("GMMStats",
@@ -287,8 +300,10 @@ void bind_machine_gmm()
          "Accumulate the GMM statistics for this sample(s). Inputs are checked.")
     .def("acc_statistics_", &py_gmmmachine_accStatistics_, args("self", "x", "stats"),
          "Accumulate the GMM statistics for this sample(s). Inputs are NOT checked.")
-    .def("load", &bob::machine::GMMMachine::load, (arg("self"), arg("config")), "Load from a Configuration")
-    .def("save", &bob::machine::GMMMachine::save, (arg("self"), arg("config")), "Save to a Configuration")
+    .def("load", (void (bob::machine::GMMMachine::*)(bob::io::HDF5File&))&bob::machine::GMMMachine::load, (arg("self"), arg("config")), "Load from a Configuration")
+    .def("save", (void (bob::machine::GMMMachine::*)(bob::io::HDF5File&) const)&bob::machine::GMMMachine::save, (arg("self"), arg("config")), "Save to a Configuration")
+    .def("load_flat", &py_gmmmachine_load_flat, (arg("self"), arg("filename")), "Loads the parameters from a flat binary file (see save_flat()).")
+    .def("save_flat", &py_gmmmachine_save_flat, (arg("self"), arg("filename")), "Saves the parameters to a flat binary file, which is faster to load than an HDF5 file.")
     .def(self_ns::str(self_ns::self))
   ;
 
@@ -14,6 +14,20 @@
 
 using namespace boost::python;
 
+static void py_iv_save_flat(const bob::machine::IVectorMachine& machine,
+  const std::string& filename)
+{
+  bob::machine::FlatFileWriter config(filename, "IVectorMachine");
+  machine.save(config);
+  config.close();
+}
+
+static void py_iv_load_flat(bob::machine::IVectorMachine& machine,
+  const std::string& filename)
+{
+  machine.load(boost::shared_ptr<const bob::machine::FlatFile>(new bob::machine::FlatFile(filename)));
+}
+
 static void py_iv_setT(bob::machine::IVectorMachine& machine,
   bob::python::const_ndarray T)
 {
@@ -92,8 +106,10 @@ void bind_machine_ivector()
     .def(self == self)
     .def(self != self)
     .def("is_similar_to", &bob::machine::IVectorMachine::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this IVectorMachine with the 'other' one to be approximately the same.")
-    .def("load", &bob::machine::IVectorMachine::load, (arg("self"), arg("config")), "Loads the configuration parameters from a configuration file.")
-    .def("save", &bob::machine::IVectorMachine::save, (arg("self"), arg("config")), "Saves the configuration parameters to a configuration file.")
+    .def("load", (void (bob::machine::IVectorMachine::*)(bob::io::HDF5File&))&bob::machine::IVectorMachine::load, (arg("self"), arg("config")), "Loads the configuration parameters from a configuration file.")
+    .def("save", (void (bob::machine::IVectorMachine::*)(bob::io::HDF5File&) const)&bob::machine::IVectorMachine::save, (arg("self"), arg("config")), "Saves the configuration parameters to a configuration file.")
+    .def("load_flat", &py_iv_load_flat, (arg("self"), arg("filename")), "Loads the configuration parameters from a flat binary file (see save_flat()). The file is mapped in memory, and its pages are shared with the other processes that load it. The UBM should be set before, so that the precomputed values stored in the file could be used.")
+    .def("save_flat", &py_iv_save_flat, (arg("self"), arg("filename")), "Saves the configuration parameters (and precomputed values) to a flat binary file, which can be memory-mapped.")
     .def("resize", &bob::machine::IVectorMachine::resize, (arg("self"), arg("rt")), "Reset the dimensionality of the Total Variability subspace T.")
     .add_property("ubm", &bob::machine::IVectorMachine::getUbm, &bob::machine::IVectorMachine::setUbm, "The UBM GMM attached to this Joint Factor Analysis model")
     .add_property("t", make_function(&bob::machine::IVectorMachine::getT, return_value_policy<copy_const_reference>()), &py_iv_setT, "The subspace T (Total Variability matrix)")
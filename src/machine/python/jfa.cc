@@ -9,7 +9,9 @@
  */
 
 #include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <boost/shared_ptr.hpp>
 #include <bob/machine/JFAMachine.h>
 #include <bob/machine/GMMMachine.h>
@@ -137,6 +139,57 @@ static void py_gen2b_forward_(const bob::machine::Machine<bob::machine::GMMStats
 }
 
 
+static void convertGMMStatsList(object stats,
+  std::vector<boost::shared_ptr<const bob::machine::GMMStats> >& stats_c)
+{
+  stl_input_iterator<boost::shared_ptr<bob::machine::GMMStats> > dbegin(stats), dend;
+  stats_c.assign(dbegin, dend);
+}
+
+template <typename TBase>
+static object py_base_estimateUx(const TBase& base, object stats,
+  const size_t n_threads)
+{
+  std::vector<boost::shared_ptr<const bob::machine::GMMStats> > stats_c;
+  convertGMMStatsList(stats, stats_c);
+  bob::python::ndarray ux(bob::core::array::t_float64, stats_c.size(), base.getDimCD());
+  blitz::Array<double,2> ux_ = ux.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    base.estimateUx(stats_c, ux_, n_threads);
+  }
+  return ux.self();
+}
+
+template <typename TMachine>
+static object py_fa_scoring(void (*scoring)(const std::vector<boost::shared_ptr<const TMachine> >&,
+    const std::vector<boost::shared_ptr<const bob::machine::GMMStats> >&,
+    blitz::Array<double,2>&, const size_t),
+  object models, object probes, const size_t n_threads)
+{
+  stl_input_iterator<boost::shared_ptr<TMachine> > mbegin(models), mend;
+  std::vector<boost::shared_ptr<const TMachine> > models_c(mbegin, mend);
+  std::vector<boost::shared_ptr<const bob::machine::GMMStats> > probes_c;
+  convertGMMStatsList(probes, probes_c);
+  bob::python::ndarray scores(bob::core::array::t_float64, models_c.size(), probes_c.size());
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    scoring(models_c, probes_c, scores_, n_threads);
+  }
+  return scores.self();
+}
+
+static object py_jfa_scoring(object models, object probes, const size_t n_threads)
+{
+  return py_fa_scoring<bob::machine::JFAMachine>(&bob::machine::jfaScoring, models, probes, n_threads);
+}
+
+static object py_isv_scoring(object models, object probes, const size_t n_threads)
+{
+  return py_fa_scoring<bob::machine::ISVMachine>(&bob::machine::isvScoring, models, probes, n_threads);
+}
+
 void bind_machine_jfa() 
 {
   class_<bob::machine::Machine<bob::machine::GMMStats, double>, boost::noncopyable>("MachineGMMStatsScalarBase", 
@@ -173,6 +226,7 @@ void bind_machine_jfa()
     .add_property("dim_cd", &bob::machine::JFABase::getDimCD, "The dimensionality of the supervector space")
     .add_property("dim_ru", &bob::machine::JFABase::getDimRu, "The dimensionality of the within-class variations subspace (rank of U)")
     .add_property("dim_rv", &bob::machine::JFABase::getDimRv, "The dimensionality of the between-class variations subspace (rank of V)")
+    .def("estimate_ux", &py_base_estimateUx<bob::machine::JFABase>, (arg("self"), arg("stats"), arg("n_threads")=0), "Estimates Ux (LPT assumption) for each of the given GMM statistics, and returns them as the rows of a 2D array. The statistics are processed by blocks, in parallel.")
   ;
 
   class_<bob::machine::JFAMachine, boost::shared_ptr<bob::machine::JFAMachine>, bases<bob::machine::Machine<bob::machine::GMMStats, double> > >("JFAMachine", "A JFAMachine. An attached JFABase should be provided for Joint Factor Analysis. The JFAMachine carries information about the speaker factors y and z, whereas a JFABase carries information about the matrices U, V and D.\n\nReferences:\n[1] 'Explicit Modelling of Session Variability for Speaker Verification', R. Vogt, S. Sridharan, Computer Speech & Language, 2008, vol. 22, no. 1, pp. 17-38\n[2] 'Session Variability Modelling for Face Authentication', C. McCool, R. Wallace, M. McLaren, L. El Shafey, S. Marcel, IET Biometrics, 2013", init<const boost::shared_ptr<bob::machine::JFABase> >((arg("self"), arg("jfa_base")), "Builds a new JFAMachine."))
@@ -191,6 +245,7 @@ void bind_machine_jfa()
     .add_property("__x__", make_function(&bob::machine::JFAMachine::getX, return_value_policy<copy_const_reference>()), "The latent variable x (last one computed). This is a feature provided for convenience, but this attribute is not 'part' of the machine. The session latent variable x is indeed not class-specific, but depends on the sample considered. Furthermore, it is not saved into the machine or used when comparing machines.")
     .add_property("y", make_function(&bob::machine::JFAMachine::getY, return_value_policy<copy_const_reference>()), &py_jfa_setY, "The latent variable y of this machine")
     .add_property("z", make_function(&bob::machine::JFAMachine::getZ, return_value_policy<copy_const_reference>()), &py_jfa_setZ, "The latent variable z of this machine")
+    .add_property("mean_supervector", make_function(&bob::machine::JFAMachine::getMeanSupervector, return_value_policy<copy_const_reference>()), "The mean supervector m + Vy + Dz of the client model")
     .add_property("dim_c", &bob::machine::JFAMachine::getDimC, "The number of Gaussian components")
     .add_property("dim_d", &bob::machine::JFAMachine::getDimD, "The dimensionality of the feature space")
     .add_property("dim_cd", &bob::machine::JFAMachine::getDimCD, "The dimensionality of the supervector space")
@@ -215,6 +270,7 @@ void bind_machine_jfa()
     .add_property("dim_d", &bob::machine::ISVBase::getDimD, "The dimensionality of the feature space")
     .add_property("dim_cd", &bob::machine::ISVBase::getDimCD, "The dimensionality of the supervector space")
     .add_property("dim_ru", &bob::machine::ISVBase::getDimRu, "The dimensionality of the within-class variations subspace (rank of U)")
+    .def("estimate_ux", &py_base_estimateUx<bob::machine::ISVBase>, (arg("self"), arg("stats"), arg("n_threads")=0), "Estimates Ux (LPT assumption) for each of the given GMM statistics, and returns them as the rows of a 2D array. The statistics are processed by blocks, in parallel.")
   ;
 
   class_<bob::machine::ISVMachine, boost::shared_ptr<bob::machine::ISVMachine>, bases<bob::machine::Machine<bob::machine::GMMStats, double> > >("ISVMachine", "An ISVMachine. An attached ISVBase should be provided for Inter-session Variability Modelling. The ISVMachine carries information about the speaker factors z, whereas a ISVBase carries information about the matrices U and D. \n\nReferences:\n[1] 'Explicit Modelling of Session Variability for Speaker Verification', R. Vogt, S. Sridharan, Computer Speech & Language, 2008, vol. 22, no. 1, pp. 17-38\n[2] 'Session Variability Modelling for Face Authentication', C. McCool, R. Wallace, M. McLaren, L. El Shafey, S. Marcel, IET Biometrics, 2013", init<const boost::shared_ptr<bob::machine::ISVBase> >((arg("self"), arg("isv_base")), "Builds a new ISVMachine."))
@@ -232,9 +288,13 @@ void bind_machine_jfa()
     .add_property("isv_base", &bob::machine::ISVMachine::getISVBase, &bob::machine::ISVMachine::setISVBase, "The ISVBase attached to this machine")
     .add_property("__x__", make_function(&bob::machine::ISVMachine::getX, return_value_policy<copy_const_reference>()), "The latent variable x (last one computed). This is a feature provided for convenience, but this attribute is not 'part' of the machine. The session latent variable x is indeed not class-specific, but depends on the sample considered. Furthermore, it is not saved into the machine or used when comparing machines.")
     .add_property("z", make_function(&bob::machine::ISVMachine::getZ, return_value_policy<copy_const_reference>()), &py_isv_setZ, "The latent variable z of this machine")
+    .add_property("mean_supervector", make_function(&bob::machine::ISVMachine::getMeanSupervector, return_value_policy<copy_const_reference>()), "The mean supervector m + Dz of the client model")
     .add_property("dim_c", &bob::machine::ISVMachine::getDimC, "The number of Gaussian components")
     .add_property("dim_d", &bob::machine::ISVMachine::getDimD, "The dimensionality of the feature space")
     .add_property("dim_cd", &bob::machine::ISVMachine::getDimCD, "The dimensionality of the supervector space")
     .add_property("dim_ru", &bob::machine::ISVMachine::getDimRu, "The dimensionality of the within-class variations subspace (rank of U)")
   ;
+
+  def("jfa_scoring", &py_jfa_scoring, (arg("models"), arg("probes"), arg("n_threads")=0), "Computes the scores of several JFA models (sharing the same JFABase) against several probes (GMM statistics), and returns them as a 2D array, scores[m,p] being the score of model m against probe p. The session offset Ux of each probe is estimated once, and shared by all the models.");
+  def("isv_scoring", &py_isv_scoring, (arg("models"), arg("probes"), arg("n_threads")=0), "Computes the scores of several ISV models (sharing the same ISVBase) against several probes (GMM statistics), and returns them as a 2D array, scores[m,p] being the score of model m against probe p. The session offset Ux of each probe is estimated once, and shared by all the models.");
 }
@@ -10,6 +10,7 @@
 #include <bob/machine/KMeansMachine.h>
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 
 using namespace boost::python;
 
@@ -70,6 +71,23 @@ static tuple py_getClosestMean(const bob::machine::KMeansMachine& machine, bob::
   return boost::python::make_tuple(closest_mean, min_distance);
 }
 
+static tuple py_getClosestMeans(const bob::machine::KMeansMachine& machine, bob::python::const_ndarray X, const size_t n_threads)
+{
+  const blitz::Array<double,2> X_ = X.bz<double,2>();
+  const int n_samples = X_.extent(0);
+  blitz::Array<size_t,1> closest_means(n_samples);
+  bob::python::ndarray min_distances(bob::core::array::t_float64, n_samples);
+  blitz::Array<double,1> min_distances_ = min_distances.bz<double,1>();
+  {
+    bob::python::no_gil unlock;
+    machine.getClosestMeans(X_, closest_means, min_distances_, n_threads);
+  }
+  bob::python::ndarray indices(bob::core::array::t_uint64, n_samples);
+  blitz::Array<uint64_t,1> indices_ = indices.bz<uint64_t,1>();
+  indices_ = blitz::cast<uint64_t>(closest_means);
+  return boost::python::make_tuple(indices.self(), min_distances.self());
+}
+
 static double py_getMinDistance(const bob::machine::KMeansMachine& machine, bob::python::const_ndarray input)
 {
   return machine.getMinDistance(input.bz<double,1>());
@@ -103,6 +121,8 @@ void bind_machine_kmeans()
         "Return the power of two of the square Euclidean distance of the sample, x, to the i'th mean")
     .def("get_closest_mean", &py_getClosestMean, (arg("self"), arg("x")),
         "Calculate the index of the mean that is closest (in terms of square Euclidean distance) to the data sample, x")
+    .def("get_closest_means", &py_getClosestMeans, (arg("self"), arg("data"), arg("n_threads")=0),
+        "Calculate, for each data sample (row of data), the index of the mean that is closest (in terms of square Euclidean distance) and the distance from this mean. Returns a tuple with the two arrays (indices, distances). The computation uses one matrix product per block of samples and is distributed over n_threads threads (0 means as many threads as hardware threads).")
     .def("get_min_distance", &py_getMinDistance, (arg("self"), arg("input")),
         "Output the minimum square Euclidean distance between the input and one of the means")
     .def("get_variances_and_weights_for_each_cluster", &py_getVariancesAndWeightsForEachCluster, (arg("self"), arg("data")),
@@ -9,6 +9,7 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <bob/machine/LinearMachine.h>
 
 using namespace boost::python;
@@ -31,11 +32,9 @@ static object forward(const bob::machine::LinearMachine& m,
         bob::python::ndarray output(bob::core::array::t_float64, info.shape[0], m.outputSize());
         blitz::Array<double,2> input_ = input.bz<double,2>();
         blitz::Array<double,2> output_ = output.bz<double,2>();
-        blitz::Range all = blitz::Range::all();
-        for (size_t k=0; k<info.shape[0]; ++k) {
-          blitz::Array<double,1> i_ = input_(k,all);
-          blitz::Array<double,1> o_ = output_(k,all);
-          m.forward(i_, o_);
+        {
+          bob::python::no_gil unlock;
+          m.forward(input_, output_);
         }
         return output.self();
       }
@@ -59,12 +58,15 @@ static void forward2(const bob::machine::LinearMachine& m,
     case 2:
       {
         blitz::Array<double,2> input_ = input.bz<double,2>();
-        blitz::Array<double,2> output_ = output.bz<double,2>();
-        blitz::Range all = blitz::Range::all();
-        for (size_t k=0; k<info.shape[0]; ++k) {
-          blitz::Array<double,1> i_ = input_(k,all);
-          blitz::Array<double,1> o_ = output_(k,all);
-          m.forward(i_, o_);
+        if (output.type().dtype == bob::core::array::t_float32) {
+          blitz::Array<float,2> output_ = output.bz<float,2>();
+          bob::python::no_gil unlock;
+          m.forward(input_, output_);
+        }
+        else {
+          blitz::Array<double,2> output_ = output.bz<double,2>();
+          bob::python::no_gil unlock;
+          m.forward(input_, output_);
         }
       }
       break;
@@ -177,8 +179,8 @@ void bind_machine_linear() {
     .add_property("activation", &bob::machine::LinearMachine::getActivation, &bob::machine::LinearMachine::setActivation, "The activation function - by default, the identity function. The output provided by the activation function is passed, unchanged, to the user.")
     .add_property("shape", &get_shape, &set_shape, "A tuple that represents the size of the input vector followed by the size of the output vector in the format ``(input, output)``.")
     .def("resize", &bob::machine::LinearMachine::resize, (arg("self"), arg("input"), arg("output")), "Resizes the machine. If either the input or output increases in size, the weights and other factors should be considered uninitialized. If the size is preserved or reduced, already initialized values will not be changed.\n\nTip: Use this method to force data compression. All will work out given most relevant factors to be preserved are organized on the top of the weight matrix. In this way, reducing the system size will supress less relevant projections.")
-    .def("__call__", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output")
-    .def("forward", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output")
+    .def("__call__", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output. If the input is 2D, each row is projected at once using a matrix-matrix product, and the output may be a 2D float32 array.")
+    .def("forward", &forward2, (arg("self"), arg("input"), arg("output")), "Projects the input to the weights and biases and saves results on the output. If the input is 2D, each row is projected at once using a matrix-matrix product, and the output may be a 2D float32 array.")
     .def("__call__", &forward, (arg("self"), arg("input")), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one.")
     .def("forward", &forward, (arg("self"), arg("input")), "Projects the input to the weights and biases and returns the output. This method implies in copying out the output data and is, therefore, less efficient as its counterpart that sets the output given as parameter. If you have to do a tight loop, consider using that variant instead of this one.")
     ;
@@ -7,6 +7,7 @@
  */
 #include <boost/python.hpp>
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <boost/shared_ptr.hpp>
 #include <bob/machine/LinearScoring.h>
 #include <boost/python/stl_iterator.hpp>
@@ -46,7 +47,7 @@ static void convertGMMMachineList(object models, std::vector<boost::shared_ptr<c
 static object linearScoring1(object models,
     bob::python::const_ndarray ubm_mean, bob::python::const_ndarray ubm_variance,
     object test_stats, object test_channelOffset = list(), // Empty list
-    bool frame_length_normalisation = false) 
+    bool frame_length_normalisation = false, const size_t n_threads = 0)
 {
   blitz::Array<double,1> ubm_mean_ = ubm_mean.bz<double,1>();
   blitz::Array<double,1> ubm_variance_ = ubm_variance.bz<double,1>();
@@ -60,12 +61,14 @@ static object linearScoring1(object models,
   bob::python::ndarray ret(bob::core::array::t_float64, models_c.size(), test_stats_c.size());
   blitz::Array<double,2> ret_ = ret.bz<double,2>();
   if (test_channelOffset.ptr() == Py_None || len(test_channelOffset) == 0) { //list is empty
-    bob::machine::linearScoring(models_c, ubm_mean_, ubm_variance_, test_stats_c, frame_length_normalisation, ret_);
+    bob::python::no_gil unlock;
+    bob::machine::linearScoring(models_c, ubm_mean_, ubm_variance_, test_stats_c, frame_length_normalisation, ret_, n_threads);
   }
   else { 
     std::vector<blitz::Array<double,1> > test_channelOffset_c;
     convertChannelOffsetList(test_channelOffset, test_channelOffset_c);
-    bob::machine::linearScoring(models_c, ubm_mean_, ubm_variance_, test_stats_c, test_channelOffset_c, frame_length_normalisation, ret_);
+    bob::python::no_gil unlock;
+    bob::machine::linearScoring(models_c, ubm_mean_, ubm_variance_, test_stats_c, test_channelOffset_c, frame_length_normalisation, ret_, n_threads);
   }
  
   return ret.self();
@@ -74,7 +77,7 @@ static object linearScoring1(object models,
 static object linearScoring2(object models,
     bob::machine::GMMMachine& ubm,
     object test_stats, object test_channelOffset = list(), // Empty list
-    bool frame_length_normalisation = false) 
+    bool frame_length_normalisation = false, const size_t n_threads = 0)
 {
   std::vector<boost::shared_ptr<const bob::machine::GMMMachine> > models_c;
   convertGMMMachineList(models, models_c);
@@ -85,17 +88,59 @@ static object linearScoring2(object models,
   bob::python::ndarray ret(bob::core::array::t_float64, models_c.size(), test_stats_c.size());
   blitz::Array<double,2> ret_ = ret.bz<double,2>();
   if (test_channelOffset.ptr() == Py_None || len(test_channelOffset) == 0) { //list is empty
-    bob::machine::linearScoring(models_c, ubm, test_stats_c, frame_length_normalisation, ret_);
+    bob::python::no_gil unlock;
+    bob::machine::linearScoring(models_c, ubm, test_stats_c, frame_length_normalisation, ret_, n_threads);
   }
   else { 
     std::vector<blitz::Array<double,1> > test_channelOffset_c;
     convertChannelOffsetList(test_channelOffset, test_channelOffset_c);
-    bob::machine::linearScoring(models_c, ubm, test_stats_c, test_channelOffset_c, frame_length_normalisation, ret_);
+    bob::python::no_gil unlock;
+    bob::machine::linearScoring(models_c, ubm, test_stats_c, test_channelOffset_c, frame_length_normalisation, ret_, n_threads);
   }
   
   return ret.self();
 }
 
+static boost::shared_ptr<bob::machine::LinearScorer> linearScorer1(object models,
+  bob::python::const_ndarray ubm_mean, bob::python::const_ndarray ubm_variance)
+{
+  std::vector<blitz::Array<double,1> > models_c;
+  convertGMMMeanList(models, models_c);
+  return boost::shared_ptr<bob::machine::LinearScorer>(new bob::machine::LinearScorer(models_c,
+    ubm_mean.bz<double,1>(), ubm_variance.bz<double,1>()));
+}
+
+static boost::shared_ptr<bob::machine::LinearScorer> linearScorer2(object models,
+  const bob::machine::GMMMachine& ubm)
+{
+  std::vector<boost::shared_ptr<const bob::machine::GMMMachine> > models_c;
+  convertGMMMachineList(models, models_c);
+  return boost::shared_ptr<bob::machine::LinearScorer>(new bob::machine::LinearScorer(models_c, ubm));
+}
+
+static object linearScorerScore(const bob::machine::LinearScorer& scorer,
+    object test_stats, object test_channelOffset = list(), // Empty list
+    bool frame_length_normalisation = false, const size_t n_threads = 0)
+{
+  std::vector<boost::shared_ptr<const bob::machine::GMMStats> > test_stats_c;
+  convertGMMStatsList(test_stats, test_stats_c);
+
+  bob::python::ndarray ret(bob::core::array::t_float64, scorer.getNModels(), test_stats_c.size());
+  blitz::Array<double,2> ret_ = ret.bz<double,2>();
+  if (test_channelOffset.ptr() == Py_None || len(test_channelOffset) == 0) { //list is empty
+    bob::python::no_gil unlock;
+    scorer.score(test_stats_c, frame_length_normalisation, ret_, n_threads);
+  }
+  else {
+    std::vector<blitz::Array<double,1> > test_channelOffset_c;
+    convertChannelOffsetList(test_channelOffset, test_channelOffset_c);
+    bob::python::no_gil unlock;
+    scorer.score(test_stats_c, test_channelOffset_c, frame_length_normalisation, ret_, n_threads);
+  }
+
+  return ret.self();
+}
+
 static double linearScoring3(bob::python::const_ndarray model,
   bob::python::const_ndarray ubm_mean, bob::python::const_ndarray ubm_var,
   const bob::machine::GMMStats& test_stats, bob::python::const_ndarray test_channelOffset,
@@ -105,12 +150,13 @@ static double linearScoring3(bob::python::const_ndarray model,
           ubm_var.bz<double,1>(), test_stats, test_channelOffset.bz<double,1>(), frame_length_normalisation);
 }
 
-BOOST_PYTHON_FUNCTION_OVERLOADS(linearScoring1_overloads, linearScoring1, 4, 6)
-BOOST_PYTHON_FUNCTION_OVERLOADS(linearScoring2_overloads, linearScoring2, 3, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(linearScoring1_overloads, linearScoring1, 4, 7)
+BOOST_PYTHON_FUNCTION_OVERLOADS(linearScoring2_overloads, linearScoring2, 3, 6)
+BOOST_PYTHON_FUNCTION_OVERLOADS(linearScorerScore_overloads, linearScorerScore, 2, 5)
 BOOST_PYTHON_FUNCTION_OVERLOADS(linearScoring3_overloads, linearScoring3, 5, 6)
 
 void bind_machine_linear_scoring() {
-  def("linear_scoring", linearScoring1, linearScoring1_overloads(args("models", "ubm_mean", "ubm_variance", "test_stats", "test_channelOffset", "frame_length_normalisation"),
+  def("linear_scoring", linearScoring1, linearScoring1_overloads(args("models", "ubm_mean", "ubm_variance", "test_stats", "test_channelOffset", "frame_length_normalisation", "n_threads"),
     "Compute a matrix of scores using linear scoring.\n"
     "Return a 2D matrix of scores, scores[m, s] is the score for model m against statistics s\n"
     "\n"
@@ -122,8 +168,9 @@ void bind_machine_linear_scoring() {
     "test_stats   -- list of accumulate statistics for each test trial\n"
     "test_channelOffset -- \n"
     "frame_length_normlisation -- perform a normalisation by the number of feature vectors\n"
+    "n_threads    -- number of threads to use (0 for the number of hardware threads)\n"
     ));
-  def("linear_scoring", linearScoring2, linearScoring2_overloads(args("models", "ubm", "test_stats", "test_channel_offset", "frame_length_normalisation"),
+  def("linear_scoring", linearScoring2, linearScoring2_overloads(args("models", "ubm", "test_stats", "test_channel_offset", "frame_length_normalisation", "n_threads"),
     "Compute a matrix of scores using linear scoring.\n"
     "Return a 2D matrix of scores, scores[m, s] is the score for model m against statistics s\n"
     "\n"
@@ -134,6 +181,7 @@ void bind_machine_linear_scoring() {
     "test_stats  -- list of accumulate statistics for each test trial\n"
     "test_channel_offset -- \n"
     "frame_length_normlisation -- perform a normalisation by the number of feature vectors\n"
+    "n_threads   -- number of threads to use (0 for the number of hardware threads)\n"
     ));
   def("linear_scoring", linearScoring3, linearScoring3_overloads(args("model", "ubm_mean", "ubm_variance", "test_stats", "test_channelOffset", "frame_length_normalisation"),
     "Compute a score using linear scoring.\n"
@@ -145,4 +193,22 @@ void bind_machine_linear_scoring() {
     "test_channelOffset -- \n"
     "frame_length_normlisation -- perform a normalisation by the number of feature vectors\n"
     ));
+
+  class_<bob::machine::LinearScorer, boost::shared_ptr<bob::machine::LinearScorer> >("LinearScorer",
+      "Linear scoring of many test statistics against a fixed set of client models.\n"
+      "\n"
+      "The model-side matrix, whose rows are (model - ubm_mean) / ubm_variance, is computed once at construction time, and reused by each call. The scores are computed by tiles, which are processed in parallel, so that the memory required does not depend on the number of test statistics.", no_init)
+    .def("__init__", make_constructor(&linearScorer1, default_call_policies(), (arg("models"), arg("ubm_mean"), arg("ubm_variance"))), "Builds a scorer from the list of mean supervectors of the client models, and the mean and variance supervectors of the world model.")
+    .def("__init__", make_constructor(&linearScorer2, default_call_policies(), (arg("models"), arg("ubm"))), "Builds a scorer from the list of client models and the world model.")
+    .add_property("n_models", &bob::machine::LinearScorer::getNModels, "The number of client models")
+    .add_property("supervector_length", &bob::machine::LinearScorer::getSupervectorLength, "The length of the supervectors")
+    .def("__call__", linearScorerScore, linearScorerScore_overloads((arg("self"), arg("test_stats"), arg("test_channel_offset"), arg("frame_length_normalisation"), arg("n_threads")),
+      "Computes a 2D matrix of scores, scores[m, s] being the score for model m against statistics s.\n"
+      "\n"
+      "test_stats  -- list of accumulate statistics for each test trial\n"
+      "test_channel_offset -- list of channel offsets for each test trial, if any\n"
+      "frame_length_normlisation -- perform a normalisation by the number of feature vectors\n"
+      "n_threads   -- number of threads to use (0 for the number of hardware threads)\n"
+      ))
+    ;
 }
@@ -14,6 +14,7 @@
 
 void bind_machine_base();
 void bind_machine_bic();
+void bind_machine_flatfile();
 void bind_machine_gabor();
 void bind_machine_gaussian();
 void bind_machine_gmm();
@@ -40,6 +41,7 @@ BOOST_PYTHON_MODULE(_machine) {
 
   bind_machine_base();
   bind_machine_bic();
+  bind_machine_flatfile();
   bind_machine_gabor();
   bind_machine_gaussian();
   bind_machine_gmm();
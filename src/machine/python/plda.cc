@@ -10,11 +10,28 @@
 
 #include <bob/python/ndarray.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/python/stl_iterator.hpp>
 #include <bob/python/exception.h>
+#include <bob/python/gil.h>
 #include <bob/machine/PLDAMachine.h>
+#include <vector>
 
 using namespace boost::python;
 
+static void py_plda_save_flat(const bob::machine::PLDABase& machine,
+  const std::string& filename)
+{
+  bob::machine::FlatFileWriter config(filename, "PLDABase");
+  machine.save(config);
+  config.close();
+}
+
+static void py_plda_load_flat(bob::machine::PLDABase& machine,
+  const std::string& filename)
+{
+  machine.load(boost::shared_ptr<const bob::machine::FlatFile>(new bob::machine::FlatFile(filename)));
+}
+
 static void py_set_dim_d(bob::machine::PLDABase& machine, const size_t dim_d)
 {
   machine.resize(dim_d, machine.getDimF(), machine.getDimG());
@@ -100,7 +117,24 @@ static double py_log_likelihood_point_estimate(bob::machine::PLDABase& plda,
            hi.bz<double,1>(), wij.bz<double,1>());
 }
 
+static object py_plda_scoring(object machines,
+  bob::python::const_ndarray probes, const size_t n_threads=0)
+{
+  stl_input_iterator<boost::shared_ptr<bob::machine::PLDAMachine> > dbegin(machines), dend;
+  std::vector<boost::shared_ptr<const bob::machine::PLDAMachine> > machines_c(dbegin, dend);
+  const blitz::Array<double,2> probes_ = probes.bz<double,2>();
+
+  bob::python::ndarray scores(bob::core::array::t_float64, probes_.extent(0), machines_c.size());
+  blitz::Array<double,2> scores_ = scores.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    bob::machine::pldaScoring(machines_c, probes_, scores_, n_threads);
+  }
+  return scores.self();
+}
+
 BOOST_PYTHON_FUNCTION_OVERLOADS(computeLogLikelihood_overloads, computeLogLikelihood, 2, 3)
+BOOST_PYTHON_FUNCTION_OVERLOADS(py_plda_scoring_overloads, py_plda_scoring, 2, 3)
 
 void bind_machine_plda()
 {
@@ -111,8 +145,10 @@ void bind_machine_plda()
     .def(self == self)
     .def(self != self)
     .def("is_similar_to", &bob::machine::PLDABase::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this PLDABase with the 'other' one to be approximately the same.")
-    .def("load", &bob::machine::PLDABase::load, (arg("self"), arg("config")), "Loads the configuration parameters from a configuration file.")
-    .def("save", &bob::machine::PLDABase::save, (arg("self"), arg("config")), "Saves the configuration parameters to a configuration file.")
+    .def("load", (void (bob::machine::PLDABase::*)(bob::io::HDF5File&))&bob::machine::PLDABase::load, (arg("self"), arg("config")), "Loads the configuration parameters from a configuration file.")
+    .def("save", (void (bob::machine::PLDABase::*)(bob::io::HDF5File&) const)&bob::machine::PLDABase::save, (arg("self"), arg("config")), "Saves the configuration parameters to a configuration file.")
+    .def("load_flat", &py_plda_load_flat, (arg("self"), arg("filename")), "Loads the configuration parameters from a flat binary file (see save_flat()). The file is mapped in memory, and its pages are shared with the other processes that load it.")
+    .def("save_flat", &py_plda_save_flat, (arg("self"), arg("filename")), "Saves the configuration parameters (and precomputed values) to a flat binary file, which can be memory-mapped.")
     .add_property("dim_d", &bob::machine::PLDABase::getDimD, &py_set_dim_d, "Dimensionality of the input feature vectors")
     .add_property("dim_f", &bob::machine::PLDABase::getDimF, &py_set_dim_f, "Dimensionality of the F subspace/matrix of the PLDA model")
     .add_property("dim_g", &bob::machine::PLDABase::getDimG, &py_set_dim_g, "Dimensionality of the G subspace/matrix of the PLDA model")
@@ -174,4 +210,6 @@ void bind_machine_plda()
     .def("__call__", &plda_forward_sample, (arg("self"), arg("sample")), "Processes a sample and returns a log-likelihood ratio score.")
     .def("forward", &plda_forward_sample, (arg("self"), arg("sample")), "Processes a sample and returns a log-likelihood ratio score.")
   ;
+
+  def("plda_scoring", &py_plda_scoring, py_plda_scoring_overloads((arg("machines"), arg("probes"), arg("n_threads")=0), "Computes the log-likelihood ratio scores of many probes (2D array, one sample per row) against many enrolled PLDAMachine's sharing the same PLDABase, and returns the 2D array of scores, scores[p,m] being the score of probe p against machine m. The score matrix is computed using matrix-matrix products on blocks of probes, processed by n_threads threads (0 means the number of hardware threads). The caches of the machines are not modified."));
 }
@@ -9,6 +9,7 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <bob/machine/SVM.h>
 
 using namespace boost::python;
@@ -28,17 +29,18 @@ static object predict_class_(const bob::machine::SupportVector& m,
 }
 
 static object predict_class_n(const bob::machine::SupportVector& m,
-    bob::python::const_ndarray input) {
+    bob::python::const_ndarray input, const size_t n_threads) {
   blitz::Array<double,2> i_ = input.bz<double,2>();
   if ((size_t)i_.extent(1) < m.inputSize()) {
     PYTHON_ERROR(RuntimeError, "Input array should have **at least** " SIZE_T_FMT " columns, but you have given me one with %d instead", m.inputSize(), i_.extent(1));
   }
-  blitz::Range all = blitz::Range::all();
-  list retval;
-  for (int k=0; k<i_.extent(0); ++k) {
-    blitz::Array<double,1> tmp = i_(k,all);
-    retval.append(m.predictClass_(tmp));
+  blitz::Array<int,1> labels(i_.extent(0));
+  {
+    bob::python::no_gil unlock;
+    m.predictClass_(i_, labels, n_threads);
   }
+  list retval;
+  for (int k=0; k<labels.extent(0); ++k) retval.append(labels(k));
   return tuple(retval);
 }
 
@@ -48,7 +50,7 @@ static object svm_call(const bob::machine::SupportVector& m,
     case 1:
       return predict_class(m, input);
     case 2:
-      return predict_class_n(m, input);
+      return predict_class_n(m, input, 0);
     default:
       PYTHON_ERROR(RuntimeError, "Input array should be 1D or 2D. You passed an array with " SIZE_T_FMT " dimensions instead", input.type().nd);
   }
@@ -76,19 +78,25 @@ static tuple predict_class_and_scores2(const bob::machine::SupportVector& m,
 }
 
 static object predict_class_and_scores_n(const bob::machine::SupportVector& m,
-    bob::python::const_ndarray input) {
+    bob::python::const_ndarray input, const size_t n_threads) {
   blitz::Array<double,2> i_ = input.bz<double,2>();
   if ((size_t)i_.extent(1) < m.inputSize()) {
     PYTHON_ERROR(RuntimeError, "Input array should have **at least** " SIZE_T_FMT " columns, but you have given me one with %d instead", m.inputSize(), i_.extent(1));
   }
   size_t size = m.outputSize() < 2 ? 1 : (m.outputSize()*(m.outputSize()-1))/2;
+  blitz::Array<int,1> labels(i_.extent(0));
+  blitz::Array<double,2> scores_(i_.extent(0), size);
+  {
+    bob::python::no_gil unlock;
+    m.predictClassAndScores_(i_, labels, scores_, n_threads);
+  }
   blitz::Range all = blitz::Range::all();
   list classes, scores;
   for (int k=0; k<i_.extent(0); ++k) {
-    blitz::Array<double,1> tmp = i_(k,all);
     bob::python::ndarray s(bob::core::array::t_float64, size);
     blitz::Array<double,1> s_ = s.bz<double,1>();
-    classes.append(m.predictClassAndScores_(tmp, s_));
+    s_ = scores_(k,all);
+    classes.append(labels(k));
     scores.append(s.self());
   }
   return make_tuple(tuple(classes), tuple(scores));
@@ -115,7 +123,7 @@ static tuple predict_class_and_probs2(const bob::machine::SupportVector& m,
 }
 
 static object predict_class_and_probs_n(const bob::machine::SupportVector& m,
-    bob::python::const_ndarray input) {
+    bob::python::const_ndarray input, const size_t n_threads) {
   blitz::Array<double,2> i_ = input.bz<double,2>();
   if ((size_t)i_.extent(1) < m.inputSize()) {
     PYTHON_ERROR(RuntimeError, "Input array should have **at least** " SIZE_T_FMT " columns, but you have given me one with %d instead", m.inputSize(), i_.extent(1));
@@ -123,13 +131,19 @@ static object predict_class_and_probs_n(const bob::machine::SupportVector& m,
   if (!m.supportsProbability()) {
     PYTHON_ERROR(RuntimeError, "this SVM does not support probabilities");
   }
+  blitz::Array<int,1> labels(i_.extent(0));
+  blitz::Array<double,2> probs_(i_.extent(0), m.numberOfClasses());
+  {
+    bob::python::no_gil unlock;
+    m.predictClassAndProbabilities_(i_, labels, probs_, n_threads);
+  }
   blitz::Range all = blitz::Range::all();
   list classes, probs;
   for (int k=0; k<i_.extent(0); ++k) {
-    blitz::Array<double,1> tmp = i_(k,all);
     bob::python::ndarray s(bob::core::array::t_float64, m.numberOfClasses());
     blitz::Array<double,1> s_ = s.bz<double,1>();
-    classes.append(m.predictClassAndProbabilities_(tmp, s_));
+    s_ = probs_(k,all);
+    classes.append(labels(k));
     probs.append(s.self());
   }
   return make_tuple(tuple(classes), tuple(probs));
@@ -268,16 +282,16 @@ void bind_machine_svm() {
     .add_property("probability", &bob::machine::SupportVector::supportsProbability, "true if this machine supports probability outputs")
     .def("predict_class", &predict_class, (arg("self"), arg("input")), "Returns the predicted class given a certain input. Checks the input data for size conformity. If the size is wrong, an exception is raised.")
     .def("predict_class_", &predict_class_, (arg("self"), arg("input")), "Returns the predicted class given a certain input. Does not check the input data and is, therefore, a little bit faster.")
-    .def("predict_classes", &predict_class_n, (arg("self"), arg("input")), "Returns the predicted class given a certain input. Checks the input data for size conformity. If the size is wrong, an exception is raised. This variant accepts as input a 2D array with samples arranged in lines. The array can have as many lines as you want, but the number of columns should match the expected machine input size.")
+    .def("predict_classes", &predict_class_n, (arg("self"), arg("input"), arg("n_threads")=0), "Returns the predicted class given a certain input. Checks the input data for size conformity. If the size is wrong, an exception is raised. This variant accepts as input a 2D array with samples arranged in lines. The array can have as many lines as you want, but the number of columns should match the expected machine input size. The samples are processed by ``n_threads`` threads (0 means as many as hardware threads). For LINEAR kernels, the support vectors are collapsed into one weight vector per decision function, so that the predictions only match the ones of :py:meth:`predict_class` up to rounding errors.")
     .def("__call__", &svm_call, (arg("self"), arg("input")), "Returns the predicted class(es) given a certain input. Checks the input data for size conformity. If the size is wrong, an exception is raised. The input may be either a 1D or a 2D numpy ndarray object of double-precision floating-point numbers. If the array is 1D, a single answer is returned (the class of the input vector). If the array is 2D, then the number of columns in such array must match the input size. In this case, the SupportVector object will return 1 prediction for every row at the input array.")
     .def("predict_class_and_scores", &predict_class_and_scores2, (arg("self"), arg("input")), "Returns the predicted class and output scores as a tuple, in this order. Checks the input and output arrays for size conformity. In particular, the size of the output array should be, if ``o`` is the number of classes the machine can treat, :math:`o*(o-1)/2`. The order, as the ``libsvm`` README points out, is label[0] vs label[1], ..., label[0] vs. label[o-1], label[1] vs. label[2], ... label[o-2] vs label[o-1]. Note that when :math:`o = 1`, this function does not give any decision value. If the size is wrong, an exception is raised.")
     .def("predict_class_and_scores", &predict_class_and_scores, (arg("self"), arg("input"), arg("scores")), "Returns the predicted class given a certain input. Returns the scores for each class in the second argument. Checks the input and output arrays for size conformity. In particular, the size of the output array should be, if ``o`` is the number of classes the machine can treat, :math:`o*(o-1)/2`. The order, as the ``libsvm`` README points out, is label[0] vs label[1], ..., label[0] vs. label[o-1], label[1] vs. label[2], ... label[o-2] vs label[o-1]. Note that when :math:`o = 1`, this function does not give any decision value. If the size is wrong, an exception is raised.")
     .def("predict_class_and_scores_", &predict_class_and_scores_, (arg("self"), arg("input"), arg("scores")), "Returns the predicted class given a certain input. Returns the scores for each class in the second argument. Checks the input and output arrays for size conformity. Does not check the input data and is, therefore, a little bit faster.")
-    .def("predict_classes_and_scores", &predict_class_and_scores_n, (arg("self"), arg("input")), "Returns the predicted class and output scores as a tuple, in this order. Checks the input array for size conformity. In particular, the size of the output array should be, if ``o`` is the number of classes the machine can treat, :math:`o*(o-1)/2`. The order, as the ``libsvm`` README points out, is label[0] vs label[1], ..., label[0] vs. label[o-1], label[1] vs. label[2], ... label[o-2] vs label[o-1]. Note that when :math:`o = 1`, this function does not give any decision value. If the size is wrong, an exception is raised. This variant takes a single 2D double array as input. The samples should be organized row-wise.")
+    .def("predict_classes_and_scores", &predict_class_and_scores_n, (arg("self"), arg("input"), arg("n_threads")=0), "Returns the predicted class and output scores as a tuple, in this order. Checks the input array for size conformity. In particular, the size of the output array should be, if ``o`` is the number of classes the machine can treat, :math:`o*(o-1)/2`. The order, as the ``libsvm`` README points out, is label[0] vs label[1], ..., label[0] vs. label[o-1], label[1] vs. label[2], ... label[o-2] vs label[o-1]. Note that when :math:`o = 1`, this function does not give any decision value. If the size is wrong, an exception is raised. This variant takes a single 2D double array as input. The samples should be organized row-wise, and are processed by ``n_threads`` threads (0 means as many as hardware threads).")
     .def("predict_class_and_probabilities", &predict_class_and_probs2, (arg("self"), arg("input")), "Returns the predicted class and probabilities in a tuple (on that order) given a certain input. The current machine has to support probabilities, otherwise an exception is raised. Checks the input array for size conformity. If the size is wrong, an exception is raised.")
     .def("predict_class_and_probabilities", &predict_class_and_probs, (arg("self"), arg("input"), arg("probabilities")), "Returns the predicted class given a certain input. If the model supports it, returns the probabilities for each class in the second argument, otherwise raises an exception. Checks the input and output arrays for size conformity. If the size is wrong, an exception is raised.")
     .def("predict_class_and_probabilities_", &predict_class_and_probs_, (arg("self"), arg("input"), arg("probabilities")), "Returns the predicted class given a certain input. This version will not run any checks, so you must be sure to pass the correct input to the classifier.")
-    .def("predict_classes_and_probabilities", &predict_class_and_probs_n, (arg("self"), arg("input")), "Returns the predicted class and output probabilities for each possible class as a tuple, in this order. Checks the input array for size conformity. If the size is wrong, an exception is raised. This variant takes a single 2D double array as input. The samples should be organized row-wise.")
+    .def("predict_classes_and_probabilities", &predict_class_and_probs_n, (arg("self"), arg("input"), arg("n_threads")=0), "Returns the predicted class and output probabilities for each possible class as a tuple, in this order. Checks the input array for size conformity. If the size is wrong, an exception is raised. This variant takes a single 2D double array as input. The samples should be organized row-wise, and are processed by ``n_threads`` threads (0 means as many as hardware threads).")
     .def("save", (void (bob::machine::SupportVector::*)(const std::string&) const)&bob::machine::SupportVector::save, (arg("self"), arg("filename")), "Saves the currently loaded model to an output file. Overwrites the file, if necessary")
     .def("save", (void (bob::machine::SupportVector::*)(bob::io::HDF5File&) const)&bob::machine::SupportVector::save, (arg("self"), arg("config")), "Saves the whole machine into a configuration file. This allows for a single instruction parameter loading, which includes both the model and the scaling parameters.")
     ;
@@ -10,6 +10,7 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 
 #include <boost/python.hpp>
 #include <bob/machine/ZTNorm.h>
@@ -116,8 +117,89 @@ static object znorm(
   return ret.self();
 }
 
+static void py_appendZStatistics(bob::machine::ZTNorm& ztnorm,
+  bob::python::const_ndarray rawscores_zprobes_vs_models, const size_t n_threads=0)
+{
+  const blitz::Array<double,2> B = rawscores_zprobes_vs_models.bz<double,2>();
+  bob::python::no_gil unlock;
+  ztnorm.appendZStatistics(B, n_threads);
+}
+
+static void py_setTModelsStatistics(bob::machine::ZTNorm& ztnorm,
+  bob::python::const_ndarray rawscores_zprobes_vs_tmodels,
+  object mask_zprobes_vs_tmodels_istruetrial=object(), const size_t n_threads=0)
+{
+  const blitz::Array<double,2> D = rawscores_zprobes_vs_tmodels.bz<double,2>();
+  if (mask_zprobes_vs_tmodels_istruetrial.ptr() == Py_None) {
+    bob::python::no_gil unlock;
+    ztnorm.setTModelsStatistics(D, n_threads);
+  }
+  else {
+    const blitz::Array<bool,2> mask = extract<bob::python::const_ndarray>(mask_zprobes_vs_tmodels_istruetrial)().bz<bool,2>();
+    bob::python::no_gil unlock;
+    ztnorm.setTModelsStatistics(D, mask, n_threads);
+  }
+}
+
+static void py_appendTStatistics(bob::machine::ZTNorm& ztnorm,
+  bob::python::const_ndarray rawscores_probes_vs_tmodels, const size_t n_threads=0)
+{
+  const blitz::Array<double,2> C = rawscores_probes_vs_tmodels.bz<double,2>();
+  bob::python::no_gil unlock;
+  ztnorm.appendTStatistics(C, n_threads);
+}
+
+static object py_normalize(const bob::machine::ZTNorm& ztnorm,
+  bob::python::const_ndarray rawscores_probes_vs_models,
+  const size_t first_model=0, const size_t first_probe=0,
+  const size_t n_threads=0)
+{
+  const blitz::Array<double,2> A = rawscores_probes_vs_models.bz<double,2>();
+  bob::python::ndarray ret(bob::core::array::t_float64, A.extent(0), A.extent(1));
+  blitz::Array<double,2> ret_ = ret.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    ztnorm.normalize(A, ret_, first_model, first_probe, n_threads);
+  }
+  return ret.self();
+}
+
+static void py_normalize_file(const bob::machine::ZTNorm& ztnorm,
+  bob::io::HDF5File& rawscores_file, const std::string& rawscores_path,
+  bob::io::HDF5File& normalized_file, const std::string& normalized_path,
+  const size_t block_size=256, const size_t n_threads=0)
+{
+  ztnorm.normalize(rawscores_file, rawscores_path, normalized_file,
+    normalized_path, block_size, n_threads);
+}
+
+BOOST_PYTHON_FUNCTION_OVERLOADS(py_appendZStatistics_overloads, py_appendZStatistics, 2, 3)
+BOOST_PYTHON_FUNCTION_OVERLOADS(py_setTModelsStatistics_overloads, py_setTModelsStatistics, 2, 4)
+BOOST_PYTHON_FUNCTION_OVERLOADS(py_appendTStatistics_overloads, py_appendTStatistics, 2, 3)
+BOOST_PYTHON_FUNCTION_OVERLOADS(py_normalize_overloads, py_normalize, 2, 5)
+BOOST_PYTHON_FUNCTION_OVERLOADS(py_normalize_file_overloads, py_normalize_file, 5, 7)
+
 void bind_machine_ztnorm() 
 {
+  class_<bob::machine::ZTNorm, boost::shared_ptr<bob::machine::ZTNorm> >("ZTNorm",
+      "ZT-Norm engine based on sufficient statistics.\n"
+      "\n"
+      "The Z-Norm statistics (mean and standard deviation of the scores of each model against the Z-Norm probes) and the T-Norm statistics (mean and standard deviation of the Z-normalised scores of each probe against the T-Norm models) are computed once, from blocks of raw scores which are appended one after the other. The raw scores are then normalised by tiles, in parallel, which allows to normalise score matrices stored in HDF5 files which do not fit in memory.\n"
+      "\n"
+      "If no Z-Norm (resp. T-Norm) statistics are appended, Z-Norm (resp. T-Norm) is not applied.",
+      init<>((arg("self"))))
+    .def("reset", &bob::machine::ZTNorm::reset, (arg("self")), "Removes all the statistics")
+    .def("append_z_statistics", &py_appendZStatistics, py_appendZStatistics_overloads((arg("self"), arg("rawscores_zprobes_vs_models"), arg("n_threads")), "Computes and appends the Z-Norm statistics of the next models (rows of the given raw scores against all the Z-Norm probes)"))
+    .def("set_tmodels_statistics", &py_setTModelsStatistics, py_setTModelsStatistics_overloads((arg("self"), arg("rawscores_zprobes_vs_tmodels"), arg("mask_zprobes_vs_tmodels_istruetrial"), arg("n_threads")), "Computes the statistics of the T-Norm models against the Z-Norm probes (excluding the true trials of the mask, if any), which are used to Z-normalise the T-Norm scores. This clears the T-Norm statistics computed so far."))
+    .def("append_t_statistics", &py_appendTStatistics, py_appendTStatistics_overloads((arg("self"), arg("rawscores_probes_vs_tmodels"), arg("n_threads")), "Computes and appends the T-Norm statistics of the next probes (columns of the given raw scores of all the T-Norm models)"))
+    .add_property("z_means", make_function(&bob::machine::ZTNorm::getZMeans, return_value_policy<copy_const_reference>()), "The Z-Norm means of the models")
+    .add_property("z_stds", make_function(&bob::machine::ZTNorm::getZStds, return_value_policy<copy_const_reference>()), "The Z-Norm standard deviations of the models")
+    .add_property("t_means", make_function(&bob::machine::ZTNorm::getTMeans, return_value_policy<copy_const_reference>()), "The T-Norm means of the probes")
+    .add_property("t_stds", make_function(&bob::machine::ZTNorm::getTStds, return_value_policy<copy_const_reference>()), "The T-Norm standard deviations of the probes")
+    .def("normalize", &py_normalize, py_normalize_overloads((arg("self"), arg("rawscores_probes_vs_models"), arg("first_model"), arg("first_probe"), arg("n_threads")), "Normalises a tile of raw scores, starting at the given model (row) and probe (column), and returns the normalised scores"))
+    .def("normalize_file", &py_normalize_file, py_normalize_file_overloads((arg("self"), arg("rawscores_file"), arg("rawscores_path"), arg("normalized_file"), arg("normalized_path"), arg("block_size"), arg("n_threads")), "Normalises the raw scores stored in a dataset of an HDF5 file (a 2D array, or a list of 1D arrays, one per model), by blocks of models, and appends the normalised scores of each model to a dataset of another HDF5 file"))
+    ;
+
   def("ztnorm",
       ztnorm1,
       args("rawscores_probes_vs_models",
@@ -0,0 +1,165 @@
+/**
+ * @file math/cxx/gemm.cc
+ * @date Mon Oct 19 02:16:10 2026 +0000
+ * @author agent <agent@local>
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <bob/math/gemm.h>
+#include <bob/core/assert.h>
+#include <bob/core/array_copy.h>
+#include <algorithm>
+
+// Declaration of the external BLAS functions
+// General matrix-matrix multiplication (dgemm)
+extern "C" void dgemm_( const char *transa, const char *transb, const int *M,
+  const int *N, const int *K, const double *alpha, const double *A,
+  const int *lda, const double *B, const int *ldb, const double *beta,
+  double *C, const int *ldc);
+// General matrix-vector multiplication (dgemv)
+extern "C" void dgemv_( const char *trans, const int *M, const int *N,
+  const double *alpha, const double *A, const int *lda, const double *x,
+  const int *incx, const double *beta, double *y, const int *incy);
+
+/**
+ * @brief Returns a pointer to a row-major storage of the matrix A (or of its
+ * transpose, in which case trans is flipped), as well as the corresponding
+ * leading dimension. A is copied into tmp if its strides are not supported
+ * by BLAS.
+ */
+static const double* blasMatrix(const blitz::Array<double,2>& A, bool& trans,
+  int& ld, blitz::Array<double,2>& tmp)
+{
+  if (A.stride(1) == 1 && A.stride(0) >= std::max(1, A.extent(1))) {
+    ld = A.stride(0);
+    return A.data();
+  }
+  if (A.stride(0) == 1 && A.stride(1) >= std::max(1, A.extent(0))) {
+    // A is the transpose of a row-major matrix
+    ld = A.stride(1);
+    trans = !trans;
+    return A.data();
+  }
+  tmp.reference(bob::core::array::ccopy(A));
+  ld = std::max(1, A.extent(1));
+  return tmp.data();
+}
+
+void bob::math::gemm(const blitz::Array<double,2>& A,
+  const blitz::Array<double,2>& B, blitz::Array<double,2>& C,
+  const bool transA, const bool transB, const double alpha, const double beta)
+{
+  // Check inputs
+  bob::core::array::assertZeroBase(A);
+  bob::core::array::assertZeroBase(B);
+  bob::core::array::assertSameDimensionLength(A.extent(transA?0:1),
+    B.extent(transB?1:0));
+
+  // Check output
+  bob::core::array::assertZeroBase(C);
+  bob::core::array::assertSameDimensionLength(A.extent(transA?1:0), C.extent(0));
+  bob::core::array::assertSameDimensionLength(B.extent(transB?0:1), C.extent(1));
+
+  bob::math::gemm_(A, B, C, transA, transB, alpha, beta);
+}
+
+void bob::math::gemm_(const blitz::Array<double,2>& A,
+  const blitz::Array<double,2>& B, blitz::Array<double,2>& C,
+  const bool transA, const bool transB, const double alpha, const double beta)
+{
+  // Defines dimensionality variables
+  const int M = C.extent(0);
+  const int N = C.extent(1);
+  const int K = A.extent(transA?0:1);
+  if (M == 0 || N == 0) return;
+  if (K == 0) {
+    if (beta == 0.) C = 0.;
+    else C *= beta;
+    return;
+  }
+
+  // Row-major storage: C^T = op(B)^T op(A)^T is computed by the column-major
+  // BLAS function, which avoids any transposition of the data.
+  bool tA = transA, tB = transB;
+  int lda, ldb;
+  blitz::Array<double,2> A_tmp, B_tmp;
+  const double* A_blas = blasMatrix(A, tA, lda, A_tmp);
+  const double* B_blas = blasMatrix(B, tB, ldb, B_tmp);
+
+  // Tries to use C directly
+  bool C_direct_use = (C.stride(1) == 1 && C.stride(0) >= N);
+  blitz::Array<double,2> C_blas;
+  if (C_direct_use)
+    C_blas.reference(C);
+  else if (beta != 0.)
+    C_blas.reference(bob::core::array::ccopy(C));
+  else
+    C_blas.resize(M, N);
+  const int ldc = C_blas.stride(0);
+
+  const char transa = (tB ? 'T' : 'N');
+  const char transb = (tA ? 'T' : 'N');
+  dgemm_( &transa, &transb, &N, &M, &K, &alpha, B_blas, &ldb, A_blas, &lda,
+    &beta, C_blas.data(), &ldc);
+
+  // Copy result back to C if required
+  if (!C_direct_use)
+    C = C_blas;
+}
+
+void bob::math::gemv(const blitz::Array<double,2>& A,
+  const blitz::Array<double,1>& x, blitz::Array<double,1>& y,
+  const bool transA, const double alpha, const double beta)
+{
+  // Check inputs
+  bob::core::array::assertZeroBase(A);
+  bob::core::array::assertZeroBase(x);
+  bob::core::array::assertSameDimensionLength(A.extent(transA?0:1), x.extent(0));
+
+  // Check output
+  bob::core::array::assertZeroBase(y);
+  bob::core::array::assertSameDimensionLength(A.extent(transA?1:0), y.extent(0));
+
+  bob::math::gemv_(A, x, y, transA, alpha, beta);
+}
+
+void bob::math::gemv_(const blitz::Array<double,2>& A,
+  const blitz::Array<double,1>& x, blitz::Array<double,1>& y,
+  const bool transA, const double alpha, const double beta)
+{
+  if (y.extent(0) == 0) return;
+  if (x.extent(0) == 0) {
+    if (beta == 0.) y = 0.;
+    else y *= beta;
+    return;
+  }
+
+  bool tA = transA;
+  int lda;
+  blitz::Array<double,2> A_tmp;
+  const double* A_blas = blasMatrix(A, tA, lda, A_tmp);
+  // Dimensions of the row-major matrix pointed by A_blas
+  const int rows = (tA == transA ? A.extent(0) : A.extent(1));
+  const int cols = (tA == transA ? A.extent(1) : A.extent(0));
+
+  // Vectors with non-positive strides are copied
+  blitz::Array<double,1> x_blas;
+  if (x.stride(0) > 0) x_blas.reference(x);
+  else x_blas.reference(bob::core::array::ccopy(x));
+  const int incx = x_blas.stride(0);
+  bool y_direct_use = (y.stride(0) > 0);
+  blitz::Array<double,1> y_blas;
+  if (y_direct_use) y_blas.reference(y);
+  else y_blas.reference(bob::core::array::ccopy(y));
+  const int incy = y_blas.stride(0);
+
+  // The column-major BLAS function sees the transpose of the row-major matrix
+  const char trans = (tA ? 'N' : 'T');
+  dgemv_( &trans, &cols, &rows, &alpha, A_blas, &lda, x_blas.data(), &incx,
+    &beta, y_blas.data(), &incy);
+
+  // Copy result back to y if required
+  if (!y_direct_use)
+    y = y_blas;
+}
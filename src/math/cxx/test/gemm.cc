@@ -0,0 +1,130 @@
+/**
+ * @file math/cxx/test/gemm.cc
+ * @date Mon Oct 19 02:16:10 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Test the BLAS-based matrix-matrix and matrix-vector products
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE math-gemm Tests
+#define BOOST_TEST_MAIN
+#include <boost/test/unit_test.hpp>
+#include <bob/math/gemm.h>
+#include <bob/core/array_copy.h>
+
+
+struct T {
+  blitz::Array<double,2> A_24, A_43, A_23, At_42, Bt_34;
+  blitz::Array<double,1> b_4, b_2;
+  double eps;
+
+  T(): A_24(2,4), A_43(4,3), A_23(2,3), b_4(4), b_2(2), eps(1e-10)
+  {
+    A_24 = 1., 2., 3., 4., 5., 6., 7., 8.;
+    A_43 = 12., 11., 10., 9., 8., 7., 6., 5., 4., 3., 2., 1.;
+    A_23 = 60., 50., 40., 180., 154., 128.;
+    At_42.reference(bob::core::array::ccopy(A_24.transpose(1,0)));
+    Bt_34.reference(bob::core::array::ccopy(A_43.transpose(1,0)));
+
+    b_4 = 4., 3., 2., 1.;
+    b_2 = 20., 60.;
+  }
+
+  ~T() {}
+};
+
+template<typename T, typename U, int d>  
+void check_dimensions( blitz::Array<T,d>& t1, blitz::Array<U,d>& t2) 
+{
+  BOOST_REQUIRE_EQUAL(t1.dimensions(), t2.dimensions());
+  for( int i=0; i<t1.dimensions(); ++i)
+    BOOST_CHECK_EQUAL(t1.extent(i), t2.extent(i));
+}
+
+template<typename T>  
+void checkBlitzClose( blitz::Array<T,1>& t1, blitz::Array<T,1>& t2, 
+  const double eps )
+{
+  check_dimensions( t1, t2);
+  for( int i=0; i<t1.extent(0); ++i)
+    BOOST_CHECK_SMALL( fabs( t2(i)-t1(i) ), eps);
+}
+
+template<typename T>  
+void checkBlitzClose( blitz::Array<T,2>& t1, blitz::Array<T,2>& t2, 
+  const double eps )
+{
+  check_dimensions( t1, t2);
+  for( int i=0; i<t1.extent(0); ++i)
+    for( int j=0; j<t1.extent(1); ++j)
+      BOOST_CHECK_SMALL( fabs( t2(i,j)-t1(i,j) ), eps);
+}
+
+BOOST_FIXTURE_TEST_SUITE( test_setup, T )
+
+BOOST_AUTO_TEST_CASE( test_gemm )
+{
+  blitz::Array<double,2> sol(2,3);
+
+  bob::math::gemm(A_24, A_43, sol);
+  checkBlitzClose(A_23, sol, eps);
+
+  sol = 0.;
+  bob::math::gemm(At_42, A_43, sol, true, false);
+  checkBlitzClose(A_23, sol, eps);
+
+  sol = 0.;
+  bob::math::gemm(A_24, Bt_34, sol, false, true);
+  checkBlitzClose(A_23, sol, eps);
+
+  sol = 0.;
+  bob::math::gemm(At_42, Bt_34, sol, true, true);
+  checkBlitzClose(A_23, sol, eps);
+}
+
+BOOST_AUTO_TEST_CASE( test_gemm_views )
+{
+  // Transposed views are passed to BLAS without copy
+  blitz::Array<double,2> sol(2,3);
+  bob::math::gemm(At_42.transpose(1,0), Bt_34.transpose(1,0), sol);
+  checkBlitzClose(A_23, sol, eps);
+
+  // Non-contiguous output
+  blitz::Array<double,2> out(2,6);
+  out = 0.;
+  blitz::Array<double,2> sol2 = out(blitz::Range::all(), blitz::Range(0,4,2));
+  bob::math::gemm(A_24, A_43, sol2);
+  checkBlitzClose(A_23, sol2, eps);
+  for (int i=0; i<2; ++i)
+    for (int j=1; j<6; j+=2)
+      BOOST_CHECK_EQUAL(out(i,j), 0.);
+}
+
+BOOST_AUTO_TEST_CASE( test_gemm_alpha_beta )
+{
+  blitz::Array<double,2> sol(2,3);
+  sol = A_23;
+  bob::math::gemm(A_24, A_43, sol, false, false, 2., -1.);
+  checkBlitzClose(A_23, sol, eps);
+}
+
+BOOST_AUTO_TEST_CASE( test_gemv )
+{
+  blitz::Array<double,1> sol(2);
+
+  bob::math::gemv(A_24, b_4, sol);
+  checkBlitzClose(b_2, sol, eps);
+
+  sol = 0.;
+  bob::math::gemv(At_42, b_4, sol, true);
+  checkBlitzClose(b_2, sol, eps);
+
+  sol = 0.;
+  bob::math::gemv(At_42.transpose(1,0), b_4, sol);
+  checkBlitzClose(b_2, sol, eps);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
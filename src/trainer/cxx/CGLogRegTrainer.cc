@@ -7,9 +7,306 @@
  */
 
 #include <bob/trainer/CGLogRegTrainer.h>
-#include <bob/math/linear.h>
+#include <bob/core/assert.h>
 #include <bob/core/logging.h>
+#include <bob/core/parallel.h>
+#include <bob/lbfgs/lbfgs.h>
 #include <limits>
+#include <cmath>
+
+namespace {
+
+  /**
+   * Number of samples of the blocks processed by a single thread. The
+   * partial results of the blocks are reduced in order, such that the
+   * results do not depend on the number of threads.
+   */
+  static const size_t LOGREG_BLOCK_SIZE = 4096;
+
+  /**
+   * The training samples of both classes, read from the original arrays.
+   * Sample i is x_i = y_i [(s_i - mean) / std_dev; 1], with y_i = +1 for the
+   * positives (which come first) and y_i = -1 for the negatives.
+   */
+  struct LogRegSamples {
+    const double* m_data[2]; ///< first sample of the positives/negatives
+    std::ptrdiff_t m_row_stride[2];
+    std::ptrdiff_t m_col_stride[2];
+    size_t m_n_samples[2];
+    size_t m_n_blocks[2];
+    const double* m_mean; ///< D means
+    const double* m_std_dev; ///< D standard deviations
+    const size_t m_n_features;
+
+    LogRegSamples(const blitz::Array<double,2>& positives,
+        const blitz::Array<double,2>& negatives, const double* mean,
+        const double* std_dev):
+      m_mean(mean), m_std_dev(std_dev), m_n_features(positives.extent(1))
+    {
+      const blitz::Array<double,2>* data[2] = {&positives, &negatives};
+      for (int c=0; c<2; ++c) {
+        m_data[c] = data[c]->data();
+        m_row_stride[c] = data[c]->stride(0);
+        m_col_stride[c] = data[c]->stride(1);
+        m_n_samples[c] = data[c]->extent(0);
+        m_n_blocks[c] = (m_n_samples[c] + LOGREG_BLOCK_SIZE - 1) / LOGREG_BLOCK_SIZE;
+      }
+    }
+
+    size_t nSamples() const { return m_n_samples[0] + m_n_samples[1]; }
+    size_t nBlocks() const { return m_n_blocks[0] + m_n_blocks[1]; }
+
+    /**
+     * The samples of a block: class (0 for the positives), index of the first
+     * sample (among all the samples) and number of samples
+     */
+    void block(const size_t b, int& c, size_t& first, size_t& n) const
+    {
+      c = (b < m_n_blocks[0]) ? 0 : 1;
+      const size_t begin = (b - (c ? m_n_blocks[0] : 0)) * LOGREG_BLOCK_SIZE;
+      n = std::min(m_n_samples[c] - begin, LOGREG_BLOCK_SIZE);
+      first = (c ? m_n_samples[0] : 0) + begin;
+    }
+
+    /**
+     * The raw value of a feature of a sample of the given class
+     */
+    double value(const int c, const size_t i, const size_t d) const
+    {
+      return m_data[c][i * m_row_stride[c] + d * m_col_stride[c]];
+    }
+
+    /**
+     * Normalizes the features of a sample of the given class
+     */
+    void normalize(const int c, const size_t i, double* z) const
+    {
+      const double* s = m_data[c] + i * m_row_stride[c];
+      for (size_t d=0; d<m_n_features; ++d)
+        z[d] = (s[d * m_col_stride[c]] - m_mean[d]) / m_std_dev[d];
+    }
+  };
+
+  /**
+   * Computes the sums of the features and of their squares over a block
+   */
+  struct LogRegMomentsBlock {
+    const LogRegSamples& m_samples;
+    double* m_partial; ///< n_blocks x 2D partial sums
+
+    LogRegMomentsBlock(const LogRegSamples& samples, double* partial):
+      m_samples(samples), m_partial(partial)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t b) const
+    {
+      int c;
+      size_t first, n;
+      m_samples.block(b, c, first, n);
+      const size_t D = m_samples.m_n_features;
+      const size_t begin = first - (c ? m_samples.m_n_samples[0] : 0);
+      double* sum = m_partial + b * 2 * D;
+      double* sum2 = sum + D;
+      std::fill(sum, sum + 2 * D, 0.);
+      for (size_t i=begin; i<begin+n; ++i) {
+        for (size_t d=0; d<D; ++d) {
+          const double v = m_samples.value(c, i, d);
+          sum[d] += v;
+          sum2[d] += v * v;
+        }
+      }
+    }
+  };
+
+  /**
+   * The numerically stable log(1 + exp(a))
+   */
+  inline double softplus(const double a)
+  {
+    return a > 0. ? a + std::log1p(std::exp(-a)) : std::log1p(std::exp(a));
+  }
+
+  /**
+   * Computes, over a block, the gradient of the weighted log-likelihood
+   * sum_i weight_i s1_i x_i, where s1_i = 1 / (1 + exp(m_i)) and
+   * m_i = w^T x_i + y_i logit, the weighted curvatures
+   * h_i = weight_i s1_i (1 - s1_i), and optionally the weighted negative
+   * log-likelihood sum_i weight_i log(1 + exp(-m_i)).
+   */
+  struct LogRegGradientBlock {
+    const LogRegSamples& m_samples;
+    const double* m_w; ///< D+1 weights (the bias being the last one)
+    const double m_logit;
+    const double m_weight_pos; ///< weight of the positives
+    const double m_weight_neg; ///< weight of the negatives
+    double* m_partial; ///< n_blocks x (D+2) gradients and objectives
+    double* m_h; ///< N curvatures
+    std::vector<std::vector<double> >& m_z; ///< per thread buffers
+    const bool m_objective;
+
+    LogRegGradientBlock(const LogRegSamples& samples, const double* w,
+        const double logit, const double weight_pos, const double weight_neg,
+        double* partial, double* h, std::vector<std::vector<double> >& z,
+        const bool objective):
+      m_samples(samples), m_w(w), m_logit(logit), m_weight_pos(weight_pos),
+      m_weight_neg(weight_neg), m_partial(partial), m_h(h), m_z(z),
+      m_objective(objective)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t b) const
+    {
+      int c;
+      size_t first, n;
+      m_samples.block(b, c, first, n);
+      const size_t D = m_samples.m_n_features;
+      const size_t begin = first - (c ? m_samples.m_n_samples[0] : 0);
+      const double y = c ? -1. : 1.;
+      const double weight = c ? m_weight_neg : m_weight_pos;
+      double* z = &m_z[ith][0];
+      double* g = m_partial + b * (D + 2);
+      std::fill(g, g + D + 2, 0.);
+      double f = 0.;
+      for (size_t k=0; k<n; ++k) {
+        m_samples.normalize(c, begin + k, z);
+        double m = m_w[D];
+        for (size_t d=0; d<D; ++d) m += m_w[d] * z[d];
+        m = y * (m + m_logit);
+        const double s1 = 1. / (1. + std::exp(m));
+        const double t = y * weight * s1;
+        for (size_t d=0; d<D; ++d) g[d] += t * z[d];
+        g[D] += t;
+        m_h[first + k] = weight * s1 * (1. - s1);
+        if (m_objective) f += weight * softplus(-m);
+      }
+      g[D+1] = f;
+    }
+  };
+
+  /**
+   * Computes, over a block, the curvature sum_i h_i (u^T x_i)^2 of the
+   * weighted log-likelihood along a direction u
+   */
+  struct LogRegCurvatureBlock {
+    const LogRegSamples& m_samples;
+    const double* m_u; ///< D+1 direction
+    const double* m_h; ///< N curvatures
+    double* m_partial; ///< n_blocks partial sums
+
+    LogRegCurvatureBlock(const LogRegSamples& samples, const double* u,
+        const double* h, double* partial):
+      m_samples(samples), m_u(u), m_h(h), m_partial(partial)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t b) const
+    {
+      int c;
+      size_t first, n;
+      m_samples.block(b, c, first, n);
+      const size_t D = m_samples.m_n_features;
+      const size_t begin = first - (c ? m_samples.m_n_samples[0] : 0);
+      double acc = 0.;
+      for (size_t k=0; k<n; ++k) {
+        const double* s = m_samples.m_data[c] + (begin + k) * m_samples.m_row_stride[c];
+        double ux = m_u[D];
+        for (size_t d=0; d<D; ++d)
+          ux += m_u[d] * (s[d * m_samples.m_col_stride[c]] - m_samples.m_mean[d]) / m_samples.m_std_dev[d];
+        acc += ux * ux * m_h[first + k];
+      }
+      m_partial[b] = acc;
+    }
+  };
+
+  /**
+   * The weighted logistic regression problem, whose gradient and curvature
+   * are computed by blocks of samples
+   */
+  struct LogRegProblem {
+    const LogRegSamples& samples;
+    const double logit;
+    const double weight_pos;
+    const double weight_neg;
+    const double lambda;
+    const size_t n_threads;
+    std::vector<double> partial; ///< per block results
+    std::vector<std::vector<double> > z; ///< per thread buffers
+    blitz::Array<double,1> h; ///< curvatures of the samples
+
+    LogRegProblem(const LogRegSamples& samples_, const double prior,
+        const double lambda_, const size_t n_threads_):
+      samples(samples_),
+      logit(std::log(prior / (1. - prior))),
+      weight_pos(prior * samples_.nSamples() / samples_.m_n_samples[0]),
+      weight_neg((1. - prior) * samples_.nSamples() / samples_.m_n_samples[1]),
+      lambda(lambda_),
+      n_threads(n_threads_),
+      partial(samples_.nBlocks() * (samples_.m_n_features + 2)),
+      z(bob::core::thread_count(samples_.nBlocks(), n_threads_),
+        std::vector<double>(std::max(samples_.m_n_features, (size_t)1))),
+      h(samples_.nSamples())
+    {
+    }
+
+    /**
+     * Computes the (regularized) gradient g of the log-likelihood at w, the
+     * curvatures of the samples, and returns the (non-regularized) negative
+     * log-likelihood if required (0 otherwise)
+     */
+    double gradient(const blitz::Array<double,1>& w, blitz::Array<double,1>& g,
+        const bool objective)
+    {
+      const size_t D = samples.m_n_features;
+      const size_t n_blocks = samples.nBlocks();
+      bob::core::thread_blocks(LogRegGradientBlock(samples, w.data(), logit,
+        weight_pos, weight_neg, &partial[0], h.data(), z, objective),
+        n_blocks, n_threads);
+      g = 0.;
+      double f = 0.;
+      for (size_t b=0; b<n_blocks; ++b) {
+        const double* p = &partial[b * (D + 2)];
+        for (size_t d=0; d<=D; ++d) g((int)d) += p[d];
+        f += p[D+1];
+      }
+      g -= lambda * w; // Regularization
+      return f;
+    }
+
+    /**
+     * Computes u^T H u, where H is the Hessian of the negative
+     * log-likelihood at the last point where the gradient was computed
+     */
+    double curvature(const blitz::Array<double,1>& u)
+    {
+      const size_t n_blocks = samples.nBlocks();
+      bob::core::thread_blocks(LogRegCurvatureBlock(samples, u.data(),
+        h.data(), &partial[0]), n_blocks, n_threads);
+      double uhu = 0.;
+      for (size_t b=0; b<n_blocks; ++b) uhu += partial[b];
+      return uhu + lambda * blitz::sum(blitz::pow2(u));
+    }
+  };
+
+  /**
+   * The objective minimized by L-BFGS, i.e. the regularized negative
+   * log-likelihood, divided by the number of samples for the convergence
+   * test not to depend on it
+   */
+  lbfgsfloatval_t logRegEvaluate(void* instance, const lbfgsfloatval_t* x,
+    lbfgsfloatval_t* g, const int n, const lbfgsfloatval_t step)
+  {
+    LogRegProblem& problem = *static_cast<LogRegProblem*>(instance);
+    const blitz::Array<double,1> w(const_cast<double*>(x), blitz::shape(n),
+      blitz::neverDeleteData);
+    blitz::Array<double,1> gradient(g, blitz::shape(n), blitz::neverDeleteData);
+    const double f = problem.gradient(w, gradient, true);
+    const double scale = 1. / problem.samples.nSamples();
+    gradient *= -scale;
+    return scale * (f + 0.5 * problem.lambda * blitz::sum(blitz::pow2(w)));
+  }
+
+}
 
 bob::trainer::CGLogRegTrainer::CGLogRegTrainer(const double prior,
   const double convergence_threshold, const size_t max_iterations,
@@ -18,7 +315,9 @@ bob::trainer::CGLogRegTrainer::CGLogRegTrainer(const double prior,
     m_convergence_threshold(convergence_threshold),
     m_max_iterations(max_iterations),
     m_lambda(lambda),
-    m_mean_std_norm(mean_std_norm)
+    m_mean_std_norm(mean_std_norm),
+    m_solver(CONJUGATE_GRADIENT),
+    m_n_threads(0)
 {
   if(prior<=0. || prior>=1.)
   {
@@ -33,7 +332,9 @@ bob::trainer::CGLogRegTrainer::CGLogRegTrainer(const bob::trainer::CGLogRegTrain
   m_convergence_threshold(other.m_convergence_threshold),
   m_max_iterations(other.m_max_iterations),
   m_lambda(other.m_lambda),
-  m_mean_std_norm(other.m_mean_std_norm)
+  m_mean_std_norm(other.m_mean_std_norm),
+  m_solver(other.m_solver),
+  m_n_threads(other.m_n_threads)
 {
 }
 
@@ -49,6 +350,8 @@ bob::trainer::CGLogRegTrainer& bob::trainer::CGLogRegTrainer::operator=
     m_max_iterations = other.m_max_iterations;
     m_lambda = other.m_lambda;
     m_mean_std_norm = other.m_mean_std_norm;
+    m_solver = other.m_solver;
+    m_n_threads = other.m_n_threads;
   }
   return *this;
 }
@@ -60,7 +363,8 @@ bob::trainer::CGLogRegTrainer::operator==(const bob::trainer::CGLogRegTrainer& b
           this->m_convergence_threshold == b.m_convergence_threshold &&
           this->m_max_iterations == b.m_max_iterations &&
           this->m_lambda == b.m_lambda &&
-          this->m_mean_std_norm == b.m_mean_std_norm);
+          this->m_mean_std_norm == b.m_mean_std_norm &&
+          this->m_solver == b.m_solver);
 }
 
 bool
@@ -84,137 +388,134 @@ void bob::trainer::CGLogRegTrainer::train(bob::machine::LinearMachine& machine,
   // Defines useful ranges
   blitz::Range rall = blitz::Range::all();
   blitz::Range rd = blitz::Range(0,n_features-1);
-  blitz::Range r1 = blitz::Range(0,n_samples1-1);
-  blitz::Range r2 = blitz::Range(n_samples1,n_samples-1);
-
-  // indices for blitz iterations
-  blitz::firstIndex i;
-  blitz::secondIndex j;
 
+  // The samples are read from the original arrays, and normalized on the fly
   blitz::Array<double,1> mean(n_features);
   blitz::Array<double,1> std_dev(n_features);
+  mean = 0.;
+  std_dev = 1.;
+  const LogRegSamples samples(positives, negatives, mean.data(), std_dev.data());
+
   // mean and variance of the training data
   if (m_mean_std_norm){
-    // collect all samples in one matrix
-    blitz::Array<double,2> all_data(n_samples,n_features);
-    for(size_t i=0; i<n_samples1; ++i)
-      all_data(i,rall) = positives(i,rall);
-    for(size_t i=0; i<n_samples2; ++i)
-      all_data(i+n_samples1, rall) = negatives(i,rall);
-
     // compute mean and std-dev from samples
-    mean = blitz::mean(all_data(j,i), j);
-    blitz::Array<double,2> squared(blitz::pow2(all_data));
-    std_dev = blitz::sqrt((blitz::sum(squared(j,i), j) - n_samples*blitz::pow2(mean)) / n_samples);
-  } else {
-    mean = 0.;
-    std_dev = 1.;
+    const size_t n_blocks = samples.nBlocks();
+    std::vector<double> partial(n_blocks * 2 * n_features);
+    bob::core::thread_blocks(LogRegMomentsBlock(samples, &partial[0]),
+      n_blocks, m_n_threads);
+    blitz::Array<double,1> sum2(n_features);
+    sum2 = 0.;
+    for (size_t b=0; b<n_blocks; ++b)
+      for (size_t d=0; d<n_features; ++d) {
+        mean((int)d) += partial[(b * 2) * n_features + d];
+        sum2((int)d) += partial[(b * 2 + 1) * n_features + d];
+      }
+    mean /= n_samples;
+    std_dev = blitz::sqrt((sum2 - n_samples*blitz::pow2(mean)) / n_samples);
   }
 
-  // Creates a large blitz::Array containing the samples
-  // x = |positives - negatives|, of size (n_features+1,n_samples1+n_samples2)
-  //     |1.  -1. |
-  blitz::Array<double,2> x(n_features+1, n_samples);
-  x(n_features,r1) = 1.;
-  x(n_features,r2) = -1.;
-  for(size_t i=0; i<n_samples1; ++i)
-    x(rd,i) = (positives(i,rall) - mean(rall)) / std_dev(rall);
-  for(size_t i=0; i<n_samples2; ++i)
-    x(rd,i+n_samples1) = -(negatives(i,rall) - mean(rall)) / std_dev(rall);
-
-  // Ratio between the two classes and weights vector
-  double prop = (double)n_samples1 / (double)n_samples;
-  blitz::Array<double,1> weights(n_samples);
-  weights(r1) = m_prior / prop;
-  weights(r2) = (1.-m_prior) / (1.-prop);
-
-  // Initializes offset vector
-  blitz::Array<double,1> offset(n_samples);
-  const double logit = log(m_prior/(1.-m_prior));
-  offset(r1) = logit;
-  offset(r2) = -logit;
-
-  // Initializes gradient and w vectors
-  blitz::Array<double,1> g_old(n_features+1);
-  blitz::Array<double,1> w_old(n_features+1);
-  blitz::Array<double,1> g(n_features+1);
+  LogRegProblem problem(samples, m_prior, m_lambda, m_n_threads);
   blitz::Array<double,1> w(n_features+1);
-  g_old = 0.;
-  w_old = 0.;
-  g = 0.;
   w = 0.;
 
-  // Initialize working arrays
-  blitz::Array<double,1> s1(n_samples);
-  blitz::Array<double,1> u(n_features+1);
-  blitz::Array<double,1> tmp_n(n_samples);
-  blitz::Array<double,1> tmp_d(n_features+1);
+  if (m_solver == LBFGS) {
+    lbfgs_parameter_t param;
+    lbfgs_parameter_init(&param);
+    param.epsilon = m_convergence_threshold;
+    param.max_iterations = m_max_iterations;
 
-  // Iterates...
-  static const double ten_epsilon = 10*std::numeric_limits<double>::epsilon();
-  for(size_t iter=0; ; ++iter)
-  {
-    // 1. Computes the non-weighted version of the likelihood
-    // s1 = sum_{i=1}^{n}(1./(1.+exp(-y_i (w^T x_i + logit))
-    //   where - the x blitz::Array contains -y_i x_i values
-    //         - the offset blitz::Array contains -y_i logit values
-    s1 = 1. / (1. + blitz::exp(blitz::sum(w(j)*x(j,i), j) + offset));
-    // 2. Likelihood weighted by the prior/proportion
-    tmp_n = s1 * weights;
-    // 3. Gradient g of this weighted likelihood wrt. the weight vector w
-    bob::math::prod(x, tmp_n, g);
-    g -= m_lambda * w; // Regularization
-
-    // 4. Conjugate gradient step
-    if(iter == 0)
-      u = g;
-    else
+    lbfgsfloatval_t* x = lbfgs_malloc(n_features+1);
+    std::fill(x, x + n_features + 1, 0.);
+    lbfgsfloatval_t fx = 0.;
+    const int ret = lbfgs(n_features+1, x, &fx, logRegEvaluate, NULL,
+      (void*)&problem, &param);
+    std::copy(x, x + n_features + 1, w.data());
+    lbfgs_free(x);
+
+    if (ret == LBFGS_SUCCESS || ret == LBFGS_ALREADY_MINIMIZED)
+      bob::core::info << "# CGLogReg Training terminated: L-BFGS convergence." << std::endl;
+    else if (ret == LBFGSERR_MAXIMUMITERATION)
+      bob::core::info << "# CGLogReg terminated: maximum number of iterations (" << m_max_iterations << ") reached." << std::endl;
+    else if (ret == LBFGSERR_ROUNDING_ERROR || ret == LBFGSERR_MINIMUMSTEP ||
+        ret == LBFGSERR_MAXIMUMSTEP || ret == LBFGSERR_MAXIMUMLINESEARCH)
+      bob::core::info << "# CGLogReg Training terminated: the L-BFGS line search cannot progress anymore (code " << ret << ")." << std::endl;
+    else {
+      boost::format m("CGLogRegTrainer: L-BFGS optimization failed (error code %d)");
+      m % ret;
+      throw std::runtime_error(m.str());
+    }
+  }
+  else {
+    // Initializes gradient and w vectors
+    blitz::Array<double,1> g_old(n_features+1);
+    blitz::Array<double,1> w_old(n_features+1);
+    blitz::Array<double,1> g(n_features+1);
+    g_old = 0.;
+    w_old = 0.;
+    g = 0.;
+
+    // Initialize working arrays
+    blitz::Array<double,1> u(n_features+1);
+    blitz::Array<double,1> tmp_d(n_features+1);
+
+    // Iterates...
+    static const double ten_epsilon = 10*std::numeric_limits<double>::epsilon();
+    for(size_t iter=0; ; ++iter)
     {
-      tmp_d = (g-g_old);
-      double den = blitz::sum(u * tmp_d);
-      if(den == 0)
-        u = 0.;
+      // 1. Gradient g of the likelihood weighted by the prior/proportion wrt.
+      //    the weight vector w, where the non-weighted version of the
+      //    likelihood is sum_{i=1}^{n}(1./(1.+exp(-y_i (w^T x_i + logit))
+      problem.gradient(w, g, false);
+
+      // 2. Conjugate gradient step
+      if(iter == 0)
+        u = g;
       else
       {
-        // Hestenes-Stiefel formula: Heuristic to set the scale factor beta
-        //   (chosen as it works well in practice)
-        // beta = g^t(g-g_old) / (u_old^T (g - g_old))
-        double beta = blitz::sum(tmp_d * g) / den;
-        u = g - beta * u;
+        tmp_d = (g-g_old);
+        double den = blitz::sum(u * tmp_d);
+        if(den == 0)
+          u = 0.;
+        else
+        {
+          // Hestenes-Stiefel formula: Heuristic to set the scale factor beta
+          //   (chosen as it works well in practice)
+          // beta = g^t(g-g_old) / (u_old^T (g - g_old))
+          double beta = blitz::sum(tmp_d * g) / den;
+          u = g - beta * u;
+        }
       }
-    }
 
-    // 5. Line search along the direction u
-    // a. Compute ux
-    bob::math::prod(u,x,tmp_n);
-    // b. Compute u^T H u
-    //      = sum_{i} weights(i) sigmoid(w^T x_i) [1-sigmoid(w^T x_i)] (u^T x_i) + lambda u^T u
-    double uhu = blitz::sum(blitz::pow2(tmp_n) * weights * s1 * (1.-s1)) + m_lambda*blitz::sum(blitz::pow2(u));
-    // Terminates if uhu is close to zero
-    if(fabs(uhu) < ten_epsilon)
-    {
-      bob::core::info << "# CGLogReg Training terminated: convergence after " << iter << " iterations (u^T H u == 0)." << std::endl;
-      break;
-    }
-    // c. Compute w = w_old - (g^T u)/(u^T H u) u
-    w = w + blitz::sum(u*g) / uhu * u;
+      // 3. Line search along the direction u
+      // a. Compute u^T H u
+      //      = sum_{i} weights(i) sigmoid(w^T x_i) [1-sigmoid(w^T x_i)] (u^T x_i) + lambda u^T u
+      double uhu = problem.curvature(u);
+      // Terminates if uhu is close to zero
+      if(fabs(uhu) < ten_epsilon)
+      {
+        bob::core::info << "# CGLogReg Training terminated: convergence after " << iter << " iterations (u^T H u == 0)." << std::endl;
+        break;
+      }
+      // b. Compute w = w_old - (g^T u)/(u^T H u) u
+      w = w + blitz::sum(u*g) / uhu * u;
 
-    // Terminates if convergence has been reached
-    if(blitz::max(blitz::fabs(w-w_old)) <= m_convergence_threshold)
-    {
-      bob::core::info << "# CGLogReg Training terminated: convergence after " << iter << " iterations." << std::endl;
-      break;
-    }
-    // Terminates if maximum number of iterations has been reached
-    if(m_max_iterations > 0 && iter+1 >= m_max_iterations)
-    {
-      bob::core::info << "# CGLogReg terminated: maximum number of iterations (" << m_max_iterations << ") reached." << std::endl;
-      break;
-    }
+      // Terminates if convergence has been reached
+      if(blitz::max(blitz::fabs(w-w_old)) <= m_convergence_threshold)
+      {
+        bob::core::info << "# CGLogReg Training terminated: convergence after " << iter << " iterations." << std::endl;
+        break;
+      }
+      // Terminates if maximum number of iterations has been reached
+      if(m_max_iterations > 0 && iter+1 >= m_max_iterations)
+      {
+        bob::core::info << "# CGLogReg terminated: maximum number of iterations (" << m_max_iterations << ") reached." << std::endl;
+        break;
+      }
 
-    // Backup previous values
-    g_old = g;
-    w_old = w;
+      // Backup previous values
+      g_old = g;
+      w_old = w;
+    }
   }
 
   // Updates the LinearMachine
@@ -226,4 +527,3 @@ void bob::trainer::CGLogRegTrainer::train(bob::machine::LinearMachine& machine,
   w_(rall,0) = w(rd); // Weights: first D values
   machine.setBiases(w(n_features)); // Bias: D+1 value
 }
-
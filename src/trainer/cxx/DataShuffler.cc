@@ -9,13 +9,113 @@
  */
 
 #include <stdexcept>
+#include <algorithm>
 #include <sys/time.h>
 #include <boost/format.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 
 #include <bob/core/assert.h>
 #include <bob/core/array_copy.h>
+#include <bob/core/check.h>
 #include <bob/trainer/DataShuffler.h>
 
+/**
+ * Draws n samples and matching targets, picking a random sample of each
+ * class in turn, into C-contiguous buffers. The (internal) data and target
+ * arrays are C-contiguous.
+ */
+static void drawSamples(boost::mt19937& rng,
+    std::vector<boost::uniform_int<size_t> >& range,
+    const std::vector<blitz::Array<double,2> >& data,
+    const std::vector<blitz::Array<double,1> >& target,
+    const size_t n, double* data_out, double* target_out) {
+  const size_t width = data[0].extent(1);
+  const size_t target_width = target[0].extent(0);
+  size_t counter = 0;
+  while (counter < n) {
+    for (size_t i=0; i<data.size() && counter<n; ++i, ++counter) { //for all classes
+      size_t index = range[i](rng); //pick a random position within class
+      const double* sample = data[i].data() + index * width;
+      std::copy(sample, sample + width, data_out + counter * width);
+      std::copy(target[i].data(), target[i].data() + target_width,
+          target_out + counter * target_width);
+    }
+  }
+}
+
+/**
+ * State of the background thread which draws mini-batches ahead of the
+ * calls to DataShuffler::next(), into a ring of buffers
+ */
+struct bob::trainer::DataShuffler::Prefetcher {
+  size_t batch_size;
+  boost::mt19937 rng;
+  std::vector<boost::uniform_int<size_t> > range; ///< copy, used by the background thread only
+  std::vector<std::vector<double> > data; ///< ring of data buffers
+  std::vector<std::vector<double> > target; ///< ring of target buffers
+  boost::shared_ptr<boost::thread> thread;
+  boost::mutex mutex;
+  boost::condition_variable condition;
+  size_t produced; ///< number of batches drawn by the background thread
+  size_t released; ///< number of batches released by the consumer
+  size_t next; ///< index of the next batch returned by next()
+  bool stop; ///< should the background thread stop?
+  boost::exception_ptr error; ///< error raised by the background thread
+
+  Prefetcher(const size_t batch_size_, const boost::uint32_t seed,
+      const size_t n_buffers,
+      const std::vector<boost::uniform_int<size_t> >& range_,
+      const size_t width, const size_t target_width):
+    batch_size(batch_size_), rng(seed), range(range_),
+    data(n_buffers, std::vector<double>(batch_size_ * width)),
+    target(n_buffers, std::vector<double>(batch_size_ * target_width)),
+    produced(0), released(0), next(0), stop(false)
+  {}
+
+  ~Prefetcher() {
+    if (thread) {
+      {
+        boost::lock_guard<boost::mutex> lock(mutex);
+        stop = true;
+        condition.notify_all();
+      }
+      thread->join();
+    }
+  }
+
+  void produce(const std::vector<blitz::Array<double,2> >* data_in,
+      const std::vector<blitz::Array<double,1> >* target_in) {
+    try {
+      const size_t n_buffers = data.size();
+      for (size_t b=0; ; ++b) {
+        // waits for a free buffer
+        {
+          boost::unique_lock<boost::mutex> lock(mutex);
+          while (!stop && b >= released + n_buffers) condition.wait(lock);
+          if (stop) return;
+        }
+
+        // the buffers are never resized: no lock is required to fill them
+        drawSamples(rng, range, *data_in, *target_in, batch_size,
+            &data[b % n_buffers][0], &target[b % n_buffers][0]);
+
+        {
+          boost::lock_guard<boost::mutex> lock(mutex);
+          produced = b + 1;
+          condition.notify_all();
+        }
+      }
+    }
+    catch (...) {
+      boost::lock_guard<boost::mutex> lock(mutex);
+      error = boost::current_exception();
+      condition.notify_all();
+    }
+  }
+};
+
 bob::trainer::DataShuffler::DataShuffler
 (const std::vector<blitz::Array<double,2> >& data,
  const std::vector<blitz::Array<double,1> >& target):
@@ -81,6 +181,9 @@ bob::trainer::DataShuffler::~DataShuffler() { }
 
 bob::trainer::DataShuffler& bob::trainer::DataShuffler::operator=(const bob::trainer::DataShuffler& other) {
 
+  if (this == &other) return *this;
+  stopPrefetching();
+
   m_data.resize(other.m_data.size());
   m_target.resize(other.m_target.size());
 
@@ -151,6 +254,7 @@ void invertApplyStdNormParameters(std::vector<blitz::Array<double,2> >& data,
 }
 
 void bob::trainer::DataShuffler::setAutoStdNorm(bool s) {
+  stopPrefetching();
   if (s && !m_do_stdnorm) {
     evaluateStdNormParameters(m_data, m_mean, m_stddev);
     applyStdNormParameters(m_data, m_mean, m_stddev);
@@ -179,18 +283,18 @@ void bob::trainer::DataShuffler::operator() (boost::mt19937& rng,
   
   bob::core::array::assertSameDimensionLength(data.extent(0), target.extent(0));
 
-  size_t counter = 0;
-  size_t max = data.extent(0);
-  blitz::Range all = blitz::Range::all();
-  while (true) {
-    for (size_t i=0; i<m_data.size(); ++i) { //for all classes
-      size_t index = m_range[i](rng); //pick a random position within class
-      data(counter,all) = m_data[i](index,all);
-      target(counter,all) = m_target[i];
-      ++counter;
-      if (counter >= max) break;
-    }
-    if (counter >= max) break;
+  if (bob::core::array::isCZeroBaseContiguous(data) &&
+      bob::core::array::isCZeroBaseContiguous(target)) {
+    drawSamples(rng, m_range, m_data, m_target, data.extent(0), data.data(),
+        target.data());
+  }
+  else {
+    blitz::Array<double,2> data_(data.shape());
+    blitz::Array<double,2> target_(target.shape());
+    drawSamples(rng, m_range, m_data, m_target, data.extent(0), data_.data(),
+        target_.data());
+    data = data_;
+    target = target_;
   }
 
 }
@@ -202,3 +306,48 @@ void bob::trainer::DataShuffler::operator() (blitz::Array<double,2>& data,
   boost::mt19937 rng(tv.tv_sec + tv.tv_usec);
   operator()(rng, data, target); 
 }
+
+void bob::trainer::DataShuffler::startPrefetching(size_t batch_size,
+    boost::uint32_t seed, size_t n_buffers) {
+  if (batch_size == 0 || n_buffers == 0)
+    throw std::runtime_error("DataShuffler: the batch size and the number of buffers should be strictly positive");
+  stopPrefetching();
+  m_prefetcher.reset(new Prefetcher(batch_size, seed, n_buffers, m_range,
+        getDataWidth(), getTargetWidth()));
+  m_prefetcher->thread.reset(new boost::thread(boost::bind(
+          &Prefetcher::produce, m_prefetcher.get(), &m_data, &m_target)));
+}
+
+void bob::trainer::DataShuffler::stopPrefetching() {
+  m_prefetcher.reset();
+}
+
+void bob::trainer::DataShuffler::next(blitz::Array<double,2>& data,
+    blitz::Array<double,2>& target) {
+  if (!m_prefetcher)
+    throw std::runtime_error("DataShuffler: mini-batches are not drawn in the background (see startPrefetching())");
+  Prefetcher& p = *m_prefetcher;
+
+  boost::unique_lock<boost::mutex> lock(p.mutex);
+  // releases the previous batch, such that its buffer could be refilled
+  if (p.next > p.released) {
+    p.released = p.next;
+    p.condition.notify_all();
+  }
+
+  // waits for the next batch
+  while (p.produced <= p.next && !p.error) p.condition.wait(lock);
+  if (p.produced <= p.next) {
+    boost::exception_ptr error = p.error;
+    lock.unlock();
+    stopPrefetching();
+    boost::rethrow_exception(error);
+  }
+
+  const size_t b = p.next % p.data.size();
+  data.reference(blitz::Array<double,2>(&p.data[b][0],
+    blitz::shape(p.batch_size, getDataWidth()), blitz::neverDeleteData));
+  target.reference(blitz::Array<double,2>(&p.target[b][0],
+    blitz::shape(p.batch_size, getTargetWidth()), blitz::neverDeleteData));
+  ++p.next;
+}
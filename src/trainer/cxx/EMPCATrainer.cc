@@ -14,22 +14,170 @@
 #include <bob/trainer/EMPCATrainer.h>
 #include <bob/core/array_copy.h>
 #include <bob/core/array_type.h>
+#include <bob/core/assert.h>
 #include <bob/core/check.h>
+#include <bob/core/parallel.h>
+#include <bob/core/logging.h>
 #include <bob/math/linear.h>
+#include <bob/math/gemm.h>
 #include <bob/math/det.h>
 #include <bob/math/inv.h>
 #include <bob/math/stats.h>
 
+namespace {
+
+  /**
+   * Number of samples of each chunk of the E-step
+   */
+  static const size_t EMPCA_ESTEP_CHUNK_SIZE = 1024;
+
+  /**
+   * Buffers of a thread of the E-step: centered samples and latent
+   * variables of a chunk, and statistics of this chunk
+   */
+  struct EMPCAWorkspace {
+    std::vector<double> tc; ///< chunk size x n_features
+    std::vector<double> z; ///< chunk size x dimensionality
+    std::vector<double> xz; ///< n_features x dimensionality
+    std::vector<double> zz; ///< dimensionality x dimensionality
+    double sum_sq; ///< sum of the squared norms of the centered samples
+
+    EMPCAWorkspace(const size_t n_features, const size_t n_outputs):
+      tc(EMPCA_ESTEP_CHUNK_SIZE * n_features),
+      z(EMPCA_ESTEP_CHUNK_SIZE * n_outputs),
+      xz(n_features * n_outputs),
+      zz(n_outputs * n_outputs),
+      sum_sq(0.)
+    {}
+  };
+
+  /**
+   * Computes the statistics of a chunk of samples with matrix-matrix
+   * products: Z = (T - mu) (inv(M) W^T)^T, (T - mu)^T Z and Z^T Z, which are
+   * then added to the total statistics in the order of the chunks (see
+   * bob::core::thread_reduce_blocks()).
+   */
+  struct EMPCAStatsChunk {
+    const double* m_data;
+    const size_t m_n_samples;
+    const size_t m_n_features;
+    const size_t m_n_outputs;
+    const double* m_mu; ///< n_features
+    const double* m_invMWt; ///< dimensionality x n_features
+    std::vector<EMPCAWorkspace>& m_workspaces;
+    double* m_xz;
+    double* m_zz;
+    double& m_sum_sq;
+
+    EMPCAStatsChunk(const double* data, const size_t n_samples,
+        const size_t n_features, const size_t n_outputs, const double* mu,
+        const double* invMWt, std::vector<EMPCAWorkspace>& workspaces,
+        double* xz, double* zz, double& sum_sq):
+      m_data(data), m_n_samples(n_samples), m_n_features(n_features),
+      m_n_outputs(n_outputs), m_mu(mu), m_invMWt(invMWt),
+      m_workspaces(workspaces), m_xz(xz), m_zz(zz), m_sum_sq(sum_sq)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      const size_t begin = b * EMPCA_ESTEP_CHUNK_SIZE;
+      const size_t n = std::min(m_n_samples, begin + EMPCA_ESTEP_CHUNK_SIZE) - begin;
+      const size_t F = m_n_features;
+      const size_t D = m_n_outputs;
+      EMPCAWorkspace& ws = m_workspaces[ith];
+
+      // centered samples
+      ws.sum_sq = 0.;
+      for (size_t i=0; i<n; ++i) {
+        const double* t = m_data + (begin + i) * F;
+        double* tc = &ws.tc[i * F];
+        for (size_t j=0; j<F; ++j) {
+          tc[j] = t[j] - m_mu[j];
+          ws.sum_sq += tc[j] * tc[j];
+        }
+      }
+
+      const blitz::Array<double,2> Tc(&ws.tc[0], blitz::shape(n, F), blitz::neverDeleteData);
+      const blitz::Array<double,2> P(const_cast<double*>(m_invMWt),
+        blitz::shape(D, F), blitz::neverDeleteData);
+      blitz::Array<double,2> Z(&ws.z[0], blitz::shape(n, D), blitz::neverDeleteData);
+      blitz::Array<double,2> XZ(&ws.xz[0], blitz::shape(F, D), blitz::neverDeleteData);
+      blitz::Array<double,2> ZZ(&ws.zz[0], blitz::shape(D, D), blitz::neverDeleteData);
+      // E(z_i) = inv(M) W^T (t_i - mu) for all the samples of the chunk
+      bob::math::gemm_(Tc, P, Z, false, true);
+      bob::math::gemm_(Tc, Z, XZ, true, false);
+      bob::math::gemm_(Z, Z, ZZ, true, false);
+    }
+
+    void reduce(const size_t ith, const size_t b) const {
+      const EMPCAWorkspace& ws = m_workspaces[ith];
+      const size_t F = m_n_features;
+      const size_t D = m_n_outputs;
+      for (size_t k=0; k<F*D; ++k) m_xz[k] += ws.xz[k];
+      for (size_t k=0; k<D*D; ++k) m_zz[k] += ws.zz[k];
+      m_sum_sq += ws.sum_sq;
+    }
+  };
+
+  /**
+   * Accumulates the statistics of a set of samples (the whole data or a
+   * block of a sampler) into the given totals
+   */
+  void accStatistics(const blitz::Array<double,2>& data,
+    const blitz::Array<double,1>& mu, const blitz::Array<double,2>& invMWt,
+    const size_t n_threads, std::vector<EMPCAWorkspace>& workspaces,
+    blitz::Array<double,2>& xz, blitz::Array<double,2>& zz, double& sum_sq)
+  {
+    const size_t n_samples = data.extent(0);
+    const size_t n_chunks = (n_samples + EMPCA_ESTEP_CHUNK_SIZE - 1) / EMPCA_ESTEP_CHUNK_SIZE;
+    if (n_chunks == 0) return;
+
+    // raw data is accessed by the threads
+    blitz::Array<double,2> data_copy;
+    const blitz::Array<double,2>* x = &data;
+    if (!bob::core::array::isCZeroBaseContiguous(data)) {
+      data_copy.reference(bob::core::array::ccopy(data));
+      x = &data_copy;
+    }
+    const blitz::Array<double,1> mu_c = bob::core::array::ccopy(mu);
+
+    // each thread has its own buffers
+    const size_t n = bob::core::thread_count(n_chunks, n_threads);
+    while (workspaces.size() < n)
+      workspaces.push_back(EMPCAWorkspace(invMWt.extent(1), invMWt.extent(0)));
+
+    bob::core::thread_reduce_blocks(EMPCAStatsChunk(x->data(), n_samples,
+      invMWt.extent(1), invMWt.extent(0), mu_c.data(), invMWt.data(),
+      workspaces, xz.data(), zz.data(), sum_sq), n_chunks, n);
+  }
+
+  /**
+   * Performs an E-step by streaming the data of a sampler
+   */
+  struct StreamEStep {
+    bob::trainer::EMPCATrainer& m_trainer;
+    bob::machine::LinearMachine& m_machine;
+    bob::trainer::HDF5Sampler& m_sampler;
+
+    StreamEStep(bob::trainer::EMPCATrainer& trainer,
+        bob::machine::LinearMachine& machine, bob::trainer::HDF5Sampler& sampler):
+      m_trainer(trainer), m_machine(machine), m_sampler(sampler)
+    {}
+
+    void operator()() const { m_trainer.eStep(m_machine, m_sampler); }
+  };
+
+}
+
 bob::trainer::EMPCATrainer::EMPCATrainer(double convergence_threshold,
     size_t max_iterations, bool compute_likelihood):
   EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >(convergence_threshold,
     max_iterations, compute_likelihood),
   m_S(0,0),
-  m_z_first_order(0,0), m_z_second_order(0,0,0),
-  m_inW(0,0), m_invM(0,0), m_sigma2(0), m_f_log2pi(0),
-  m_tmp_dxf(0,0), m_tmp_d(0), m_tmp_f(0),
+  m_XZ(0,0), m_ZZ(0,0), m_sum_sq(0), m_n_samples(0),
+  m_inW(0,0), m_invM(0,0), m_sigma2(0), m_f_log2pi(0), m_n_threads(0),
+  m_tmp_dxf(0,0),
   m_tmp_dxd_1(0,0), m_tmp_dxd_2(0,0),
-  m_tmp_fxd_1(0,0), m_tmp_fxd_2(0,0),
+  m_tmp_fxd_1(0,0),
   m_tmp_fxf_1(0,0), m_tmp_fxf_2(0,0)
 {
 }
@@ -38,18 +186,17 @@ bob::trainer::EMPCATrainer::EMPCATrainer(const bob::trainer::EMPCATrainer& other
   EMTrainer<bob::machine::LinearMachine, blitz::Array<double,2> >(other.m_convergence_threshold,
     other.m_max_iterations, other.m_compute_likelihood),
   m_S(bob::core::array::ccopy(other.m_S)),
-  m_z_first_order(bob::core::array::ccopy(other.m_z_first_order)),
-  m_z_second_order(bob::core::array::ccopy(other.m_z_second_order)),
+  m_XZ(bob::core::array::ccopy(other.m_XZ)),
+  m_ZZ(bob::core::array::ccopy(other.m_ZZ)),
+  m_sum_sq(other.m_sum_sq), m_n_samples(other.m_n_samples),
   m_inW(bob::core::array::ccopy(other.m_inW)),
   m_invM(bob::core::array::ccopy(other.m_invM)),
   m_sigma2(other.m_sigma2), m_f_log2pi(other.m_f_log2pi),
+  m_n_threads(other.m_n_threads),
   m_tmp_dxf(bob::core::array::ccopy(other.m_tmp_dxf)),
-  m_tmp_d(bob::core::array::ccopy(other.m_tmp_d)),
-  m_tmp_f(bob::core::array::ccopy(other.m_tmp_f)),
   m_tmp_dxd_1(bob::core::array::ccopy(other.m_tmp_dxd_1)),
   m_tmp_dxd_2(bob::core::array::ccopy(other.m_tmp_dxd_2)),
   m_tmp_fxd_1(bob::core::array::ccopy(other.m_tmp_fxd_1)),
-  m_tmp_fxd_2(bob::core::array::ccopy(other.m_tmp_fxd_2)),
   m_tmp_fxf_1(bob::core::array::ccopy(other.m_tmp_fxf_1)),
   m_tmp_fxf_2(bob::core::array::ccopy(other.m_tmp_fxf_2))
 {
@@ -67,19 +214,19 @@ bob::trainer::EMPCATrainer& bob::trainer::EMPCATrainer::operator=
     bob::trainer::EMTrainer<bob::machine::LinearMachine,
       blitz::Array<double,2> >::operator=(other);
     m_S = bob::core::array::ccopy(other.m_S);
-    m_z_first_order = bob::core::array::ccopy(other.m_z_first_order);
-    m_z_second_order = bob::core::array::ccopy(other.m_z_second_order);
+    m_XZ = bob::core::array::ccopy(other.m_XZ);
+    m_ZZ = bob::core::array::ccopy(other.m_ZZ);
+    m_sum_sq = other.m_sum_sq;
+    m_n_samples = other.m_n_samples;
     m_inW = bob::core::array::ccopy(other.m_inW);
     m_invM = bob::core::array::ccopy(other.m_invM);
     m_sigma2 = other.m_sigma2;
     m_f_log2pi = other.m_f_log2pi;
+    m_n_threads = other.m_n_threads;
     m_tmp_dxf = bob::core::array::ccopy(other.m_tmp_dxf);
-    m_tmp_d = bob::core::array::ccopy(other.m_tmp_d);
-    m_tmp_f = bob::core::array::ccopy(other.m_tmp_f);
     m_tmp_dxd_1 = bob::core::array::ccopy(other.m_tmp_dxd_1);
     m_tmp_dxd_2 = bob::core::array::ccopy(other.m_tmp_dxd_2);
     m_tmp_fxd_1 = bob::core::array::ccopy(other.m_tmp_fxd_1);
-    m_tmp_fxd_2 = bob::core::array::ccopy(other.m_tmp_fxd_2);
     m_tmp_fxf_1 = bob::core::array::ccopy(other.m_tmp_fxf_1);
     m_tmp_fxf_2 = bob::core::array::ccopy(other.m_tmp_fxf_2);
   }
@@ -92,8 +239,10 @@ bool bob::trainer::EMPCATrainer::operator==
   return bob::trainer::EMTrainer<bob::machine::LinearMachine,
            blitz::Array<double,2> >::operator==(other) &&
         bob::core::array::isEqual(m_S, other.m_S) &&
-        bob::core::array::isEqual(m_z_first_order, other.m_z_first_order) &&
-        bob::core::array::isEqual(m_z_second_order, other.m_z_second_order) &&
+        bob::core::array::isEqual(m_XZ, other.m_XZ) &&
+        bob::core::array::isEqual(m_ZZ, other.m_ZZ) &&
+        m_sum_sq == other.m_sum_sq &&
+        m_n_samples == other.m_n_samples &&
         bob::core::array::isEqual(m_inW, other.m_inW) &&
         bob::core::array::isEqual(m_invM, other.m_invM) &&
         m_sigma2 == other.m_sigma2 &&
@@ -113,8 +262,10 @@ bool bob::trainer::EMPCATrainer::is_similar_to
   return bob::trainer::EMTrainer<bob::machine::LinearMachine,
            blitz::Array<double,2> >::is_similar_to(other, r_epsilon, a_epsilon) &&
         bob::core::array::isClose(m_S, other.m_S, r_epsilon, a_epsilon) &&
-        bob::core::array::isClose(m_z_first_order, other.m_z_first_order, r_epsilon, a_epsilon) &&
-        bob::core::array::isClose(m_z_second_order, other.m_z_second_order, r_epsilon, a_epsilon) &&
+        bob::core::array::isClose(m_XZ, other.m_XZ, r_epsilon, a_epsilon) &&
+        bob::core::array::isClose(m_ZZ, other.m_ZZ, r_epsilon, a_epsilon) &&
+        bob::core::isClose(m_sum_sq, other.m_sum_sq, r_epsilon, a_epsilon) &&
+        m_n_samples == other.m_n_samples &&
         bob::core::array::isClose(m_inW, other.m_inW, r_epsilon, a_epsilon) &&
         bob::core::array::isClose(m_invM, other.m_invM, r_epsilon, a_epsilon) &&
         bob::core::isClose(m_sigma2, other.m_sigma2, r_epsilon, a_epsilon) &&
@@ -125,7 +276,7 @@ void bob::trainer::EMPCATrainer::initialize(bob::machine::LinearMachine& machine
   const blitz::Array<double,2>& ar)
 {
   // reinitializes array members and checks dimensionality
-  initMembers(machine, ar);
+  initMembers(machine, ar.extent(1));
 
   // computes the mean and the covariance if required
   computeMeanVariance(machine, ar);
@@ -139,6 +290,16 @@ void bob::trainer::EMPCATrainer::initialize(bob::machine::LinearMachine& machine
   computeInvM();
 }
 
+void bob::trainer::EMPCATrainer::initialize(bob::machine::LinearMachine& machine,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  initMembers(machine, sampler.getNInputs());
+  computeMeanVariance(machine, sampler);
+  initRandomWSigma2(machine);
+  computeWtW(machine);
+  computeInvM();
+}
+
 void bob::trainer::EMPCATrainer::finalize(bob::machine::LinearMachine& machine,
   const blitz::Array<double,2>& ar)
 {
@@ -146,12 +307,8 @@ void bob::trainer::EMPCATrainer::finalize(bob::machine::LinearMachine& machine,
 
 void bob::trainer::EMPCATrainer::initMembers(
   const bob::machine::LinearMachine& machine,
-  const blitz::Array<double,2>& ar)
+  const size_t n_features)
 {
-  // Gets dimensions
-  const size_t n_samples = ar.extent(0);
-  const size_t n_features = ar.extent(1);
-
   // Checks that the dimensions are matching
   const size_t n_inputs = machine.inputSize();
   const size_t n_outputs = machine.outputSize();
@@ -168,8 +325,10 @@ void bob::trainer::EMPCATrainer::initMembers(
     m_S.resize(n_features,n_features);
   else
     m_S.resize(0,0);
-  m_z_first_order.resize(n_samples, n_outputs);
-  m_z_second_order.resize(n_samples, n_outputs, n_outputs);
+  m_XZ.resize(n_features, n_outputs);
+  m_ZZ.resize(n_outputs, n_outputs);
+  m_sum_sq = 0.;
+  m_n_samples = 0;
   m_inW.resize(n_outputs, n_outputs);
   m_invM.resize(n_outputs, n_outputs);
   m_sigma2 = 0.;
@@ -177,12 +336,9 @@ void bob::trainer::EMPCATrainer::initMembers(
 
   // Cache
   m_tmp_dxf.resize(n_outputs, n_features);
-  m_tmp_d.resize(n_outputs);
-  m_tmp_f.resize(n_features);
   m_tmp_dxd_1.resize(n_outputs, n_outputs);
   m_tmp_dxd_2.resize(n_outputs, n_outputs);
   m_tmp_fxd_1.resize(n_features, n_outputs);
-  m_tmp_fxd_2.resize(n_features, n_outputs);
   // The following large cache matrices are only required to compute the
   // log likelihood.
   if (m_compute_likelihood)
@@ -220,6 +376,44 @@ void bob::trainer::EMPCATrainer::computeMeanVariance(bob::machine::LinearMachine
   }
 }
 
+void bob::trainer::EMPCATrainer::computeMeanVariance(bob::machine::LinearMachine& machine,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  const size_t n_samples = sampler.getNSamples();
+  if (n_samples < 2) {
+    boost::format m("the sampler provides %u sample(s), but at least two are required to compute the mean and the covariance of the data");
+    m % n_samples;
+    throw std::runtime_error(m.str());
+  }
+  blitz::Array<double,1> mu = machine.updateInputSubtraction();
+  blitz::Range all = blitz::Range::all();
+  blitz::Array<double,2> block;
+
+  // 1/ mean
+  mu = 0.;
+  sampler.reset();
+  while (sampler.next(block))
+    for (int i=0; i<block.extent(0); ++i)
+      mu += block(i,all);
+  mu /= static_cast<double>(n_samples);
+
+  // 2/ scatter of the centered blocks, divided by N-1
+  if (m_compute_likelihood)
+  {
+    m_S = 0.;
+    blitz::Array<double,2> centered;
+    sampler.reset();
+    while (sampler.next(block))
+    {
+      centered.resize(block.shape());
+      for (int i=0; i<block.extent(0); ++i)
+        centered(i,all) = block(i,all) - mu;
+      bob::math::gemm(centered, centered, m_S, true, false, 1., 1.);
+    }
+    m_S /= static_cast<double>(n_samples-1);
+  }
+}
+
 void bob::trainer::EMPCATrainer::initRandomWSigma2(bob::machine::LinearMachine& machine)
 {
   // Initializes the random number generator
@@ -253,119 +447,151 @@ void bob::trainer::EMPCATrainer::computeInvM()
 }
 
 
-
-void bob::trainer::EMPCATrainer::eStep(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar)
+void bob::trainer::EMPCATrainer::initEStep(const bob::machine::LinearMachine& machine)
 {
-  // Gets mu and W from the machine
-  const blitz::Array<double,1>& mu = machine.getInputSubtraction();
+  m_XZ = 0.;
+  m_ZZ = 0.;
+  m_sum_sq = 0.;
+  m_n_samples = 0;
+
+  // m_tmp_dxf = inv(M) * W^T, such that E(z_i) = inv(M) * W^T * (t_i - mu)
   const blitz::Array<double,2>& W = machine.getWeights();
   const blitz::Array<double,2> Wt = W.transpose(1,0); // W^T
+  bob::math::prod(m_invM, Wt, m_tmp_dxf);
+}
 
-  // Computes the statistics
-  blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i)
-  {
-    /// 1/ First order statistics: \f$z_first_order_i = inv(M) W^T (t - \mu)\f$
-    // m_tmp_f = t (sample) - mu (normalized sample)
-    m_tmp_f = ar(i,a) - mu;
-    // m_tmp_dxf = inv(M) * W^T
-    bob::math::prod(m_invM, Wt, m_tmp_dxf);
-    blitz::Array<double,1> z_first_order_i = m_z_first_order(i,blitz::Range::all());
-    // z_first_order_i = inv(M) * W^T * (t - mu)
-    bob::math::prod(m_tmp_dxf, m_tmp_f, z_first_order_i);
-
-    /// 2/ Second order statistics:
-    ///     z_second_order_i = sigma2 * inv(M) + z_first_order_i * z_first_order_i^T
-    blitz::Array<double,2> z_second_order_i = m_z_second_order(i,blitz::Range::all(),blitz::Range::all());
-    // m_tmp_dxd = z_first_order_i * z_first_order_i^T
-    bob::math::prod(z_first_order_i, z_first_order_i, m_tmp_dxd_1); // outer product
-    // z_second_order_i = sigma2 * inv(M)
-    z_second_order_i = m_invM;
-    z_second_order_i *= m_sigma2;
-    // z_second_order_i = sigma2 * inv(M) + z_first_order_i * z_first_order_i^T
-    z_second_order_i += m_tmp_dxd_1;
+void bob::trainer::EMPCATrainer::finalizeEStep()
+{
+  // Second order statistics:
+  //   sum_i E(z_i z_i^T) = sum_i {sigma2 * inv(M) + E(z_i) E(z_i)^T}
+  m_ZZ += static_cast<double>(m_n_samples) * m_sigma2 * m_invM;
+}
+
+void bob::trainer::EMPCATrainer::eStep(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar)
+{
+  bob::core::array::assertSameDimensionLength(ar.extent(1), m_XZ.extent(0));
+  bob::core::array::assertSameDimensionLength(machine.outputSize(), m_XZ.extent(1));
+
+  initEStep(machine);
+  std::vector<EMPCAWorkspace> workspaces;
+  accStatistics(ar, machine.getInputSubtraction(), m_tmp_dxf, m_n_threads,
+    workspaces, m_XZ, m_ZZ, m_sum_sq);
+  m_n_samples = ar.extent(0);
+  finalizeEStep();
+}
+
+void bob::trainer::EMPCATrainer::eStep(bob::machine::LinearMachine& machine,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  bob::core::array::assertSameDimensionLength(sampler.getNInputs(), m_XZ.extent(0));
+  bob::core::array::assertSameDimensionLength(machine.outputSize(), m_XZ.extent(1));
+
+  initEStep(machine);
+  // the buffers of the threads are kept from one block to the next one
+  std::vector<EMPCAWorkspace> workspaces;
+  blitz::Array<double,2> block;
+  sampler.reset();
+  while (sampler.next(block)) {
+    accStatistics(block, machine.getInputSubtraction(), m_tmp_dxf,
+      m_n_threads, workspaces, m_XZ, m_ZZ, m_sum_sq);
+    m_n_samples += block.extent(0);
   }
+  finalizeEStep();
+}
+
+void bob::trainer::EMPCATrainer::train(bob::machine::LinearMachine& machine,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  bob::core::info << "# " << name() << ":" << std::endl;
+
+  // the data is not used by the M-step
+  const blitz::Array<double,2> no_data(0, (int)sampler.getNInputs());
+  initialize(machine, sampler);
+  iterate(machine, no_data, StreamEStep(*this, machine, sampler));
+  finalize(machine, no_data);
+}
+
+void bob::trainer::EMPCATrainer::resume(bob::machine::LinearMachine& machine,
+  bob::trainer::HDF5Sampler& sampler, const std::string& filename)
+{
+  bob::core::info << "# " << name() << ": resuming from '" << filename
+    << "'" << std::endl;
+
+  // the data is not used by the M-step
+  const blitz::Array<double,2> no_data(0, (int)sampler.getNInputs());
+  initialize(machine, sampler);
+  iterate(machine, no_data, StreamEStep(*this, machine, sampler), filename);
+  finalize(machine, no_data);
 }
 
 void bob::trainer::EMPCATrainer::mStep(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar)
 {
   // 1/ New estimate of W
-  updateW(machine, ar);
+  updateW(machine);
 
   // 2/ New estimate of sigma2
-  updateSigma2(machine, ar);
+  updateSigma2(machine);
 
   // Computes the new value of inverse(M), where M = Wt * W + sigma2 * Id
   computeInvM();
 }
 
-void bob::trainer::EMPCATrainer::updateW(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar) {
-  // Get the mean mu and the projection matrix W
-  const blitz::Array<double,1>& mu = machine.getInputSubtraction();
+void bob::trainer::EMPCATrainer::updateW(bob::machine::LinearMachine& machine) {
+  // Get the projection matrix W
   blitz::Array<double,2>& W = machine.updateWeights();
   const blitz::Array<double,2> Wt = W.transpose(1,0); // W^T
 
   // Compute W = sum{ (t_{i} - mu) z_first_order_i^T} * inv( sum{z_second_order_i} )
-  m_tmp_fxd_1 = 0.;
-  m_tmp_dxd_1 = 0.;
-  blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i)
-  {
-    // m_tmp_f = t (sample) - mu (normalized sample)
-    m_tmp_f = ar(i,a) - mu;
-    // first order statistics of sample i
-    blitz::Array<double,1> z_first_order_i = m_z_first_order(i,blitz::Range::all());
-    // m_tmp_fxd_2 = (t - mu)*z_first_order_i
-    bob::math::prod(m_tmp_f, z_first_order_i, m_tmp_fxd_2);
-    m_tmp_fxd_1 += m_tmp_fxd_2;
-
-    // second order statistics of sample i
-    blitz::Array<double,2> z_second_order_i = m_z_second_order(i,blitz::Range::all(),blitz::Range::all());
-    m_tmp_dxd_1 += z_second_order_i;
-  }
-
   // m_tmp_dxd_2 = inv( sum(E(x_i.x_i^T)) )
-  bob::math::inv(m_tmp_dxd_1, m_tmp_dxd_2);
+  bob::math::inv(m_ZZ, m_tmp_dxd_2);
   // New estimates of W
-  bob::math::prod(m_tmp_fxd_1, m_tmp_dxd_2, W);
+  bob::math::prod(m_XZ, m_tmp_dxd_2, W);
   // Updates W'*W as well
   bob::math::prod(Wt, W, m_inW);
 }
 
-void bob::trainer::EMPCATrainer::updateSigma2(bob::machine::LinearMachine& machine, const blitz::Array<double,2>& ar) {
-  // Get the mean mu and the projection matrix W
-  const blitz::Array<double,1>& mu = machine.getInputSubtraction();
+void bob::trainer::EMPCATrainer::updateSigma2(bob::machine::LinearMachine& machine) {
+  // Get the projection matrix W (updated by updateW(), as well as W^T W)
   const blitz::Array<double,2>& W = machine.getWeights();
-  const blitz::Array<double,2> Wt = W.transpose(1,0); // W^T
 
-  m_sigma2 = 0.;
-  blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i)
-  {
-    // a. sigma2 += || t - mu ||^2
-    // m_tmp_f = t (sample) - mu (normalized sample)
-    m_tmp_f = ar(i,a) - mu;
-    // sigma2 += || t - mu ||^2
-    m_sigma2 += blitz::sum(blitz::pow2(m_tmp_f));
-
-    // b. sigma2 -= 2*E(x_i)^T*W^T*(t - mu)
-    // m_tmp_d = W^T*(t - mu)
-    bob::math::prod(Wt, m_tmp_f, m_tmp_d);
-    // first order of i
-    blitz::Array<double,1> z_first_order_i = m_z_first_order(i,blitz::Range::all());
-    // sigma2 -= 2*E(x_i)^T*W^T*(t - mu)
-    m_sigma2 -= 2*bob::math::dot(z_first_order_i, m_tmp_d);
-
-    // c. sigma2 += trace( E(x_i.x_i^T)*W^T*W )
-    // second order of i
-    blitz::Array<double,2> z_second_order_i = m_z_second_order(i,blitz::Range::all(),blitz::Range::all());
-    // m_tmp_dxd_1 = E(x_i.x_i^T)*W^T*W
-    bob::math::prod(z_second_order_i, m_inW, m_tmp_dxd_1);
-    // sigma2 += trace( E(x_i.x_i^T)*W^T*W )
-    m_sigma2 += bob::math::trace(m_tmp_dxd_1);
-  }
+  // a. sigma2 = sum_i || t_i - mu ||^2
+  m_sigma2 = m_sum_sq;
+
+  // b. sigma2 -= 2 * sum_i E(x_i)^T*W^T*(t_i - mu)
+  //            = 2 * trace( W^T * sum_i (t_i - mu) E(x_i)^T )
+  m_sigma2 -= 2 * blitz::sum(W * m_XZ);
+
+  // c. sigma2 += sum_i trace( E(x_i.x_i^T)*W^T*W )
+  // m_tmp_dxd_1 = sum_i E(x_i.x_i^T)*W^T*W
+  bob::math::prod(m_ZZ, m_inW, m_tmp_dxd_1);
+  m_sigma2 += bob::math::trace(m_tmp_dxd_1);
+
   // Normalization factor
-  m_sigma2 /= (static_cast<double>(ar.extent(0)) * mu.extent(0));
+  m_sigma2 /= (static_cast<double>(m_n_samples) * W.extent(0));
+}
+
+bool bob::trainer::EMPCATrainer::saveAccumulators(bob::io::HDF5File& file) const
+{
+  file.set("sigma2", m_sigma2);
+  file.setArray("xz", m_XZ);
+  file.setArray("zz", m_ZZ);
+  file.set("sum_sq", m_sum_sq);
+  file.set("n_samples", static_cast<uint64_t>(m_n_samples));
+  return true;
+}
+
+void bob::trainer::EMPCATrainer::loadAccumulators(
+  bob::machine::LinearMachine& machine, bob::io::HDF5File& file)
+{
+  m_sigma2 = file.read<double>("sigma2");
+  // the statistics have been resized by initialize()
+  file.readArray("xz", m_XZ);
+  file.readArray("zz", m_ZZ);
+  m_sum_sq = file.read<double>("sum_sq");
+  m_n_samples = file.read<uint64_t>("n_samples");
+  // W^T W and inv(M) of the restored machine, instead of the random ones
+  computeWtW(machine);
+  computeInvM();
 }
 
 double bob::trainer::EMPCATrainer::computeLikelihood(bob::machine::LinearMachine& machine)
@@ -418,7 +644,7 @@ double bob::trainer::EMPCATrainer::computeLikelihood(bob::machine::LinearMachine
 
   // 4/ Use previous values to compute the log likelihood:
   // Log likelihood =  - N/2*{ d*ln(2*PI) + ln |detC| + tr(C^-1.S) }
-  double llh = - static_cast<double>(m_z_first_order.extent(0)) / 2. *
+  double llh = - static_cast<double>(m_n_samples) / 2. *
     ( m_f_log2pi + log(fabs(detC)) + bob::math::trace(m_tmp_fxf_2) );
 
   return llh;
@@ -111,12 +111,47 @@ void bob::trainer::FisherLDATrainer::train
     }
   }
 
-  int osize = output_size(data);
+  blitz::Array<double,1> preMean(n_features);
+  blitz::Array<double,2> Sw(n_features, n_features);
+  blitz::Array<double,2> Sb(n_features, n_features);
+  bob::math::scatters_(data, Sw, Sb, preMean);
+
+  trainFromScatters(machine, eigen_values, Sw, Sb, preMean, output_size(data));
+}
+
+void bob::trainer::FisherLDATrainer::train
+(bob::machine::LinearMachine& machine, blitz::Array<double,1>& eigen_values,
+  const bob::trainer::ScatterAccumulator& accumulator) const
+{
+  // if #classes < 2, then throw
+  if (accumulator.getNClasses() < 2) {
+    boost::format m("The number of classes with samples in the accumulated statistics == %d whereas for LDA you should provide at least 2");
+    m % accumulator.getNClasses();
+    throw std::runtime_error(m.str());
+  }
+
+  const int n_features = accumulator.getNFeatures();
+  blitz::Array<double,1> preMean(n_features);
+  blitz::Array<double,2> Sw(n_features, n_features);
+  blitz::Array<double,2> Sb(n_features, n_features);
+  accumulator.scatters(Sw, Sb, preMean);
+
+  trainFromScatters(machine, eigen_values, Sw, Sb, preMean,
+    output_size(accumulator));
+}
+
+void bob::trainer::FisherLDATrainer::trainFromScatters
+(bob::machine::LinearMachine& machine, blitz::Array<double,1>& eigen_values,
+  blitz::Array<double,2>& Sw, blitz::Array<double,2>& Sb,
+  const blitz::Array<double,1>& preMean, const size_t n_outputs) const
+{
+  const int n_features = Sw.extent(0);
+  const int osize = n_outputs;
 
   // Checks that the dimensions are matching
-  if (machine.inputSize() != (size_t)data[0].extent(1)) {
+  if (machine.inputSize() != (size_t)n_features) {
     boost::format m("Number of features at input data set (%d columns) does not match machine input size (%d)");
-    m % data[0].extent(1) % machine.inputSize();
+    m % n_features % machine.inputSize();
     throw std::runtime_error(m.str());
   }
   if (machine.outputSize() != (size_t)osize) {
@@ -130,11 +165,6 @@ void bob::trainer::FisherLDATrainer::train
     throw std::runtime_error(m.str());
   }
 
-  blitz::Array<double,1> preMean(n_features);
-  blitz::Array<double,2> Sw(n_features, n_features);
-  blitz::Array<double,2> Sb(n_features, n_features);
-  bob::math::scatters_(data, Sw, Sb, preMean);
-
   // computes the generalized eigenvalue decomposition
   // so to find the eigen vectors/values of Sw^(-1) * Sb
   blitz::Array<double,2> V(Sw.shape());
@@ -194,3 +224,13 @@ void bob::trainer::FisherLDATrainer::train(bob::machine::LinearMachine& machine,
 size_t bob::trainer::FisherLDATrainer::output_size(const std::vector<blitz::Array<double,2> >& data) const {
   return m_strip_to_rank ? std::min(data.size()-1, (size_t)data[0].extent(1)) : data[0].extent(1);
 }
+
+void bob::trainer::FisherLDATrainer::train(bob::machine::LinearMachine& machine,
+    const bob::trainer::ScatterAccumulator& accumulator) const {
+  blitz::Array<double,1> throw_away(output_size(accumulator));
+  train(machine, throw_away, accumulator);
+}
+
+size_t bob::trainer::FisherLDATrainer::output_size(const bob::trainer::ScatterAccumulator& accumulator) const {
+  return m_strip_to_rank ? std::min(accumulator.getNClasses()-1, accumulator.getNFeatures()) : accumulator.getNFeatures();
+}
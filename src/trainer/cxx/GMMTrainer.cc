@@ -9,6 +9,73 @@
 #include <bob/trainer/GMMTrainer.h>
 #include <bob/core/assert.h>
 #include <bob/core/check.h>
+#include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <bob/core/logging.h>
+#include <boost/format.hpp>
+#include <algorithm>
+
+namespace {
+
+  /**
+   * Number of samples of each chunk of the E-step
+   */
+  static const size_t GMM_ESTEP_CHUNK_SIZE = 1024;
+
+  /**
+   * Accumulates the statistics of a chunk of samples, using the GMM and
+   * the statistics of the thread, which are then added to the total
+   * statistics in the order of the chunks (see
+   * bob::core::thread_reduce_blocks()).
+   */
+  struct GMMStatsChunk {
+    const double* m_data;
+    const int m_n_samples;
+    const int m_n_inputs;
+    std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& m_gmms;
+    std::vector<boost::shared_ptr<bob::machine::GMMStats> >& m_stats;
+    bob::machine::GMMStats& m_total;
+
+    GMMStatsChunk(const double* data, const int n_samples, const int n_inputs,
+        std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& gmms,
+        std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+        bob::machine::GMMStats& total):
+      m_data(data), m_n_samples(n_samples), m_n_inputs(n_inputs),
+      m_gmms(gmms), m_stats(stats), m_total(total)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      const int begin = b * GMM_ESTEP_CHUNK_SIZE;
+      const int n = std::min(m_n_samples, begin + (int)GMM_ESTEP_CHUNK_SIZE) - begin;
+      const blitz::Array<double,2> x(const_cast<double*>(m_data) + begin * m_n_inputs,
+        blitz::shape(n, m_n_inputs), blitz::neverDeleteData);
+      bob::machine::GMMStats& stats = *m_stats[ith];
+      stats.init();
+      m_gmms[ith]->accStatistics_(x, stats);
+    }
+
+    void reduce(const size_t ith, const size_t b) const {
+      m_total += *m_stats[ith];
+    }
+  };
+
+  /**
+   * Performs an E-step by streaming the data of a sampler
+   */
+  struct StreamEStep {
+    bob::trainer::GMMTrainer& m_trainer;
+    bob::machine::GMMMachine& m_gmm;
+    bob::trainer::HDF5Sampler& m_sampler;
+
+    StreamEStep(bob::trainer::GMMTrainer& trainer,
+        bob::machine::GMMMachine& gmm, bob::trainer::HDF5Sampler& sampler):
+      m_trainer(trainer), m_gmm(gmm), m_sampler(sampler)
+    {}
+
+    void operator()() const { m_trainer.eStep(m_gmm, m_sampler); }
+  };
+
+}
 
 bob::trainer::GMMTrainer::GMMTrainer(const bool update_means, 
     const bool update_variances, const bool update_weights,
@@ -16,14 +83,16 @@ bob::trainer::GMMTrainer::GMMTrainer(const bool update_means,
   bob::trainer::EMTrainer<bob::machine::GMMMachine, blitz::Array<double,2> >(), 
   m_update_means(update_means), m_update_variances(update_variances),
   m_update_weights(update_weights), 
-  m_mean_var_update_responsibilities_threshold(mean_var_update_responsibilities_threshold) 
+  m_mean_var_update_responsibilities_threshold(mean_var_update_responsibilities_threshold),
+  m_n_threads(0)
 {
 }
 
 bob::trainer::GMMTrainer::GMMTrainer(const bob::trainer::GMMTrainer& b):
   bob::trainer::EMTrainer<bob::machine::GMMMachine, blitz::Array<double,2> >(b),
   m_update_means(b.m_update_means), m_update_variances(b.m_update_variances),
-  m_mean_var_update_responsibilities_threshold(b.m_mean_var_update_responsibilities_threshold)
+  m_mean_var_update_responsibilities_threshold(b.m_mean_var_update_responsibilities_threshold),
+  m_n_threads(b.m_n_threads)
 {
 }
 
@@ -42,8 +111,91 @@ void bob::trainer::GMMTrainer::eStep(bob::machine::GMMMachine& gmm,
   const blitz::Array<double,2>& data) 
 {
   m_ss.init();
+  bob::core::array::assertSameDimensionLength(m_ss.sumPx.extent(0), gmm.getNGaussians());
+  bob::core::array::assertSameDimensionLength(m_ss.sumPx.extent(1), gmm.getNInputs());
+  bob::core::array::assertSameDimensionLength(data.extent(1), gmm.getNInputs());
+
+  const size_t n_chunks = (data.extent(0) + GMM_ESTEP_CHUNK_SIZE - 1) / GMM_ESTEP_CHUNK_SIZE;
+  if (n_chunks == 0) return;
+
   // Calculate the sufficient statistics and save in m_ss
-  gmm.accStatistics(data, m_ss);
+  std::vector<boost::shared_ptr<bob::machine::GMMMachine> > gmms;
+  std::vector<boost::shared_ptr<bob::machine::GMMStats> > stats;
+  createWorkspace(gmm, bob::core::thread_count(n_chunks, m_n_threads), gmms, stats);
+  accStatistics(data, gmms, stats, m_ss);
+}
+
+void bob::trainer::GMMTrainer::eStep(bob::machine::GMMMachine& gmm,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  m_ss.init();
+  bob::core::array::assertSameDimensionLength(m_ss.sumPx.extent(0), gmm.getNGaussians());
+  bob::core::array::assertSameDimensionLength(m_ss.sumPx.extent(1), gmm.getNInputs());
+  bob::core::array::assertSameDimensionLength(sampler.getNInputs(), gmm.getNInputs());
+  // the chunks of the blocks should be the ones of the in-memory E-step
+  if (sampler.getBlockSize() % GMM_ESTEP_CHUNK_SIZE != 0) {
+    boost::format m("GMMTrainer: the block size of the sampler (%u) should be a multiple of %u");
+    m % sampler.getBlockSize() % GMM_ESTEP_CHUNK_SIZE;
+    throw std::runtime_error(m.str());
+  }
+
+  // Calculate the sufficient statistics block by block, and save in m_ss
+  const size_t n_chunks = sampler.getBlockSize() / GMM_ESTEP_CHUNK_SIZE;
+  std::vector<boost::shared_ptr<bob::machine::GMMMachine> > gmms;
+  std::vector<boost::shared_ptr<bob::machine::GMMStats> > stats;
+  createWorkspace(gmm, bob::core::thread_count(n_chunks, m_n_threads), gmms, stats);
+  blitz::Array<double,2> block;
+  sampler.reset();
+  while (sampler.next(block))
+    accStatistics(block, gmms, stats, m_ss);
+}
+
+void bob::trainer::GMMTrainer::train(bob::machine::GMMMachine& gmm,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  bob::core::info << "# " << name() << ":" << std::endl;
+
+  // the data is only used by the E-step
+  const blitz::Array<double,2> no_data(0, (int)sampler.getNInputs());
+  initialize(gmm, no_data);
+  iterate(gmm, no_data, StreamEStep(*this, gmm, sampler));
+  finalize(gmm, no_data);
+}
+
+void bob::trainer::GMMTrainer::createWorkspace(const bob::machine::GMMMachine& gmm,
+  const size_t n_threads,
+  std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& gmms,
+  std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats) const
+{
+  // each thread has its own GMM (with its own caches) and statistics
+  gmms.resize(n_threads);
+  stats.resize(n_threads);
+  for (size_t i=0; i<n_threads; ++i) {
+    gmms[i].reset(new bob::machine::GMMMachine(gmm));
+    stats[i].reset(new bob::machine::GMMStats(gmm.getNGaussians(), gmm.getNInputs()));
+  }
+}
+
+void bob::trainer::GMMTrainer::accStatistics(const blitz::Array<double,2>& data,
+  std::vector<boost::shared_ptr<bob::machine::GMMMachine> >& gmms,
+  std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  bob::machine::GMMStats& total) const
+{
+  const int n_samples = data.extent(0);
+  const size_t n_chunks = (n_samples + GMM_ESTEP_CHUNK_SIZE - 1) / GMM_ESTEP_CHUNK_SIZE;
+  if (n_chunks == 0) return;
+
+  // raw data is accessed by the threads
+  blitz::Array<double,2> data_copy;
+  const blitz::Array<double,2>* x = &data;
+  if (!bob::core::array::isCZeroBaseContiguous(data)) {
+    data_copy.reference(bob::core::array::ccopy(data));
+    x = &data_copy;
+  }
+
+  bob::core::thread_reduce_blocks(GMMStatsChunk(x->data(), n_samples,
+    data.extent(1), gmms, stats, total), n_chunks,
+    std::min(gmms.size(), n_chunks));
 }
 
 double bob::trainer::GMMTrainer::computeLikelihood(bob::machine::GMMMachine& gmm)
@@ -68,6 +220,7 @@ bob::trainer::GMMTrainer& bob::trainer::GMMTrainer::operator=
     m_update_variances = other.m_update_variances;
     m_update_weights = other.m_update_weights;
     m_mean_var_update_responsibilities_threshold = other.m_mean_var_update_responsibilities_threshold;
+    m_n_threads = other.m_n_threads;
   }
   return *this;
 }
@@ -110,3 +263,17 @@ void bob::trainer::GMMTrainer::setGMMStats(const bob::machine::GMMStats& stats)
   bob::core::array::assertSameShape(m_ss.sumPx, stats.sumPx);
   m_ss = stats;
 }
+
+bool bob::trainer::GMMTrainer::saveAccumulators(bob::io::HDF5File& file) const
+{
+  m_ss.save(file);
+  return true;
+}
+
+void bob::trainer::GMMTrainer::loadAccumulators(bob::machine::GMMMachine& gmm,
+  bob::io::HDF5File& file)
+{
+  m_ss.load(file);
+  bob::core::array::assertSameDimensionLength(m_ss.sumPx.extent(0), gmm.getNGaussians());
+  bob::core::array::assertSameDimensionLength(m_ss.sumPx.extent(1), gmm.getNInputs());
+}
@@ -0,0 +1,211 @@
+/**
+ * @file trainer/cxx/HDF5Sampler.cc
+ * @date Mon Oct 19 02:52:55 2026 +0000
+ * @author agent <agent@local>
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <bob/trainer/HDF5Sampler.h>
+#include <bob/core/assert.h>
+#include <bob/core/check.h>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <algorithm>
+
+bob::trainer::HDF5Sampler::HDF5Sampler(
+    const std::vector<std::string>& filenames, const std::string& path,
+    const size_t block_size, const size_t n_buffers):
+  m_filenames(filenames),
+  m_path(path),
+  m_block_size(block_size),
+  m_n_inputs(0),
+  m_offsets(1, 0),
+  m_produced(0),
+  m_released(0),
+  m_next(0),
+  m_started(false),
+  m_stop(false)
+{
+  if (filenames.empty())
+    throw std::runtime_error("HDF5Sampler: the list of files is empty");
+  if (block_size == 0 || n_buffers == 0)
+    throw std::runtime_error("HDF5Sampler: the block size and the number of buffers should be strictly positive");
+
+  for (size_t i=0; i<filenames.size(); ++i) {
+    bob::io::HDF5File file(filenames[i], 'r');
+    if (!file.contains(path)) {
+      boost::format m("HDF5Sampler: file '%s' does not contain any dataset at path '%s'");
+      m % filenames[i] % path;
+      throw std::runtime_error(m.str());
+    }
+    const std::vector<bob::io::HDF5Descriptor>& descr = file.describe(path);
+    if (descr.size() != 2 || descr[1].type.shape().n() != 2 ||
+        descr[0].type.type() != bob::io::f64) {
+      boost::format m("HDF5Sampler: dataset '%s' of file '%s' is not a 2D array of double precision values");
+      m % path % filenames[i];
+      throw std::runtime_error(m.str());
+    }
+    const size_t n_samples = descr[1].type.shape()[0];
+    const size_t n_inputs = descr[1].type.shape()[1];
+    if (i == 0) m_n_inputs = n_inputs;
+    else if (n_inputs != m_n_inputs) {
+      boost::format m("HDF5Sampler: the samples of file '%s' have %u dimensions, whereas the ones of file '%s' have %u dimensions");
+      m % filenames[i] % n_inputs % filenames[0] % m_n_inputs;
+      throw std::runtime_error(m.str());
+    }
+    m_offsets.push_back(m_offsets.back() + n_samples);
+  }
+
+  // the memory used does not depend on the number of samples
+  const size_t buffer_size = std::min(m_block_size, getNSamples()) * m_n_inputs;
+  m_buffers.resize(n_buffers, std::vector<double>(std::max(buffer_size, (size_t)1)));
+}
+
+bob::trainer::HDF5Sampler::~HDF5Sampler()
+{
+  stop();
+}
+
+void bob::trainer::HDF5Sampler::stop()
+{
+  if (m_thread) {
+    {
+      boost::lock_guard<boost::mutex> lock(m_mutex);
+      m_stop = true;
+      m_condition.notify_all();
+    }
+    m_thread->join();
+    m_thread.reset();
+  }
+  m_started = false;
+}
+
+void bob::trainer::HDF5Sampler::reset()
+{
+  stop();
+  m_produced = 0;
+  m_released = 0;
+  m_next = 0;
+  m_stop = false;
+  m_error = boost::exception_ptr();
+  m_started = true;
+  if (getNBlocks() > 0)
+    m_thread.reset(new boost::thread(boost::bind(&bob::trainer::HDF5Sampler::produce, this)));
+}
+
+bool bob::trainer::HDF5Sampler::next(blitz::Array<double,2>& block)
+{
+  if (!m_started) reset();
+
+  boost::unique_lock<boost::mutex> lock(m_mutex);
+  // releases the previous block, such that its buffer could be refilled
+  if (m_next > m_released) {
+    m_released = m_next;
+    m_condition.notify_all();
+  }
+
+  // end of the pass
+  if (m_next >= getNBlocks()) {
+    lock.unlock();
+    stop();
+    return false;
+  }
+
+  // waits for the next block
+  while (m_produced <= m_next && !m_error) m_condition.wait(lock);
+  if (m_produced <= m_next) {
+    boost::exception_ptr error = m_error;
+    lock.unlock();
+    stop();
+    boost::rethrow_exception(error);
+  }
+
+  const size_t begin = m_next * m_block_size;
+  const size_t n_samples = std::min(getNSamples(), begin + m_block_size) - begin;
+  block.reference(blitz::Array<double,2>(&m_buffers[m_next % m_buffers.size()][0],
+    blitz::shape(n_samples, m_n_inputs), blitz::neverDeleteData));
+  ++m_next;
+  return true;
+}
+
+void bob::trainer::HDF5Sampler::read(const size_t index,
+  blitz::Array<double,1>& sample)
+{
+  if (index >= getNSamples()) {
+    boost::format m("HDF5Sampler: cannot read sample %u, as there are only %u samples");
+    m % index % getNSamples();
+    throw std::runtime_error(m.str());
+  }
+  bob::core::array::assertSameDimensionLength(sample.extent(0), m_n_inputs);
+
+  // HDF5 is not accessed by two threads at the same time
+  stop();
+
+  size_t file_index = 0;
+  boost::shared_ptr<bob::io::HDF5File> file;
+  if (bob::core::array::isCZeroBaseContiguous(sample))
+    readRows(index, index+1, sample.data(), file_index, file);
+  else {
+    blitz::Array<double,1> tmp(m_n_inputs);
+    readRows(index, index+1, tmp.data(), file_index, file);
+    sample = tmp;
+  }
+}
+
+void bob::trainer::HDF5Sampler::readRows(const size_t begin,
+  const size_t end, double* buffer, size_t& file_index,
+  boost::shared_ptr<bob::io::HDF5File>& file) const
+{
+  const bob::io::HDF5Type type(bob::io::f64, bob::io::HDF5Shape(1, &m_n_inputs));
+  size_t row = begin;
+  while (row < end) {
+    // moves to the file containing the current row
+    while (row >= m_offsets[file_index+1]) {
+      ++file_index;
+      file.reset();
+    }
+    if (!file) file.reset(new bob::io::HDF5File(m_filenames[file_index], 'r'));
+
+    // reads as many rows as possible from this file at once
+    const size_t count = std::min(end, m_offsets[file_index+1]) - row;
+    file->read_buffer(m_path, row - m_offsets[file_index], count, type, buffer);
+    buffer += count * m_n_inputs;
+    row += count;
+  }
+}
+
+void bob::trainer::HDF5Sampler::produce()
+{
+  try {
+    const size_t n_blocks = getNBlocks();
+    const size_t n_buffers = m_buffers.size();
+    size_t file_index = 0;
+    boost::shared_ptr<bob::io::HDF5File> file;
+    for (size_t b=0; b<n_blocks; ++b) {
+      // waits for a free buffer
+      {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while (!m_stop && b >= m_released + n_buffers) m_condition.wait(lock);
+        if (m_stop) return;
+      }
+
+      const size_t begin = b * m_block_size;
+      const size_t end = std::min(getNSamples(), begin + m_block_size);
+      // the buffers are never resized: no lock is required to fill them
+      double* buffer = &m_buffers[b % n_buffers][0];
+      readRows(begin, end, buffer, file_index, file);
+
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_produced = b + 1;
+        m_condition.notify_all();
+      }
+    }
+  }
+  catch (...) {
+    boost::lock_guard<boost::mutex> lock(m_mutex);
+    m_error = boost::current_exception();
+    m_condition.notify_all();
+  }
+}
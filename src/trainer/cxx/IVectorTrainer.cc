@@ -12,11 +12,309 @@
 #include <bob/core/array_copy.h>
 #include <bob/core/array_random.h>
 #include <bob/core/check.h>
+#include <bob/core/assert.h>
+#include <bob/core/parallel.h>
 #include <bob/math/inv.h>
 #include <bob/math/linear.h>
 #include <bob/math/linsolve.h>
+#include <bob/math/gemm.h>
 #include <boost/shared_ptr.hpp>
 #include <boost/random.hpp>
+#include <algorithm>
+
+namespace {
+
+  /**
+   * Number of utterances processed together by the E-step
+   */
+  static const size_t IVECTOR_ESTEP_BLOCK_SIZE = 64;
+
+  /**
+   * Number of columns (or rows) of the chunks of the matrix products of the
+   * E-step, each chunk being computed by a single thread. The decomposition
+   * does not depend on the number of threads, such that the results do not
+   * either.
+   */
+  static const int IVECTOR_GEMM_CHUNK_SIZE = 64;
+
+  /**
+   * Returns a view on a (sub-)matrix with the given row stride
+   */
+  blitz::Array<double,2> matrixView(const double* data, const int rows,
+    const int cols, const int row_stride)
+  {
+    return blitz::Array<double,2>(const_cast<double*>(data),
+      blitz::shape(rows, cols), blitz::shape(row_stride, 1),
+      blitz::neverDeleteData);
+  }
+
+  /**
+   * Computes a chunk of the product C = op(A).B + beta.C, C being split
+   * into chunks of IVECTOR_GEMM_CHUNK_SIZE columns, or rows if m_by_rows
+   * is set. All the matrices are C-contiguous.
+   */
+  struct GemmChunk {
+    const double* m_A;
+    const int m_a_rows;
+    const int m_a_cols;
+    const bool m_transA;
+    const double* m_B;
+    const int m_b_cols;
+    double* m_C;
+    const int m_c_rows;
+    const int m_c_cols;
+    const double m_beta;
+    const bool m_by_rows;
+
+    GemmChunk(const blitz::Array<double,2>& A, const bool transA,
+        const blitz::Array<double,2>& B, blitz::Array<double,2>& C,
+        const double beta, const bool by_rows):
+      m_A(A.data()), m_a_rows(A.extent(0)), m_a_cols(A.extent(1)),
+      m_transA(transA), m_B(B.data()), m_b_cols(B.extent(1)),
+      m_C(C.data()), m_c_rows(C.extent(0)), m_c_cols(C.extent(1)),
+      m_beta(beta), m_by_rows(by_rows)
+    {}
+
+    size_t n_chunks() const {
+      const int n = (m_by_rows ? m_c_rows : m_c_cols);
+      return (n + IVECTOR_GEMM_CHUNK_SIZE - 1) / IVECTOR_GEMM_CHUNK_SIZE;
+    }
+
+    void operator()(const size_t ith, const size_t k) const {
+      const int begin = k * IVECTOR_GEMM_CHUNK_SIZE;
+      const int n = std::min(m_by_rows ? m_c_rows : m_c_cols,
+        begin + IVECTOR_GEMM_CHUNK_SIZE) - begin;
+      if (m_by_rows) {
+        // rows [begin, begin+n) of op(A)
+        const blitz::Array<double,2> A = m_transA ?
+          matrixView(m_A + begin, m_a_rows, n, m_a_cols) :
+          matrixView(m_A + begin * m_a_cols, n, m_a_cols, m_a_cols);
+        const blitz::Array<double,2> B = matrixView(m_B,
+          m_transA ? m_a_rows : m_a_cols, m_b_cols, m_b_cols);
+        blitz::Array<double,2> C = matrixView(m_C + begin * m_c_cols, n,
+          m_c_cols, m_c_cols);
+        bob::math::gemm_(A, B, C, m_transA, false, 1., m_beta);
+      }
+      else {
+        // columns [begin, begin+n) of B and C
+        const blitz::Array<double,2> A = matrixView(m_A, m_a_rows, m_a_cols,
+          m_a_cols);
+        const blitz::Array<double,2> B = matrixView(m_B + begin,
+          m_transA ? m_a_rows : m_a_cols, n, m_b_cols);
+        blitz::Array<double,2> C = matrixView(m_C + begin, m_c_rows, n,
+          m_c_cols);
+        bob::math::gemm_(A, B, C, m_transA, false, 1., m_beta);
+      }
+    }
+  };
+
+  /**
+   * Gets the zeroth order statistics and the centered first order
+   * statistics \f$F_{norm} = F_{c} - N_{c} m_{c}\f$ of each utterance of
+   * a block, as rows of N and Fnorm
+   */
+  struct UtteranceStats {
+    const std::vector<bob::machine::GMMStats>& m_data;
+    const size_t m_begin;
+    const double* m_mean;
+    double* m_N;
+    double* m_Fnorm;
+    const int m_C;
+    const int m_D;
+
+    UtteranceStats(const std::vector<bob::machine::GMMStats>& data,
+        const size_t begin, const blitz::Array<double,1>& mean,
+        blitz::Array<double,2>& N, blitz::Array<double,2>& Fnorm,
+        const int C, const int D):
+      m_data(data), m_begin(begin), m_mean(mean.data()), m_N(N.data()),
+      m_Fnorm(Fnorm.data()), m_C(C), m_D(D)
+    {}
+
+    void operator()(const size_t ith, const size_t j) const {
+      const bob::machine::GMMStats& stats = m_data[m_begin + j];
+      const double* n = stats.n.data();
+      const double* sumPx = stats.sumPx.data();
+      double* N = m_N + j * m_C;
+      double* Fnorm = m_Fnorm + j * m_C * m_D;
+      for (int c=0; c<m_C; ++c) {
+        N[c] = n[c];
+        for (int d=0; d<m_D; ++d, ++Fnorm)
+          *Fnorm = sumPx[c*m_D+d] - n[c] * m_mean[c*m_D+d];
+      }
+    }
+  };
+
+  /**
+   * Computes the posterior \f$E{w_{ij}}\f$ and the packed upper triangle of
+   * \f$E{w_{ij} w_{ij}^{T}}\f$ of each utterance of a block, given the
+   * packed upper triangle of \f$\sum_{c} N_{ijc} T_{c}^{T} \Sigma_{c}^{-1} T_{c}\f$
+   * and \f$T^{T} \Sigma^{-1} F_{norm}\f$
+   */
+  struct UtterancePosterior {
+    const double* m_Lp;
+    const double* m_U;
+    double* m_W;
+    double* m_W2p;
+    const int m_Rt;
+    std::vector<std::vector<double> >& m_tmp;
+
+    UtterancePosterior(const blitz::Array<double,2>& Lp,
+        const blitz::Array<double,2>& U, blitz::Array<double,2>& W,
+        blitz::Array<double,2>& W2p, std::vector<std::vector<double> >& tmp):
+      m_Lp(Lp.data()), m_U(U.data()), m_W(W.data()), m_W2p(W2p.data()),
+      m_Rt(U.extent(1)), m_tmp(tmp)
+    {}
+
+    void operator()(const size_t ith, const size_t j) const {
+      const int P = m_Rt * (m_Rt + 1) / 2;
+      double* tmp = &m_tmp[ith][0];
+      blitz::Array<double,2> L = matrixView(tmp, m_Rt, m_Rt, m_Rt);
+      blitz::Array<double,2> Linv = matrixView(tmp + m_Rt * m_Rt, m_Rt, m_Rt, m_Rt);
+      const blitz::Array<double,1> u(const_cast<double*>(m_U) + j * m_Rt,
+        blitz::shape(m_Rt), blitz::neverDeleteData);
+      blitz::Array<double,1> w(m_W + j * m_Rt, blitz::shape(m_Rt),
+        blitz::neverDeleteData);
+
+      // Id + T^{T} \Sigma^{-1} N T
+      const double* lp = m_Lp + j * P;
+      for (int r1=0; r1<m_Rt; ++r1) {
+        L(r1,r1) = 1. + *lp++;
+        for (int r2=r1+1; r2<m_Rt; ++r2)
+          L(r1,r2) = L(r2,r1) = *lp++;
+      }
+      // (Id + T^{T} \Sigma^{-1} N T)^{-1}
+      bob::math::inv_(L, Linv);
+      // E{wij} = (Id + T^{T} \Sigma^{-1} N T)^{-1} T^{T} \Sigma^{-1} F_{norm}
+      bob::math::prod_(Linv, u, w);
+      // E{wij.wij^{T}} = (Id + T^{T} \Sigma^{-1} N T)^{-1} + E{wij}.E{wij^{T}}
+      double* w2p = m_W2p + j * P;
+      for (int r1=0; r1<m_Rt; ++r1)
+        for (int r2=r1; r2<m_Rt; ++r2)
+          *w2p++ = Linv(r1,r2) + w(r1) * w(r2);
+    }
+  };
+
+  /**
+   * Accumulates the zeroth order statistics and the centered second order
+   * statistics of a block of utterances, for a Gaussian component c
+   */
+  struct SigmaStats {
+    const std::vector<bob::machine::GMMStats>& m_data;
+    const size_t m_begin;
+    const size_t m_size;
+    const double* m_mean;
+    const double* m_Fnorm;
+    double* m_acc_N;
+    double* m_acc_S;
+    const int m_C;
+    const int m_D;
+
+    SigmaStats(const std::vector<bob::machine::GMMStats>& data,
+        const size_t begin, const size_t size,
+        const blitz::Array<double,1>& mean, const blitz::Array<double,2>& Fnorm,
+        blitz::Array<double,1>& acc_N, blitz::Array<double,2>& acc_S,
+        const int C, const int D):
+      m_data(data), m_begin(begin), m_size(size), m_mean(mean.data()),
+      m_Fnorm(Fnorm.data()), m_acc_N(acc_N.data()), m_acc_S(acc_S.data()),
+      m_C(C), m_D(D)
+    {}
+
+    void operator()(const size_t ith, const size_t c) const {
+      const double* mc = m_mean + c * m_D;
+      double* S = m_acc_S + c * m_D;
+      for (size_t j=0; j<m_size; ++j) {
+        const bob::machine::GMMStats& stats = m_data[m_begin + j];
+        const double* sumPx = stats.sumPx.data() + c * m_D;
+        const double* sumPxx = stats.sumPxx.data() + c * m_D;
+        const double* Fnorm = m_Fnorm + j * m_C * m_D + c * m_D;
+        m_acc_N[c] += stats.n.data()[c];
+        for (int d=0; d<m_D; ++d)
+          S[d] += sumPxx[d] - mc[d] * (sumPx[d] + Fnorm[d]);
+      }
+    }
+  };
+
+  /**
+   * Unpacks the accumulator of \f$N_{ijc} E{w_{ij} w_{ij}^{T}}\f$ of a
+   * Gaussian component c
+   */
+  struct UnpackAccumulator {
+    const double* m_acc_p;
+    double* m_acc;
+    const int m_Rt;
+
+    UnpackAccumulator(const blitz::Array<double,2>& acc_p,
+        blitz::Array<double,3>& acc):
+      m_acc_p(acc_p.data()), m_acc(acc.data()), m_Rt(acc.extent(1))
+    {}
+
+    void operator()(const size_t ith, const size_t c) const {
+      const double* p = m_acc_p + c * (m_Rt * (m_Rt + 1) / 2);
+      double* a = m_acc + c * m_Rt * m_Rt;
+      for (int r1=0; r1<m_Rt; ++r1)
+        for (int r2=r1; r2<m_Rt; ++r2, ++p)
+          a[r1*m_Rt+r2] = a[r2*m_Rt+r1] = *p;
+    }
+  };
+
+  /**
+   * Updates the rows of T (and the elements of \f$\Sigma\f$) of a
+   * Gaussian component c, by solving the linear system given by the
+   * accumulators of the E-step
+   */
+  struct MStepComponent {
+    const double* m_acc_Nij_wij2;
+    const double* m_acc_Fnormij_wij;
+    const double* m_acc_Nij;
+    const double* m_acc_Snormij;
+    double* m_T;
+    double* m_sigma;
+    const int m_D;
+    const int m_Rt;
+    const bool m_update_sigma;
+
+    MStepComponent(const blitz::Array<double,3>& acc_Nij_wij2,
+        const blitz::Array<double,3>& acc_Fnormij_wij,
+        const blitz::Array<double,1>& acc_Nij,
+        const blitz::Array<double,2>& acc_Snormij,
+        blitz::Array<double,2>& T, blitz::Array<double,1>& sigma,
+        const bool update_sigma):
+      m_acc_Nij_wij2(acc_Nij_wij2.data()),
+      m_acc_Fnormij_wij(acc_Fnormij_wij.data()),
+      m_acc_Nij(acc_Nij.data()), m_acc_Snormij(acc_Snormij.data()),
+      m_T(T.data()), m_sigma(sigma.data()), m_D(acc_Fnormij_wij.extent(1)),
+      m_Rt(acc_Fnormij_wij.extent(2)), m_update_sigma(update_sigma)
+    {}
+
+    void operator()(const size_t ith, const size_t c) const {
+      // Solves linear system A.T = B to update T, based on accumulators of 
+      // the eStep()
+      blitz::Array<double,2> acc_Nij_wij2_c = matrixView(
+        m_acc_Nij_wij2 + c * m_Rt * m_Rt, m_Rt, m_Rt, m_Rt);
+      blitz::Array<double,2> tacc_Nij_wij2_c = acc_Nij_wij2_c.transpose(1,0);
+      blitz::Array<double,2> acc_Fnormij_wij_c = matrixView(
+        m_acc_Fnormij_wij + c * m_D * m_Rt, m_D, m_Rt, m_Rt);
+      blitz::Array<double,2> tacc_Fnormij_wij_c = acc_Fnormij_wij_c.transpose(1,0);
+      blitz::Array<double,2> T_c = matrixView(m_T + c * m_D * m_Rt, m_D,
+        m_Rt, m_Rt);
+      blitz::Array<double,2> Tt_c = T_c.transpose(1,0);
+      if (blitz::all(acc_Nij_wij2_c == 0)) // TODO
+        Tt_c = 0;
+      else
+        bob::math::linsolve(tacc_Nij_wij2_c, Tt_c, tacc_Fnormij_wij_c);
+      if (m_update_sigma)
+      {
+        // sigma_c = (Snorm_c - diag(acc_Fnormij_wij_c . T_c^{T})) / N_c
+        const double* S_c = m_acc_Snormij + c * m_D;
+        double* sigma_c = m_sigma + c * m_D;
+        for (int d=0; d<m_D; ++d)
+          sigma_c[d] = (S_c[d] - blitz::sum(acc_Fnormij_wij_c(d,blitz::Range::all()) *
+            T_c(d,blitz::Range::all()))) / m_acc_Nij[c];
+      }
+    }
+  };
+
+}
 
 bob::trainer::IVectorTrainer::IVectorTrainer(const bool update_sigma,
     const double convergence_threshold,
@@ -24,28 +322,21 @@ bob::trainer::IVectorTrainer::IVectorTrainer(const bool update_sigma,
   bob::trainer::EMTrainer<bob::machine::IVectorMachine, 
     std::vector<bob::machine::GMMStats> >(convergence_threshold,
       max_iterations, compute_likelihood), 
-  m_update_sigma(update_sigma)
+  m_update_sigma(update_sigma),
+  m_n_threads(0)
 {
 }
 
 bob::trainer::IVectorTrainer::IVectorTrainer(const bob::trainer::IVectorTrainer& other):
   bob::trainer::EMTrainer<bob::machine::IVectorMachine, 
     std::vector<bob::machine::GMMStats> >(other),
-  m_update_sigma(other.m_update_sigma)
+  m_update_sigma(other.m_update_sigma),
+  m_n_threads(other.m_n_threads)
 {
   m_acc_Nij_wij2.reference(bob::core::array::ccopy(other.m_acc_Nij_wij2));
   m_acc_Fnormij_wij.reference(bob::core::array::ccopy(other.m_acc_Fnormij_wij));
   m_acc_Nij.reference(bob::core::array::ccopy(other.m_acc_Nij));
   m_acc_Snormij.reference(bob::core::array::ccopy(other.m_acc_Snormij));
-
-  m_tmp_wij.reference(bob::core::array::ccopy(other.m_tmp_wij));
-  m_tmp_wij2.reference(bob::core::array::ccopy(other.m_tmp_wij2));
-  m_tmp_d1.reference(bob::core::array::ccopy(other.m_tmp_d1));
-  m_tmp_t1.reference(bob::core::array::ccopy(other.m_tmp_t1));
-  m_tmp_dd1.reference(bob::core::array::ccopy(other.m_tmp_dd1));
-  m_tmp_dt1.reference(bob::core::array::ccopy(other.m_tmp_dt1));
-  m_tmp_tt1.reference(bob::core::array::ccopy(other.m_tmp_tt1));
-  m_tmp_tt2.reference(bob::core::array::ccopy(other.m_tmp_tt2));
 }
 
 bob::trainer::IVectorTrainer::~IVectorTrainer() 
@@ -69,17 +360,6 @@ void bob::trainer::IVectorTrainer::initialize(
     m_acc_Snormij.resize(C,D);
   }
 
-  // Tmp
-  m_tmp_wij.resize(Rt);
-  m_tmp_wij2.resize(Rt,Rt);
-  m_tmp_d1.resize(D);
-  m_tmp_t1.resize(Rt);
-  m_tmp_dt1.resize(D,Rt);
-  m_tmp_tt1.resize(Rt,Rt);
-  m_tmp_tt2.resize(Rt,Rt);
-  if (m_update_sigma)
-    m_tmp_dd1.resize(D,D);
-
   // Initializes \f$T\f$ and \f$\Sigma\f$ of the machine
   blitz::Array<double,2>& T = machine.updateT();
   bob::core::array::randn(*m_rng, T);
@@ -92,90 +372,129 @@ void bob::trainer::IVectorTrainer::eStep(
   bob::machine::IVectorMachine& machine,
   const std::vector<bob::machine::GMMStats>& data)
 {
-  blitz::Range rall = blitz::Range::all();
   const int C = machine.getDimC();
+  const int D = machine.getDimD();
+  const int Rt = machine.getDimRt();
+  const int P = Rt * (Rt + 1) / 2;
 
   // Reinitializes accumulators to 0
+  bob::core::array::assertCZeroBaseContiguous(m_acc_Nij_wij2);
+  bob::core::array::assertCZeroBaseContiguous(m_acc_Fnormij_wij);
   m_acc_Nij_wij2 = 0.;
   m_acc_Fnormij_wij = 0.;
   if (m_update_sigma)
   {
+    bob::core::array::assertCZeroBaseContiguous(m_acc_Nij);
+    bob::core::array::assertCZeroBaseContiguous(m_acc_Snormij);
     m_acc_Nij = 0.;
     m_acc_Snormij = 0.;
   }
-  for (std::vector<bob::machine::GMMStats>::const_iterator it = data.begin();
-       it != data.end(); ++it)
+  for (size_t i=0; i<data.size(); ++i)
   {
-    // Computes E{wij} and E{wij.wij^{T}}
-    // a. Computes \f$T^{T} \Sigma^{-1} F_{norm}\f$
-    machine.computeTtSigmaInvFnorm(*it, m_tmp_t1);
-    // b. Computes \f$Id + T^{T} \Sigma^{-1} T\f$
-    machine.computeIdTtSigmaInvT(*it, m_tmp_tt1);
-    // c. Computes \f$(Id + T^{T} \Sigma^{-1} T)^{-1}\f$
-    bob::math::inv(m_tmp_tt1, m_tmp_tt2);
-    // d. Computes \f$E{wij} = (Id + T^{T} \Sigma^{-1} T)^{-1} T^{T} \Sigma^{-1} F_{norm}\f$
-    bob::math::prod(m_tmp_tt2, m_tmp_t1, m_tmp_wij); // E{wij}
-    // e.  Computes \f$E{wij}.E{wij^{T}}\f$
-    bob::math::prod(m_tmp_wij, m_tmp_wij, m_tmp_wij2);
-    // f. Computes \f$E{wij.wij^{T}} = (Id + T^{T} \Sigma^{-1} T)^{-1} + E{wij}.E{wij^{T}}\f$
-    m_tmp_wij2 += m_tmp_tt2; // E{wij.wij^{T}}
+    bob::core::array::assertCZeroBaseContiguous(data[i].n);
+    bob::core::array::assertCZeroBaseContiguous(data[i].sumPx);
+    bob::core::array::assertSameDimensionLength(data[i].sumPx.extent(0), C);
+    bob::core::array::assertSameDimensionLength(data[i].sumPx.extent(1), D);
+    if (m_update_sigma)
+      bob::core::array::assertCZeroBaseContiguous(data[i].sumPxx);
+  }
+  if (data.empty()) return;
+
+  // \f$\Sigma^{-1} T\f$ and the packed upper triangles of
+  // \f$T_{c}^{T} \Sigma_{c}^{-1} T_{c}\f$, which the machine keeps in cache
+  const blitz::Array<double,2>& T = machine.getT();
+  const blitz::Array<double,1>& sigma = machine.getSigma();
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  blitz::Array<double,2> SigmaInvT(C*D, Rt);
+  SigmaInvT = T(i,j) / sigma(i);
+  const blitz::Array<double,3>& TtSigmaInvT = machine.getTctSigmacInvTc();
+  blitz::Array<double,2> Qp(C, P);
+  for (int c=0; c<C; ++c)
+  {
+    int p = 0;
+    for (int r1=0; r1<Rt; ++r1)
+      for (int r2=r1; r2<Rt; ++r2, ++p)
+        Qp(c,p) = TtSigmaInvT(c,r1,r2);
+  }
+  const size_t n_threads = bob::core::thread_count(IVECTOR_ESTEP_BLOCK_SIZE,
+    m_n_threads);
+  std::vector<std::vector<double> > tmp(n_threads,
+    std::vector<double>(2 * Rt * Rt));
+  const blitz::Array<double,1> mean =
+    bob::core::array::ccopy(machine.getUbm()->getMeanSupervector());
 
+  // Packed upper triangles of the accumulators of \f$N_{ijc} E{w_{ij} w_{ij}^{T}}\f$
+  blitz::Array<double,2> acc_Nij_wij2_p(C, P);
+  acc_Nij_wij2_p = 0.;
+  blitz::Array<double,2> acc_Fnormij_wij(m_acc_Fnormij_wij.data(),
+    blitz::shape(C*D, Rt), blitz::neverDeleteData);
+  blitz::Array<double,2> acc_Snormij(m_acc_Snormij.data(),
+    blitz::shape(m_acc_Snormij.extent(0), m_acc_Snormij.extent(1)),
+    blitz::neverDeleteData);
+
+  // Processes the utterances by blocks
+  for (size_t begin=0; begin<data.size(); begin+=IVECTOR_ESTEP_BLOCK_SIZE)
+  {
+    const size_t n = std::min(data.size() - begin, IVECTOR_ESTEP_BLOCK_SIZE);
+    blitz::Array<double,2> N(n, C), Fnorm(n, C*D), U(n, Rt), Lp(n, P),
+      W(n, Rt), W2p(n, P);
+
+    // a. Zeroth and (centered) first order statistics of the block
+    bob::core::thread_blocks(UtteranceStats(data, begin, mean, N, Fnorm, C, D),
+      n, m_n_threads);
+    // b. Computes \f$T^{T} \Sigma^{-1} F_{norm}\f$ for all the utterances
+    GemmChunk u_product(Fnorm, false, SigmaInvT, U, 0., false);
+    bob::core::thread_blocks(u_product, u_product.n_chunks(), m_n_threads);
+    // c. Computes \f$\sum_{c} N_{ijc} T_{c}^{T} \Sigma_{c}^{-1} T_{c}\f$
+    // for all the utterances (packed)
+    GemmChunk l_product(N, false, Qp, Lp, 0., false);
+    bob::core::thread_blocks(l_product, l_product.n_chunks(), m_n_threads);
+    // d. Computes E{wij} and E{wij.wij^{T}} (packed) of each utterance
+    bob::core::thread_blocks(UtterancePosterior(Lp, U, W, W2p, tmp), n,
+      m_n_threads);
+    // e. acc_Nij_wij2_c += sum_j Nijc . E{wij.wij^{T}}, for all c at once
+    GemmChunk w2_product(N, true, W2p, acc_Nij_wij2_p, 1., false);
+    bob::core::thread_blocks(w2_product, w2_product.n_chunks(), m_n_threads);
+    // f. acc_Fnormij_wij += sum_j (Fijc - Nijc * ubmmean_{c}).E{wij}^{T}
+    GemmChunk f_product(Fnorm, true, W, acc_Fnormij_wij, 1., true);
+    bob::core::thread_blocks(f_product, f_product.n_chunks(), m_n_threads);
+    // g. Statistics used to update Sigma
     if (m_update_sigma)
-      m_acc_Nij += (*it).n;
-
-    for (int c=0; c<C; ++c)
-    {
-      blitz::Array<double,2> acc_Nij_wij2_c = m_acc_Nij_wij2(c,rall,rall);
-      blitz::Array<double,2> acc_Fnormij_wij = m_acc_Fnormij_wij(c,rall,rall);
-      // acc_Nij_wij2_c += Nijc . E{wij.wij^{T}}
-      acc_Nij_wij2_c += (*it).n(c) * m_tmp_wij2;
-      blitz::Array<double,1> mc = machine.getUbm()->getGaussian(c)->getMean();
-      // m_tmp_d1 = Fijc - Nijc * ubmmean_{c}
-      m_tmp_d1 = (*it).sumPx(c,rall) - (*it).n(c)*mc; // Fnorm_c
-      // m_tmp_dt1 = (Fijc - Nijc * ubmmean_{c}).E{wij}^{T}
-      bob::math::prod(m_tmp_d1, m_tmp_wij, m_tmp_dt1); 
-      // acc_Fnormij_wij += (Fijc - Nijc * ubmmean_{c}).E{wij}^{T}
-      acc_Fnormij_wij += m_tmp_dt1;
-      if (m_update_sigma)
-      {
-        blitz::Array<double,1> acc_Snormij_c = m_acc_Snormij(c,rall);
-        acc_Snormij_c += (*it).sumPxx(c,rall) - mc*((*it).sumPx(c,rall) + m_tmp_d1);
-      }
-    }
+      bob::core::thread_blocks(SigmaStats(data, begin, n, mean, Fnorm,
+        m_acc_Nij, acc_Snormij, C, D), C, m_n_threads);
   }
+
+  // Unpacks the accumulators of \f$N_{ijc} E{w_{ij} w_{ij}^{T}}\f$
+  bob::core::thread_blocks(UnpackAccumulator(acc_Nij_wij2_p, m_acc_Nij_wij2),
+    C, m_n_threads);
 }
 
 void bob::trainer::IVectorTrainer::mStep(
   bob::machine::IVectorMachine& machine,
   const std::vector<bob::machine::GMMStats>& data)
 {
-  blitz::Range rall = blitz::Range::all();
   blitz::Array<double,2>& T = machine.updateT();
   blitz::Array<double,1>& sigma = machine.updateSigma();
   const int C = (int)machine.getDimC();
-  const int D = (int)machine.getDimD();
-  for (int c=0; c<C; ++c)
+  bob::core::array::assertCZeroBaseContiguous(m_acc_Nij_wij2);
+  bob::core::array::assertCZeroBaseContiguous(m_acc_Fnormij_wij);
+  if (m_update_sigma)
   {
-    // Solves linear system A.T = B to update T, based on accumulators of 
-    // the eStep()
-    blitz::Array<double,2> acc_Nij_wij2_c = m_acc_Nij_wij2(c,rall,rall);
-    blitz::Array<double,2> tacc_Nij_wij2_c = acc_Nij_wij2_c.transpose(1,0);
-    blitz::Array<double,2> acc_Fnormij_wij_c = m_acc_Fnormij_wij(c,rall,rall);
-    blitz::Array<double,2> tacc_Fnormij_wij_c = acc_Fnormij_wij_c.transpose(1,0);
-    blitz::Array<double,2> T_c = T(blitz::Range(c*D,(c+1)*D-1),rall);
-    blitz::Array<double,2> Tt_c = T_c.transpose(1,0);
-    if (blitz::all(acc_Nij_wij2_c == 0)) // TODO
-      Tt_c = 0;
-    else
-      bob::math::linsolve(tacc_Nij_wij2_c, Tt_c, tacc_Fnormij_wij_c);
-    if (m_update_sigma)
-    {
-      blitz::Array<double,1> sigma_c = sigma(blitz::Range(c*D,(c+1)*D-1));
-      bob::math::prod(acc_Fnormij_wij_c, Tt_c, m_tmp_dd1);
-      bob::math::diag(m_tmp_dd1, m_tmp_d1);
-      sigma_c = (m_acc_Snormij(c,rall) - m_tmp_d1) / m_acc_Nij(c);
-    }
+    bob::core::array::assertCZeroBaseContiguous(m_acc_Nij);
+    bob::core::array::assertCZeroBaseContiguous(m_acc_Snormij);
   }
+
+  // The components are updated in parallel, in (contiguous) copies of T
+  // and Sigma
+  blitz::Array<double,2> T_new = bob::core::array::ccopy(T);
+  blitz::Array<double,1> sigma_new = bob::core::array::ccopy(sigma);
+  bob::core::thread_blocks(MStepComponent(m_acc_Nij_wij2, m_acc_Fnormij_wij,
+    m_acc_Nij, m_acc_Snormij, T_new, sigma_new, m_update_sigma), C,
+    m_n_threads);
+  T = T_new;
+  if (m_update_sigma)
+    sigma = sigma_new;
   machine.precompute();
 }
 
@@ -201,20 +520,12 @@ bob::trainer::IVectorTrainer& bob::trainer::IVectorTrainer::operator=
     bob::trainer::EMTrainer<bob::machine::IVectorMachine,
       std::vector<bob::machine::GMMStats> >::operator=(other);
     m_update_sigma = other.m_update_sigma;
+    m_n_threads = other.m_n_threads;
 
     m_acc_Nij_wij2.reference(bob::core::array::ccopy(other.m_acc_Nij_wij2));
     m_acc_Fnormij_wij.reference(bob::core::array::ccopy(other.m_acc_Fnormij_wij));
     m_acc_Nij.reference(bob::core::array::ccopy(other.m_acc_Nij));
     m_acc_Snormij.reference(bob::core::array::ccopy(other.m_acc_Snormij));
-
-    m_tmp_wij.reference(bob::core::array::ccopy(other.m_tmp_wij));
-    m_tmp_wij2.reference(bob::core::array::ccopy(other.m_tmp_wij2));
-    m_tmp_d1.reference(bob::core::array::ccopy(other.m_tmp_d1));
-    m_tmp_t1.reference(bob::core::array::ccopy(other.m_tmp_t1));
-    m_tmp_dd1.reference(bob::core::array::ccopy(other.m_tmp_dd1));
-    m_tmp_dt1.reference(bob::core::array::ccopy(other.m_tmp_dt1));
-    m_tmp_tt1.reference(bob::core::array::ccopy(other.m_tmp_tt1));
-    m_tmp_tt2.reference(bob::core::array::ccopy(other.m_tmp_tt2)); 
   }
   return *this;
 }
@@ -250,3 +561,26 @@ bool bob::trainer::IVectorTrainer::is_similar_to
         bob::core::array::isClose(m_acc_Snormij, other.m_acc_Snormij, r_epsilon, a_epsilon);
 }
 
+
+bool bob::trainer::IVectorTrainer::saveAccumulators(bob::io::HDF5File& file) const
+{
+  file.setArray("acc_Nij_wij2", m_acc_Nij_wij2);
+  file.setArray("acc_Fnormij_wij", m_acc_Fnormij_wij);
+  if (m_update_sigma) {
+    file.setArray("acc_Nij", m_acc_Nij);
+    file.setArray("acc_Snormij", m_acc_Snormij);
+  }
+  return true;
+}
+
+void bob::trainer::IVectorTrainer::loadAccumulators(
+  bob::machine::IVectorMachine& ivector, bob::io::HDF5File& file)
+{
+  // the accumulators have been resized by initialize()
+  file.readArray("acc_Nij_wij2", m_acc_Nij_wij2);
+  file.readArray("acc_Fnormij_wij", m_acc_Fnormij_wij);
+  if (m_update_sigma) {
+    file.readArray("acc_Nij", m_acc_Nij);
+    file.readArray("acc_Snormij", m_acc_Snormij);
+  }
+}
@@ -10,22 +10,85 @@
 
 #include <bob/trainer/JFATrainer.h>
 #include <bob/core/check.h>
+#include <bob/core/assert.h>
 #include <bob/core/array_copy.h>
 #include <bob/core/array_random.h>
+#include <bob/core/parallel.h>
 #include <bob/math/inv.h>
 #include <bob/math/linear.h>
 #include <bob/core/check.h>
 #include <bob/core/array_repmat.h>
 #include <algorithm>
 
+namespace {
+
+  /**
+   * Number of consecutive identities of each block processed by a thread
+   */
+  static const size_t FA_BLOCK_SIZE = 16;
+
+  /**
+   * Processes a block of consecutive identities with the workspace of the
+   * thread. If accumulators are given, the ones of the workspace are set to
+   * zero before the block, and then added to the total accumulators in the
+   * order of the blocks (see bob::core::thread_reduce_blocks()), such that
+   * the result does not depend on the number of threads.
+   */
+  struct FAIdentityBlock {
+    bob::trainer::FABaseTrainer& m_trainer;
+    const bob::trainer::FABaseTrainer::IdentityStep m_step;
+    const bob::machine::FABase& m_machine;
+    const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& m_stats;
+    std::vector<bob::trainer::FABaseTrainer::Workspace>& m_workspaces;
+    double* m_acc_A1;
+    const size_t m_size_A1;
+    double* m_acc_A2;
+    const size_t m_size_A2;
+
+    FAIdentityBlock(bob::trainer::FABaseTrainer& trainer,
+        const bob::trainer::FABaseTrainer::IdentityStep step,
+        const bob::machine::FABase& machine,
+        const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& stats,
+        std::vector<bob::trainer::FABaseTrainer::Workspace>& workspaces,
+        double* acc_A1, const size_t size_A1,
+        double* acc_A2, const size_t size_A2):
+      m_trainer(trainer), m_step(step), m_machine(machine), m_stats(stats),
+      m_workspaces(workspaces), m_acc_A1(acc_A1), m_size_A1(size_A1),
+      m_acc_A2(acc_A2), m_size_A2(size_A2)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      bob::trainer::FABaseTrainer::Workspace& ws = m_workspaces[ith];
+      if (m_acc_A1 != 0) {
+        ws.acc_A1.assign(m_size_A1, 0.);
+        ws.acc_A2.assign(m_size_A2, 0.);
+      }
+      const size_t end = std::min(m_stats.size(), (b+1) * FA_BLOCK_SIZE);
+      for (size_t id=b*FA_BLOCK_SIZE; id<end; ++id)
+        (m_trainer.*m_step)(ws, m_machine, m_stats[id], id);
+    }
+
+    void reduce(const size_t ith, const size_t b) const {
+      const bob::trainer::FABaseTrainer::Workspace& ws = m_workspaces[ith];
+      for (size_t k=0; k<m_size_A1; ++k) m_acc_A1[k] += ws.acc_A1[k];
+      for (size_t k=0; k<m_size_A2; ++k) m_acc_A2[k] += ws.acc_A2[k];
+    }
+  };
+
+}
+
 
 bob::trainer::FABaseTrainer::FABaseTrainer():
   m_Nid(0), m_dim_C(0), m_dim_D(0), m_dim_ru(0), m_dim_rv(0),
+  m_n_threads(0),
   m_x(0), m_y(0), m_z(0), m_Nacc(0), m_Facc(0)
 {
 }
 
-bob::trainer::FABaseTrainer::FABaseTrainer(const bob::trainer::FABaseTrainer& other)
+bob::trainer::FABaseTrainer::FABaseTrainer(const bob::trainer::FABaseTrainer& other):
+  m_Nid(0), m_dim_C(0), m_dim_D(0), m_dim_ru(0), m_dim_rv(0),
+  m_n_threads(other.m_n_threads),
+  m_x(0), m_y(0), m_z(0), m_Nacc(0), m_Facc(0)
 {
 }
 
@@ -143,36 +206,62 @@ void bob::trainer::FABaseTrainer::initCache()
   // U
   m_cache_UtSigmaInv.resize(m_dim_ru, dim_CD);
   m_cache_UProd.resize(m_dim_C, m_dim_ru, m_dim_ru);
-  m_cache_IdPlusUProd_ih.resize(m_dim_ru, m_dim_ru);
-  m_cache_Fn_x_ih.resize(dim_CD);
   m_acc_U_A1.resize(m_dim_C, m_dim_ru, m_dim_ru);
   m_acc_U_A2.resize(dim_CD, m_dim_ru);
   // V
   m_cache_VtSigmaInv.resize(m_dim_rv, dim_CD);
   m_cache_VProd.resize(m_dim_C, m_dim_rv, m_dim_rv);
-  m_cache_IdPlusVProd_i.resize(m_dim_rv, m_dim_rv);
-  m_cache_Fn_y_i.resize(dim_CD);
   m_acc_V_A1.resize(m_dim_C, m_dim_rv, m_dim_rv);
   m_acc_V_A2.resize(dim_CD, m_dim_rv);
   // D
   m_cache_DtSigmaInv.resize(dim_CD);
   m_cache_DProd.resize(dim_CD);
-  m_cache_IdPlusDProd_i.resize(dim_CD);
-  m_cache_Fn_z_i.resize(dim_CD);
   m_acc_D_A1.resize(dim_CD);
   m_acc_D_A2.resize(dim_CD);
 
   // tmp
-  m_tmp_CD.resize(dim_CD);
-  m_tmp_CD_b.resize(dim_CD);
-
-  m_tmp_ru.resize(m_dim_ru);
   m_tmp_ruD.resize(m_dim_ru, m_dim_D);
   m_tmp_ruru.resize(m_dim_ru, m_dim_ru);
-
-  m_tmp_rv.resize(m_dim_rv);
   m_tmp_rvD.resize(m_dim_rv, m_dim_D);
   m_tmp_rvrv.resize(m_dim_rv, m_dim_rv);
+
+  // the workspaces are allocated when needed, with the new dimensions
+  m_workspaces.clear();
+}
+
+void bob::trainer::FABaseTrainer::processIdentities(
+  bob::trainer::FABaseTrainer::IdentityStep step,
+  const bob::machine::FABase& m,
+  const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& stats,
+  double* acc_A1, const size_t size_A1, double* acc_A2, const size_t size_A2)
+{
+  const size_t n_blocks = (stats.size() + FA_BLOCK_SIZE - 1) / FA_BLOCK_SIZE;
+  if (n_blocks == 0) return;
+
+  // Allocates the workspaces of the threads
+  const size_t n_threads = bob::core::thread_count(n_blocks, m_n_threads);
+  const size_t dim_CD = m_dim_C*m_dim_D;
+  for (size_t i=m_workspaces.size(); i<n_threads; ++i) {
+    m_workspaces.push_back(Workspace());
+    Workspace& ws = m_workspaces.back();
+    ws.IdPlusVProd_i.resize(m_dim_rv, m_dim_rv);
+    ws.Fn_y_i.resize(dim_CD);
+    ws.IdPlusUProd_ih.resize(m_dim_ru, m_dim_ru);
+    ws.Fn_x_ih.resize(dim_CD);
+    ws.IdPlusDProd_i.resize(dim_CD);
+    ws.Fn_z_i.resize(dim_CD);
+    ws.tmp_ruru.resize(m_dim_ru, m_dim_ru);
+    ws.tmp_rvrv.resize(m_dim_rv, m_dim_rv);
+    ws.tmp_ru.resize(m_dim_ru);
+    ws.tmp_rv.resize(m_dim_rv);
+    ws.tmp_CD.resize(dim_CD);
+    ws.tmp_CD_b.resize(dim_CD);
+  }
+
+  const FAIdentityBlock op(*this, step, m, stats, m_workspaces, acc_A1,
+    size_A1, acc_A2, size_A2);
+  if (acc_A1 != 0) bob::core::thread_reduce_blocks(op, n_blocks, n_threads);
+  else bob::core::thread_blocks(op, n_blocks, n_threads);
 }
 
 
@@ -208,20 +297,25 @@ void bob::trainer::FABaseTrainer::computeVProd(const bob::machine::FABase& m)
   }
 }
 
-void bob::trainer::FABaseTrainer::computeIdPlusVProd_i(const size_t id)
+void bob::trainer::FABaseTrainer::computeIdPlusVProd_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const size_t id) const
 {
   const blitz::Array<double,1>& Ni = m_Nacc[id];
-  bob::math::eye(m_tmp_rvrv); // m_tmp_rvrv = I
-  blitz::Range rall = blitz::Range::all();
-  for (size_t c=0; c<m_dim_C; ++c) {
-    blitz::Array<double,2> VProd_c = m_cache_VProd(c, rall, rall);
-    m_tmp_rvrv += VProd_c * Ni(c);
-  }
-  bob::math::inv(m_tmp_rvrv, m_cache_IdPlusVProd_i); // m_cache_IdPlusVProd_i = ( I+Vt*diag(sigma)^-1*Ni*V)^-1
-}
-
-void bob::trainer::FABaseTrainer::computeFn_y_i(const bob::machine::FABase& mb,
-  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats, const size_t id)
+  bob::math::eye(ws.tmp_rvrv); // ws.tmp_rvrv = I
+  // The cache is shared by the threads: it is not sliced
+  const double* VProd = m_cache_VProd.data();
+  const size_t size = m_dim_rv*m_dim_rv;
+  double* tmp = ws.tmp_rvrv.data();
+  for (size_t c=0; c<m_dim_C; ++c, VProd+=size)
+    for (size_t k=0; k<size; ++k)
+      tmp[k] += VProd[k] * Ni(c);
+  bob::math::inv(ws.tmp_rvrv, ws.IdPlusVProd_i); // ws.IdPlusVProd_i = ( I+Vt*diag(sigma)^-1*Ni*V)^-1
+}
+
+void bob::trainer::FABaseTrainer::computeFn_y_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& mb,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id) const
 {
   const blitz::Array<double,2>& U = mb.getU();
   const blitz::Array<double,1>& d = mb.getD();
@@ -229,28 +323,66 @@ void bob::trainer::FABaseTrainer::computeFn_y_i(const bob::machine::FABase& mb,
   const blitz::Array<double,1>& Fi = m_Facc[id];
   const blitz::Array<double,1>& m = mb.getUbmMean();
   const blitz::Array<double,1>& z = m_z[id];
-  bob::core::array::repelem(m_Nacc[id], m_tmp_CD);
-  m_cache_Fn_y_i = Fi - m_tmp_CD * (m + d * z); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i})
+  bob::core::array::repelem(m_Nacc[id], ws.tmp_CD);
+  ws.Fn_y_i = Fi - ws.tmp_CD * (m + d * z); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i})
+  // x_{i} is only accessed by the thread processing the identity i
   const blitz::Array<double,2>& X = m_x[id];
   blitz::Range rall = blitz::Range::all();
   for (int h=0; h<X.extent(1); ++h) // Loops over the sessions
   {
     blitz::Array<double,1> Xh = X(rall, h); // Xh = x_{i,h} (length: ru)
-    bob::math::prod(U, Xh, m_tmp_CD_b); // m_tmp_CD_b = U*x_{i,h}
+    bob::math::prod(U, Xh, ws.tmp_CD_b); // ws.tmp_CD_b = U*x_{i,h}
     const blitz::Array<double,1>& Nih = stats[h]->n;
-    bob::core::array::repelem(Nih, m_tmp_CD);
-    m_cache_Fn_y_i -= m_tmp_CD * m_tmp_CD_b; // N_{i,h} * U * x_{i,h}
+    bob::core::array::repelem(Nih, ws.tmp_CD);
+    ws.Fn_y_i -= ws.tmp_CD * ws.tmp_CD_b; // N_{i,h} * U * x_{i,h}
   }
   // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
 }
 
-void bob::trainer::FABaseTrainer::updateY_i(const size_t id)
+void bob::trainer::FABaseTrainer::updateY_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const size_t id)
 {
   // Computes yi = Ayi * Cvs * Fn_yi
   blitz::Array<double,1>& y = m_y[id];
-  // m_tmp_rv = m_cache_VtSigmaInv * m_cache_Fn_y_i = Vt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
-  bob::math::prod(m_cache_VtSigmaInv, m_cache_Fn_y_i, m_tmp_rv);
-  bob::math::prod(m_cache_IdPlusVProd_i, m_tmp_rv, y);
+  // ws.tmp_rv = m_cache_VtSigmaInv * ws.Fn_y_i = Vt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - D*z_{i} - U*x_{i,h})
+  bob::math::prod(m_cache_VtSigmaInv, ws.Fn_y_i, ws.tmp_rv);
+  bob::math::prod(ws.IdPlusVProd_i, ws.tmp_rv, y);
+}
+
+void bob::trainer::FABaseTrainer::estimateY_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& m,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id)
+{
+  computeIdPlusVProd_i(ws, id);
+  computeFn_y_i(ws, m, stats, id);
+  updateY_i(ws, id);
+}
+
+void bob::trainer::FABaseTrainer::accumulateV_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& m,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id)
+{
+  computeIdPlusVProd_i(ws, id);
+  computeFn_y_i(ws, m, stats, id);
+
+  // Needs to return values to be accumulated for estimating V
+  const blitz::Array<double,1>& y = m_y[id];
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  ws.tmp_rvrv = ws.IdPlusVProd_i;
+  ws.tmp_rvrv += y(i) * y(j);
+  const size_t size = m_dim_rv*m_dim_rv;
+  const double* tmp = ws.tmp_rvrv.data();
+  double* A1 = &ws.acc_A1[0];
+  for (size_t c=0; c<m_dim_C; ++c, A1+=size)
+    for (size_t k=0; k<size; ++k)
+      A1[k] += tmp[k] * m_Nacc[id](c);
+  double* A2 = &ws.acc_A2[0];
+  for (size_t k=0; k<m_dim_C*m_dim_D; ++k)
+    for (size_t r=0; r<m_dim_rv; ++r, ++A2)
+      *A2 += ws.Fn_y_i(k) * y(r);
 }
 
 void bob::trainer::FABaseTrainer::updateY(const bob::machine::FABase& m,
@@ -260,11 +392,7 @@ void bob::trainer::FABaseTrainer::updateY(const bob::machine::FABase& m,
   computeVtSigmaInv(m);
   computeVProd(m);
   // Loops over all people
-  for (size_t id=0; id<stats.size(); ++id) {
-    computeIdPlusVProd_i(id);
-    computeFn_y_i(m, stats[id], id);
-    updateY_i(id);
-  }
+  processIdentities(&bob::trainer::FABaseTrainer::estimateY_i, m, stats);
 }
 
 void bob::trainer::FABaseTrainer::computeAccumulatorsV(
@@ -275,24 +403,9 @@ void bob::trainer::FABaseTrainer::computeAccumulatorsV(
   m_acc_V_A1 = 0.;
   m_acc_V_A2 = 0.;
   // Loops over all people
-  blitz::firstIndex i;
-  blitz::secondIndex j;
-  blitz::Range rall = blitz::Range::all();
-  for (size_t id=0; id<stats.size(); ++id) {
-    computeIdPlusVProd_i(id);
-    computeFn_y_i(m, stats[id], id);
-
-    // Needs to return values to be accumulated for estimating V
-    const blitz::Array<double,1>& y = m_y[id];
-    m_tmp_rvrv = m_cache_IdPlusVProd_i;
-    m_tmp_rvrv += y(i) * y(j);
-    for (size_t c=0; c<m_dim_C; ++c)
-    {
-      blitz::Array<double,2> A1_y_c = m_acc_V_A1(c, rall, rall);
-      A1_y_c += m_tmp_rvrv * m_Nacc[id](c);
-    }
-    m_acc_V_A2 += m_cache_Fn_y_i(i) * y(j);
-  }
+  processIdentities(&bob::trainer::FABaseTrainer::accumulateV_i, m, stats,
+    m_acc_V_A1.data(), m_acc_V_A1.numElements(),
+    m_acc_V_A2.data(), m_acc_V_A2.numElements());
 }
 
 void bob::trainer::FABaseTrainer::updateV(blitz::Array<double,2>& V)
@@ -340,19 +453,25 @@ void bob::trainer::FABaseTrainer::computeUProd(const bob::machine::FABase& m)
 }
 
 void bob::trainer::FABaseTrainer::computeIdPlusUProd_ih(
-  const boost::shared_ptr<bob::machine::GMMStats>& stats)
+  bob::trainer::FABaseTrainer::Workspace& ws,
+  const boost::shared_ptr<bob::machine::GMMStats>& stats) const
 {
   const blitz::Array<double,1>& Nih = stats->n;
-  bob::math::eye(m_tmp_ruru); // m_tmp_ruru = I
-  for (size_t c=0; c<m_dim_C; ++c) {
-    blitz::Array<double,2> UProd_c = m_cache_UProd(c,blitz::Range::all(),blitz::Range::all());
-    m_tmp_ruru += UProd_c * Nih(c);
-  }
-  bob::math::inv(m_tmp_ruru, m_cache_IdPlusUProd_ih); // m_cache_IdPlusUProd_ih = ( I+Ut*diag(sigma)^-1*Ni*U)^-1
-}
-
-void bob::trainer::FABaseTrainer::computeFn_x_ih(const bob::machine::FABase& mb,
-  const boost::shared_ptr<bob::machine::GMMStats>& stats, const size_t id)
+  bob::math::eye(ws.tmp_ruru); // ws.tmp_ruru = I
+  // The cache is shared by the threads: it is not sliced
+  const double* UProd = m_cache_UProd.data();
+  const size_t size = m_dim_ru*m_dim_ru;
+  double* tmp = ws.tmp_ruru.data();
+  for (size_t c=0; c<m_dim_C; ++c, UProd+=size)
+    for (size_t k=0; k<size; ++k)
+      tmp[k] += UProd[k] * Nih(c);
+  bob::math::inv(ws.tmp_ruru, ws.IdPlusUProd_ih); // ws.IdPlusUProd_ih = ( I+Ut*diag(sigma)^-1*Ni*U)^-1
+}
+
+void bob::trainer::FABaseTrainer::computeFn_x_ih(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& mb,
+  const boost::shared_ptr<bob::machine::GMMStats>& stats,
+  const size_t id) const
 {
   const blitz::Array<double,2>& V = mb.getV();
   const blitz::Array<double,1>& d =  mb.getD();
@@ -361,26 +480,68 @@ void bob::trainer::FABaseTrainer::computeFn_x_ih(const bob::machine::FABase& mb,
   const blitz::Array<double,1>& m = mb.getUbmMean();
   const blitz::Array<double,1>& z = m_z[id];
   const blitz::Array<double,1>& Nih = stats->n;
-  bob::core::array::repelem(Nih, m_tmp_CD);
-  for (size_t c=0; c<m_dim_C; ++c) {
-    blitz::Array<double,1> Fn_x_ih_c = m_cache_Fn_x_ih(blitz::Range(c*m_dim_D,(c+1)*m_dim_D-1));
-    Fn_x_ih_c = Fih(c,blitz::Range::all());
-  }
-  m_cache_Fn_x_ih -= m_tmp_CD * (m + d * z); // Fn_x_ih = N_{i,h}*(o_{i,h} - m - D*z_{i})
+  bob::core::array::repelem(Nih, ws.tmp_CD);
+  for (size_t c=0; c<m_dim_C; ++c)
+    for (size_t k=0; k<m_dim_D; ++k)
+      ws.Fn_x_ih(c*m_dim_D+k) = Fih(c,k);
+  ws.Fn_x_ih -= ws.tmp_CD * (m + d * z); // Fn_x_ih = N_{i,h}*(o_{i,h} - m - D*z_{i})
 
   const blitz::Array<double,1>& y = m_y[id];
-  bob::math::prod(V, y, m_tmp_CD_b);
-  m_cache_Fn_x_ih -= m_tmp_CD * m_tmp_CD_b;
+  bob::math::prod(V, y, ws.tmp_CD_b);
+  ws.Fn_x_ih -= ws.tmp_CD * ws.tmp_CD_b;
   // Fn_x_ih = N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i})
 }
 
-void bob::trainer::FABaseTrainer::updateX_ih(const size_t id, const size_t h)
+void bob::trainer::FABaseTrainer::updateX_ih(
+  bob::trainer::FABaseTrainer::Workspace& ws, const size_t id, const size_t h)
 {
   // Computes xih = Axih * Cus * Fn_x_ih
+  // x_{i} is only accessed by the thread processing the identity i
   blitz::Array<double,1> x = m_x[id](blitz::Range::all(), h);
-  // m_tmp_ru = m_cache_UtSigmaInv * m_cache_Fn_x_ih = Ut*diag(sigma)^-1 * N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i})
-  bob::math::prod(m_cache_UtSigmaInv, m_cache_Fn_x_ih, m_tmp_ru);
-  bob::math::prod(m_cache_IdPlusUProd_ih, m_tmp_ru, x);
+  // ws.tmp_ru = m_cache_UtSigmaInv * ws.Fn_x_ih = Ut*diag(sigma)^-1 * N_{i,h}*(o_{i,h} - m - D*z_{i} - V*y_{i})
+  bob::math::prod(m_cache_UtSigmaInv, ws.Fn_x_ih, ws.tmp_ru);
+  bob::math::prod(ws.IdPlusUProd_ih, ws.tmp_ru, x);
+}
+
+void bob::trainer::FABaseTrainer::estimateX_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& m,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id)
+{
+  for (size_t h=0; h<stats.size(); ++h) {
+    computeIdPlusUProd_ih(ws, stats[h]);
+    computeFn_x_ih(ws, m, stats[h], id);
+    updateX_ih(ws, id, h);
+  }
+}
+
+void bob::trainer::FABaseTrainer::accumulateU_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& m,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id)
+{
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  const size_t size = m_dim_ru*m_dim_ru;
+  for (size_t h=0; h<stats.size(); ++h) {
+    computeIdPlusUProd_ih(ws, stats[h]);
+    computeFn_x_ih(ws, m, stats[h], id);
+
+    // Needs to return values to be accumulated for estimating U
+    const blitz::Array<double,1> x = m_x[id](blitz::Range::all(), h);
+    ws.tmp_ruru = ws.IdPlusUProd_ih;
+    ws.tmp_ruru += x(i) * x(j);
+    const blitz::Array<double,1>& Nih = stats[h]->n;
+    const double* tmp = ws.tmp_ruru.data();
+    double* A1 = &ws.acc_A1[0];
+    for (size_t c=0; c<m_dim_C; ++c, A1+=size)
+      for (size_t k=0; k<size; ++k)
+        A1[k] += tmp[k] * Nih(c);
+    double* A2 = &ws.acc_A2[0];
+    for (size_t k=0; k<m_dim_C*m_dim_D; ++k)
+      for (size_t r=0; r<m_dim_ru; ++r, ++A2)
+        *A2 += ws.Fn_x_ih(k) * x(r);
+  }
 }
 
 void bob::trainer::FABaseTrainer::updateX(const bob::machine::FABase& m,
@@ -390,14 +551,7 @@ void bob::trainer::FABaseTrainer::updateX(const bob::machine::FABase& m,
   computeUtSigmaInv(m);
   computeUProd(m);
   // Loops over all people
-  for (size_t id=0; id<stats.size(); ++id) {
-    int n_session_i = stats[id].size();
-    for (int s=0; s<n_session_i; ++s) {
-      computeIdPlusUProd_ih(stats[id][s]);
-      computeFn_x_ih(m, stats[id][s], id);
-      updateX_ih(id, s);
-    }
-  }
+  processIdentities(&bob::trainer::FABaseTrainer::estimateX_i, m, stats);
 }
 
 void bob::trainer::FABaseTrainer::computeAccumulatorsU(
@@ -408,27 +562,9 @@ void bob::trainer::FABaseTrainer::computeAccumulatorsU(
   m_acc_U_A1 = 0.;
   m_acc_U_A2 = 0.;
   // Loops over all people
-  blitz::firstIndex i;
-  blitz::secondIndex j;
-  blitz::Range rall = blitz::Range::all();
-  for (size_t id=0; id<stats.size(); ++id) {
-    int n_session_i = stats[id].size();
-    for (int h=0; h<n_session_i; ++h) {
-      computeIdPlusUProd_ih(stats[id][h]);
-      computeFn_x_ih(m, stats[id][h], id);
-
-      // Needs to return values to be accumulated for estimating U
-      blitz::Array<double,1> x = m_x[id](rall, h);
-      m_tmp_ruru = m_cache_IdPlusUProd_ih;
-      m_tmp_ruru += x(i) * x(j);
-      for (int c=0; c<(int)m_dim_C; ++c)
-      {
-        blitz::Array<double,2> A1_x_c = m_acc_U_A1(c,rall,rall);
-        A1_x_c += m_tmp_ruru * stats[id][h]->n(c);
-      }
-      m_acc_U_A2 += m_cache_Fn_x_ih(i) * x(j);
-    }
-  }
+  processIdentities(&bob::trainer::FABaseTrainer::accumulateU_i, m, stats,
+    m_acc_U_A1.data(), m_acc_U_A1.numElements(),
+    m_acc_U_A2.data(), m_acc_U_A2.numElements());
 }
 
 void bob::trainer::FABaseTrainer::updateU(blitz::Array<double,2>& U)
@@ -459,18 +595,20 @@ void bob::trainer::FABaseTrainer::computeDProd(const bob::machine::FABase& m)
   m_cache_DProd = d / sigma * d; // Dt * diag(sigma)^-1 * D
 }
 
-void bob::trainer::FABaseTrainer::computeIdPlusDProd_i(const size_t id)
+void bob::trainer::FABaseTrainer::computeIdPlusDProd_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const size_t id) const
 {
   const blitz::Array<double,1>& Ni = m_Nacc[id];
-  bob::core::array::repelem(Ni, m_tmp_CD); // m_tmp_CD = Ni 'repmat'
-  m_cache_IdPlusDProd_i = 1.; // m_cache_IdPlusDProd_i = Id
-  m_cache_IdPlusDProd_i += m_cache_DProd * m_tmp_CD; // m_cache_IdPlusDProd_i = I+Dt*diag(sigma)^-1*Ni*D
-  m_cache_IdPlusDProd_i = 1 / m_cache_IdPlusDProd_i; // m_cache_IdPlusVProd_i = (I+Dt*diag(sigma)^-1*Ni*D)^-1
+  bob::core::array::repelem(Ni, ws.tmp_CD); // ws.tmp_CD = Ni 'repmat'
+  ws.IdPlusDProd_i = 1.; // ws.IdPlusDProd_i = Id
+  ws.IdPlusDProd_i += m_cache_DProd * ws.tmp_CD; // ws.IdPlusDProd_i = I+Dt*diag(sigma)^-1*Ni*D
+  ws.IdPlusDProd_i = 1 / ws.IdPlusDProd_i; // ws.IdPlusVProd_i = (I+Dt*diag(sigma)^-1*Ni*D)^-1
 }
 
 void bob::trainer::FABaseTrainer::computeFn_z_i(
-  const bob::machine::FABase& mb,
-  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats, const size_t id)
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& mb,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id) const
 {
   const blitz::Array<double,2>& U = mb.getU();
   const blitz::Array<double,2>& V = mb.getV();
@@ -478,29 +616,58 @@ void bob::trainer::FABaseTrainer::computeFn_z_i(
   const blitz::Array<double,1>& Fi = m_Facc[id];
   const blitz::Array<double,1>& m = mb.getUbmMean();
   const blitz::Array<double,1>& y = m_y[id];
-  bob::core::array::repelem(m_Nacc[id], m_tmp_CD);
-  bob::math::prod(V, y, m_tmp_CD_b); // m_tmp_CD_b = V * y
-  m_cache_Fn_z_i = Fi - m_tmp_CD * (m + m_tmp_CD_b); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i})
+  bob::core::array::repelem(m_Nacc[id], ws.tmp_CD);
+  bob::math::prod(V, y, ws.tmp_CD_b); // ws.tmp_CD_b = V * y
+  ws.Fn_z_i = Fi - ws.tmp_CD * (m + ws.tmp_CD_b); // Fn_yi = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i})
 
+  // x_{i} is only accessed by the thread processing the identity i
   const blitz::Array<double,2>& X = m_x[id];
   blitz::Range rall = blitz::Range::all();
   for (int h=0; h<X.extent(1); ++h) // Loops over the sessions
   {
     const blitz::Array<double,1>& Nh = stats[h]->n; // Nh = N_{i,h} (length: C)
-    bob::core::array::repelem(Nh, m_tmp_CD);
+    bob::core::array::repelem(Nh, ws.tmp_CD);
     blitz::Array<double,1> Xh = X(rall, h); // Xh = x_{i,h} (length: ru)
-    bob::math::prod(U, Xh, m_tmp_CD_b);
-    m_cache_Fn_z_i -= m_tmp_CD * m_tmp_CD_b;
+    bob::math::prod(U, Xh, ws.tmp_CD_b);
+    ws.Fn_z_i -= ws.tmp_CD * ws.tmp_CD_b;
   }
   // Fn_z_i = sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
 }
 
-void bob::trainer::FABaseTrainer::updateZ_i(const size_t id)
+void bob::trainer::FABaseTrainer::updateZ_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const size_t id)
 {
   // Computes zi = Azi * D^T.Sigma^-1 * Fn_zi
   blitz::Array<double,1>& z = m_z[id];
-  // m_tmp_CD = m_cache_DtSigmaInv * m_cache_Fn_z_i = Dt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
-  z = m_cache_IdPlusDProd_i * m_cache_DtSigmaInv * m_cache_Fn_z_i;
+  // ws.tmp_CD = m_cache_DtSigmaInv * ws.Fn_z_i = Dt*diag(sigma)^-1 * sum_{sessions h}(N_{i,h}*(o_{i,h} - m - V*y_{i} - U*x_{i,h})
+  z = ws.IdPlusDProd_i * m_cache_DtSigmaInv * ws.Fn_z_i;
+}
+
+void bob::trainer::FABaseTrainer::estimateZ_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& m,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id)
+{
+  computeIdPlusDProd_i(ws, id);
+  computeFn_z_i(ws, m, stats, id);
+  updateZ_i(ws, id);
+}
+
+void bob::trainer::FABaseTrainer::accumulateD_i(
+  bob::trainer::FABaseTrainer::Workspace& ws, const bob::machine::FABase& m,
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  const size_t id)
+{
+  computeIdPlusDProd_i(ws, id);
+  computeFn_z_i(ws, m, stats, id);
+
+  // Needs to return values to be accumulated for estimating D
+  const blitz::Array<double,1>& z = m_z[id];
+  bob::core::array::repelem(m_Nacc[id], ws.tmp_CD);
+  for (size_t k=0; k<m_dim_C*m_dim_D; ++k) {
+    ws.acc_A1[k] += (ws.IdPlusDProd_i(k) + z(k) * z(k)) * ws.tmp_CD(k);
+    ws.acc_A2[k] += ws.Fn_z_i(k) * z(k);
+  }
 }
 
 void bob::trainer::FABaseTrainer::updateZ(const bob::machine::FABase& m,
@@ -510,11 +677,7 @@ void bob::trainer::FABaseTrainer::updateZ(const bob::machine::FABase& m,
   computeDtSigmaInv(m);
   computeDProd(m);
   // Loops over all people
-  for (size_t id=0; id<m_Nid; ++id) {
-    computeIdPlusDProd_i(id);
-    computeFn_z_i(m, stats[id], id);
-    updateZ_i(id);
-  }
+  processIdentities(&bob::trainer::FABaseTrainer::estimateZ_i, m, stats);
 }
 
 void bob::trainer::FABaseTrainer::computeAccumulatorsD(
@@ -525,18 +688,9 @@ void bob::trainer::FABaseTrainer::computeAccumulatorsD(
   m_acc_D_A1 = 0.;
   m_acc_D_A2 = 0.;
   // Loops over all people
-  blitz::firstIndex i;
-  blitz::secondIndex j;
-  for (size_t id=0; id<stats.size(); ++id) {
-    computeIdPlusDProd_i(id);
-    computeFn_z_i(m, stats[id], id);
-
-    // Needs to return values to be accumulated for estimating D
-    blitz::Array<double,1> z = m_z[id];
-    bob::core::array::repelem(m_Nacc[id], m_tmp_CD);
-    m_acc_D_A1 += (m_cache_IdPlusDProd_i + z * z) * m_tmp_CD;
-    m_acc_D_A2 += m_cache_Fn_z_i * z;
-  }
+  processIdentities(&bob::trainer::FABaseTrainer::accumulateD_i, m, stats,
+    m_acc_D_A1.data(), m_acc_D_A1.numElements(),
+    m_acc_D_A2.data(), m_acc_D_A2.numElements());
 }
 
 void bob::trainer::FABaseTrainer::updateD(blitz::Array<double,1>& d)
@@ -558,6 +712,7 @@ bob::trainer::ISVTrainer::ISVTrainer(const bob::trainer::ISVTrainer& other):
   EMTrainer<bob::machine::ISVBase, std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > > >
     (other.m_convergence_threshold, other.m_max_iterations,
      other.m_compute_likelihood),
+  m_base_trainer(other.m_base_trainer),
   m_relevance_factor(other.m_relevance_factor)
 {
 }
@@ -574,6 +729,7 @@ bob::trainer::ISVTrainer& bob::trainer::ISVTrainer::operator=
     bob::trainer::EMTrainer<bob::machine::ISVBase,
       std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > > >::operator=(other);
     m_relevance_factor = other.m_relevance_factor;
+    m_base_trainer.setNThreads(other.m_base_trainer.getNThreads());
   }
   return *this;
 }
@@ -668,6 +824,29 @@ void bob::trainer::ISVTrainer::enrol(bob::machine::ISVMachine& machine,
   machine.setZ(z);
 }
 
+void bob::trainer::ISVTrainer::enrol(const bob::machine::ISVBase& machine,
+  const std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > >& ar,
+  const size_t n_iter, blitz::Array<double,2>& z)
+{
+  const bob::machine::FABase& fb = machine.getBase();
+  bob::core::array::assertSameDimensionLength(z.extent(0), ar.size());
+  bob::core::array::assertSameDimensionLength(z.extent(1), fb.getDimCD());
+
+  // The clients are independent: they are processed as the identities of
+  // a single set, such that updateX() and updateZ() process them in parallel
+  m_base_trainer.initUbmNidSumStatistics(fb, ar);
+  m_base_trainer.initializeXYZ(ar);
+
+  for (size_t i=0; i<n_iter; ++i) {
+    m_base_trainer.updateX(fb, ar);
+    m_base_trainer.updateZ(fb, ar);
+  }
+
+  const std::vector<blitz::Array<double,1> >& zs = m_base_trainer.getZ();
+  for (size_t i=0; i<zs.size(); ++i)
+    z(i, blitz::Range::all()) = zs[i];
+}
+
 
 
 //////////////////////////// JFATrainer ///////////////////////////
@@ -677,7 +856,8 @@ bob::trainer::JFATrainer::JFATrainer(const size_t max_iterations):
 }
 
 bob::trainer::JFATrainer::JFATrainer(const bob::trainer::JFATrainer& other):
-  m_max_iterations(other.m_max_iterations), m_rng(other.m_rng)
+  m_max_iterations(other.m_max_iterations), m_rng(other.m_rng),
+  m_base_trainer(other.m_base_trainer)
 {
 }
 
@@ -692,6 +872,7 @@ bob::trainer::JFATrainer& bob::trainer::JFATrainer::operator=
   {
     m_max_iterations = other.m_max_iterations;
     m_rng = other.m_rng;
+    m_base_trainer.setNThreads(other.m_base_trainer.getNThreads());
   }
   return *this;
 }
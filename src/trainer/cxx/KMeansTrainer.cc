@@ -9,91 +9,83 @@
 
 #include <bob/trainer/KMeansTrainer.h>
 #include <bob/core/array_copy.h>
+#include <bob/core/check.h>
+#include <bob/core/assert.h>
+#include <bob/core/logging.h>
+#include <bob/core/parallel.h>
 #include <boost/random.hpp>
+#include <boost/format.hpp>
+#include <limits>
+#include <sstream>
 
 #if BOOST_VERSION >= 104700
 #include <boost/random/discrete_distribution.hpp>
 #endif
 
-bob::trainer::KMeansTrainer::KMeansTrainer(double convergence_threshold,
-    size_t max_iterations, bool compute_likelihood, InitializationMethod i_m):
-  bob::trainer::EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >(
-    convergence_threshold, max_iterations, compute_likelihood), 
-  m_initialization_method(i_m),
-  m_rng(new boost::mt19937()), m_average_min_distance(0),
-  m_zeroethOrderStats(0), m_firstOrderStats(0,0)
-{
-}
+namespace {
 
-bob::trainer::KMeansTrainer::KMeansTrainer(const bob::trainer::KMeansTrainer& other):
-  bob::trainer::EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >(
-    other.m_convergence_threshold, other.m_max_iterations, other.m_compute_likelihood), 
-  m_initialization_method(other.m_initialization_method),
-  m_rng(other.m_rng), m_average_min_distance(other.m_average_min_distance),
-  m_zeroethOrderStats(bob::core::array::ccopy(other.m_zeroethOrderStats)), 
-  m_firstOrderStats(bob::core::array::ccopy(other.m_firstOrderStats))
-{
-}
- 
-bob::trainer::KMeansTrainer& bob::trainer::KMeansTrainer::operator=
-(const bob::trainer::KMeansTrainer& other) 
-{
-  if(this != &other)
-  {
-    EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::operator=(other);
-    m_initialization_method = other.m_initialization_method;
-    m_rng = other.m_rng;
-    m_average_min_distance = other.m_average_min_distance;
-    m_zeroethOrderStats.reference(bob::core::array::ccopy(other.m_zeroethOrderStats));
-    m_firstOrderStats.reference(bob::core::array::ccopy(other.m_firstOrderStats));
-  }
-  return *this;
-}
+  /**
+   * Number of samples of the blocks processed by
+   * KMeansMachine::getClosestMeans(). The blocks of a sampler should be
+   * made of such blocks, for the results to be the ones obtained in memory.
+   */
+  static const size_t KMEANS_SAMPLER_BLOCK_MULTIPLE = 256;
 
-bool bob::trainer::KMeansTrainer::operator==(const bob::trainer::KMeansTrainer& b) const {
-  return EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::operator==(b) &&
-         m_initialization_method == b.m_initialization_method &&
-         *m_rng == *(b.m_rng) && m_average_min_distance == b.m_average_min_distance &&
-         bob::core::array::hasSameShape(m_zeroethOrderStats, b.m_zeroethOrderStats) &&
-         bob::core::array::hasSameShape(m_firstOrderStats, b.m_firstOrderStats) &&
-         blitz::all(m_zeroethOrderStats == b.m_zeroethOrderStats) &&
-         blitz::all(m_firstOrderStats == b.m_firstOrderStats);
-}
+  /**
+   * Gives access to the samples of an in-memory array
+   */
+  struct ArraySamples {
+    const blitz::Array<double,2>& m_ar;
 
-bool bob::trainer::KMeansTrainer::operator!=(const bob::trainer::KMeansTrainer& b) const {
-  return !(this->operator==(b));
-}
- 
-void bob::trainer::KMeansTrainer::initialize(bob::machine::KMeansMachine& kmeans,
-  const blitz::Array<double,2>& ar) 
-{
-  // split data into as many chunks as there are means
-  size_t n_data = ar.extent(0);
- 
-  // assign the i'th mean to a random example within the i'th chunk
-  blitz::Range a = blitz::Range::all();
-#if BOOST_VERSION >= 104700
-  if(m_initialization_method == RANDOM || m_initialization_method == RANDOM_NO_DUPLICATE) // Random initialization
-#endif
+    ArraySamples(const blitz::Array<double,2>& ar): m_ar(ar) {}
+
+    size_t size() const { return m_ar.extent(0); }
+
+    void get(const size_t index, blitz::Array<double,1>& sample) const
+    { sample = m_ar((int)index, blitz::Range::all()); }
+  };
+
+  /**
+   * Gives access to the samples of a sampler, by reading them
+   */
+  struct SamplerSamples {
+    bob::trainer::HDF5Sampler& m_sampler;
+
+    SamplerSamples(bob::trainer::HDF5Sampler& sampler): m_sampler(sampler) {}
+
+    size_t size() const { return m_sampler.getNSamples(); }
+
+    void get(const size_t index, blitz::Array<double,1>& sample) const
+    { m_sampler.read(index, sample); }
+  };
+
+  /**
+   * Splits the samples into as many chunks as there are means, and sets the
+   * i'th mean to a random sample within the i'th chunk
+   */
+  template <typename T_samples>
+  void randomInitialization(bob::machine::KMeansMachine& kmeans,
+    const T_samples& samples, const bool no_duplicate, boost::mt19937& rng)
   {
-    unsigned int n_chunk = n_data / kmeans.getNMeans();
+    unsigned int n_chunk = samples.size() / kmeans.getNMeans();
     size_t n_max_trials = (size_t)n_chunk * 5;
     blitz::Array<double,1> cur_mean;
-    if(m_initialization_method == RANDOM_NO_DUPLICATE)
+    if(no_duplicate)
       cur_mean.resize(kmeans.getNInputs());
- 
+    blitz::Array<double,1> mean(kmeans.getNInputs());
+
     for(size_t i=0; i<kmeans.getNMeans(); ++i) 
     {
       boost::uniform_int<> range(i*n_chunk, (i+1)*n_chunk-1);
-      boost::variate_generator<boost::mt19937&, boost::uniform_int<> > die(*m_rng, range);
+      boost::variate_generator<boost::mt19937&, boost::uniform_int<> > die(rng, range);
       
       // get random index within chunk
       unsigned int index = die();
 
       // get the example at that index
-      blitz::Array<double, 1> mean = ar(index,a);
+      samples.get(index, mean);
 
-      if(m_initialization_method == RANDOM_NO_DUPLICATE)
+      if(no_duplicate)
       {
         size_t count = 0;
         while(count < n_max_trials)
@@ -112,7 +104,7 @@ void bob::trainer::KMeansTrainer::initialize(bob::machine::KMeansMachine& kmeans
           else
           {
             index = die();
-            mean = ar(index,a);
+            samples.get(index, mean);
             ++count;
           }
         }
@@ -128,48 +120,357 @@ void bob::trainer::KMeansTrainer::initialize(bob::machine::KMeansMachine& kmeans
       kmeans.setMean(i, mean);
     }
   }
+
+  /**
+   * Performs an E-step by streaming the data of a sampler
+   */
+  struct StreamEStep {
+    bob::trainer::KMeansTrainer& m_trainer;
+    bob::machine::KMeansMachine& m_kmeans;
+    bob::trainer::HDF5Sampler& m_sampler;
+
+    StreamEStep(bob::trainer::KMeansTrainer& trainer,
+        bob::machine::KMeansMachine& kmeans, bob::trainer::HDF5Sampler& sampler):
+      m_trainer(trainer), m_kmeans(kmeans), m_sampler(sampler)
+    {}
+
+    void operator()() const { m_trainer.eStep(m_kmeans, m_sampler); }
+  };
+
+  /**
+   * Returns C-contiguous samples, which could be accessed from raw pointers
+   */
+  blitz::Array<double,2> contiguousSamples(const blitz::Array<double,2>& ar)
+  {
+    if (bob::core::array::isCZeroBaseContiguous(ar)) return ar;
+    return bob::core::array::ccopy(ar);
+  }
+
+  /**
+   * Accumulates the zeroth and first order statistics of the samples which
+   * are the closest to a range of means. Each thread owns the accumulators
+   * of its means, and visits the samples in order, such that the statistics
+   * do not depend on the number of threads.
+   */
+  struct KMeansAccumulate {
+    const double* m_X; ///< N x D samples
+    const size_t* m_closest; ///< N closest means
+    double* m_zeroeth; ///< K zeroeth order statistics
+    double* m_first; ///< K x D first order statistics
+    const size_t m_n_samples;
+    const size_t m_dim_d;
+
+    KMeansAccumulate(const double* X, const size_t* closest, double* zeroeth,
+        double* first, const size_t n_samples, const size_t dim_d):
+      m_X(X), m_closest(closest), m_zeroeth(zeroeth), m_first(first),
+      m_n_samples(n_samples), m_dim_d(dim_d)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t begin, const size_t end) const
+    {
+      for (size_t i=0; i<m_n_samples; ++i) {
+        const size_t k = m_closest[i];
+        if (k < begin || k >= end) continue;
+        m_zeroeth[k] += 1.;
+        const double* x = m_X + i*m_dim_d;
+        double* f = m_first + k*m_dim_d;
+        for (size_t j=0; j<m_dim_d; ++j) f[j] += x[j];
+      }
+    }
+  };
+
+  /**
+   * Accumulates the statistics of the given samples into the (C-contiguous)
+   * accumulators, and adds their min distances to sum_distances
+   */
+  void accumulateStatistics(const blitz::Array<double,2>& ar,
+    const blitz::Array<size_t,1>& closest_means,
+    const blitz::Array<double,1>& min_distances,
+    blitz::Array<double,1>& zeroeth, blitz::Array<double,2>& first,
+    double& sum_distances, const size_t n_threads)
+  {
+    const int n_samples = ar.extent(0);
+    for (int i=0; i<n_samples; ++i) sum_distances += min_distances(i);
+
+    const blitz::Array<double,2> X = contiguousSamples(ar);
+    const blitz::Array<size_t,1> closest = bob::core::array::isCZeroBaseContiguous(closest_means) ?
+      closest_means : bob::core::array::ccopy(closest_means);
+    bob::core::thread_loop(KMeansAccumulate(X.data(), closest.data(),
+      zeroeth.data(), first.data(), n_samples, X.extent(1)),
+      zeroeth.extent(0), n_threads);
+  }
+
+  /**
+   * Updates the (square Euclidean) distances of a range of samples to their
+   * closest mean, when a new mean is added
+   */
+  struct KMeansUpdateMinDistances {
+    const double* m_X; ///< N x D samples
+    const double* m_mean; ///< D new mean
+    double* m_min_distances; ///< N min distances
+    const size_t m_dim_d;
+
+    KMeansUpdateMinDistances(const double* X, const double* mean,
+        double* min_distances, const size_t dim_d):
+      m_X(X), m_mean(mean), m_min_distances(min_distances), m_dim_d(dim_d)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t begin, const size_t end) const
+    {
+      for (size_t i=begin; i<end; ++i) {
+        const double* x = m_X + i*m_dim_d;
+        double d = 0.;
+        for (size_t j=0; j<m_dim_d; ++j) {
+          const double diff = m_mean[j] - x[j];
+          d += diff * diff;
+        }
+        m_min_distances[i] = std::min(m_min_distances[i], d);
+      }
+    }
+  };
+
 #if BOOST_VERSION >= 104700
-  else // K-Means++
+  /**
+   * k-means++ initialization. Each new mean is drawn with probabilities
+   * proportional to the squared distances of the samples to their closest
+   * mean, which are only updated with the last chosen mean.
+   */
+  void kmeansPlusPlusInitialization(bob::machine::KMeansMachine& kmeans,
+    const blitz::Array<double,2>& ar, boost::mt19937& rng,
+    const size_t n_threads)
   {
+    const blitz::Array<double,2> X = contiguousSamples(ar);
+    const size_t n_data = X.extent(0);
+    const size_t dim_d = X.extent(1);
+    blitz::Range a = blitz::Range::all();
+
     // 1.a. Selects one sample randomly
     boost::uniform_int<> range(0, n_data-1);
-    boost::variate_generator<boost::mt19937&, boost::uniform_int<> > die(*m_rng, range);
-    //   Gets the example at a random index
-    blitz::Array<double,1> mean = ar(die(),a);
-    kmeans.setMean(0, mean);
+    boost::variate_generator<boost::mt19937&, boost::uniform_int<> > die(rng, range);
+    size_t index = die();
+    kmeans.setMean(0, X((int)index,a));
 
     // 1.b. Loops, computes probability distribution and select samples accordingly
+    blitz::Array<double,1> min_distances(n_data);
+    min_distances = std::numeric_limits<double>::infinity();
     blitz::Array<double,1> weights(n_data);
     for(size_t m=1; m<kmeans.getNMeans(); ++m) 
     {
-      // For each sample, puts the distance to the closest mean in the weight vector
-      for(size_t s=0; s<n_data; ++s)
-      {
-        blitz::Array<double,1> s_cur = ar(s,a);
-        double& w_cur = weights(s);
-        // Initializes with the distance to first mean
-        w_cur = kmeans.getDistanceFromMean(s_cur, 0);
-        // Loops over the remaining mean and update the mean distance if required
-        for(size_t i=1; i<m; ++i)
-          w_cur = std::min(w_cur, kmeans.getDistanceFromMean(s_cur, i));
-      }
+      // Updates the distance of each sample to its closest mean with the
+      // distance to the last chosen mean
+      bob::core::thread_loop(KMeansUpdateMinDistances(X.data(),
+        X.data() + index*dim_d, min_distances.data(), dim_d), n_data,
+        n_threads);
       // Square and normalize the weights vectors such that
       // \f$weights[x] = D(x)^{2} \sum_{y} D(y)^{2}\f$
-      weights = blitz::pow2(weights);
+      weights = blitz::pow2(min_distances);
       weights /= blitz::sum(weights);
 
       // Takes a sample according to the weights distribution
       // Blitz iterators is fine as the weights array should be C-style contiguous
-      bob::core::array::assertCContiguous(weights);
       boost::random::discrete_distribution<> die2(weights.begin(), weights.end());
-      blitz::Array<double,1> new_mean = ar(die2(*m_rng),a); 
-      kmeans.setMean(m, new_mean);
+      index = die2(rng);
+      kmeans.setMean(m, X((int)index,a));
+    }
+  }
+
+  /**
+   * k-means|| initialization (Bahmani et al., "Scalable k-means++", 2012)
+   */
+  void kmeansParallelInitialization(bob::machine::KMeansMachine& kmeans,
+    const blitz::Array<double,2>& X, boost::mt19937& rng,
+    const size_t n_rounds, const double oversampling, const size_t n_threads)
+  {
+    const size_t n_data = X.extent(0);
+    const size_t n_means = kmeans.getNMeans();
+    blitz::Range a = blitz::Range::all();
+    boost::uniform_int<> range(0, n_data-1);
+    boost::variate_generator<boost::mt19937&, boost::uniform_int<> > die(rng, range);
+    boost::uniform_real<> range01(0., 1.);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > uniform(rng, range01);
+
+    // 1. Starts with one sample selected randomly, and samples the
+    // candidates of each round independently, with probabilities
+    // proportional to the distances of the samples to their closest
+    // candidate. The distances to the candidates of a round are computed
+    // at once by a KMeansMachine.
+    std::vector<size_t> candidates;
+    std::vector<size_t> new_candidates(1, die());
+    blitz::Array<double,1> min_distances(n_data);
+    min_distances = std::numeric_limits<double>::infinity();
+    blitz::Array<size_t,1> closest(n_data);
+    closest = 0;
+    blitz::Array<size_t,1> new_closest(n_data);
+    blitz::Array<double,1> new_distances(n_data);
+    for (size_t round=0; ; ++round) {
+      if (!new_candidates.empty()) {
+        blitz::Array<double,2> new_means(new_candidates.size(), X.extent(1));
+        for (size_t c=0; c<new_candidates.size(); ++c)
+          new_means((int)c,a) = X((int)new_candidates[c],a);
+        bob::machine::KMeansMachine(new_means).getClosestMeans(X, new_closest,
+          new_distances, n_threads);
+        for (size_t i=0; i<n_data; ++i) {
+          if (new_distances(i) < min_distances(i)) {
+            // the expansion used by getClosestMeans() might be slightly negative
+            min_distances(i) = std::max(new_distances(i), 0.);
+            closest(i) = candidates.size() + new_closest(i);
+          }
+        }
+        candidates.insert(candidates.end(), new_candidates.begin(),
+          new_candidates.end());
+        new_candidates.clear();
+      }
+      if (round == n_rounds) break;
+
+      const double cost = blitz::sum(min_distances);
+      if (cost <= 0.) break;
+      const double factor = oversampling * n_means / cost;
+      for (size_t i=0; i<n_data; ++i)
+        if (uniform() < factor * min_distances(i)) new_candidates.push_back(i);
+    }
+
+    // 2. Not enough candidates (e.g. duplicated samples): random samples
+    // complete them
+    const size_t n_candidates = candidates.size();
+    if (n_candidates <= n_means) {
+      for (size_t m=0; m<n_means; ++m)
+        kmeans.setMean(m, X((int)(m < n_candidates ? candidates[m] : die()),a));
+      return;
+    }
+
+    // 3. Weights the candidates by the number of samples they are the
+    // closest to, and reclusters them with a weighted k-means++
+    std::vector<double> weights(n_candidates, 0.);
+    for (size_t i=0; i<n_data; ++i) weights[closest(i)] += 1.;
+    std::vector<double> candidate_distances(n_candidates,
+      std::numeric_limits<double>::infinity());
+    std::vector<double> probabilities(n_candidates);
+    size_t chosen = boost::random::discrete_distribution<>(weights.begin(),
+      weights.end())(rng);
+    for (size_t m=0; ; ++m) {
+      const blitz::Array<double,1> mean = X((int)candidates[chosen],a);
+      kmeans.setMean(m, mean);
+      if (m+1 == n_means) break;
+
+      double sum = 0.;
+      for (size_t c=0; c<n_candidates; ++c) {
+        candidate_distances[c] = std::min(candidate_distances[c],
+          blitz::sum(blitz::pow2(X((int)candidates[c],a) - mean)));
+        probabilities[c] = weights[c] * candidate_distances[c];
+        sum += probabilities[c];
+      }
+      // all the candidates are identical to the chosen means
+      if (sum <= 0.) std::fill(probabilities.begin(), probabilities.end(), 1.);
+      chosen = boost::random::discrete_distribution<>(probabilities.begin(),
+        probabilities.end())(rng);
     }
   }
 #endif
+
+}
+
+bob::trainer::KMeansTrainer::KMeansTrainer(double convergence_threshold,
+    size_t max_iterations, bool compute_likelihood, InitializationMethod i_m):
+  bob::trainer::EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >(
+    convergence_threshold, max_iterations, compute_likelihood), 
+  m_initialization_method(i_m),
+  m_rng(new boost::mt19937()), m_average_min_distance(0),
+  m_zeroethOrderStats(0), m_firstOrderStats(0,0), m_pruning(false),
+  m_kmeans_parallel_rounds(5), m_kmeans_parallel_oversampling(2.),
+  m_mini_batch_size(0), m_n_threads(0)
+{
+}
+
+bob::trainer::KMeansTrainer::KMeansTrainer(const bob::trainer::KMeansTrainer& other):
+  bob::trainer::EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >(
+    other.m_convergence_threshold, other.m_max_iterations, other.m_compute_likelihood), 
+  m_initialization_method(other.m_initialization_method),
+  m_rng(other.m_rng), m_average_min_distance(other.m_average_min_distance),
+  m_zeroethOrderStats(bob::core::array::ccopy(other.m_zeroethOrderStats)), 
+  m_firstOrderStats(bob::core::array::ccopy(other.m_firstOrderStats)),
+  m_pruning(other.m_pruning),
+  m_kmeans_parallel_rounds(other.m_kmeans_parallel_rounds),
+  m_kmeans_parallel_oversampling(other.m_kmeans_parallel_oversampling),
+  m_mini_batch_size(other.m_mini_batch_size),
+  m_mini_batch_counts(bob::core::array::ccopy(other.m_mini_batch_counts)),
+  m_n_threads(other.m_n_threads)
+{
+}
+ 
+bob::trainer::KMeansTrainer& bob::trainer::KMeansTrainer::operator=
+(const bob::trainer::KMeansTrainer& other) 
+{
+  if(this != &other)
+  {
+    EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::operator=(other);
+    m_initialization_method = other.m_initialization_method;
+    m_rng = other.m_rng;
+    m_average_min_distance = other.m_average_min_distance;
+    m_zeroethOrderStats.reference(bob::core::array::ccopy(other.m_zeroethOrderStats));
+    m_firstOrderStats.reference(bob::core::array::ccopy(other.m_firstOrderStats));
+    m_pruning = other.m_pruning;
+    m_closest_means.resize(0);
+    m_kmeans_parallel_rounds = other.m_kmeans_parallel_rounds;
+    m_kmeans_parallel_oversampling = other.m_kmeans_parallel_oversampling;
+    m_mini_batch_size = other.m_mini_batch_size;
+    m_mini_batch_counts.reference(bob::core::array::ccopy(other.m_mini_batch_counts));
+    m_n_threads = other.m_n_threads;
+  }
+  return *this;
+}
+
+bool bob::trainer::KMeansTrainer::operator==(const bob::trainer::KMeansTrainer& b) const {
+  return EMTrainer<bob::machine::KMeansMachine, blitz::Array<double,2> >::operator==(b) &&
+         m_initialization_method == b.m_initialization_method &&
+         *m_rng == *(b.m_rng) && m_average_min_distance == b.m_average_min_distance &&
+         bob::core::array::hasSameShape(m_zeroethOrderStats, b.m_zeroethOrderStats) &&
+         bob::core::array::hasSameShape(m_firstOrderStats, b.m_firstOrderStats) &&
+         blitz::all(m_zeroethOrderStats == b.m_zeroethOrderStats) &&
+         blitz::all(m_firstOrderStats == b.m_firstOrderStats);
+}
+
+bool bob::trainer::KMeansTrainer::operator!=(const bob::trainer::KMeansTrainer& b) const {
+  return !(this->operator==(b));
+}
+
+void bob::trainer::KMeansTrainer::setKMeansParallelOversampling(const double oversampling)
+{
+  if (oversampling <= 0.) {
+    boost::format m("KMeansTrainer: the oversampling factor of the k-means|| initialization should be strictly positive (got %f)");
+    m % oversampling;
+    throw std::runtime_error(m.str());
+  }
+  m_kmeans_parallel_oversampling = oversampling;
+}
+ 
+void bob::trainer::KMeansTrainer::initialize(bob::machine::KMeansMachine& kmeans,
+  const blitz::Array<double,2>& ar) 
+{
+  // assign the i'th mean to a random example within the i'th chunk
+#if BOOST_VERSION >= 104700
+  if(m_initialization_method == RANDOM || m_initialization_method == RANDOM_NO_DUPLICATE) // Random initialization
+#endif
+  {
+    randomInitialization(kmeans, ArraySamples(ar),
+      m_initialization_method == RANDOM_NO_DUPLICATE, *m_rng);
+  }
+#if BOOST_VERSION >= 104700
+  else if(m_initialization_method == KMEANS_PLUS_PLUS) // K-Means++
+    kmeansPlusPlusInitialization(kmeans, ar, *m_rng, m_n_threads);
+  else // K-Means||
+    kmeansParallelInitialization(kmeans, ar, *m_rng, m_kmeans_parallel_rounds,
+      m_kmeans_parallel_oversampling, m_n_threads);
+#endif
    // Resize the accumulator
   m_zeroethOrderStats.resize(kmeans.getNMeans());
   m_firstOrderStats.resize(kmeans.getNMeans(), kmeans.getNInputs());
+  // Invalidate the bounds of the pruning
+  m_closest_means.resize(0);
+  // No sample has been assigned to the means yet
+  m_mini_batch_counts.resize(kmeans.getNMeans());
+  m_mini_batch_counts = 0.;
 }
 
 void bob::trainer::KMeansTrainer::eStep(bob::machine::KMeansMachine& kmeans, 
@@ -178,29 +479,136 @@ void bob::trainer::KMeansTrainer::eStep(bob::machine::KMeansMachine& kmeans,
   // initialise the accumulators
   resetAccumulators(kmeans);
 
-  // iterate over data samples
-  blitz::Range a = blitz::Range::all();
-  for(int i=0; i<ar.extent(0); ++i) {
-    // get example
-    blitz::Array<double, 1> x(ar(i,a));
-
-    // find closest mean, and distance from that mean
-    size_t closest_mean = 0;
-    double min_distance = 0;
-    kmeans.getClosestMean(x,closest_mean,min_distance);
-
-    // accumulate the stats
-    m_average_min_distance += min_distance;
-    ++m_zeroethOrderStats(closest_mean);
-    m_firstOrderStats(closest_mean,blitz::Range::all()) += x;
+  const int n_samples = ar.extent(0);
+  if (m_mini_batch_size > 0) {
+    // draw the samples of the mini-batch (with replacement)
+    const int n_batch = std::min((int)m_mini_batch_size, n_samples);
+    blitz::Array<double,2> batch(n_batch, ar.extent(1));
+    boost::uniform_int<> range(0, n_samples-1);
+    boost::variate_generator<boost::mt19937&, boost::uniform_int<> > die(*m_rng, range);
+    blitz::Range a = blitz::Range::all();
+    for (int i=0; i<n_batch; ++i) batch(i,a) = ar(die(),a);
+
+    blitz::Array<size_t,1> closest_means(n_batch);
+    blitz::Array<double,1> min_distances(n_batch);
+    kmeans.getClosestMeans(batch, closest_means, min_distances, m_n_threads);
+    accumulateStatistics(batch, closest_means, min_distances,
+      m_zeroethOrderStats, m_firstOrderStats, m_average_min_distance,
+      m_n_threads);
+    m_average_min_distance /= static_cast<double>(n_batch);
+    return;
   }
-  m_average_min_distance /= static_cast<double>(ar.extent(0));
+
+  // find the closest means, and the distances from these means
+  blitz::Array<double,1> min_distances(n_samples);
+  if (m_pruning && m_closest_means.extent(0) == n_samples &&
+      bob::core::array::hasSameShape(m_previous_means, kmeans.getMeans()))
+    kmeans.updateClosestMeans(ar, m_previous_means, m_closest_means,
+      min_distances, m_lower_bounds, m_n_threads);
+  else {
+    m_closest_means.resize(n_samples);
+    m_lower_bounds.resize(n_samples);
+    kmeans.getClosestMeans(ar, m_closest_means, min_distances, m_lower_bounds,
+      m_n_threads);
+  }
+  m_previous_means.reference(bob::core::array::ccopy(kmeans.getMeans()));
+
+  // accumulate the stats of the data samples
+  accumulateStatistics(ar, m_closest_means, min_distances, m_zeroethOrderStats,
+    m_firstOrderStats, m_average_min_distance, m_n_threads);
+  m_average_min_distance /= static_cast<double>(n_samples);
+}
+
+void bob::trainer::KMeansTrainer::initialize(bob::machine::KMeansMachine& kmeans,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  bob::core::array::assertSameDimensionLength(sampler.getNInputs(), kmeans.getNInputs());
+#if BOOST_VERSION >= 104700
+  if(m_initialization_method == KMEANS_PLUS_PLUS || m_initialization_method == KMEANS_PARALLEL)
+    throw std::runtime_error("KMeansTrainer: the k-means++ and k-means|| initializations require the data to be in memory");
+#endif
+
+  // assign the i'th mean to a random example within the i'th chunk
+  randomInitialization(kmeans, SamplerSamples(sampler),
+    m_initialization_method == RANDOM_NO_DUPLICATE, *m_rng);
+
+  // Resize the accumulator
+  m_zeroethOrderStats.resize(kmeans.getNMeans());
+  m_firstOrderStats.resize(kmeans.getNMeans(), kmeans.getNInputs());
+  // Invalidate the bounds of the pruning
+  m_closest_means.resize(0);
+  m_mini_batch_counts.resize(kmeans.getNMeans());
+  m_mini_batch_counts = 0.;
+}
+
+void bob::trainer::KMeansTrainer::eStep(bob::machine::KMeansMachine& kmeans,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  bob::core::array::assertSameDimensionLength(sampler.getNInputs(), kmeans.getNInputs());
+  if (m_mini_batch_size > 0)
+    throw std::runtime_error("KMeansTrainer: the mini-batch mode requires the data to be in memory");
+  if (sampler.getBlockSize() % KMEANS_SAMPLER_BLOCK_MULTIPLE != 0) {
+    boost::format m("KMeansTrainer: the block size of the sampler (%u) should be a multiple of %u");
+    m % sampler.getBlockSize() % KMEANS_SAMPLER_BLOCK_MULTIPLE;
+    throw std::runtime_error(m.str());
+  }
+
+  // initialise the accumulators
+  resetAccumulators(kmeans);
+  // the pruning would require bounds for all the samples
+  m_closest_means.resize(0);
+
+  // iterate over the blocks of samples to accumulate the stats
+  blitz::Array<size_t,1> closest_means;
+  blitz::Array<double,1> min_distances, lower_bounds;
+  blitz::Array<double,2> block;
+  sampler.reset();
+  while (sampler.next(block)) {
+    const int n_samples = block.extent(0);
+    if (closest_means.extent(0) != n_samples) {
+      closest_means.resize(n_samples);
+      min_distances.resize(n_samples);
+      lower_bounds.resize(n_samples);
+    }
+    kmeans.getClosestMeans(block, closest_means, min_distances, lower_bounds,
+      m_n_threads);
+    accumulateStatistics(block, closest_means, min_distances,
+      m_zeroethOrderStats, m_firstOrderStats, m_average_min_distance,
+      m_n_threads);
+  }
+  m_average_min_distance /= static_cast<double>(sampler.getNSamples());
+}
+
+void bob::trainer::KMeansTrainer::train(bob::machine::KMeansMachine& kmeans,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  bob::core::info << "# " << name() << ":" << std::endl;
+
+  // the data is only used by the initialization and the E-step
+  const blitz::Array<double,2> no_data(0, (int)sampler.getNInputs());
+  initialize(kmeans, sampler);
+  iterate(kmeans, no_data, StreamEStep(*this, kmeans, sampler));
+  finalize(kmeans, no_data);
 }
 
 void bob::trainer::KMeansTrainer::mStep(bob::machine::KMeansMachine& kmeans, 
   const blitz::Array<double,2>&) 
 {
   blitz::Array<double,2>& means = kmeans.updateMeans();
+  if (m_mini_batch_size > 0) {
+    // per-mean learning rates, which decrease with the number of samples
+    // assigned to each mean
+    blitz::Range a = blitz::Range::all();
+    for(size_t i=0; i<kmeans.getNMeans(); ++i)
+    {
+      if (m_zeroethOrderStats(i) == 0.) continue;
+      m_mini_batch_counts(i) += m_zeroethOrderStats(i);
+      means(i,a) += (m_firstOrderStats(i,a) -
+        m_zeroethOrderStats(i) * means(i,a)) / m_mini_batch_counts(i);
+    }
+    return;
+  }
+
   for(size_t i=0; i<kmeans.getNMeans(); ++i)
   {
     means(i,blitz::Range::all()) = 
@@ -238,3 +646,31 @@ void bob::trainer::KMeansTrainer::setFirstOrderStats(const blitz::Array<double,2
   m_firstOrderStats = firstOrderStats;
 }
 
+
+bool bob::trainer::KMeansTrainer::saveAccumulators(bob::io::HDF5File& file) const
+{
+  file.set("average_min_distance", m_average_min_distance);
+  file.setArray("zeroeth_order_stats", m_zeroethOrderStats);
+  file.setArray("first_order_stats", m_firstOrderStats);
+  // this trainer uses its own random generator, instead of the one of
+  // EMTrainer, which is saved with the checkpoint
+  std::ostringstream rng;
+  rng << *m_rng;
+  file.set("rng", rng.str());
+  if (m_mini_batch_size > 0)
+    file.setArray("mini_batch_counts", m_mini_batch_counts);
+  return true;
+}
+
+void bob::trainer::KMeansTrainer::loadAccumulators(
+  bob::machine::KMeansMachine& kmeans, bob::io::HDF5File& file)
+{
+  m_average_min_distance = file.read<double>("average_min_distance");
+  // the accumulators have been resized by initialize()
+  file.readArray("zeroeth_order_stats", m_zeroethOrderStats);
+  file.readArray("first_order_stats", m_firstOrderStats);
+  std::istringstream rng(file.read<std::string>("rng"));
+  rng >> *m_rng;
+  if (file.contains("mini_batch_counts"))
+    file.readArray("mini_batch_counts", m_mini_batch_counts);
+}
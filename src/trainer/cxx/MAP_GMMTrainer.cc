@@ -8,6 +8,134 @@
 
 #include <bob/trainer/MAP_GMMTrainer.h>
 #include <bob/core/check.h>
+#include <bob/core/assert.h>
+#include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <bob/math/log.h>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+  /**
+   * Enrols a single client, by adapting the means of the prior GMM to its
+   * statistics. If features are given, the statistics of the client are
+   * first accumulated in per-thread buffers, by computing the
+   * responsibilities of the prior GMM exactly as GMMMachine::accStatistics()
+   * does (without using the caches of the machine).
+   */
+  struct MAPEnrolClient {
+    const std::vector<const double*>& m_features;
+    const std::vector<size_t>& m_n_samples;
+    const std::vector<const double*>& m_n;
+    const std::vector<const double*>& m_sumPx;
+    const std::vector<double>& m_prior_means;
+    const std::vector<double>& m_variances;
+    const std::vector<double>& m_log_weights;
+    const std::vector<double>& m_g_norms;
+    const size_t m_C, m_D;
+    const double m_relevance_factor;
+    const bool m_T3_adaptation;
+    const double m_T3_alpha;
+    const double m_threshold;
+    std::vector<std::vector<double> >& m_acc_n;
+    std::vector<std::vector<double> >& m_acc_sumPx;
+    std::vector<std::vector<double> >& m_log_likelihoods;
+    double* m_output;
+
+    MAPEnrolClient(const std::vector<const double*>& features,
+        const std::vector<size_t>& n_samples,
+        const std::vector<const double*>& n,
+        const std::vector<const double*>& sumPx,
+        const std::vector<double>& prior_means,
+        const std::vector<double>& variances,
+        const std::vector<double>& log_weights,
+        const std::vector<double>& g_norms,
+        const size_t C, const size_t D, const double relevance_factor,
+        const bool T3_adaptation, const double T3_alpha,
+        const double threshold,
+        std::vector<std::vector<double> >& acc_n,
+        std::vector<std::vector<double> >& acc_sumPx,
+        std::vector<std::vector<double> >& log_likelihoods,
+        double* output):
+      m_features(features), m_n_samples(n_samples), m_n(n), m_sumPx(sumPx),
+      m_prior_means(prior_means), m_variances(variances),
+      m_log_weights(log_weights), m_g_norms(g_norms), m_C(C), m_D(D),
+      m_relevance_factor(relevance_factor), m_T3_adaptation(T3_adaptation),
+      m_T3_alpha(T3_alpha), m_threshold(threshold), m_acc_n(acc_n),
+      m_acc_sumPx(acc_sumPx), m_log_likelihoods(log_likelihoods),
+      m_output(output)
+    {}
+
+    /**
+     * Accumulates the zeroth and first order statistics of the given
+     * features in the buffers of the given thread
+     */
+    void accumulate(const double* x, const size_t n_samples,
+        const size_t ith) const
+    {
+      double* n = &m_acc_n[ith][0];
+      double* sumPx = &m_acc_sumPx[ith][0];
+      double* l = &m_log_likelihoods[ith][0];
+      std::fill(n, n + m_C, 0.);
+      std::fill(sumPx, sumPx + m_C * m_D, 0.);
+      for (size_t t=0; t<n_samples; ++t, x+=m_D) {
+        double log_likelihood = bob::math::Log::LogZero;
+        for (size_t c=0; c<m_C; ++c) {
+          const double* mean = &m_prior_means[c * m_D];
+          const double* variance = &m_variances[c * m_D];
+          double z = 0.;
+          for (size_t d=0; d<m_D; ++d) {
+            const double diff = x[d] - mean[d];
+            z += diff * diff / variance[d];
+          }
+          l[c] = m_log_weights[c] + (-0.5 * (m_g_norms[c] + z));
+          log_likelihood = bob::math::Log::logAdd(log_likelihood, l[c]);
+        }
+        for (size_t c=0; c<m_C; ++c) {
+          const double P = exp(l[c] - log_likelihood);
+          n[c] += P;
+          double* sumPx_c = sumPx + c * m_D;
+          for (size_t d=0; d<m_D; ++d) sumPx_c[d] += P * x[d];
+        }
+      }
+    }
+
+    void operator()(const size_t ith, const size_t b) const {
+      const double* n;
+      const double* sumPx;
+      if (!m_features.empty()) {
+        accumulate(m_features[b], m_n_samples[b], ith);
+        n = &m_acc_n[ith][0];
+        sumPx = &m_acc_sumPx[ith][0];
+      }
+      else {
+        n = m_n[b];
+        sumPx = m_sumPx[b];
+      }
+
+      // Equation 12 of Reynolds et al., "Speaker Verification Using Adapted
+      // Gaussian Mixture Models", Digital Signal Processing, 2000
+      double* means = m_output + b * m_C * m_D;
+      for (size_t c=0; c<m_C; ++c) {
+        const double* prior_means = &m_prior_means[c * m_D];
+        double* means_c = means + c * m_D;
+        if (n[c] < m_threshold) {
+          std::copy(prior_means, prior_means + m_D, means_c);
+        }
+        else {
+          const double alpha = m_T3_adaptation ? m_T3_alpha :
+            n[c] / (n[c] + m_relevance_factor);
+          const double* sumPx_c = sumPx + c * m_D;
+          for (size_t d=0; d<m_D; ++d)
+            means_c[d] = alpha * (sumPx_c[d] / n[c]) + (1-alpha) * prior_means[d];
+        }
+      }
+    }
+  };
+
+}
 
 bob::trainer::MAP_GMMTrainer::MAP_GMMTrainer(const double relevance_factor, 
     const bool update_means, const bool update_variances, 
@@ -141,6 +269,128 @@ void bob::trainer::MAP_GMMTrainer::mStep(bob::machine::GMMMachine& gmm,
   }
 }
 
+void bob::trainer::MAP_GMMTrainer::enrol(
+  const std::vector<boost::shared_ptr<bob::machine::GMMStats> >& stats,
+  blitz::Array<double,2>& supervectors, const size_t n_threads) const
+{
+  if (!m_prior_gmm)
+    throw std::runtime_error("MAP_GMMTrainer: Prior GMM distribution has not been set");
+  const int C = m_prior_gmm->getNGaussians();
+  const int D = m_prior_gmm->getNInputs();
+  bob::core::array::assertSameDimensionLength(supervectors.extent(0), stats.size());
+  bob::core::array::assertSameDimensionLength(supervectors.extent(1), C*D);
+
+  // raw data of the statistics is accessed by the threads
+  std::vector<blitz::Array<double,1> > n_copies;
+  std::vector<blitz::Array<double,2> > sumPx_copies;
+  std::vector<const double*> n(stats.size()), sumPx(stats.size());
+  for (size_t i=0; i<stats.size(); ++i) {
+    if (!stats[i]) {
+      boost::format m("MAP_GMMTrainer: the statistics of client %u are not set");
+      m % i;
+      throw std::runtime_error(m.str());
+    }
+    bob::core::array::assertSameDimensionLength(stats[i]->n.extent(0), C);
+    bob::core::array::assertSameDimensionLength(stats[i]->sumPx.extent(0), C);
+    bob::core::array::assertSameDimensionLength(stats[i]->sumPx.extent(1), D);
+    if (bob::core::array::isCZeroBaseContiguous(stats[i]->n))
+      n[i] = stats[i]->n.data();
+    else {
+      n_copies.push_back(bob::core::array::ccopy(stats[i]->n));
+      n[i] = n_copies.back().data();
+    }
+    if (bob::core::array::isCZeroBaseContiguous(stats[i]->sumPx))
+      sumPx[i] = stats[i]->sumPx.data();
+    else {
+      sumPx_copies.push_back(bob::core::array::ccopy(stats[i]->sumPx));
+      sumPx[i] = sumPx_copies.back().data();
+    }
+  }
+
+  enrol_(std::vector<const double*>(), std::vector<size_t>(), n, sumPx,
+    supervectors, n_threads);
+}
+
+void bob::trainer::MAP_GMMTrainer::enrol(
+  const std::vector<blitz::Array<double,2> >& features,
+  blitz::Array<double,2>& supervectors, const size_t n_threads) const
+{
+  if (!m_prior_gmm)
+    throw std::runtime_error("MAP_GMMTrainer: Prior GMM distribution has not been set");
+  const int C = m_prior_gmm->getNGaussians();
+  const int D = m_prior_gmm->getNInputs();
+  bob::core::array::assertSameDimensionLength(supervectors.extent(0), features.size());
+  bob::core::array::assertSameDimensionLength(supervectors.extent(1), C*D);
+
+  // raw data of the features is accessed by the threads
+  std::vector<blitz::Array<double,2> > copies;
+  std::vector<const double*> x(features.size());
+  std::vector<size_t> n_samples(features.size());
+  for (size_t i=0; i<features.size(); ++i) {
+    bob::core::array::assertSameDimensionLength(features[i].extent(1), D);
+    n_samples[i] = features[i].extent(0);
+    if (bob::core::array::isCZeroBaseContiguous(features[i]))
+      x[i] = features[i].data();
+    else {
+      copies.push_back(bob::core::array::ccopy(features[i]));
+      x[i] = copies.back().data();
+    }
+  }
+
+  enrol_(x, n_samples, std::vector<const double*>(),
+    std::vector<const double*>(), supervectors, n_threads);
+}
+
+void bob::trainer::MAP_GMMTrainer::enrol_(
+  const std::vector<const double*>& features,
+  const std::vector<size_t>& n_samples,
+  const std::vector<const double*>& n,
+  const std::vector<const double*>& sumPx,
+  blitz::Array<double,2>& supervectors, const size_t n_threads) const
+{
+  const size_t n_clients = supervectors.extent(0);
+  if (n_clients == 0) return;
+  const size_t C = m_prior_gmm->getNGaussians();
+  const size_t D = m_prior_gmm->getNInputs();
+
+  // copies the parameters of the prior GMM, such that the threads do not
+  // rely on the caches of the machine
+  std::vector<double> prior_means(C*D), variances(C*D), log_weights(C),
+    g_norms(C);
+  const blitz::Array<double,1>& prior_log_weights = m_prior_gmm->getLogWeights();
+  for (size_t c=0; c<C; ++c) {
+    boost::shared_ptr<const bob::machine::Gaussian> g = m_prior_gmm->getGaussian(c);
+    const blitz::Array<double,1>& mean = g->getMean();
+    const blitz::Array<double,1>& variance = g->getVariance();
+    for (size_t d=0; d<D; ++d) {
+      prior_means[c*D+d] = mean(d);
+      variances[c*D+d] = variance(d);
+    }
+    log_weights[c] = prior_log_weights(c);
+    // same as Gaussian::preComputeConstants()
+    g_norms[c] = D * bob::math::Log::Log2Pi + blitz::sum(blitz::log(variance));
+  }
+
+  // rows of the output are written by the threads
+  blitz::Array<double,2> out;
+  const bool direct_use = bob::core::array::isCZeroBaseContiguous(supervectors);
+  if (direct_use) out.reference(supervectors);
+  else out.resize(supervectors.shape());
+
+  const size_t n_t = bob::core::thread_count(n_clients, n_threads);
+  const size_t buffer_size = features.empty() ? 0 : 1;
+  std::vector<std::vector<double> > acc_n(n_t, std::vector<double>(buffer_size * C));
+  std::vector<std::vector<double> > acc_sumPx(n_t, std::vector<double>(buffer_size * C * D));
+  std::vector<std::vector<double> > log_likelihoods(n_t, std::vector<double>(buffer_size * C));
+
+  bob::core::thread_blocks(MAPEnrolClient(features, n_samples, n, sumPx,
+    prior_means, variances, log_weights, g_norms, C, D, m_relevance_factor,
+    m_T3_adaptation, m_T3_alpha, m_mean_var_update_responsibilities_threshold,
+    acc_n, acc_sumPx, log_likelihoods, out.data()), n_clients, n_t);
+
+  if (!direct_use) supervectors = out;
+}
+
 bob::trainer::MAP_GMMTrainer& bob::trainer::MAP_GMMTrainer::operator=
   (const bob::trainer::MAP_GMMTrainer &other)
 {
@@ -10,15 +10,224 @@
 #include <algorithm>
 #include <bob/core/assert.h>
 #include <bob/core/check.h>
+#include <bob/core/parallel.h>
 #include <bob/math/linear.h>
+#include <bob/math/gemm.h>
 #include <bob/trainer/MLPBaseTrainer.h>
 
+namespace {
+
+  /**
+   * Maximum number of blocks of samples a batch is split into by the forward
+   * and backward steps. Each block is processed by a single thread, and the
+   * derivatives of the blocks are summed with a tree reduction.
+   */
+  static const size_t MLP_MAX_BLOCKS = 16;
+
+  /**
+   * Minimum number of samples of a block, below which splitting a batch is
+   * not worth the synchronization cost
+   */
+  static const size_t MLP_MIN_BLOCK_SIZE = 32;
+
+  /**
+   * Returns the number of blocks a batch of the given size is split into.
+   * This only depends on the batch size, such that the results do not depend
+   * on the number of threads.
+   */
+  size_t mlp_n_blocks(const size_t batch_size) {
+    return std::max((size_t)1,
+      std::min(MLP_MAX_BLOCKS, batch_size / MLP_MIN_BLOCK_SIZE));
+  }
+
+  /**
+   * Returns a C-contiguous view on a matrix
+   */
+  blitz::Array<double,2> matrixView(const double* data, const int rows,
+    const int cols)
+  {
+    return blitz::Array<double,2>(const_cast<double*>(data),
+      blitz::shape(rows, cols), blitz::neverDeleteData);
+  }
+
+  /**
+   * Returns the given arrays, copying the ones which are not C-contiguous,
+   * such that the threads could access their raw data
+   */
+  template <int N> void contiguous(const std::vector<blitz::Array<double,N> >& v,
+    std::vector<blitz::Array<double,N> >& copies, std::vector<const double*>& data)
+  {
+    for (size_t k=0; k<v.size(); ++k) {
+      if (bob::core::array::isCZeroBaseContiguous(v[k]))
+        data.push_back(v[k].data());
+      else {
+        copies.push_back(bob::core::array::ccopy(v[k]));
+        data.push_back(copies.back().data());
+      }
+    }
+  }
+
+  /**
+   * The parameters of the machine and the buffers of the trainer, as raw
+   * pointers to C-contiguous data which could be shared by the threads
+   */
+  struct MLPLayers {
+    std::vector<int> sizes; ///< number of inputs, then outputs of each layer
+    std::vector<const double*> weights;
+    std::vector<const double*> biases;
+    std::vector<double*> output; ///< m_output of each layer
+    std::vector<double*> error; ///< m_error of each layer
+    const bob::machine::Activation* hidden_actfun;
+    const bob::machine::Activation* output_actfun;
+    // copies of the non-contiguous weights and biases
+    std::vector<blitz::Array<double,2> > weight_copies;
+    std::vector<blitz::Array<double,1> > bias_copies;
+
+    MLPLayers(const bob::machine::MLP& machine,
+        std::vector<blitz::Array<double,2> >& output_,
+        std::vector<blitz::Array<double,2> >& error_):
+      hidden_actfun(machine.getHiddenActivation().get()),
+      output_actfun(machine.getOutputActivation().get())
+    {
+      const std::vector<blitz::Array<double,2> >& w = machine.getWeights();
+      contiguous(w, weight_copies, weights);
+      contiguous(machine.getBiases(), bias_copies, biases);
+      sizes.push_back(w[0].extent(0));
+      for (size_t k=0; k<w.size(); ++k) {
+        sizes.push_back(w[k].extent(1));
+        output.push_back(output_[k].data());
+        error.push_back(error_[k].data());
+      }
+    }
+
+    size_t n_layers() const
+    { return weights.size(); }
+
+    /// Number of derivatives (weights, then biases) of all the layers
+    size_t n_derivatives() const {
+      size_t n = 0;
+      for (size_t k=0; k<n_layers(); ++k) n += (sizes[k] + 1) * sizes[k+1];
+      return n;
+    }
+  };
+
+  /**
+   * Forwards the samples of a block through all the layers
+   */
+  struct MLPForwardBlock {
+    const MLPLayers& m_layers;
+    const double* m_input;
+    const std::vector<size_t>& m_begins;
+    const std::vector<size_t>& m_ends;
+
+    MLPForwardBlock(const MLPLayers& layers, const double* input,
+        const std::vector<size_t>& begins, const std::vector<size_t>& ends):
+      m_layers(layers), m_input(input), m_begins(begins), m_ends(ends)
+    {}
+
+    void operator()(const size_t, const size_t b) const {
+      const int rows = m_ends[b] - m_begins[b];
+      for (size_t k=0; k<m_layers.n_layers(); ++k) {
+        const int n_in = m_layers.sizes[k];
+        const int n_out = m_layers.sizes[k+1];
+        const double* in = (k == 0 ? m_input : m_layers.output[k-1]) +
+          m_begins[b] * n_in;
+        double* out = m_layers.output[k] + m_begins[b] * n_out;
+        //the biases are accumulated by the matrix product
+        for (int i=0; i<rows; ++i)
+          std::copy(m_layers.biases[k], m_layers.biases[k] + n_out, out + i * n_out);
+        blitz::Array<double,2> O = matrixView(out, rows, n_out);
+        bob::math::gemm_(matrixView(in, rows, n_in),
+          matrixView(m_layers.weights[k], n_in, n_out), O, false, false, 1., 1.);
+        const bob::machine::Activation* actfun =
+          (k == m_layers.n_layers()-1 ? m_layers.output_actfun : m_layers.hidden_actfun);
+        actfun->f(O, O);
+      }
+    }
+  };
+
+  /**
+   * Back-propagates the error of the samples of a block, and computes the
+   * sums of the derivatives over the samples of this block (weights, then
+   * biases, for each layer)
+   */
+  struct MLPBackwardBlock {
+    const MLPLayers& m_layers;
+    const bob::trainer::Cost& m_cost;
+    const double* m_input;
+    const double* m_target;
+    const std::vector<size_t>& m_begins;
+    const std::vector<size_t>& m_ends;
+    std::vector<std::vector<double> >& m_partial_deriv;
+    std::vector<std::vector<double> >& m_prime;
+
+    MLPBackwardBlock(const MLPLayers& layers, const bob::trainer::Cost& cost,
+        const double* input, const double* target,
+        const std::vector<size_t>& begins, const std::vector<size_t>& ends,
+        std::vector<std::vector<double> >& partial_deriv,
+        std::vector<std::vector<double> >& prime):
+      m_layers(layers), m_cost(cost), m_input(input), m_target(target),
+      m_begins(begins), m_ends(ends), m_partial_deriv(partial_deriv),
+      m_prime(prime)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      const size_t begin = m_begins[b];
+      const int rows = m_ends[b] - begin;
+      const size_t H = m_layers.n_layers() - 1;
+
+      //last layer
+      const int n_out = m_layers.sizes[H+1];
+      const double* out = m_layers.output[H] + begin * n_out;
+      const double* target = m_target + begin * n_out;
+      double* err = m_layers.error[H] + begin * n_out;
+      for (int i=0; i<rows*n_out; ++i) err[i] = m_cost.error(out[i], target[i]);
+
+      //all other layers
+      for (size_t k=H; k>0; --k) {
+        const int n = m_layers.sizes[k];
+        blitz::Array<double,2> E = matrixView(m_layers.error[k-1] + begin * n, rows, n);
+        bob::math::gemm_(matrixView(m_layers.error[k] + begin * m_layers.sizes[k+1],
+            rows, m_layers.sizes[k+1]),
+          matrixView(m_layers.weights[k], n, m_layers.sizes[k+1]), E, false, true);
+        m_prime[ith].resize(rows * n);
+        blitz::Array<double,2> prime = matrixView(&m_prime[ith][0], rows, n);
+        m_layers.hidden_actfun->f_prime_from_f(
+          matrixView(m_layers.output[k-1] + begin * n, rows, n), prime);
+        double* e = E.data();
+        for (int i=0; i<rows*n; ++i) e[i] *= m_prime[ith][i];
+      }
+
+      //sums of the derivatives w.r.t. the weights and biases
+      std::vector<double>& partial = m_partial_deriv[b];
+      partial.resize(m_layers.n_derivatives());
+      double* d = &partial[0];
+      for (size_t k=0; k<m_layers.n_layers(); ++k) {
+        const int n_in = m_layers.sizes[k];
+        const int n_out = m_layers.sizes[k+1];
+        const double* in = (k == 0 ? m_input : m_layers.output[k-1]) + begin * n_in;
+        const double* e = m_layers.error[k] + begin * n_out;
+        blitz::Array<double,2> D = matrixView(d, n_in, n_out);
+        bob::math::gemm_(matrixView(in, rows, n_in), matrixView(e, rows, n_out),
+          D, true, false);
+        d += n_in * n_out;
+        std::fill(d, d + n_out, 0.);
+        for (int i=0; i<rows; ++i)
+          for (int j=0; j<n_out; ++j) d[j] += e[i * n_out + j];
+        d += n_out;
+      }
+    }
+  };
+
+}
+
 bob::trainer::MLPBaseTrainer::MLPBaseTrainer(size_t batch_size,
     boost::shared_ptr<bob::trainer::Cost> cost):
   m_batch_size(batch_size),
   m_cost(cost),
   m_train_bias(true),
   m_H(0), ///< handy!
+  m_n_threads(0),
   m_deriv(1),
   m_deriv_bias(1),
   m_error(1),
@@ -38,6 +247,7 @@ bob::trainer::MLPBaseTrainer::MLPBaseTrainer(size_t batch_size,
   m_cost(cost),
   m_train_bias(true),
   m_H(machine.numOfHiddenLayers()), ///< handy!
+  m_n_threads(0),
   m_deriv(m_H + 1),
   m_deriv_bias(m_H + 1),
   m_error(m_H + 1),
@@ -54,6 +264,7 @@ bob::trainer::MLPBaseTrainer::MLPBaseTrainer(size_t batch_size,
   m_cost(cost),
   m_train_bias(train_biases),
   m_H(machine.numOfHiddenLayers()), ///< handy!
+  m_n_threads(0),
   m_deriv(m_H + 1),
   m_deriv_bias(m_H + 1),
   m_error(m_H + 1),
@@ -68,7 +279,8 @@ bob::trainer::MLPBaseTrainer::MLPBaseTrainer(const MLPBaseTrainer& other):
   m_batch_size(other.m_batch_size),
   m_cost(other.m_cost),
   m_train_bias(other.m_train_bias),
-  m_H(other.m_H)
+  m_H(other.m_H),
+  m_n_threads(other.m_n_threads)
 {
   bob::core::array::ccopy(other.m_deriv, m_deriv);
   bob::core::array::ccopy(other.m_deriv_bias, m_deriv_bias);
@@ -84,6 +296,7 @@ bob::trainer::MLPBaseTrainer& bob::trainer::MLPBaseTrainer::operator=
     m_cost = other.m_cost;
     m_train_bias = other.m_train_bias;
     m_H = other.m_H;
+    m_n_threads = other.m_n_threads;
 
     bob::core::array::ccopy(other.m_deriv, m_deriv);
     bob::core::array::ccopy(other.m_deriv_bias, m_deriv_bias);
@@ -128,59 +341,63 @@ bool bob::trainer::MLPBaseTrainer::isCompatible(const bob::machine::MLP& machine
 void bob::trainer::MLPBaseTrainer::forward_step(const bob::machine::MLP& machine,
   const blitz::Array<double,2>& input)
 {
-  const std::vector<blitz::Array<double,2> >& machine_weight = machine.getWeights();
-  const std::vector<blitz::Array<double,1> >& machine_bias = machine.getBiases();
-
-  boost::shared_ptr<bob::machine::Activation> hidden_actfun = machine.getHiddenActivation();
-  boost::shared_ptr<bob::machine::Activation> output_actfun = machine.getOutputActivation();
-
-  for (size_t k=0; k<machine_weight.size(); ++k) { //for all layers
-    if (k == 0) bob::math::prod_(input, machine_weight[k], m_output[k]);
-    else bob::math::prod_(m_output[k-1], machine_weight[k], m_output[k]);
-    boost::shared_ptr<bob::machine::Activation> cur_actfun =
-      (k == (machine_weight.size()-1) ? output_actfun : hidden_actfun );
-    for (int i=0; i<(int)m_batch_size; ++i) { //for every example
-      for (int j=0; j<m_output[k].extent(1); ++j) { //for all variables
-        m_output[k](i,j) = cur_actfun->f(m_output[k](i,j) + machine_bias[k](j));
-      }
-    }
-  }
+  bob::core::array::assertSameDimensionLength(input.extent(0), m_batch_size);
+  bob::core::array::assertSameDimensionLength(input.extent(1), m_deriv[0].extent(0));
+  const blitz::Array<double,2> x = bob::core::array::isCZeroBaseContiguous(input) ?
+    input : bob::core::array::ccopy(input);
+  const MLPLayers layers(machine, m_output, m_error);
+
+  // each block of samples is forwarded by a single thread
+  std::vector<size_t> begins, ends;
+  bob::core::thread_split(m_batch_size, mlp_n_blocks(m_batch_size), begins, ends);
+  bob::core::thread_blocks(MLPForwardBlock(layers, x.data(), begins, ends),
+    begins.size(), m_n_threads);
 }
 
 void bob::trainer::MLPBaseTrainer::backward_step
 (const bob::machine::MLP& machine,
  const blitz::Array<double,2>& input, const blitz::Array<double,2>& target)
 {
-  const std::vector<blitz::Array<double,2> >& machine_weight = machine.getWeights();
-
-  //last layer
-  boost::shared_ptr<bob::machine::Activation> output_actfun = machine.getOutputActivation();
-  for (int i=0; i<(int)m_batch_size; ++i) { //for every example
-    for (int j=0; j<m_error[m_H].extent(1); ++j) { //for all variables
-      m_error[m_H](i,j) = m_cost->error(m_output[m_H](i,j), target(i,j));
-    }
-  }
-
-  //all other layers
-  boost::shared_ptr<bob::machine::Activation> hidden_actfun = machine.getHiddenActivation();
-  for (size_t k=m_H; k>0; --k) {
-    bob::math::prod_(m_error[k], machine_weight[k].transpose(1,0), m_error[k-1]);
-    for (int i=0; i<(int)m_batch_size; ++i) { //for every example
-      for (int j=0; j<m_error[k-1].extent(1); ++j) { //for all variables
-        m_error[k-1](i,j) *= hidden_actfun->f_prime_from_f(m_output[k-1](i,j));
-      }
+  bob::core::array::assertSameDimensionLength(input.extent(0), m_batch_size);
+  bob::core::array::assertSameDimensionLength(input.extent(1), m_deriv[0].extent(0));
+  bob::core::array::assertSameShape(target, m_output[m_H]);
+  const blitz::Array<double,2> x = bob::core::array::isCZeroBaseContiguous(input) ?
+    input : bob::core::array::ccopy(input);
+  const blitz::Array<double,2> t = bob::core::array::isCZeroBaseContiguous(target) ?
+    target : bob::core::array::ccopy(target);
+  const MLPLayers layers(machine, m_output, m_error);
+
+  // errors and sums of the derivatives of each block of samples
+  std::vector<size_t> begins, ends;
+  bob::core::thread_split(m_batch_size, mlp_n_blocks(m_batch_size), begins, ends);
+  const size_t n_blocks = begins.size();
+  m_partial_deriv.resize(n_blocks);
+  std::vector<std::vector<double> > prime(bob::core::thread_count(n_blocks, m_n_threads));
+  bob::core::thread_blocks(MLPBackwardBlock(layers, *m_cost, x.data(), t.data(),
+    begins, ends, m_partial_deriv, prime), n_blocks, m_n_threads);
+
+  // pairwise tree reduction of the derivatives of the blocks, which does not
+  // depend on the number of threads. There are at most 16 blocks, hence the
+  // calling thread does it alone.
+  for (size_t stride=1; stride<n_blocks; stride*=2)
+    for (size_t b=0; b+stride<n_blocks; b+=2*stride) {
+      std::vector<double>& dst = m_partial_deriv[b];
+      const std::vector<double>& src = m_partial_deriv[b + stride];
+      for (size_t i=0; i<dst.size(); ++i) dst[i] += src[i];
     }
-  }
 
-  //calculate the derivatives of the cost w.r.t. the weights and biases
-  for (size_t k=0; k<machine_weight.size(); ++k) { //for all layers
+  //averages the derivatives of the cost w.r.t. the weights and biases
+  const double* d = &m_partial_deriv[0][0];
+  for (size_t k=0; k<layers.n_layers(); ++k) { //for all layers
+    const int n_in = layers.sizes[k];
+    const int n_out = layers.sizes[k+1];
     // For the weights
-    if (k == 0) bob::math::prod_(input.transpose(1,0), m_error[k], m_deriv[k]);
-    else bob::math::prod_(m_output[k-1].transpose(1,0), m_error[k], m_deriv[k]);
-    m_deriv[k] /= m_batch_size;
+    m_deriv[k] = matrixView(d, n_in, n_out) / static_cast<double>(m_batch_size);
+    d += n_in * n_out;
     // For the biases
-    blitz::secondIndex bj;
-    m_deriv_bias[k] = blitz::mean(m_error[k].transpose(1,0), bj);
+    m_deriv_bias[k] = blitz::Array<double,1>(const_cast<double*>(d),
+      blitz::shape(n_out), blitz::neverDeleteData) / static_cast<double>(m_batch_size);
+    d += n_out;
   }
 }
 
@@ -11,13 +11,349 @@
 #include <bob/trainer/PLDATrainer.h>
 #include <bob/core/array_copy.h>
 #include <bob/core/array_random.h>
+#include <bob/core/check.h>
+#include <bob/core/parallel.h>
 #include <bob/math/linear.h>
 #include <bob/math/inv.h>
 #include <bob/math/svd.h>
+#include <bob/math/gemm.h>
 #include <algorithm>
 #include <boost/random.hpp>
 #include <vector>
 #include <limits>
+#include <map>
+
+namespace {
+
+  /**
+   * Maximum number of samples processed together by the E- and M-steps.
+   * All the identities of a chunk have the same number of samples, and a
+   * chunk contains at least one identity. The decomposition does not depend
+   * on the number of threads, such that the results do not either.
+   */
+  static const size_t PLDA_CHUNK_SIZE = 256;
+
+  /**
+   * Returns a view on a matrix with the given row stride
+   */
+  blitz::Array<double,2> matrixView(const double* data, const int rows,
+    const int cols, const int row_stride)
+  {
+    return blitz::Array<double,2>(const_cast<double*>(data),
+      blitz::shape(rows, cols), blitz::shape(row_stride, 1),
+      blitz::neverDeleteData);
+  }
+
+  /**
+   * The training samples, grouped into chunks of identities with the same
+   * number of samples. This is set up by the calling thread, and only read
+   * by the workers.
+   */
+  struct PLDAChunks {
+    std::vector<std::vector<size_t> > ids; ///< identities of each chunk
+    std::vector<size_t> n_samples; ///< number of samples per identity of each chunk
+    std::vector<const double*> x; ///< C-contiguous samples of each identity
+    std::vector<blitz::Array<double,2> > copies; ///< copies of non-contiguous inputs
+
+    PLDAChunks(const std::vector<blitz::Array<double,2> >& v_ar) {
+      std::map<size_t, std::vector<size_t> > buckets;
+      for (size_t i=0; i<v_ar.size(); ++i) {
+        if (bob::core::array::isCZeroBaseContiguous(v_ar[i]))
+          x.push_back(v_ar[i].data());
+        else {
+          copies.push_back(bob::core::array::ccopy(v_ar[i]));
+          x.push_back(copies.back().data());
+        }
+        if (v_ar[i].extent(0) > 0) buckets[v_ar[i].extent(0)].push_back(i);
+      }
+      for (std::map<size_t, std::vector<size_t> >::const_iterator
+          it=buckets.begin(); it!=buckets.end(); ++it) {
+        const std::vector<size_t>& b = it->second;
+        const size_t per_chunk = std::max((size_t)1, PLDA_CHUNK_SIZE / it->first);
+        for (size_t k=0; k<b.size(); k+=per_chunk) {
+          ids.push_back(std::vector<size_t>(b.begin() + k,
+            b.begin() + std::min(b.size(), k + per_chunk)));
+          n_samples.push_back(it->first);
+        }
+      }
+    }
+
+    size_t size() const
+    { return ids.size(); }
+  };
+
+  /**
+   * Per-thread working arrays
+   */
+  struct PLDAWorkspace {
+    std::vector<double> Xc; ///< centred samples of a chunk
+    std::vector<double> S; ///< sum of the centred samples of each identity
+    std::vector<double> H; ///< F^T.beta.S
+    std::vector<double> Eh; ///< E{h_i} of each identity
+    std::vector<double> FEh; ///< F.E{h_i} of each identity
+    std::vector<double> U; ///< G^T.sigma^-1.(x_ij-mu-F.E{h_i})
+    std::vector<double> Z; ///< E{z_ij} of the samples of a chunk
+    std::vector<double> BZ; ///< B.E{z_ij}
+    std::vector<double> acc; ///< contribution of a chunk to a sum
+  };
+
+  /**
+   * Base of the functors which compute the contribution of a chunk to a sum
+   * in the workspace of the thread. The contributions are then added in the
+   * order of the chunks (see bob::core::thread_reduce_blocks()), such that
+   * the sum does not depend on the number of threads.
+   */
+  struct PLDAChunkSum {
+    std::vector<PLDAWorkspace>& m_workspaces;
+    double* m_sum;
+    const size_t m_size;
+
+    PLDAChunkSum(std::vector<PLDAWorkspace>& workspaces, double* sum,
+        const size_t size):
+      m_workspaces(workspaces), m_sum(sum), m_size(size)
+    {}
+
+    void reduce(const size_t ith, const size_t b) const {
+      const std::vector<double>& acc = m_workspaces[ith].acc;
+      for (size_t k=0; k<m_size; ++k) m_sum[k] += acc[k];
+    }
+  };
+
+  /**
+   * Stacks the centred samples x_ij-mu of the identities of a chunk
+   */
+  void centredSamples(const PLDAChunks& chunks, const size_t b,
+    const double* mu, const size_t D, std::vector<double>& Xc)
+  {
+    const std::vector<size_t>& ids = chunks.ids[b];
+    const size_t n_i = chunks.n_samples[b];
+    Xc.resize(ids.size() * n_i * D);
+    double* out = &Xc[0];
+    for (size_t k=0; k<ids.size(); ++k) {
+      const double* x = chunks.x[ids[k]];
+      for (size_t j=0; j<n_i; ++j)
+        for (size_t d=0; d<D; ++d) *out++ = *x++ - mu[d];
+    }
+  }
+
+  /**
+   * Stacks the first order statistics E{z_ij} of the identities of a chunk
+   */
+  void firstOrderStatistics(const PLDAChunks& chunks, const size_t b,
+    const std::vector<const double*>& z, const size_t FG,
+    std::vector<double>& Z)
+  {
+    const std::vector<size_t>& ids = chunks.ids[b];
+    const size_t size_i = chunks.n_samples[b] * FG;
+    Z.resize(ids.size() * size_i);
+    for (size_t k=0; k<ids.size(); ++k)
+      std::copy(z[ids[k]], z[ids[k]] + size_i, &Z[k * size_i]);
+  }
+
+  /**
+   * Computes the first (and second) order statistics of the latent
+   * variables of the identities of a chunk, and adds the contribution of
+   * the chunk to the sum of the second order statistics.
+   */
+  struct PLDAEStepChunk: public PLDAChunkSum {
+    const PLDAChunks& m_chunks;
+    const size_t m_D;
+    const size_t m_F;
+    const size_t m_G;
+    const double* m_mu;
+    const double* m_F_mat;
+    const double* m_FtBeta;
+    const double* m_GtISigma;
+    const double* m_alpha;
+    const std::vector<const double*>& m_gamma; ///< gamma_a of each chunk
+    const std::vector<const double*>& m_zeta; ///< zeta_a of each chunk
+    const std::vector<const double*>& m_iota; ///< iota_a of each chunk
+    const std::vector<double*>& m_z; ///< E{z_ij} of each identity
+    const std::vector<double*>& m_z2; ///< E{z_ij.z_ij^T} of each identity (or empty)
+
+    PLDAEStepChunk(const PLDAChunks& chunks,
+        std::vector<PLDAWorkspace>& workspaces,
+        blitz::Array<double,2>& sum_z_second_order, const size_t D, const size_t F,
+        const size_t G, const blitz::Array<double,1>& mu,
+        const blitz::Array<double,2>& F_mat,
+        const blitz::Array<double,2>& FtBeta,
+        const blitz::Array<double,2>& GtISigma,
+        const blitz::Array<double,2>& alpha,
+        const std::vector<const double*>& gamma,
+        const std::vector<const double*>& zeta,
+        const std::vector<const double*>& iota,
+        const std::vector<double*>& z, const std::vector<double*>& z2):
+      PLDAChunkSum(workspaces, sum_z_second_order.data(),
+        sum_z_second_order.numElements()),
+      m_chunks(chunks), m_D(D), m_F(F), m_G(G),
+      m_mu(mu.data()), m_F_mat(F_mat.data()), m_FtBeta(FtBeta.data()),
+      m_GtISigma(GtISigma.data()), m_alpha(alpha.data()), m_gamma(gamma),
+      m_zeta(zeta), m_iota(iota), m_z(z), m_z2(z2)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      PLDAWorkspace& ws = m_workspaces[ith];
+      const std::vector<size_t>& ids = m_chunks.ids[b];
+      const size_t K = ids.size();
+      const size_t n_i = m_chunks.n_samples[b];
+      const size_t R = K * n_i;
+      const size_t FG = m_F + m_G;
+
+      // 1/ E{h_i} = gamma_a sum_j F^T.beta.(x_ij-mu), for all the identities
+      centredSamples(m_chunks, b, m_mu, m_D, ws.Xc);
+      ws.S.assign(K * m_D, 0.);
+      for (size_t k=0; k<K; ++k)
+        for (size_t j=0; j<n_i; ++j) {
+          const double* x = &ws.Xc[(k * n_i + j) * m_D];
+          double* s = &ws.S[k * m_D];
+          for (size_t d=0; d<m_D; ++d) s[d] += x[d];
+        }
+      ws.H.resize(K * m_F);
+      ws.Eh.resize(K * m_F);
+      ws.FEh.resize(K * m_D);
+      blitz::Array<double,2> S = matrixView(&ws.S[0], K, m_D, m_D);
+      blitz::Array<double,2> H = matrixView(&ws.H[0], K, m_F, m_F);
+      blitz::Array<double,2> Eh = matrixView(&ws.Eh[0], K, m_F, m_F);
+      blitz::Array<double,2> FEh = matrixView(&ws.FEh[0], K, m_D, m_D);
+      bob::math::gemm_(S, matrixView(m_FtBeta, m_F, m_D, m_D), H, false, true);
+      bob::math::gemm_(H, matrixView(m_gamma[b], m_F, m_F, m_F), Eh, false, true);
+      bob::math::gemm_(Eh, matrixView(m_F_mat, m_D, m_F, m_F), FEh, false, true);
+
+      // 2/ E{w_ij} = alpha.G^T.sigma^-1.(x_ij-mu-F.E{h_i}), for all the samples
+      for (size_t k=0; k<K; ++k)
+        for (size_t j=0; j<n_i; ++j) {
+          double* x = &ws.Xc[(k * n_i + j) * m_D];
+          const double* f = &ws.FEh[k * m_D];
+          for (size_t d=0; d<m_D; ++d) x[d] -= f[d];
+        }
+      ws.U.resize(R * m_G);
+      ws.Z.resize(R * FG);
+      blitz::Array<double,2> Xc = matrixView(&ws.Xc[0], R, m_D, m_D);
+      blitz::Array<double,2> U = matrixView(&ws.U[0], R, m_G, m_G);
+      blitz::Array<double,2> Zw = matrixView(&ws.Z[m_F], R, m_G, FG);
+      bob::math::gemm_(Xc, matrixView(m_GtISigma, m_G, m_D, m_D), U, false, true);
+      bob::math::gemm_(U, matrixView(m_alpha, m_G, m_G, m_G), Zw, false, true);
+
+      // 3/ First order statistics E{z_ij} = [E{h_i} E{w_ij}]
+      for (size_t k=0; k<K; ++k) {
+        for (size_t j=0; j<n_i; ++j)
+          std::copy(&ws.Eh[k * m_F], &ws.Eh[(k+1) * m_F],
+            &ws.Z[(k * n_i + j) * FG]);
+        std::copy(&ws.Z[k * n_i * FG], &ws.Z[(k+1) * n_i * FG], m_z[ids[k]]);
+      }
+
+      // 4/ Sum of the second order statistics:
+      //   sum_ij E{z_ij}.E{z_ij}^T + [gamma_a iota_a; iota_a^T zeta_a]
+      ws.acc.resize(FG * FG);
+      blitz::Array<double,2> Z = matrixView(&ws.Z[0], R, FG, FG);
+      blitz::Array<double,2> acc = matrixView(&ws.acc[0], FG, FG, FG);
+      bob::math::gemm_(Z, Z, acc, true, false);
+      const double* gamma_a = m_gamma[b];
+      const double* zeta_a = m_zeta[b];
+      const double* iota_a = m_iota[b];
+      for (size_t p=0; p<m_F; ++p) {
+        for (size_t q=0; q<m_F; ++q)
+          ws.acc[p * FG + q] += R * gamma_a[p * m_F + q];
+        for (size_t q=0; q<m_G; ++q) {
+          ws.acc[p * FG + m_F + q] += R * iota_a[p * m_G + q];
+          ws.acc[(m_F + q) * FG + p] += R * iota_a[p * m_G + q];
+        }
+      }
+      for (size_t p=0; p<m_G; ++p)
+        for (size_t q=0; q<m_G; ++q)
+          ws.acc[(m_F + p) * FG + m_F + q] += R * zeta_a[p * m_G + q];
+
+      // Second order statistics of each sample, if required
+      if (!m_z2.empty()) {
+        for (size_t k=0; k<K; ++k) {
+          double* z2 = m_z2[ids[k]];
+          for (size_t j=0; j<n_i; ++j) {
+            const double* z = &ws.Z[(k * n_i + j) * FG];
+            for (size_t p=0; p<FG; ++p)
+              for (size_t q=0; q<FG; ++q) {
+                double c;
+                if (p < m_F && q < m_F) c = gamma_a[p * m_F + q];
+                else if (p < m_F) c = iota_a[p * m_G + q - m_F];
+                else if (q < m_F) c = iota_a[q * m_G + p - m_F];
+                else c = zeta_a[(p - m_F) * m_G + q - m_F];
+                *z2++ = c + z[p] * z[q];
+              }
+          }
+        }
+      }
+    }
+  };
+
+  /**
+   * Adds the contribution of a chunk to the numerator of the update of B,
+   * sum_ij (x_ij-mu).E{z_ij}^T
+   */
+  struct PLDAFGChunk: public PLDAChunkSum {
+    const PLDAChunks& m_chunks;
+    const size_t m_D;
+    const size_t m_FG;
+    const double* m_mu;
+    const std::vector<const double*>& m_z;
+
+    PLDAFGChunk(const PLDAChunks& chunks,
+        std::vector<PLDAWorkspace>& workspaces,
+        blitz::Array<double,2>& numerator, const size_t D, const size_t FG,
+        const blitz::Array<double,1>& mu, const std::vector<const double*>& z):
+      PLDAChunkSum(workspaces, numerator.data(), numerator.numElements()),
+      m_chunks(chunks), m_D(D), m_FG(FG), m_mu(mu.data()), m_z(z)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      PLDAWorkspace& ws = m_workspaces[ith];
+      const size_t R = m_chunks.ids[b].size() * m_chunks.n_samples[b];
+      centredSamples(m_chunks, b, m_mu, m_D, ws.Xc);
+      firstOrderStatistics(m_chunks, b, m_z, m_FG, ws.Z);
+      ws.acc.resize(m_D * m_FG);
+      blitz::Array<double,2> acc = matrixView(&ws.acc[0], m_D, m_FG, m_FG);
+      bob::math::gemm_(matrixView(&ws.Xc[0], R, m_D, m_D),
+        matrixView(&ws.Z[0], R, m_FG, m_FG), acc, true, false);
+    }
+  };
+
+  /**
+   * Adds the contribution of a chunk to the update of sigma,
+   * sum_ij Diag{(x_ij-mu).(x_ij-mu)^T - B.E{z_ij}.(x_ij-mu)^T}
+   */
+  struct PLDASigmaChunk: public PLDAChunkSum {
+    const PLDAChunks& m_chunks;
+    const size_t m_D;
+    const size_t m_FG;
+    const double* m_mu;
+    const double* m_B;
+    const std::vector<const double*>& m_z;
+
+    PLDASigmaChunk(const PLDAChunks& chunks,
+        std::vector<PLDAWorkspace>& workspaces, blitz::Array<double,1>& sigma,
+        const size_t D, const size_t FG, const blitz::Array<double,1>& mu,
+        const blitz::Array<double,2>& B, const std::vector<const double*>& z):
+      PLDAChunkSum(workspaces, sigma.data(), sigma.numElements()),
+      m_chunks(chunks), m_D(D), m_FG(FG), m_mu(mu.data()), m_B(B.data()), m_z(z)
+    {}
+
+    void operator()(const size_t ith, const size_t b) const {
+      PLDAWorkspace& ws = m_workspaces[ith];
+      const size_t R = m_chunks.ids[b].size() * m_chunks.n_samples[b];
+      centredSamples(m_chunks, b, m_mu, m_D, ws.Xc);
+      firstOrderStatistics(m_chunks, b, m_z, m_FG, ws.Z);
+      ws.BZ.resize(R * m_D);
+      blitz::Array<double,2> BZ = matrixView(&ws.BZ[0], R, m_D, m_D);
+      bob::math::gemm_(matrixView(&ws.Z[0], R, m_FG, m_FG),
+        matrixView(m_B, m_D, m_FG, m_FG), BZ, false, true);
+      ws.acc.assign(m_D, 0.);
+      for (size_t r=0; r<R; ++r) {
+        const double* x = &ws.Xc[r * m_D];
+        const double* bz = &ws.BZ[r * m_D];
+        for (size_t d=0; d<m_D; ++d) ws.acc[d] += x[d] * (x[d] - bz[d]);
+      }
+    }
+  };
+
+}
 
 bob::trainer::PLDATrainer::PLDATrainer(const size_t max_iterations, 
     const bool use_sum_second_order):
@@ -33,9 +369,9 @@ bob::trainer::PLDATrainer::PLDATrainer(const size_t max_iterations,
   m_cache_z_first_order(0), m_cache_sum_z_second_order(0,0), m_cache_z_second_order(0),
   m_cache_n_samples_per_id(0), m_cache_n_samples_in_training(), m_cache_B(0,0),
   m_cache_Ft_isigma_G(0,0), m_cache_eta(0,0), m_cache_zeta(), m_cache_iota(),
-  m_tmp_nf_1(0), m_tmp_nf_2(0), m_tmp_ng_1(0),
-  m_tmp_D_1(0), m_tmp_D_2(0), 
-  m_tmp_nfng_nfng(0,0), m_tmp_D_nfng_1(0,0), m_tmp_D_nfng_2(0,0)
+  m_n_threads(0),
+  m_tmp_nf_1(0), m_tmp_D_1(0), m_tmp_D_2(0), 
+  m_tmp_nfng_nfng(0,0), m_tmp_D_nfng_2(0,0)
 {
 }
 
@@ -56,7 +392,8 @@ bob::trainer::PLDATrainer::PLDATrainer(const bob::trainer::PLDATrainer& other):
   m_cache_n_samples_in_training(other.m_cache_n_samples_in_training), 
   m_cache_B(bob::core::array::ccopy(other.m_cache_B)), 
   m_cache_Ft_isigma_G(bob::core::array::ccopy(other.m_cache_Ft_isigma_G)), 
-  m_cache_eta(bob::core::array::ccopy(other.m_cache_eta)) 
+  m_cache_eta(bob::core::array::ccopy(other.m_cache_eta)),
+  m_n_threads(other.m_n_threads)
 {
   bob::core::array::ccopy(other.m_cache_z_first_order, m_cache_z_first_order);
   bob::core::array::ccopy(other.m_cache_z_second_order, m_cache_z_second_order);
@@ -95,6 +432,7 @@ bob::trainer::PLDATrainer& bob::trainer::PLDATrainer::operator=
     m_cache_Ft_isigma_G = bob::core::array::ccopy(other.m_cache_Ft_isigma_G); 
     m_cache_eta = bob::core::array::ccopy(other.m_cache_eta); 
     bob::core::array::ccopy(other.m_cache_iota, m_cache_iota);
+    m_n_threads = other.m_n_threads;
     // Resize working arrays
     resizeTmp();
   }
@@ -272,12 +610,9 @@ void bob::trainer::PLDATrainer::initMembers(const std::vector<blitz::Array<doubl
 void bob::trainer::PLDATrainer::resizeTmp()
 {
   m_tmp_nf_1.resize(m_dim_f);
-  m_tmp_nf_2.resize(m_dim_f);
-  m_tmp_ng_1.resize(m_dim_g);
   m_tmp_D_1.resize(m_dim_d);
   m_tmp_D_2.resize(m_dim_d);
   m_tmp_nfng_nfng.resize(m_dim_f+m_dim_g, m_dim_f+m_dim_g);
-  m_tmp_D_nfng_1.resize(m_dim_d, m_dim_f+m_dim_g);
   m_tmp_D_nfng_2.resize(m_dim_d, m_dim_f+m_dim_g);
 }
 
@@ -505,94 +840,40 @@ void bob::trainer::PLDATrainer::eStep(bob::machine::PLDABase& machine,
 {  
   // Precomputes useful variables using current estimates of F,G, and sigma
   precomputeFromFGSigma(machine);
-  // Gets the mean mu from the machine
-  const blitz::Array<double,1>& mu = machine.getMu();
-  const blitz::Array<double,2>& alpha = machine.getAlpha();
-  const blitz::Array<double,2>& F = machine.getF();
-  const blitz::Array<double,2>& FtBeta = machine.getFtBeta();
-  const blitz::Array<double,2>& GtISigma = machine.getGtISigma();
-  blitz::Range a = blitz::Range::all();
+  // C-contiguous copies of the parameters, read by all the threads
+  const blitz::Array<double,1> mu = bob::core::array::ccopy(machine.getMu());
+  const blitz::Array<double,2> alpha = bob::core::array::ccopy(machine.getAlpha());
+  const blitz::Array<double,2> F = bob::core::array::ccopy(machine.getF());
+  const blitz::Array<double,2> FtBeta = bob::core::array::ccopy(machine.getFtBeta());
+  const blitz::Array<double,2> GtISigma = bob::core::array::ccopy(machine.getGtISigma());
+
+  // Groups the identities by number of samples, such that the statistics of
+  // the identities of a chunk are computed with a few matrix products
+  const PLDAChunks chunks(v_ar);
+  // gamma_a, zeta_a and iota_a are only computed by this thread, as
+  // getAddGamma() updates the cache of the machine
+  std::map<size_t, blitz::Array<double,2> > gammas;
+  std::vector<const double*> gamma, zeta, iota;
+  for (size_t b=0; b<chunks.size(); ++b) {
+    const size_t n_i = chunks.n_samples[b];
+    if (gammas.find(n_i) == gammas.end())
+      gammas[n_i].reference(bob::core::array::ccopy(machine.getAddGamma(n_i)));
+    gamma.push_back(gammas[n_i].data());
+    zeta.push_back(m_cache_zeta[n_i].data());
+    iota.push_back(m_cache_iota[n_i].data());
+  }
+  std::vector<double*> z, z2;
+  for (size_t i=0; i<v_ar.size(); ++i) {
+    z.push_back(m_cache_z_first_order[i].data());
+    if (!m_use_sum_second_order) z2.push_back(m_cache_z_second_order[i].data());
+  }
 
-  // blitz indices
-  blitz::firstIndex bi;
-  blitz::secondIndex bj;
   // Initializes sum of z second order statistics to 0
   m_cache_sum_z_second_order = 0.;
-  for (size_t i=0; i<v_ar.size(); ++i)
-  {
-    // Computes expectation of z_ij = [h_i w_ij]
-    // 1/a/ Computes expectation of h_i
-    // Loop over the samples
-    m_tmp_nf_1 = 0.;
-    for (int j=0; j<v_ar[i].extent(0); ++j)
-    {
-      // m_tmp_D_1 = x_sj-mu
-      m_tmp_D_1 = v_ar[i](j,a) - mu;
-
-      // m_tmp_nf_2 = F^T.beta.(x_sj-mu)
-      bob::math::prod(FtBeta, m_tmp_D_1, m_tmp_nf_2);
-      // m_tmp_nf_1 = sum_j F^T.beta.(x_sj-mu)
-      m_tmp_nf_1 += m_tmp_nf_2;
-    }
-    const blitz::Array<double,2>& gamma_a = machine.getAddGamma(v_ar[i].extent(0));
-    blitz::Range r_hi(0, m_dim_f-1);
-    // m_tmp_nf_2 = E(h_i) = gamma_A  sum_j F^T.beta.(x_sj-mu)
-    bob::math::prod(gamma_a, m_tmp_nf_1, m_tmp_nf_2);
-
-    // 1/b/ Precomputes: m_tmp_D_2 = F.E{h_i}
-    bob::math::prod(F, m_tmp_nf_2, m_tmp_D_2);
-
-    // 2/ First and second order statistics of z
-    // Precomputed values 
-    blitz::Array<double,2>& zeta_a = m_cache_zeta[v_ar[i].extent(0)];
-    blitz::Array<double,2>& iota_a = m_cache_iota[v_ar[i].extent(0)];
-    blitz::Array<double,2> iotat_a = iota_a.transpose(1,0);
-
-    // Extracts statistics of z_ij = [h_i w_ij] from y_i = [h_i w_i1 ... w_iJ]
-    blitz::Range r1(0, m_dim_f-1);
-    blitz::Range r2(m_dim_f, m_dim_f+m_dim_g-1);
-    for (int j=0; j<v_ar[i].extent(0); ++j)
-    {
-      // 1/ First order statistics of z
-      blitz::Array<double,1> z_first_order_ij_1 = m_cache_z_first_order[i](j,r1);
-      z_first_order_ij_1 = m_tmp_nf_2; // E{h_i}
-      // m_tmp_D_1 = x_sj - mu - F.E{h_i}
-      m_tmp_D_1 = v_ar[i](j,a) - mu - m_tmp_D_2;
-      // m_tmp_ng_1 = G^T.sigma^-1.(x_sj-mu-fhi)
-      bob::math::prod(GtISigma, m_tmp_D_1, m_tmp_ng_1);
-      // z_first_order_ij_2 = (Id+G^T.sigma^-1.G)^-1.G^T.sigma^-1.(x_sj-mu) = E{w_ij}
-      blitz::Array<double,1> z_first_order_ij_2 = m_cache_z_first_order[i](j,r2);
-      bob::math::prod(alpha, m_tmp_ng_1, z_first_order_ij_2); 
-
-      // 2/ Second order statistics of z
-      blitz::Array<double,2> z_sum_so_11 = m_cache_sum_z_second_order(r1,r1);
-      blitz::Array<double,2> z_sum_so_12 = m_cache_sum_z_second_order(r1,r2);
-      blitz::Array<double,2> z_sum_so_21 = m_cache_sum_z_second_order(r2,r1);
-      blitz::Array<double,2> z_sum_so_22 = m_cache_sum_z_second_order(r2,r2);
-      if (m_use_sum_second_order)
-      {
-        z_sum_so_11 += gamma_a + z_first_order_ij_1(bi) * z_first_order_ij_1(bj);
-        z_sum_so_12 += iota_a + z_first_order_ij_1(bi) * z_first_order_ij_2(bj);
-        z_sum_so_21 += iotat_a + z_first_order_ij_2(bi) * z_first_order_ij_1(bj);
-        z_sum_so_22 += zeta_a + z_first_order_ij_2(bi) * z_first_order_ij_2(bj);
-      }
-      else
-      {
-        blitz::Array<double,2> z_so_11 = m_cache_z_second_order[i](j,r1,r1);
-        z_so_11 = gamma_a + z_first_order_ij_1(bi) * z_first_order_ij_1(bj);
-        z_sum_so_11 += z_so_11;
-        blitz::Array<double,2> z_so_12 = m_cache_z_second_order[i](j,r1,r2);
-        z_so_12 = iota_a + z_first_order_ij_1(bi) * z_first_order_ij_2(bj);
-        z_sum_so_12 += z_so_12;
-        blitz::Array<double,2> z_so_21 = m_cache_z_second_order[i](j,r2,r1);
-        z_so_21 = iotat_a + z_first_order_ij_2(bi) * z_first_order_ij_1(bj);
-        z_sum_so_21 += z_so_21;
-        blitz::Array<double,2> z_so_22 = m_cache_z_second_order[i](j,r2,r2);
-        z_so_22 = zeta_a + z_first_order_ij_2(bi) * z_first_order_ij_2(bj);
-        z_sum_so_22 += z_so_22;
-      }
-    }
-  }
+  std::vector<PLDAWorkspace> workspaces(bob::core::thread_count(chunks.size(), m_n_threads));
+  bob::core::thread_reduce_blocks(PLDAEStepChunk(chunks, workspaces,
+    m_cache_sum_z_second_order, m_dim_d, m_dim_f, m_dim_g, mu, F, FtBeta, GtISigma,
+    alpha, gamma, zeta, iota, z, z2), chunks.size(), m_n_threads);
 }
 
 void bob::trainer::PLDATrainer::precomputeFromFGSigma(bob::machine::PLDABase& machine)
@@ -678,23 +959,16 @@ void bob::trainer::PLDATrainer::updateFG(bob::machine::PLDABase& machine,
 
   // 1/ Computes the numerator (sum_ij (x_ij-mu).E{z_i}^T)
   // Gets the mean mu from the machine
-  const blitz::Array<double,1>& mu = machine.getMu();
+  const blitz::Array<double,1> mu = bob::core::array::ccopy(machine.getMu());
   blitz::Range a = blitz::Range::all();
-  m_tmp_D_nfng_2 = 0.;
+  const PLDAChunks chunks(v_ar);
+  std::vector<const double*> z;
   for (size_t i=0; i<v_ar.size(); ++i)
-  {
-    // Loop over the samples
-    for (int j=0; j<v_ar[i].extent(0); ++j)
-    {
-      // m_tmp_D_1 = x_sj-mu
-      m_tmp_D_1 = v_ar[i](j,a) - mu;
-      // z_first_order_ij = E{z_ij}
-      blitz::Array<double,1> z_first_order_ij = m_cache_z_first_order[i](j, a);
-      // m_tmp_D_nfng_1 = (x_sj-mu).E{z_ij}^T
-      bob::math::prod(m_tmp_D_1, z_first_order_ij, m_tmp_D_nfng_1);
-      m_tmp_D_nfng_2 += m_tmp_D_nfng_1;
-    }
-  }
+    z.push_back(m_cache_z_first_order[i].data());
+  m_tmp_D_nfng_2 = 0.;
+  std::vector<PLDAWorkspace> workspaces(bob::core::thread_count(chunks.size(), m_n_threads));
+  bob::core::thread_reduce_blocks(PLDAFGChunk(chunks, workspaces, m_tmp_D_nfng_2,
+    m_dim_d, m_dim_f+m_dim_g, mu, z), chunks.size(), m_n_threads);
 
   // 2/ Computes the denominator inv(sum_ij E{z_i.z_i^T})
   bob::math::inv(m_cache_sum_z_second_order, m_tmp_nfng_nfng);
@@ -717,32 +991,21 @@ void bob::trainer::PLDATrainer::updateSigma(bob::machine::PLDABase& machine,
 
   // Gets the mean mu and the matrix sigma from the machine
   blitz::Array<double,1>& sigma = machine.updateSigma();
-  const blitz::Array<double,1>& mu = machine.getMu();
-  blitz::Range a = blitz::Range::all();
+  const blitz::Array<double,1> mu = bob::core::array::ccopy(machine.getMu());
 
-  sigma = 0.;
+  const PLDAChunks chunks(v_ar);
+  std::vector<const double*> z;
   size_t n_IJ=0; /// counts the number of samples
-  for (size_t i=0; i<v_ar.size(); ++i)
-  {
-    // Loop over the samples
-    for (int j=0; j<v_ar[i].extent(0); ++j)
-    {
-      // m_tmp_D_1 = x_ij-mu
-      m_tmp_D_1 = v_ar[i](j,a) - mu;
-      // sigma += Diag{(x_ij-mu).(x_ij-mu)^T}
-      sigma += blitz::pow2(m_tmp_D_1);
-
-      // z_first_order_ij = E{z_ij}
-      blitz::Array<double,1> z_first_order_ij = m_cache_z_first_order[i](j,a);
-      // m_tmp_D_2 = B.E{z_ij}
-      bob::math::prod(m_cache_B, z_first_order_ij, m_tmp_D_2);
-      // sigma -= Diag{B.E{z_ij}.(x_ij-mu)
-      sigma -= (m_tmp_D_1 * m_tmp_D_2);
-      ++n_IJ;
-    }
+  for (size_t i=0; i<v_ar.size(); ++i) {
+    z.push_back(m_cache_z_first_order[i].data());
+    n_IJ += v_ar[i].extent(0);
   }
+  m_tmp_D_1 = 0.;
+  std::vector<PLDAWorkspace> workspaces(bob::core::thread_count(chunks.size(), m_n_threads));
+  bob::core::thread_reduce_blocks(PLDASigmaChunk(chunks, workspaces, m_tmp_D_1,
+    m_dim_d, m_dim_f+m_dim_g, mu, m_cache_B, z), chunks.size(), m_n_threads);
   // Normalizes by the number of samples
-  sigma /= static_cast<double>(n_IJ);
+  sigma = m_tmp_D_1 / static_cast<double>(n_IJ);
   // Apply variance threshold
   machine.applyVarianceThreshold();
 }
@@ -805,3 +1068,40 @@ void bob::trainer::PLDATrainer::enrol(bob::machine::PLDAMachine& plda_machine,
   plda_machine.setLogLikelihood(plda_machine.computeLogLikelihood(
                                   blitz::Array<double,2>(0,dim_d),true));
 }
+
+bool bob::trainer::PLDATrainer::saveAccumulators(bob::io::HDF5File& file) const
+{
+  for (size_t i=0; i<m_cache_z_first_order.size(); ++i) {
+    boost::format m("z_first_order_%u");
+    m % i;
+    file.setArray(m.str(), m_cache_z_first_order[i]);
+  }
+  file.setArray("sum_z_second_order", m_cache_sum_z_second_order);
+  if (!m_use_sum_second_order) {
+    for (size_t i=0; i<m_cache_z_second_order.size(); ++i) {
+      boost::format m("z_second_order_%u");
+      m % i;
+      file.setArray(m.str(), m_cache_z_second_order[i]);
+    }
+  }
+  return true;
+}
+
+void bob::trainer::PLDATrainer::loadAccumulators(bob::machine::PLDABase& machine,
+  bob::io::HDF5File& file)
+{
+  // the caches have been resized by initialize()
+  for (size_t i=0; i<m_cache_z_first_order.size(); ++i) {
+    boost::format m("z_first_order_%u");
+    m % i;
+    file.readArray(m.str(), m_cache_z_first_order[i]);
+  }
+  file.readArray("sum_z_second_order", m_cache_sum_z_second_order);
+  if (!m_use_sum_second_order) {
+    for (size_t i=0; i<m_cache_z_second_order.size(); ++i) {
+      boost::format m("z_second_order_%u");
+      m % i;
+      file.readArray(m.str(), m_cache_z_second_order[i]);
+    }
+  }
+}
@@ -13,6 +13,12 @@
 #include <boost/algorithm/string.hpp>
 #include <bob/trainer/SVMTrainer.h>
 #include <bob/core/logging.h>
+#include <bob/core/assert.h>
+#include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
+#include <map>
+#include <cmath>
 
 #ifdef BOB_DEBUG
 //remove newline
@@ -59,6 +65,8 @@ bob::trainer::SVMTrainer::SVMTrainer(
   m_param.nr_weight = 0;
   m_param.weight_label = 0;
   m_param.weight = 0;
+
+  m_n_threads = 0;
 }
 
 bob::trainer::SVMTrainer::~SVMTrainer() { }
@@ -97,6 +105,44 @@ static svm_problem* new_problem(size_t entries) {
   return retval;
 }
 
+/**
+ * Checks the number of classes, and returns the labels assigned to them
+ */
+static std::vector<double> class_labels(size_t n_classes) {
+  if ((n_classes <= 1) | (n_classes > 16)) {
+    boost::format m("Only supports SVMs for binary or multi-class classification problems (up to 16 classes). You passed me a list of %d arraysets.");
+    m % n_classes;
+    throw std::runtime_error(m.str());
+  }
+
+  std::vector<double> labels;
+  labels.reserve(n_classes);
+  if (n_classes == 2) {
+    //keep libsvm ordering
+    labels.push_back(+1.);
+    labels.push_back(-1.);
+  }
+  else { //n_classes == 3, 4, ..., 16
+    for (size_t k=0; k<n_classes; ++k) labels.push_back(k+1);
+  }
+  return labels;
+}
+
+/**
+ * Checks that all the arraysets have the same number of features
+ */
+static void check_features(const std::vector<blitz::Array<double,2> >& data) {
+  int n_features = data[0].extent(blitz::secondDim);
+
+  for (size_t cl=0; cl<data.size(); ++cl) {
+    if (data[cl].extent(blitz::secondDim) != n_features) {
+      boost::format m("number of features (columns) of array for class %u (%d) does not match that of array for class 0 (%d)");
+      m % cl % data[cl].extent(blitz::secondDim) % n_features;
+      throw std::runtime_error(m.str());
+    }
+  }
+}
+
 /**
  * Converts the input arrayset data into an svm_problem matrix, used by libsvm
  * training routines. Updates "gamma" at the svm_parameter's.
@@ -118,22 +164,7 @@ static boost::shared_ptr<svm_problem> data2problem
       std::ptr_fun(delete_problem));
 
   //choose labels.
-  if ((data.size() <= 1) | (data.size() > 16)) {
-    boost::format m("Only supports SVMs for binary or multi-class classification problems (up to 16 classes). You passed me a list of %d arraysets.");
-    m % data.size();
-    throw std::runtime_error(m.str());
-  }
-
-  std::vector<double> labels;
-  labels.reserve(data.size());
-  if (data.size() == 2) {
-    //keep libsvm ordering
-    labels.push_back(+1.);
-    labels.push_back(-1.);
-  }
-  else { //data.size() == 3, 4, ..., 16
-    for (size_t k=0; k<data.size(); ++k) labels.push_back(k+1);
-  }
+  std::vector<double> labels = class_labels(data.size());
 
   //just count how many nodes we need; unfortunately we have no other choice
   //than doing a 2-pass instantiation here as libsvm has a very weird way to
@@ -210,51 +241,289 @@ static void svm_model_free(svm_model*& m) {
 #endif
 }
 
-boost::shared_ptr<bob::machine::SupportVector> bob::trainer::SVMTrainer::train
-(const std::vector<blitz::Array<double, 2> >& data,
- const blitz::Array<double,1>& input_subtraction,
- const blitz::Array<double,1>& input_division) const {
+/**
+ * Redirects the libsvm messages to our debugging stream
+ */
+static void set_print_function() {
+#if LIBSVM_VERSION >= 291
+  svm_set_print_string_function(debug_libsvm);
+#else
+  boost::format m("libsvm-%d does not support debugging stream setting");
+  m % libsvm_version;
+  debug_libsvm(m.str().c_str());
+#endif
+}
 
-  //sanity check of input arraysets
-  int n_features = data[0].extent(blitz::secondDim);
+/**
+ * Checks the parametrization against the problem
+ */
+static void check_parameter(const svm_problem* problem,
+    const svm_parameter* param) {
+  const char* error_msg = svm_check_parameter(problem, param);
+  if (error_msg) {
+    boost::format m("libsvm-%d reports: %s");
+    m % libsvm_version % error_msg;
+    throw std::runtime_error(m.str());
+  }
+}
 
-  for (size_t cl=0; cl<data.size(); ++cl) {
-    if (data[cl].extent(blitz::secondDim) != n_features) {
-      boost::format m("number of features (columns) of array for class %u (%d) does not match that of array for class 0 (%d)");
-      m % cl % data[cl].extent(blitz::secondDim) % n_features;
-      throw std::runtime_error(m.str());
-    }
+/**
+ * Number of rows of the blocks of inner products computed by a single matrix
+ * product
+ */
+static const size_t SVM_GRAM_BLOCK_SIZE = 256;
+
+/**
+ * The value of the kernel of the given parametrization, from the inner
+ * products between two samples x and y (and with themselves)
+ */
+static inline double kernel_value(const svm_parameter& param, const double xy,
+    const double xx, const double yy) {
+  switch (param.kernel_type) {
+    case LINEAR:
+      return xy;
+    case POLY:
+      return std::pow(param.gamma * xy + param.coef0, param.degree);
+    case RBF:
+      return std::exp(-param.gamma * (xx + yy - 2. * xy));
+    case SIGMOID:
+      return std::tanh(param.gamma * xy + param.coef0);
+    default:
+      return 0.;
   }
+}
 
-  //converts the input arraysets into something libsvm can digest
-  double save_gamma = m_param.gamma; ///< the next method may update it!
-  boost::shared_ptr<svm_problem> problem =
-    data2problem(data, input_subtraction, input_division,
-        const_cast<svm_parameter&>(m_param) ///< temporary cast
-        );
+static svm_node make_node(const int index, const double value) {
+  svm_node node;
+  node.index = index;
+  node.value = value;
+  return node;
+}
 
-  //checks parametrization to make sure all is alright.
-  const char* error_msg = svm_check_parameter(problem.get(), &m_param);
+namespace {
+
+  /**
+   * Computes the inner products between a block of rows of samples and all
+   * the samples
+   */
+  struct SVMGramBlock {
+    const double* m_X; ///< N x D samples
+    double* m_G; ///< N x N inner products
+    const int m_n_samples;
+    const int m_n_features;
+
+    SVMGramBlock(const double* X, double* G, const int n_samples,
+        const int n_features):
+      m_X(X), m_G(G), m_n_samples(n_samples), m_n_features(n_features)
+    {
+    }
 
-  if (error_msg) {
-    const_cast<double&>(m_param.gamma) = save_gamma;
-    boost::format m("libsvm-%d reports: %s");
-    m % libsvm_version % error_msg;
-    std::runtime_error(m.str());
+    void operator()(const size_t ith, const size_t b) const
+    {
+      const int begin = b * SVM_GRAM_BLOCK_SIZE;
+      const int n = std::min(m_n_samples - begin, (int)SVM_GRAM_BLOCK_SIZE);
+      const blitz::Array<double,2> X(const_cast<double*>(m_X),
+        blitz::shape(m_n_samples, m_n_features), blitz::neverDeleteData);
+      const blitz::Array<double,2> Xb(const_cast<double*>(m_X) + begin*m_n_features,
+        blitz::shape(n, m_n_features), blitz::neverDeleteData);
+      blitz::Array<double,2> Gb(m_G + begin*m_n_samples,
+        blitz::shape(n, m_n_samples), blitz::neverDeleteData);
+      bob::math::gemm_(Xb, X, Gb, false, true, 1., 0.);
+    }
+  };
+
+  /**
+   * Fills rows of a kernel matrix in the format of libsvm's precomputed
+   * kernels: the first node of each row contains the (1-based) serial number
+   * of the sample, and the j'th one the kernel value with the j'th sample.
+   */
+  struct SVMKernelRows {
+    const double* m_G; ///< N x N inner products
+    svm_node* m_nodes; ///< N x (N+2) nodes
+    const svm_parameter& m_param;
+    const int m_n_samples;
+
+    SVMKernelRows(const double* G, svm_node* nodes,
+        const svm_parameter& param, const int n_samples):
+      m_G(G), m_nodes(nodes), m_param(param), m_n_samples(n_samples)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t begin, const size_t end) const
+    {
+      const int n = m_n_samples;
+      for (int i=(int)begin; i<(int)end; ++i) {
+        svm_node* row = m_nodes + i*(n+2);
+        const double* g = m_G + i*n;
+        row[0] = make_node(0, i+1);
+        for (int j=0; j<n; ++j)
+          row[j+1] = make_node(j+1, kernel_value(m_param, g[j], g[i], m_G[j*(n+1)]));
+        row[n+1] = make_node(-1, 0.);
+      }
+    }
+  };
+
+  /**
+   * Trains the binary sub-problems of a one-vs-one multi-class problem
+   */
+  struct SVMPairTraining {
+    std::vector<svm_problem>& m_problems;
+    const svm_parameter& m_param;
+    std::vector<boost::shared_ptr<svm_model> >& m_models;
+
+    SVMPairTraining(std::vector<svm_problem>& problems,
+        const svm_parameter& param,
+        std::vector<boost::shared_ptr<svm_model> >& models):
+      m_problems(problems), m_param(param), m_models(models)
+    {
+    }
+
+    void operator()(const size_t ith, const size_t p) const
+    {
+      m_models[p].reset(svm_train(&m_problems[p], &m_param),
+        std::ptr_fun(svm_model_free));
+    }
+  };
+
+  /**
+   * A multi-class model assembled from the binary models of its one-vs-one
+   * sub-problems, together with the memory it refers to
+   */
+  struct SVMOneVsOneModel {
+    svm_model model;
+    std::vector<svm_node*> sv;
+    std::vector<std::vector<double> > coef;
+    std::vector<double*> coef_rows;
+    std::vector<double> rho;
+    std::vector<int> label;
+    std::vector<int> n_sv;
+  };
+
+}
+
+/**
+ * Trains an SVM on the given problem, in which the samples of each class are
+ * stored one after the other. The one-vs-one sub-problems of multi-class
+ * C_SVC and NU_SVC machines are trained by several threads (unless
+ * probability estimates are required), and the binary models are then
+ * assembled the way svm_train() does. The support vectors of the returned
+ * model point to the data of the problem.
+ */
+static boost::shared_ptr<svm_model> train_model(const svm_problem& problem,
+    const svm_parameter& param, const std::vector<size_t>& class_sizes,
+    const std::vector<double>& labels, const size_t n_threads) {
+
+  const size_t n_classes = class_sizes.size();
+  const size_t n_pairs = n_classes * (n_classes - 1) / 2;
+  if (n_pairs <= 1 || param.probability ||
+      (param.svm_type != C_SVC && param.svm_type != NU_SVC) ||
+      bob::core::thread_count(n_pairs, n_threads) <= 1) {
+    return boost::shared_ptr<svm_model>(svm_train(&problem, &param),
+        std::ptr_fun(svm_model_free));
   }
 
-  //do the training, returns the new machine
-#if LIBSVM_VERSION >= 291
-  svm_set_print_string_function(debug_libsvm);
-#else
-  boost::format m("libsvm-%d does not support debugging stream setting");
-  m % libsvm_version;
-  debug_libsvm(m.str().c_str());
-#endif
-  boost::shared_ptr<svm_model> model(svm_train(problem.get(), &m_param),
-      std::ptr_fun(svm_model_free));
+  //first sample of each class
+  std::vector<size_t> starts(n_classes, 0);
+  for (size_t k=1; k<n_classes; ++k)
+    starts[k] = starts[k-1] + class_sizes[k-1];
+
+  //1. trains the binary sub-problems (class i vs. class j, for i < j)
+  std::vector<svm_problem> problems(n_pairs);
+  std::vector<std::vector<double> > y(n_pairs);
+  std::vector<std::vector<svm_node*> > x(n_pairs);
+  size_t p = 0;
+  for (size_t i=0; i<n_classes; ++i) {
+    for (size_t j=i+1; j<n_classes; ++j, ++p) {
+      y[p].assign(class_sizes[i], +1.);
+      y[p].insert(y[p].end(), class_sizes[j], -1.);
+      x[p].assign(problem.x + starts[i], problem.x + starts[i] + class_sizes[i]);
+      x[p].insert(x[p].end(), problem.x + starts[j],
+          problem.x + starts[j] + class_sizes[j]);
+      problems[p].l = (int)y[p].size();
+      problems[p].y = &y[p][0];
+      problems[p].x = &x[p][0];
+    }
+  }
+  std::vector<boost::shared_ptr<svm_model> > models(n_pairs);
+  bob::core::thread_blocks(SVMPairTraining(problems, param, models), n_pairs,
+      n_threads);
+
+  //2. gets the (signed) coefficients of the samples of each sub-problem; the
+  //support vectors of the binary models point to the samples of the problem
+  std::map<const svm_node*, size_t> index;
+  for (int k=0; k<problem.l; ++k) index[problem.x[k]] = k;
+  std::vector<bool> nonzero(problem.l, false);
+  std::vector<std::vector<double> > alpha(n_pairs);
+  p = 0;
+  for (size_t i=0; i<n_classes; ++i) {
+    for (size_t j=i+1; j<n_classes; ++j, ++p) {
+      alpha[p].assign(problems[p].l, 0.);
+      const svm_model& m = *models[p];
+      for (int q=0; q<m.l; ++q) {
+        const size_t g = index[m.SV[q]];
+        const size_t k = (g >= starts[j]) ? g - starts[j] + class_sizes[i] :
+          g - starts[i];
+        alpha[p][k] = m.sv_coef[0][q];
+        nonzero[g] = true;
+      }
+    }
+  }
+
+  //3. assembles the multi-class model
+  boost::shared_ptr<SVMOneVsOneModel> owner(new SVMOneVsOneModel);
+  SVMOneVsOneModel& o = *owner;
+  std::vector<int> nz_start(n_classes, 0);
+  for (size_t k=0; k<n_classes; ++k) {
+    o.label.push_back((int)labels[k]);
+    int count = 0;
+    for (size_t s=starts[k]; s<starts[k]+class_sizes[k]; ++s) {
+      if (nonzero[s]) {
+        o.sv.push_back(problem.x[s]);
+        ++count;
+      }
+    }
+    o.n_sv.push_back(count);
+    if (k > 0) nz_start[k] = nz_start[k-1] + o.n_sv[k-1];
+  }
 
-  const_cast<double&>(m_param.gamma) = save_gamma;
+  o.coef.assign(n_classes-1, std::vector<double>(o.sv.size(), 0.));
+  p = 0;
+  for (size_t i=0; i<n_classes; ++i) {
+    for (size_t j=i+1; j<n_classes; ++j, ++p) {
+      int q = nz_start[i];
+      for (size_t k=0; k<class_sizes[i]; ++k)
+        if (nonzero[starts[i]+k]) o.coef[j-1][q++] = alpha[p][k];
+      q = nz_start[j];
+      for (size_t k=0; k<class_sizes[j]; ++k)
+        if (nonzero[starts[j]+k]) o.coef[i][q++] = alpha[p][class_sizes[i]+k];
+      o.rho.push_back(models[p]->rho[0]);
+    }
+  }
+  for (size_t k=0; k<o.coef.size(); ++k) o.coef_rows.push_back(&o.coef[k][0]);
+
+  o.model = svm_model();
+  o.model.param = param;
+  o.model.nr_class = (int)n_classes;
+  o.model.l = (int)o.sv.size();
+  o.model.SV = o.sv.empty() ? 0 : &o.sv[0];
+  o.model.sv_coef = &o.coef_rows[0];
+  o.model.rho = &o.rho[0];
+  o.model.probA = 0;
+  o.model.probB = 0;
+  o.model.label = &o.label[0];
+  o.model.nSV = &o.n_sv[0];
+  o.model.free_sv = 0;
+  return boost::shared_ptr<svm_model>(owner, &o.model);
+}
+
+/**
+ * Builds a new machine from a trained model, which should not depend on the
+ * memory of the problem anymore
+ */
+static boost::shared_ptr<bob::machine::SupportVector> make_machine
+(const boost::shared_ptr<svm_model> model,
+ const blitz::Array<double,1>& input_subtraction,
+ const blitz::Array<double,1>& input_division) {
 
   //save newly created machine to file, reload from there to get rid of memory
   //dependencies due to the poorly implemented memory model in libsvm
@@ -271,6 +540,33 @@ boost::shared_ptr<bob::machine::SupportVector> bob::trainer::SVMTrainer::train
   return retval;
 }
 
+boost::shared_ptr<bob::machine::SupportVector> bob::trainer::SVMTrainer::train
+(const std::vector<blitz::Array<double, 2> >& data,
+ const blitz::Array<double,1>& input_subtraction,
+ const blitz::Array<double,1>& input_division) const {
+
+  //sanity check of input arraysets
+  check_features(data);
+
+  //converts the input arraysets into something libsvm can digest
+  svm_parameter param = m_param; ///< the next method may update gamma
+  boost::shared_ptr<svm_problem> problem =
+    data2problem(data, input_subtraction, input_division, param);
+
+  //checks parametrization to make sure all is alright.
+  check_parameter(problem.get(), &param);
+
+  //do the training, returns the new machine
+  set_print_function();
+  std::vector<size_t> class_sizes;
+  for (size_t k=0; k<data.size(); ++k)
+    class_sizes.push_back(data[k].extent(blitz::firstDim));
+  boost::shared_ptr<svm_model> model = train_model(*problem, param,
+      class_sizes, class_labels(data.size()), m_n_threads);
+
+  return make_machine(model, input_subtraction, input_division);
+}
+
 boost::shared_ptr<bob::machine::SupportVector> bob::trainer::SVMTrainer::train
 (const std::vector<blitz::Array<double,2> >& data) const {
   int n_features = data[0].extent(blitz::secondDim);
@@ -280,3 +576,116 @@ boost::shared_ptr<bob::machine::SupportVector> bob::trainer::SVMTrainer::train
   div = 1.;
   return train(data, sub, div);
 }
+
+boost::shared_ptr<bob::machine::SupportVector> bob::trainer::SVMTrainer::train
+(const bob::trainer::SVMGramMatrix& gram) const {
+
+  svm_parameter param = m_param;
+  if (param.kernel_type != LINEAR && param.kernel_type != POLY &&
+      param.kernel_type != RBF && param.kernel_type != SIGMOID) {
+    throw std::runtime_error("Only linear, polynomial, RBF and sigmoid kernels can be computed from the inner products of an SVMGramMatrix");
+  }
+  //extracted from svm-train.c
+  if (param.gamma == 0. && gram.getMaxIndex() > 0) {
+    param.gamma = 1.0/gram.getMaxIndex();
+  }
+
+  //builds the kernel matrix, in the format of libsvm's precomputed kernels
+  const int n_samples = gram.getNSamples();
+  std::vector<svm_node> nodes((size_t)n_samples * (n_samples+2));
+  bob::core::thread_loop(SVMKernelRows(gram.getInnerProducts().data(),
+        &nodes[0], param, n_samples), n_samples, m_n_threads);
+
+  std::vector<double> labels = class_labels(gram.getNClasses());
+  std::vector<double> y;
+  std::vector<svm_node*> x;
+  for (size_t k=0; k<gram.getNClasses(); ++k)
+    y.insert(y.end(), gram.getClassSizes()[k], labels[k]);
+  for (int i=0; i<n_samples; ++i) x.push_back(&nodes[(size_t)i*(n_samples+2)]);
+  svm_problem problem;
+  problem.l = n_samples;
+  problem.y = &y[0];
+  problem.x = &x[0];
+
+  svm_parameter precomputed = param;
+  precomputed.kernel_type = PRECOMPUTED;
+  check_parameter(&problem, &precomputed);
+
+  set_print_function();
+  boost::shared_ptr<svm_model> model = train_model(problem, precomputed,
+      gram.getClassSizes(), labels, m_n_threads);
+
+  //replaces the rows of the kernel matrix by the features of the support
+  //vectors, and the precomputed kernel by the kernel of this trainer
+  const blitz::Array<double,2>& samples = gram.getSamples();
+  std::vector<size_t> offsets;
+  std::vector<svm_node> sv_nodes;
+  for (int q=0; q<model->l; ++q) {
+    const int i = (int)model->SV[q][0].value - 1;
+    offsets.push_back(sv_nodes.size());
+    for (int f=0; f<samples.extent(1); ++f)
+      if (samples(i,f)) sv_nodes.push_back(make_node(f+1, samples(i,f)));
+    sv_nodes.push_back(make_node(-1, 0.));
+  }
+  for (int q=0; q<model->l; ++q) model->SV[q] = &sv_nodes[offsets[q]];
+  model->param = param;
+
+  return make_machine(model, gram.getInputSubtraction(),
+      gram.getInputDivision());
+}
+
+bob::trainer::SVMGramMatrix::SVMGramMatrix
+(const std::vector<blitz::Array<double,2> >& data,
+ const blitz::Array<double,1>& input_subtract,
+ const blitz::Array<double,1>& input_division, const size_t n_threads):
+  m_input_sub(bob::core::array::ccopy(input_subtract)),
+  m_input_div(bob::core::array::ccopy(input_division)),
+  m_max_index(0)
+{
+  initialize(data, n_threads);
+}
+
+bob::trainer::SVMGramMatrix::SVMGramMatrix
+(const std::vector<blitz::Array<double,2> >& data, const size_t n_threads):
+  m_max_index(0)
+{
+  class_labels(data.size()); //checks the number of classes
+  m_input_sub.resize(data[0].extent(blitz::secondDim));
+  m_input_sub = 0.;
+  m_input_div.resize(data[0].extent(blitz::secondDim));
+  m_input_div = 1.;
+  initialize(data, n_threads);
+}
+
+void bob::trainer::SVMGramMatrix::initialize
+(const std::vector<blitz::Array<double,2> >& data, const size_t n_threads) {
+
+  class_labels(data.size()); //checks the number of classes
+  check_features(data);
+  const int n_features = data[0].extent(blitz::secondDim);
+  bob::core::array::assertSameDimensionLength(m_input_sub.extent(0), n_features);
+  bob::core::array::assertSameDimensionLength(m_input_div.extent(0), n_features);
+
+  //normalizes the samples of all the classes
+  int n_samples = 0;
+  for (size_t k=0; k<data.size(); ++k) {
+    m_class_sizes.push_back(data[k].extent(blitz::firstDim));
+    n_samples += data[k].extent(blitz::firstDim);
+  }
+  m_samples.resize(n_samples, n_features);
+  blitz::Range all = blitz::Range::all();
+  int sample = 0;
+  for (size_t k=0; k<data.size(); ++k) {
+    for (int i=0; i<data[k].extent(blitz::firstDim); ++i, ++sample) {
+      m_samples(sample,all) = (data[k](i,all) - m_input_sub) / m_input_div;
+      for (int p=0; p<n_features; ++p)
+        if (m_samples(sample,p) && p+1 > m_max_index) m_max_index = p+1;
+    }
+  }
+
+  //computes the inner products by blocks of rows
+  m_inner_products.resize(n_samples, n_samples);
+  const size_t n_blocks = (n_samples + SVM_GRAM_BLOCK_SIZE - 1) / SVM_GRAM_BLOCK_SIZE;
+  bob::core::thread_blocks(SVMGramBlock(m_samples.data(),
+        m_inner_products.data(), n_samples, n_features), n_blocks, n_threads);
+}
@@ -0,0 +1,357 @@
+/**
+ * @file trainer/cxx/ScatterAccumulator.cc
+ * @date Mon Oct 19 03:30:35 2026 +0000
+ * @author agent <agent@local>
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <bob/trainer/ScatterAccumulator.h>
+#include <bob/core/assert.h>
+#include <bob/core/check.h>
+#include <bob/core/array_copy.h>
+#include <bob/core/parallel.h>
+#include <bob/math/gemm.h>
+#include <boost/format.hpp>
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+  /**
+   * Number of samples of each chunk of a block
+   */
+  static const size_t SCATTER_CHUNK_SIZE = 1024;
+
+  /**
+   * Adds the statistics of a set of n samples of mean mb to the ones of a
+   * class (count, mean), and the corresponding cross term to the scatter.
+   * The scatter of the samples around their mean should be added separately.
+   */
+  void combine(const size_t F, double& count, double* mean, double* scatter,
+    const double n, const double* mb)
+  {
+    if (n == 0.) return;
+    if (count == 0.) {
+      std::copy(mb, mb + F, mean);
+      count = n;
+      return;
+    }
+    const double total = count + n;
+    const double t = count * n / total;
+    std::vector<double> d(F);
+    for (size_t j=0; j<F; ++j) d[j] = mb[j] - mean[j];
+    for (size_t i=0; i<F; ++i)
+      for (size_t j=0; j<F; ++j)
+        scatter[i*F+j] += t * d[i] * d[j];
+    for (size_t j=0; j<F; ++j) mean[j] += n / total * d[j];
+    count = total;
+  }
+
+  /**
+   * Buffers of a thread: centered samples, mean and scatter of a chunk
+   */
+  struct ScatterWorkspace {
+    std::vector<double> centered; ///< chunk size x n_features
+    std::vector<double> mean; ///< n_features
+    std::vector<double> scatter; ///< n_features x n_features
+
+    ScatterWorkspace(const size_t n_features):
+      centered(SCATTER_CHUNK_SIZE * n_features),
+      mean(n_features),
+      scatter(n_features * n_features)
+    {}
+  };
+
+  /**
+   * Computes the mean and the scatter of a chunk of samples (the latter
+   * with a matrix-matrix product). The statistics of the chunks are then
+   * combined in their order, such that they do not depend on the number of
+   * threads.
+   */
+  struct ScatterChunk {
+    const double* m_data;
+    const size_t m_n_samples;
+    const size_t m_n_features;
+    std::vector<ScatterWorkspace>& m_workspaces;
+    double& m_count;
+    double* m_mean;
+    double* m_scatter;
+
+    ScatterChunk(const double* data, const size_t n_samples,
+        const size_t n_features, std::vector<ScatterWorkspace>& workspaces,
+        double& count, double* mean, double* scatter):
+      m_data(data), m_n_samples(n_samples), m_n_features(n_features),
+      m_workspaces(workspaces), m_count(count), m_mean(mean),
+      m_scatter(scatter)
+    {}
+
+    size_t size(const size_t b) const {
+      const size_t begin = b * SCATTER_CHUNK_SIZE;
+      return std::min(m_n_samples, begin + SCATTER_CHUNK_SIZE) - begin;
+    }
+
+    void operator()(const size_t ith, const size_t b) const {
+      const size_t begin = b * SCATTER_CHUNK_SIZE;
+      const size_t n = size(b);
+      const size_t F = m_n_features;
+      ScatterWorkspace& ws = m_workspaces[ith];
+
+      // mean of the chunk
+      std::fill(ws.mean.begin(), ws.mean.end(), 0.);
+      for (size_t i=0; i<n; ++i) {
+        const double* x = m_data + (begin + i) * F;
+        for (size_t j=0; j<F; ++j) ws.mean[j] += x[j];
+      }
+      for (size_t j=0; j<F; ++j) ws.mean[j] /= n;
+
+      // scatter of the chunk around its mean
+      for (size_t i=0; i<n; ++i) {
+        const double* x = m_data + (begin + i) * F;
+        double* c = &ws.centered[i * F];
+        for (size_t j=0; j<F; ++j) c[j] = x[j] - ws.mean[j];
+      }
+      const blitz::Array<double,2> C(&ws.centered[0], blitz::shape(n, F),
+        blitz::neverDeleteData);
+      blitz::Array<double,2> S(&ws.scatter[0], blitz::shape(F, F),
+        blitz::neverDeleteData);
+      bob::math::gemm_(C, C, S, true, false);
+    }
+
+    void reduce(const size_t ith, const size_t b) const {
+      const size_t F = m_n_features;
+      const ScatterWorkspace& ws = m_workspaces[ith];
+      for (size_t k=0; k<F*F; ++k) m_scatter[k] += ws.scatter[k];
+      combine(F, m_count, m_mean, m_scatter, size(b), &ws.mean[0]);
+    }
+  };
+
+}
+
+bob::trainer::ScatterAccumulator::ScatterAccumulator(const size_t n_features):
+  m_n_features(n_features),
+  m_counts(0),
+  m_means(0, (int)n_features),
+  m_scatter((int)n_features, (int)n_features),
+  m_n_threads(0)
+{
+  m_scatter = 0.;
+}
+
+bob::trainer::ScatterAccumulator::ScatterAccumulator(bob::io::HDF5File& config):
+  m_n_features(0),
+  m_n_threads(0)
+{
+  load(config);
+}
+
+bob::trainer::ScatterAccumulator::ScatterAccumulator(
+    const bob::trainer::ScatterAccumulator& other):
+  m_n_features(other.m_n_features),
+  m_counts(bob::core::array::ccopy(other.m_counts)),
+  m_means(bob::core::array::ccopy(other.m_means)),
+  m_scatter(bob::core::array::ccopy(other.m_scatter)),
+  m_n_threads(other.m_n_threads)
+{
+}
+
+bob::trainer::ScatterAccumulator::~ScatterAccumulator()
+{
+}
+
+bob::trainer::ScatterAccumulator& bob::trainer::ScatterAccumulator::operator=
+  (const bob::trainer::ScatterAccumulator& other)
+{
+  if (this != &other)
+  {
+    m_n_features = other.m_n_features;
+    m_counts.reference(bob::core::array::ccopy(other.m_counts));
+    m_means.reference(bob::core::array::ccopy(other.m_means));
+    m_scatter.reference(bob::core::array::ccopy(other.m_scatter));
+    m_n_threads = other.m_n_threads;
+  }
+  return *this;
+}
+
+bool bob::trainer::ScatterAccumulator::operator==
+  (const bob::trainer::ScatterAccumulator& other) const
+{
+  return m_n_features == other.m_n_features &&
+         bob::core::array::isEqual(m_counts, other.m_counts) &&
+         bob::core::array::isEqual(m_means, other.m_means) &&
+         bob::core::array::isEqual(m_scatter, other.m_scatter);
+}
+
+bool bob::trainer::ScatterAccumulator::operator!=
+  (const bob::trainer::ScatterAccumulator& other) const
+{
+  return !(this->operator==(other));
+}
+
+bool bob::trainer::ScatterAccumulator::is_similar_to
+  (const bob::trainer::ScatterAccumulator& other, const double r_epsilon,
+   const double a_epsilon) const
+{
+  return m_n_features == other.m_n_features &&
+         bob::core::array::isClose(m_counts, other.m_counts, r_epsilon, a_epsilon) &&
+         bob::core::array::isClose(m_means, other.m_means, r_epsilon, a_epsilon) &&
+         bob::core::array::isClose(m_scatter, other.m_scatter, r_epsilon, a_epsilon);
+}
+
+void bob::trainer::ScatterAccumulator::reset(const size_t n_features)
+{
+  m_n_features = n_features;
+  m_counts.resize(0);
+  m_means.resize(0, (int)n_features);
+  m_scatter.resize((int)n_features, (int)n_features);
+  m_scatter = 0.;
+}
+
+void bob::trainer::ScatterAccumulator::addClass(const size_t class_id)
+{
+  const int n_classes = m_counts.extent(0);
+  if ((int)class_id < n_classes) return;
+  m_counts.resizeAndPreserve(class_id + 1);
+  m_means.resizeAndPreserve(class_id + 1, (int)m_n_features);
+  blitz::Range added(n_classes, class_id);
+  m_counts(added) = 0.;
+  m_means(added, blitz::Range::all()) = 0.;
+}
+
+size_t bob::trainer::ScatterAccumulator::getNClasses() const
+{
+  return blitz::count(m_counts > 0.);
+}
+
+void bob::trainer::ScatterAccumulator::accumulate(const size_t class_id,
+  const blitz::Array<double,2>& block)
+{
+  if ((size_t)block.extent(1) != m_n_features) {
+    boost::format m("ScatterAccumulator: the samples have %d features, whereas %u were expected");
+    m % block.extent(1) % m_n_features;
+    throw std::runtime_error(m.str());
+  }
+  const size_t n_samples = block.extent(0);
+  const size_t n_chunks = (n_samples + SCATTER_CHUNK_SIZE - 1) / SCATTER_CHUNK_SIZE;
+  if (n_chunks == 0) return;
+
+  // raw data is accessed by the threads
+  blitz::Array<double,2> block_copy;
+  const blitz::Array<double,2>* x = &block;
+  if (!bob::core::array::isCZeroBaseContiguous(block)) {
+    block_copy.reference(bob::core::array::ccopy(block));
+    x = &block_copy;
+  }
+
+  // the statistics of the block are accumulated separately, such that the
+  // ones of the class are left unchanged if a thread fails
+  const size_t F = m_n_features;
+  double count = 0.;
+  std::vector<double> mean(F, 0.);
+  std::vector<double> scatter(F * F, 0.);
+
+  // each thread has its own buffers
+  const size_t n_threads = bob::core::thread_count(n_chunks, m_n_threads);
+  std::vector<ScatterWorkspace> workspaces(n_threads, ScatterWorkspace(F));
+  bob::core::thread_reduce_blocks(ScatterChunk(x->data(), n_samples, F,
+    workspaces, count, &mean[0], &scatter[0]), n_chunks, n_threads);
+
+  addClass(class_id);
+  const blitz::Array<double,2> S(&scatter[0], blitz::shape(F, F),
+    blitz::neverDeleteData);
+  m_scatter += S;
+  combine(F, m_counts((int)class_id), &m_means((int)class_id, 0),
+    m_scatter.data(), count, &mean[0]);
+}
+
+void bob::trainer::ScatterAccumulator::accumulate(const size_t class_id,
+  bob::trainer::HDF5Sampler& sampler)
+{
+  blitz::Array<double,2> block;
+  sampler.reset();
+  while (sampler.next(block))
+    accumulate(class_id, block);
+}
+
+void bob::trainer::ScatterAccumulator::merge(
+  const bob::trainer::ScatterAccumulator& other)
+{
+  if (other.m_n_features != m_n_features) {
+    boost::format m("ScatterAccumulator: cannot merge statistics of samples with %u features into an accumulator for %u features");
+    m % other.m_n_features % m_n_features;
+    throw std::runtime_error(m.str());
+  }
+  if (other.m_counts.extent(0) > 0) addClass(other.m_counts.extent(0) - 1);
+  m_scatter += other.m_scatter;
+  // the other accumulator is copied, should it be this one
+  const blitz::Array<double,1> counts = bob::core::array::ccopy(other.m_counts);
+  const blitz::Array<double,2> means = bob::core::array::ccopy(other.m_means);
+  for (int k=0; k<counts.extent(0); ++k)
+    combine(m_n_features, m_counts(k), &m_means(k,0), m_scatter.data(),
+      counts(k), &means(k,0));
+}
+
+void bob::trainer::ScatterAccumulator::scatters(blitz::Array<double,2>& Sw,
+  blitz::Array<double,2>& Sb, blitz::Array<double,1>& m) const
+{
+  bob::core::array::assertSameDimensionLength(m.extent(0), m_n_features);
+  bob::core::array::assertSameDimensionLength(Sw.extent(0), m_n_features);
+  bob::core::array::assertSameDimensionLength(Sw.extent(1), m_n_features);
+  bob::core::array::assertSameDimensionLength(Sb.extent(0), m_n_features);
+  bob::core::array::assertSameDimensionLength(Sb.extent(1), m_n_features);
+
+  blitz::firstIndex i;
+  blitz::secondIndex j;
+  blitz::Range a = blitz::Range::all();
+
+  // overall mean
+  m = 0.;
+  for (int k=0; k<m_counts.extent(0); ++k)
+    m += m_counts(k) * m_means(k,a);
+  m /= getNSamples();
+
+  // between class scatter Sb
+  Sb = 0.;
+  blitz::Array<double,1> buffer(m_n_features);
+  for (int k=0; k<m_counts.extent(0); ++k) {
+    if (m_counts(k) == 0.) continue;
+    buffer = m - m_means(k,a);
+    Sb += m_counts(k) * buffer(i) * buffer(j);
+  }
+
+  // within class scatter Sw
+  Sw = m_scatter;
+}
+
+void bob::trainer::ScatterAccumulator::load(bob::io::HDF5File& config)
+{
+  m_n_features = config.read<uint64_t>("n_features");
+  if (config.contains("counts")) {
+    m_counts.reference(config.readArray<double,1>("counts"));
+    m_means.reference(config.readArray<double,2>("means"));
+  }
+  else {
+    m_counts.resize(0);
+    m_means.resize(0, (int)m_n_features);
+  }
+  m_scatter.reference(config.readArray<double,2>("scatter"));
+  if (m_means.extent(0) != m_counts.extent(0) ||
+      (size_t)m_means.extent(1) != m_n_features ||
+      (size_t)m_scatter.extent(0) != m_n_features ||
+      (size_t)m_scatter.extent(1) != m_n_features) {
+    boost::format m("ScatterAccumulator: the statistics loaded from file '%s' have inconsistent dimensions");
+    m % config.filename();
+    throw std::runtime_error(m.str());
+  }
+}
+
+void bob::trainer::ScatterAccumulator::save(bob::io::HDF5File& config) const
+{
+  config.set("n_features", (uint64_t)m_n_features);
+  // empty arrays are not saved
+  if (m_counts.extent(0) > 0) {
+    config.setArray("counts", m_counts);
+    config.setArray("means", m_means);
+  }
+  config.setArray("scatter", m_scatter);
+}
@@ -72,6 +72,41 @@ void bob::trainer::WCCNTrainer::train(bob::machine::LinearMachine& machine,
     }
   }
 
+  // 1. Computes the mean vector and the Scatter matrix Sw and Sb
+  blitz::Array<double,1> mean(n_features);
+  blitz::Array<double,2> buf1(n_features, n_features); // Sw
+  blitz::Array<double,2> buf2(n_features, n_features); // Sb
+  bob::math::scatters(data, buf1, buf2, mean); // buf1 = Sw; buf2 = Sb
+
+  trainFromScatter(machine, buf1, n_classes);
+}
+
+void bob::trainer::WCCNTrainer::train(bob::machine::LinearMachine& machine,
+    const bob::trainer::ScatterAccumulator& accumulator)
+{
+  const size_t n_classes = accumulator.getNClasses();
+  // if #classes < 2, then throw
+  if (n_classes < 2) {
+    boost::format m("number of classes should be >= 2, but the accumulated statistics have %u classes with samples");
+    m % n_classes;
+    throw std::runtime_error(m.str());
+  }
+
+  // 1. Computes the mean vector and the Scatter matrix Sw and Sb
+  const int n_features = accumulator.getNFeatures();
+  blitz::Array<double,1> mean(n_features);
+  blitz::Array<double,2> buf1(n_features, n_features); // Sw
+  blitz::Array<double,2> buf2(n_features, n_features); // Sb
+  accumulator.scatters(buf1, buf2, mean); // buf1 = Sw; buf2 = Sb
+
+  trainFromScatter(machine, buf1, n_classes);
+}
+
+void bob::trainer::WCCNTrainer::trainFromScatter(
+    bob::machine::LinearMachine& machine, blitz::Array<double,2>& buf1,
+    const size_t n_classes) const
+{
+  const int n_features = buf1.extent(0);
   // machine dimensions
   const size_t n_inputs = machine.inputSize();
   const size_t n_outputs = machine.outputSize();
@@ -88,11 +123,7 @@ void bob::trainer::WCCNTrainer::train(bob::machine::LinearMachine& machine,
     throw std::runtime_error(m.str());
   }
 
-  // 1. Computes the mean vector and the Scatter matrix Sw and Sb
-  blitz::Array<double,1> mean(n_features);
-  blitz::Array<double,2> buf1(n_features, n_features); // Sw
-  blitz::Array<double,2> buf2(n_features, n_features); // Sb
-  bob::math::scatters(data, buf1, buf2, mean); // buf1 = Sw; buf2 = Sb
+  blitz::Array<double,2> buf2(n_features, n_features);
 
   // 2. Computes the inverse of (1/N * Sw), Sw is the within-class covariance matrix
   buf1 /= n_classes;
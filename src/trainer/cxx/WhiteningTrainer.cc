@@ -54,6 +54,45 @@ void bob::trainer::WhiteningTrainer::train(bob::machine::LinearMachine& machine,
   // training data dimensions
   const size_t n_samples = ar.extent(0);
   const size_t n_features = ar.extent(1);
+
+  // 1. Computes the mean vector and the covariance matrix of the training set
+  blitz::Array<double,1> mean(n_features);
+  blitz::Array<double,2> cov(n_features,n_features);
+  bob::math::scatter(ar, cov, mean);
+  cov /= (double)(n_samples-1);
+
+  trainFromCovariance(machine, mean, cov);
+}
+
+void bob::trainer::WhiteningTrainer::train(bob::machine::LinearMachine& machine, 
+  const bob::trainer::ScatterAccumulator& accumulator)
+{
+  const double n_samples = accumulator.getNSamples();
+  // if #samples < 2, then throw
+  if (n_samples < 2.) {
+    boost::format m("number of samples should be >= 2, but the accumulated statistics have %g samples");
+    m % n_samples;
+    throw std::runtime_error(m.str());
+  }
+
+  // 1. Computes the mean vector and the covariance matrix of all the
+  // accumulated samples (total scatter Sw + Sb)
+  const size_t n_features = accumulator.getNFeatures();
+  blitz::Array<double,1> mean(n_features);
+  blitz::Array<double,2> cov(n_features,n_features);
+  blitz::Array<double,2> Sb(n_features,n_features);
+  accumulator.scatters(cov, Sb, mean);
+  cov += Sb;
+  cov /= n_samples - 1.;
+
+  trainFromCovariance(machine, mean, cov);
+}
+
+void bob::trainer::WhiteningTrainer::trainFromCovariance(
+  bob::machine::LinearMachine& machine, const blitz::Array<double,1>& mean,
+  const blitz::Array<double,2>& cov) const
+{
+  const size_t n_features = mean.extent(0);
   // machine dimensions
   const size_t n_inputs = machine.inputSize();
   const size_t n_outputs = machine.outputSize();
@@ -70,12 +109,6 @@ void bob::trainer::WhiteningTrainer::train(bob::machine::LinearMachine& machine,
     throw std::runtime_error(m.str());
   }
 
-  // 1. Computes the mean vector and the covariance matrix of the training set
-  blitz::Array<double,1> mean(n_features);
-  blitz::Array<double,2> cov(n_features,n_features);
-  bob::math::scatter(ar, cov, mean);
-  cov /= (double)(n_samples-1);
-
   // 2. Computes the inverse of the covariance matrix
   blitz::Array<double,2> icov(n_features,n_features);
   bob::math::inv(cov, icov);
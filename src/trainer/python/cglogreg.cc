@@ -9,6 +9,7 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <bob/trainer/CGLogRegTrainer.h>
 
 using namespace boost::python;
@@ -17,29 +18,50 @@ object train1(const bob::trainer::CGLogRegTrainer& t,
   bob::python::const_ndarray data1, bob::python::const_ndarray data2)
 {
   bob::machine::LinearMachine m;
-  t.train(m, data1.bz<double,2>(), data2.bz<double,2>());
+  const blitz::Array<double,2> negatives = data1.bz<double,2>();
+  const blitz::Array<double,2> positives = data2.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    t.train(m, negatives, positives);
+  }
   return object(m);
 }
 
 void train2(const bob::trainer::CGLogRegTrainer& t, bob::machine::LinearMachine& m,
   bob::python::const_ndarray data1, bob::python::const_ndarray data2)
 {
-  t.train(m, data1.bz<double,2>(), data2.bz<double,2>());
+  const blitz::Array<double,2> negatives = data1.bz<double,2>();
+  const blitz::Array<double,2> positives = data2.bz<double,2>();
+  bob::python::no_gil unlock;
+  t.train(m, negatives, positives);
 }
 
 void bind_trainer_cglogreg()
 {
-  class_<bob::trainer::CGLogRegTrainer, boost::shared_ptr<bob::trainer::CGLogRegTrainer> >("CGLogRegTrainer", "Trains a linear machine to perform Linear Logistic Regression. References:\n1. A comparison of numerical optimizers for logistic regression, T. Minka, http://research.microsoft.com/en-us/um/people/minka/papers/logreg/\n2. FoCal, http://www.dsp.sun.ac.za/~nbrummer/focal/.",
-        init<optional<const double, const double, const size_t, const double, bool> >((arg("self"), arg("prior")=0.5, arg("convergence_threshold")=1e-5, arg("max_iterations")=10000, arg("lambda")=0., arg("mean_std_norm")=false), "Initializes a new Linear Logistic Regression trainer. The training stage will place the resulting weights (and bias) in a linear machine with a single output dimension. If mean_std_norm is enabled, data will be mean/std-dev normalized and the according values are set to the resulting machine as well."))
-    .def(init<bob::trainer::CGLogRegTrainer&>((arg("self"), arg("other"))))
+  class_<bob::trainer::CGLogRegTrainer, boost::shared_ptr<bob::trainer::CGLogRegTrainer> > CGLRT("CGLogRegTrainer", "Trains a linear machine to perform Linear Logistic Regression. References:\n1. A comparison of numerical optimizers for logistic regression, T. Minka, http://research.microsoft.com/en-us/um/people/minka/papers/logreg/\n2. FoCal, http://www.dsp.sun.ac.za/~nbrummer/focal/.",
+        init<optional<const double, const double, const size_t, const double, bool> >((arg("self"), arg("prior")=0.5, arg("convergence_threshold")=1e-5, arg("max_iterations")=10000, arg("lambda")=0., arg("mean_std_norm")=false), "Initializes a new Linear Logistic Regression trainer. The training stage will place the resulting weights (and bias) in a linear machine with a single output dimension. If mean_std_norm is enabled, data will be mean/std-dev normalized and the according values are set to the resulting machine as well."));
+
+  CGLRT.def(init<bob::trainer::CGLogRegTrainer&>((arg("self"), arg("other"))))
     .def(self == self)
     .def(self != self)
     .add_property("prior", &bob::trainer::CGLogRegTrainer::getPrior, &bob::trainer::CGLogRegTrainer::setPrior, "The synthetic prior (should be in range ]0.,1.[.")
     .add_property("convergence_threshold", &bob::trainer::CGLogRegTrainer::getConvergenceThreshold, &bob::trainer::CGLogRegTrainer::setConvergenceThreshold, "The convergence threshold for the conjugate gradient algorithm")
     .add_property("max_iterations", &bob::trainer::CGLogRegTrainer::getMaxIterations, &bob::trainer::CGLogRegTrainer::setMaxIterations, "The maximum number of iterations for the conjugate gradient algorithm")
     .add_property("lambda", &bob::trainer::CGLogRegTrainer::getLambda, &bob::trainer::CGLogRegTrainer::setLambda, "The regularization factor lambda")
+    .add_property("solver", &bob::trainer::CGLogRegTrainer::getSolver, &bob::trainer::CGLogRegTrainer::setSolver, "The optimization algorithm: CONJUGATE_GRADIENT (default) or LBFGS. With LBFGS, the convergence threshold is the one of the norm of the gradient (divided by the number of samples) relative to the norm of the weights, and the maximum number of iterations 0 means no limit.")
+    .add_property("n_threads", &bob::trainer::CGLogRegTrainer::getNThreads, &bob::trainer::CGLogRegTrainer::setNThreads, "The number of threads used to compute the gradient and the curvature (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
     .add_property("mean_std_norm", &bob::trainer::CGLogRegTrainer::getNorm, &bob::trainer::CGLogRegTrainer::setNorm, "Perform mean and standard-deviation normalization (whitening) of the input data before training the LinearMachine; recommended for large data sets with different distributions between dimensions.")
     .def("train", &train1, (arg("self"), arg("negatives"), arg("positives")), "Trains a LinearMachine to perform the Linear Logistic Regression, using two arraysets for training, one for each of the two classes (negatives vs. positives). The trained LinearMachine is returned.")
     .def("train", &train2, (arg("self"), arg("machine"), arg("negatives"), arg("positives")), "Trains a LinearMachine to perform the Linear Logistic Regression, using two arraysets for training, one for each of the two classes (negatives vs. positives).")
     ;
+
+  // Sets the scope to the one of the CGLogRegTrainer
+  scope s(CGLRT);
+
+  // Adds enum in the previously defined current scope
+  enum_<bob::trainer::CGLogRegTrainer::Solver>("solver_type")
+    .value("CONJUGATE_GRADIENT", bob::trainer::CGLogRegTrainer::CONJUGATE_GRADIENT)
+    .value("LBFGS", bob::trainer::CGLogRegTrainer::LBFGS)
+    .export_values()
+    ;
 }
@@ -0,0 +1,39 @@
+/**
+ * @file trainer/python/em.cc
+ * @date Mon Oct 19 02:56:14 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Python bindings for the telemetry of the EM trainers
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <boost/python.hpp>
+#include <bob/trainer/EMTrainer.h>
+
+using namespace boost::python;
+
+/**
+ * Converts the telemetry of an EM trainer into a list of EMIteration's
+ */
+struct em_telemetry_to_list {
+  static PyObject* convert(const std::vector<bob::trainer::EMIteration>& t) {
+    list l;
+    for (size_t i=0; i<t.size(); ++i) l.append(t[i]);
+    return incref(l.ptr());
+  }
+};
+
+void bind_trainer_em()
+{
+  class_<bob::trainer::EMIteration>("EMIteration", "Telemetry of an iteration of an EM algorithm. Iteration 0 corresponds to the E-step which follows the initialization (without M-step). The times are wall times in seconds.", no_init)
+    .def_readonly("iteration", &bob::trainer::EMIteration::iteration, "Index of the iteration")
+    .def_readonly("e_step_time", &bob::trainer::EMIteration::e_step_time, "Wall time of the E-step")
+    .def_readonly("m_step_time", &bob::trainer::EMIteration::m_step_time, "Wall time of the M-step")
+    .def_readonly("likelihood_time", &bob::trainer::EMIteration::likelihood_time, "Wall time of the computation of the likelihood")
+    .def_readonly("average_output", &bob::trainer::EMIteration::average_output, "Average output (likelihood) after this iteration (NaN if not computed)")
+    .def_readonly("delta", &bob::trainer::EMIteration::delta, "Relative change of the average output, used to check the convergence (NaN if not available)")
+  ;
+
+  to_python_converter<std::vector<bob::trainer::EMIteration>, em_telemetry_to_list>();
+}
@@ -0,0 +1,56 @@
+/**
+ * @file trainer/python/em.h
+ * @date Mon Oct 19 02:56:14 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Python bindings shared by the base classes of the EM trainers
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#ifndef BOB_TRAINER_PYTHON_EM_H
+#define BOB_TRAINER_PYTHON_EM_H
+
+#include <boost/python.hpp>
+#include <boost/python/def_visitor.hpp>
+#include <bob/trainer/EMTrainer.h>
+
+/**
+ * Binds the checkpoints and the telemetry of an EMTrainer to its python
+ * class, given the function which resumes the training from the data:
+ *
+ *   class_<EMTrainerBase, boost::noncopyable>("EMTrainer...", ..., no_init)
+ *     .def(bind_em_checkpoint(&py_resume))
+ */
+template <typename T_resume>
+class em_checkpoint_visitor:
+  public boost::python::def_visitor<em_checkpoint_visitor<T_resume> >
+{
+  friend class boost::python::def_visitor_access;
+
+  public:
+    em_checkpoint_visitor(T_resume resume): m_resume(resume) {}
+
+  private:
+    template <typename T_class> void visit(T_class& c) const {
+      using namespace boost::python;
+      typedef typename T_class::wrapped_type T_trainer;
+      c
+        .def("set_checkpoint", &T_trainer::setCheckpoint, (arg("self"), arg("filename"), arg("period")), "Saves a checkpoint (machine, accumulators, state of the random generator and telemetry) to the given HDF5 file every period iterations, from which the training could be resumed with resume(). A period of 0 disables the checkpoints.")
+        .add_property("checkpoint_filename", make_function(&T_trainer::getCheckpointFilename, return_value_policy<copy_const_reference>()), "The HDF5 file to which the checkpoints are saved")
+        .add_property("checkpoint_period", &T_trainer::getCheckpointPeriod, "The number of iterations between two checkpoints (0 if disabled)")
+        .add_property("telemetry", make_function(&T_trainer::getTelemetry, return_value_policy<copy_const_reference>()), "The list of EMIteration's of the last training (wall times, average output and convergence delta of each iteration)")
+        .def("resume", m_resume, (arg("self"), arg("machine"), arg("data"), arg("filename")), "Resumes the training of a machine from a checkpoint file, with the same data (and trainer configuration) as the interrupted training")
+      ;
+    }
+
+    T_resume m_resume;
+};
+
+template <typename T_resume>
+em_checkpoint_visitor<T_resume> bind_em_checkpoint(T_resume resume)
+{
+  return em_checkpoint_visitor<T_resume>(resume);
+}
+
+#endif /* BOB_TRAINER_PYTHON_EM_H */
@@ -7,9 +7,12 @@
  */
 #include <boost/python.hpp>
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <boost/shared_ptr.hpp>
 #include <bob/trainer/EMPCATrainer.h>
+#include <bob/trainer/HDF5Sampler.h>
 #include <bob/machine/LinearMachine.h>
+#include "em.h"
 
 using namespace boost::python;
 
@@ -18,31 +21,78 @@ typedef bob::trainer::EMTrainer<bob::machine::LinearMachine, blitz::Array<double
 static void py_train(EMTrainerLinearBase& trainer, 
   bob::machine::LinearMachine& machine, bob::python::const_ndarray data)
 {
-  trainer.train(machine, data.bz<double,2>());
+  const blitz::Array<double,2> data_ = data.bz<double,2>();
+  bob::python::no_gil unlock;
+  trainer.train(machine, data_);
+}
+
+static void py_resume(EMTrainerLinearBase& trainer,
+  bob::machine::LinearMachine& machine, bob::python::const_ndarray data, const std::string& filename)
+{
+  const blitz::Array<double,2> data_ = data.bz<double,2>();
+  bob::python::no_gil unlock;
+  trainer.resume(machine, data_, filename);
 }
 
 static void py_initialize(EMTrainerLinearBase& trainer, 
   bob::machine::LinearMachine& machine, bob::python::const_ndarray data)
 {
-  trainer.initialize(machine, data.bz<double,2>());
+  const blitz::Array<double,2> data_ = data.bz<double,2>();
+  bob::python::no_gil unlock;
+  trainer.initialize(machine, data_);
 }
 
 static void py_finalize(EMTrainerLinearBase& trainer, 
   bob::machine::LinearMachine& machine, bob::python::const_ndarray data)
 {
-  trainer.finalize(machine, data.bz<double,2>());
+  const blitz::Array<double,2> data_ = data.bz<double,2>();
+  bob::python::no_gil unlock;
+  trainer.finalize(machine, data_);
 }
 
 static void py_eStep(EMTrainerLinearBase& trainer, 
   bob::machine::LinearMachine& machine, bob::python::const_ndarray data)
 {
-  trainer.eStep(machine, data.bz<double,2>());
+  const blitz::Array<double,2> data_ = data.bz<double,2>();
+  bob::python::no_gil unlock;
+  trainer.eStep(machine, data_);
+}
+
+static void py_train_sampler(bob::trainer::EMPCATrainer& trainer,
+  bob::machine::LinearMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  bob::python::no_gil unlock;
+  trainer.train(machine, sampler);
+}
+
+static void py_resume_sampler(bob::trainer::EMPCATrainer& trainer,
+  bob::machine::LinearMachine& machine, bob::trainer::HDF5Sampler& sampler,
+  const std::string& filename)
+{
+  bob::python::no_gil unlock;
+  trainer.resume(machine, sampler, filename);
+}
+
+static void py_initialize_sampler(bob::trainer::EMPCATrainer& trainer,
+  bob::machine::LinearMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  bob::python::no_gil unlock;
+  trainer.initialize(machine, sampler);
+}
+
+static void py_eStep_sampler(bob::trainer::EMPCATrainer& trainer,
+  bob::machine::LinearMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  bob::python::no_gil unlock;
+  trainer.eStep(machine, sampler);
 }
 
 static void py_mStep(EMTrainerLinearBase& trainer, 
   bob::machine::LinearMachine& machine, bob::python::const_ndarray data)
 {
-  trainer.mStep(machine, data.bz<double,2>());
+  const blitz::Array<double,2> data_ = data.bz<double,2>();
+  bob::python::no_gil unlock;
+  trainer.mStep(machine, data_);
 }
 
 void bind_trainer_empca() 
@@ -60,6 +110,7 @@ void bind_trainer_empca()
        "Updates the hidden variable distribution (or the sufficient statistics) given the Machine parameters. ")
     .def("m_step", &py_mStep, (arg("self"), arg("machine"), arg("data")), "Updates the Machine parameters given the hidden variable distribution (or the sufficient statistics)")
     .def("compute_likelihood", &EMTrainerLinearBase::computeLikelihood, (arg("self"), arg("machine")), "Computes the current log likelihood given the hidden variable distribution (or the sufficient statistics)")
+    .def(bind_em_checkpoint(&py_resume))
   ;
 
   class_<bob::trainer::EMPCATrainer, boost::noncopyable, bases<EMTrainerLinearBase> >("EMPCATrainer",
@@ -70,5 +121,14 @@ void bind_trainer_empca()
     .def(self != self)
     .def("is_similar_to", &bob::trainer::EMPCATrainer::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this EMPCATrainer with the 'other' one to be approximately the same.")
     .add_property("sigma2", &bob::trainer::EMPCATrainer::getSigma2, &bob::trainer::EMPCATrainer::setSigma2, "The noise sigma2 of the probabilistic model")
+    .add_property("n_threads", &bob::trainer::EMPCATrainer::getNThreads, &bob::trainer::EMPCATrainer::setNThreads, "The number of threads used by the E-step (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
+    .def("train", &py_train, (arg("self"), arg("machine"), arg("data")), "Trains a machine using data")
+    .def("train", &py_train_sampler, (arg("self"), arg("machine"), arg("sampler")), "Trains a machine by streaming the data of the given HDF5Sampler at each E-step. If the block size of the sampler is a multiple of 1024, the machine is the same as the one trained with all the data at once.")
+    .def("resume", &py_resume, (arg("self"), arg("machine"), arg("data"), arg("filename")), "Resumes the training of a machine from a checkpoint file, with the same data (and trainer configuration) as the interrupted training")
+    .def("resume", &py_resume_sampler, (arg("self"), arg("machine"), arg("sampler"), arg("filename")), "Resumes the training of a machine from a checkpoint file, by streaming the data of the given HDF5Sampler at each E-step")
+    .def("initialize", &py_initialize, (arg("self"), arg("machine"), arg("data")), "This method is called before the EM algorithm")
+    .def("initialize", &py_initialize_sampler, (arg("self"), arg("machine"), arg("sampler")), "Initializes the trainer by streaming the data of the given HDF5Sampler to compute its mean (and covariance)")
+    .def("e_step", &py_eStep, (arg("self"), arg("machine"), arg("data")), "Updates the sufficient statistics given the Machine parameters")
+    .def("e_step", &py_eStep_sampler, (arg("self"), arg("machine"), arg("sampler")), "Updates the sufficient statistics given the Machine parameters, by streaming the data of the given HDF5Sampler")
   ;
 }
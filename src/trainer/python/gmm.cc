@@ -7,9 +7,11 @@
  */
 #include <boost/python.hpp>
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <bob/trainer/GMMTrainer.h>
 #include <bob/trainer/MAP_GMMTrainer.h>
 #include <bob/trainer/ML_GMMTrainer.h>
+#include "em.h"
 #include <limits>
 
 using namespace boost::python;
@@ -21,6 +23,24 @@ static void py_train(EMTrainerGMMBase& trainer, bob::machine::GMMMachine& machin
   trainer.train(machine, sample.bz<double,2>());
 }
 
+static void py_train_sampler(bob::trainer::GMMTrainer& trainer,
+  bob::machine::GMMMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  trainer.train(machine, sampler);
+}
+
+static void py_eStep_sampler(bob::trainer::GMMTrainer& trainer,
+  bob::machine::GMMMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  trainer.eStep(machine, sampler);
+}
+
+static void py_resume(EMTrainerGMMBase& trainer,
+  bob::machine::GMMMachine& machine, bob::python::const_ndarray sample, const std::string& filename)
+{
+  trainer.resume(machine, sample.bz<double,2>(), filename);
+}
+
 static void py_initialize(EMTrainerGMMBase& trainer, bob::machine::GMMMachine& machine, bob::python::const_ndarray sample)
 {
   trainer.initialize(machine, sample.bz<double,2>());
@@ -41,6 +61,37 @@ static void py_mStep(EMTrainerGMMBase& trainer, bob::machine::GMMMachine& machin
   trainer.mStep(machine, sample.bz<double,2>());
 }
 
+static object py_map_enrol(const bob::trainer::MAP_GMMTrainer& trainer,
+  object data, const size_t n_threads)
+{
+  boost::shared_ptr<bob::machine::GMMMachine> prior = trainer.getPriorGMM();
+  if (!prior)
+    throw std::runtime_error("MAP_GMMTrainer: Prior GMM distribution has not been set");
+  const size_t n_clients = len(data);
+  bob::python::ndarray supervectors(bob::core::array::t_float64, n_clients,
+    prior->getNGaussians() * prior->getNInputs());
+  blitz::Array<double,2> supervectors_ = supervectors.bz<double,2>();
+
+  // the clients are either given by their statistics or by their features
+  if (n_clients > 0 && extract<boost::shared_ptr<bob::machine::GMMStats> >(data[0]).check()) {
+    stl_input_iterator<boost::shared_ptr<bob::machine::GMMStats> > dbegin(data), dend;
+    std::vector<boost::shared_ptr<bob::machine::GMMStats> > vdata(dbegin, dend);
+    bob::python::no_gil unlock;
+    trainer.enrol(vdata, supervectors_, n_threads);
+  }
+  else {
+    stl_input_iterator<bob::python::const_ndarray> dbegin(data), dend;
+    std::vector<bob::python::const_ndarray> vdata(dbegin, dend);
+    std::vector<blitz::Array<double,2> > vdata_ref;
+    for(std::vector<bob::python::const_ndarray>::iterator it=vdata.begin();
+        it!=vdata.end(); ++it)
+      vdata_ref.push_back(it->bz<double,2>());
+    bob::python::no_gil unlock;
+    trainer.enrol(vdata_ref, supervectors_, n_threads);
+  }
+  return supervectors.self();
+}
+
 void bind_trainer_gmm() {
 
   class_<EMTrainerGMMBase, boost::noncopyable>("EMTrainerGMM", "The base python class for all EM-based trainers.", no_init)
@@ -57,12 +108,18 @@ void bind_trainer_gmm() {
        "is less than the convergence_threshold.")
     .def("m_step", &py_mStep, (arg("self"), arg("machine"), arg("data")), "Update the Machine parameters given the hidden variable distribution (or the sufficient statistics)")
     .def("compute_likelihood", &EMTrainerGMMBase::computeLikelihood, (arg("self"), arg("machine")), "Returns the likelihood.")
+    .def(bind_em_checkpoint(&py_resume))
   ;
 
   class_<bob::trainer::GMMTrainer, boost::noncopyable, bases<EMTrainerGMMBase> >("GMMTrainer",
       "This class implements the E-step of the expectation-maximisation algorithm for a GMM Machine.\n"
       "See Section 9.2.2 of Bishop, \"Pattern recognition and machine learning\", 2006", no_init)
     .add_property("gmm_statistics", make_function(&bob::trainer::GMMTrainer::getGMMStats, return_value_policy<copy_const_reference>()), &bob::trainer::GMMTrainer::setGMMStats, "The internal GMM statistics. Useful to parallelize the E-step.")
+    .add_property("n_threads", &bob::trainer::GMMTrainer::getNThreads, &bob::trainer::GMMTrainer::setNThreads, "The number of threads used by the E-step (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
+    .def("train", &py_train, (arg("self"), arg("machine"), arg("data")), "Train a machine using data")
+    .def("train", &py_train_sampler, (arg("self"), arg("machine"), arg("sampler")), "Train a machine by streaming the data of the given HDF5Sampler at each E-step. The block size of the sampler should be a multiple of 1024, in which case the machine is the same as the one trained with all the data at once.")
+    .def("e_step", &py_eStep, (arg("self"), arg("machine"), arg("data")), "Update the sufficient statistics given the Machine parameters")
+    .def("e_step", &py_eStep_sampler, (arg("self"), arg("machine"), arg("sampler")), "Update the sufficient statistics given the Machine parameters, by streaming the data of the given HDF5Sampler")
   ;
 
   class_<bob::trainer::MAP_GMMTrainer, boost::noncopyable, bases<bob::trainer::GMMTrainer> >("MAP_GMMTrainer",
@@ -80,6 +137,13 @@ void bind_trainer_gmm() {
       "Use a torch3-like MAP adaptation rule instead of Reynolds'one.")
     .def("unset_t3_map", &bob::trainer::MAP_GMMTrainer::unsetT3MAP, (arg("self")),
       "Use a Reynolds' MAP adaptation (rather than torch3-like).")
+    .def("enrol", &py_map_enrol, (arg("self"), arg("data"), arg("n_threads")=0),
+      "Enrols several client models at once, by adapting the means of the prior GMM "
+      "to the data of each client, given as a list of GMMStats or as a list of 2D arrays "
+      "of features (one feature per row). This is equivalent to train() with a single "
+      "iteration, updating the means only. The clients are processed by n_threads threads "
+      "(0: number of hardware threads). Returns a 2D array with the adapted mean "
+      "supervector of each client as a row, e.g. for linear scoring.")
   ;
  
   class_<bob::trainer::ML_GMMTrainer, boost::noncopyable, bases<bob::trainer::GMMTrainer> >("ML_GMMTrainer",
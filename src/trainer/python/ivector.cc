@@ -12,6 +12,7 @@
 #include <bob/trainer/IVectorTrainer.h>
 #include <bob/machine/IVectorMachine.h>
 #include <bob/trainer/EMTrainer.h>
+#include "em.h"
 #include <boost/python/stl_iterator.hpp>
 
 using namespace boost::python;
@@ -26,6 +27,15 @@ static void py_train(EMTrainerIVectorBase& trainer,
   trainer.train(machine, vdata);
 }
 
+static void py_resume(EMTrainerIVectorBase& trainer,
+  bob::machine::IVectorMachine& machine, object data,
+  const std::string& filename)
+{
+  stl_input_iterator<bob::machine::GMMStats> dbegin(data), dend;
+  std::vector<bob::machine::GMMStats> vdata(dbegin, dend);
+  trainer.resume(machine, vdata, filename);
+}
+
 static void py_initialize(EMTrainerIVectorBase& trainer,
   bob::machine::IVectorMachine& machine, object data)
 {
@@ -96,6 +106,7 @@ void bind_trainer_ivector()
        "Updates the hidden variable distribution (or the sufficient statistics) given the Machine parameters. ")
     .def("m_step", &py_mStep, (arg("machine"), arg("data")), "Updates the Machine parameters given the hidden variable distribution (or the sufficient statistics)")
     .def("compute_likelihood", &EMTrainerIVectorBase::computeLikelihood, (arg("machine")), "Computes the current log likelihood given the hidden variable distribution (or the sufficient statistics)")
+    .def(bind_em_checkpoint(&py_resume))
   ;
 
 
@@ -108,5 +119,6 @@ void bind_trainer_ivector()
     .add_property("acc_fnormij_wij", make_function(&bob::trainer::IVectorTrainer::getAccFnormijWij, return_value_policy<copy_const_reference>()), &py_set_AccFnormijWij, "Accumulator updated during the E-step")
     .add_property("acc_nij", make_function(&bob::trainer::IVectorTrainer::getAccNij, return_value_policy<copy_const_reference>()), &py_set_AccNij, "Accumulator updated during the E-step")
     .add_property("acc_snormij", make_function(&bob::trainer::IVectorTrainer::getAccSnormij, return_value_policy<copy_const_reference>()), &py_set_AccSnormij, "Accumulator updated during the E-step")
+    .add_property("n_threads", &bob::trainer::IVectorTrainer::getNThreads, &bob::trainer::IVectorTrainer::setNThreads, "The number of threads used by the E-step and the M-step (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
   ;
 }
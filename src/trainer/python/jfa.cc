@@ -9,6 +9,7 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <boost/python/stl_iterator.hpp>
 #include <bob/trainer/JFATrainer.h>
 #include <boost/shared_ptr.hpp>
@@ -84,6 +85,19 @@ static void isv_enrol(bob::trainer::ISVTrainer& t, bob::machine::ISVMachine& m,
   t.enrol(m, vdata, n_iter);
 }
 
+static object isv_enrol_clients(bob::trainer::ISVTrainer& t, const bob::machine::ISVBase& m, object data, const size_t n_iter)
+{
+  std::vector<std::vector<boost::shared_ptr<bob::machine::GMMStats> > > enrol_data;
+  extract_GMMStats(data, enrol_data);
+  bob::python::ndarray z(bob::core::array::t_float64, enrol_data.size(), m.getDimCD());
+  blitz::Array<double,2> z_ = z.bz<double,2>();
+  {
+    bob::python::no_gil unlock;
+    t.enrol(m, enrol_data, n_iter, z_);
+  }
+  return z.self();
+}
+
 static object isv_get_x(const bob::trainer::ISVTrainer& t)
 {
   return vector_as_list(t.getX());
@@ -328,6 +342,8 @@ void bind_trainer_jfa()
     .def("m_step", &isv_mstep, (arg("self"), arg("isv_base"), arg("gmm_stats")), "Call the m-step procedure.")
     .def("finalize", &isv_finalize, (arg("self"), arg("isv_base"), arg("gmm_stats")), "Call the finalization procedure.")
     .def("enrol", &isv_enrol, (arg("self"), arg("isv_machine"), arg("gmm_stats"), arg("n_iter")), "Call the enrolment procedure.")
+    .def("enrol", &isv_enrol_clients, (arg("self"), arg("isv_base"), arg("gmm_stats"), arg("n_iter")), "Enrols several clients at once, given the list of the GMMStats of each client, and returns their z speaker factors (one client per row). The clients are processed in parallel.")
+    .add_property("n_threads", &bob::trainer::ISVTrainer::getNThreads, &bob::trainer::ISVTrainer::setNThreads, "The number of threads used to process the identities (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
     .add_property("acc_u_a1", make_function(&bob::trainer::ISVTrainer::getAccUA1, return_value_policy<copy_const_reference>()), &isv_set_accUA1, "Accumulator updated during the E-step")
     .add_property("acc_u_a2", make_function(&bob::trainer::ISVTrainer::getAccUA2, return_value_policy<copy_const_reference>()), &isv_set_accUA2, "Accumulator updated during the E-step")
   ;
@@ -355,6 +371,7 @@ void bind_trainer_jfa()
     .def("m_step3", &jfa_mstep3, (arg("self"), arg("jfa_base"), arg("gmm_stats")), "Call the 3rd m-step procedure (for the d subspace).")
     .def("finalize3", &jfa_finalize3, (arg("self"), arg("jfa_base"), arg("gmm_stats")), "Call the 3rd finalization procedure (for the d subspace).")
     .def("enrol", &jfa_enrol, (arg("self"), arg("jfa_machine"), arg("gmm_stats"), arg("n_iter")), "Call the enrolment procedure.")
+    .add_property("n_threads", &bob::trainer::JFATrainer::getNThreads, &bob::trainer::JFATrainer::setNThreads, "The number of threads used to process the identities (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
     .add_property("acc_v_a1", make_function(&bob::trainer::JFATrainer::getAccVA1, return_value_policy<copy_const_reference>()), &jfa_set_accVA1, "Accumulator updated during the E-step")
     .add_property("acc_v_a2", make_function(&bob::trainer::JFATrainer::getAccVA2, return_value_policy<copy_const_reference>()), &jfa_set_accVA2, "Accumulator updated during the E-step")
     .add_property("acc_u_a1", make_function(&bob::trainer::JFATrainer::getAccUA1, return_value_policy<copy_const_reference>()), &jfa_set_accUA1, "Accumulator updated during the E-step")
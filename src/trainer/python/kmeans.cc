@@ -8,6 +8,7 @@
 
 #include <bob/python/ndarray.h>
 #include <bob/trainer/KMeansTrainer.h>
+#include "em.h"
 
 using namespace boost::python;
 
@@ -33,6 +34,30 @@ static void py_train(EMTrainerKMeansBase& trainer,
   trainer.train(machine, sample.bz<double,2>());
 }
 
+static void py_train_sampler(bob::trainer::KMeansTrainer& trainer,
+  bob::machine::KMeansMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  trainer.train(machine, sampler);
+}
+
+static void py_initialize_sampler(bob::trainer::KMeansTrainer& trainer,
+  bob::machine::KMeansMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  trainer.initialize(machine, sampler);
+}
+
+static void py_eStep_sampler(bob::trainer::KMeansTrainer& trainer,
+  bob::machine::KMeansMachine& machine, bob::trainer::HDF5Sampler& sampler)
+{
+  trainer.eStep(machine, sampler);
+}
+
+static void py_resume(EMTrainerKMeansBase& trainer,
+  bob::machine::KMeansMachine& machine, bob::python::const_ndarray sample, const std::string& filename)
+{
+  trainer.resume(machine, sample.bz<double,2>(), filename);
+}
+
 static void py_initialize(EMTrainerKMeansBase& trainer,
   bob::machine::KMeansMachine& machine, bob::python::const_ndarray sample)
 {
@@ -76,6 +101,7 @@ void bind_trainer_kmeans()
        "is less than the convergence_threshold.")
     .def("m_step", &py_mStep, (arg("self"), arg("machine"), arg("data")), "Update the Machine parameters given the hidden variable distribution (or the sufficient statistics)")
     .def("compute_likelihood", &EMTrainerKMeansBase::computeLikelihood, (arg("self"), arg("machine")), "Returns the average min (square Euclidean) distance")
+    .def(bind_em_checkpoint(&py_resume))
     .def("finalize", &py_finalize, (arg("self"), arg("machine"), arg("data")), "This method is called after the EM algorithm")
   ;
 
@@ -93,9 +119,20 @@ void bind_trainer_kmeans()
      .def(self != self)
      .add_property("initialization_method", &bob::trainer::KMeansTrainer::getInitializationMethod, &bob::trainer::KMeansTrainer::setInitializationMethod, "The initialization method to generate the initial means.")
      .add_property("rng", &bob::trainer::KMeansTrainer::getRng, &bob::trainer::KMeansTrainer::setRng, "The Mersenne Twister mt19937 random generator used for the initialization of the means.")
+     .add_property("pruning", &bob::trainer::KMeansTrainer::getPruning, &bob::trainer::KMeansTrainer::setPruning, "Enables the pruning of the distance computations in the E-step, using triangle inequality bounds (Hamerly's algorithm). The bounds are kept from one E-step to the next one, which should hence be called with the same data.")
+     .add_property("kmeans_parallel_rounds", &bob::trainer::KMeansTrainer::getKMeansParallelRounds, &bob::trainer::KMeansTrainer::setKMeansParallelRounds, "The number of sampling rounds of the k-means|| initialization.")
+     .add_property("kmeans_parallel_oversampling", &bob::trainer::KMeansTrainer::getKMeansParallelOversampling, &bob::trainer::KMeansTrainer::setKMeansParallelOversampling, "The oversampling factor of the k-means|| initialization, i.e., the expected number of candidates sampled at each round divided by the number of means.")
+     .add_property("mini_batch_size", &bob::trainer::KMeansTrainer::getMiniBatchSize, &bob::trainer::KMeansTrainer::setMiniBatchSize, "The number of random samples of the mini-batch used by each E-step (0 disables the mini-batch mode). In the mini-batch mode, each mean is moved towards the samples of the mini-batch it is the closest to, with a learning rate which decreases with the number of samples assigned to it since the initialization.")
+     .add_property("n_threads", &bob::trainer::KMeansTrainer::getNThreads, &bob::trainer::KMeansTrainer::setNThreads, "The number of threads used by the initialization and the E-step (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
      .add_property("average_min_distance", &bob::trainer::KMeansTrainer::getAverageMinDistance, &bob::trainer::KMeansTrainer::setAverageMinDistance, "Average min (square Euclidean) distance. Useful to parallelize the E-step.")
      .add_property("zeroeth_order_statistics", make_function(&bob::trainer::KMeansTrainer::getZeroethOrderStats, return_value_policy<copy_const_reference>()), &py_setZeroethOrderStats, "The zeroeth order statistics. Useful to parallelize the E-step.")
      .add_property("first_order_statistics", make_function(&bob::trainer::KMeansTrainer::getFirstOrderStats, return_value_policy<copy_const_reference>()), &py_setFirstOrderStats, "The first order statistics. Useful to parallelize the E-step.")
+     .def("train", &py_train, (arg("self"), arg("machine"), arg("data")), "Train a machine using data")
+     .def("train", &py_train_sampler, (arg("self"), arg("machine"), arg("sampler")), "Train a machine by streaming the data of the given HDF5Sampler at each E-step. The block size of the sampler should be a multiple of 256, in which case the machine is the same as the one trained with all the data at once (without pruning). The k-means++ and k-means|| initializations and the mini-batch mode are not supported.")
+     .def("initialize", &py_initialize, (arg("self"), arg("machine"), arg("data")), "This method is called before the EM algorithm")
+     .def("initialize", &py_initialize_sampler, (arg("self"), arg("machine"), arg("sampler")), "Initialize the means by reading random samples of the given HDF5Sampler")
+     .def("e_step", &py_eStep, (arg("self"), arg("machine"), arg("data")), "Update the sufficient statistics given the Machine parameters")
+     .def("e_step", &py_eStep_sampler, (arg("self"), arg("machine"), arg("sampler")), "Update the sufficient statistics given the Machine parameters, by streaming the data of the given HDF5Sampler")
     ;
 
   // Sets the scope to the one of the KMeansTrainer
@@ -107,6 +144,7 @@ void bind_trainer_kmeans()
     .value("RANDOM_NO_DUPLICATE", bob::trainer::KMeansTrainer::RANDOM_NO_DUPLICATE)
 #if BOOST_VERSION >= 104700
     .value("KMEANS_PLUS_PLUS", bob::trainer::KMeansTrainer::KMEANS_PLUS_PLUS)
+    .value("KMEANS_PARALLEL", bob::trainer::KMeansTrainer::KMEANS_PARALLEL)
 #endif
     .export_values()
     ;
@@ -56,6 +56,30 @@ static size_t output_size(bob::trainer::FisherLDATrainer& t, object data) {
   return t.output_size(vdata);
 }
 
+static tuple lda_train_acc1(bob::trainer::FisherLDATrainer& t,
+  const bob::trainer::ScatterAccumulator& acc)
+{
+  int osize = t.output_size(acc);
+  blitz::Array<double,1> eig_val(osize);
+  bob::machine::LinearMachine m(acc.getNFeatures(), osize);
+  t.train(m, eig_val, acc);
+  return make_tuple(m, eig_val);
+}
+
+static object lda_train_acc2(bob::trainer::FisherLDATrainer& t,
+  bob::machine::LinearMachine& m, const bob::trainer::ScatterAccumulator& acc)
+{
+  blitz::Array<double,1> eig_val(t.output_size(acc));
+  t.train(m, eig_val, acc);
+  return object(eig_val);
+}
+
+static size_t output_size_acc(bob::trainer::FisherLDATrainer& t,
+  const bob::trainer::ScatterAccumulator& acc)
+{
+  return t.output_size(acc);
+}
+
 static char CLASS_DOC[] = \
   "Trains a :py:class:`bob.machine.LinearMachine` to perform Fisher's Linear Discriminant Analysis (LDA).\n" \
   "\n" \
@@ -158,6 +182,15 @@ void bind_trainer_lda()
        "This number could be either K-1 (where K is number of classes) or the number of columns (features) in X, depending on the setting of ``strip_to_rank``.\n" \
        )
 
+    .def("train", &lda_train_acc1, (arg("self"), arg("accumulator")),
+        "Creates a LinearMachine that performs Fisher/LDA discrimination, as above, from the statistics of the classes accumulated in a :py:class:`bob.trainer.ScatterAccumulator`, such that the data never has to be in memory at once. The classes without any sample are ignored. Returns a tuple containing the resulting linear machine and the eigen values in a 1D array.")
+
+    .def("train", &lda_train_acc2, (arg("self"), arg("machine"), arg("accumulator")),
+        "Trains a given LinearMachine to perform Fisher/LDA discrimination, as above, from the statistics of the classes accumulated in a :py:class:`bob.trainer.ScatterAccumulator`. Returns the eigen values.")
+
+    .def("output_size", &output_size_acc, (arg("self"), arg("accumulator")),
+       "Returns the expected size of the output (or the number of eigen-values returned) given the statistics accumulated in a :py:class:`bob.trainer.ScatterAccumulator`.")
+
     .add_property("use_pinv", &bob::trainer::FisherLDATrainer::getUsePseudoInverse, &bob::trainer::FisherLDATrainer::setUsePseudoInverse,
         "If ``True``, use the pseudo-inverse to calculate :math:`S_w^{-1} S_b` and then perform the eigen value decomposition (using LAPACK's ``dgeev``) instead of using (the more numerically stable) LAPACK's ``dsyvgd`` to solve the generalized symmetric-definite eigenproblem of the form :math:`S_b v=(\\lambda) S_w v`")
 
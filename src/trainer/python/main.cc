@@ -13,12 +13,15 @@
 
 void bind_trainer_pca();
 void bind_trainer_lda();
+void bind_trainer_em();
 void bind_trainer_gmm();
 void bind_trainer_kmeans();
 void bind_trainer_mlpbase();
 void bind_trainer_backprop();
 void bind_trainer_rprop();
 void bind_trainer_shuffler();
+void bind_trainer_sampler();
+void bind_trainer_scatter_accumulator();
 void bind_trainer_jfa();
 void bind_trainer_ivector();
 void bind_trainer_plda();
@@ -40,12 +43,15 @@ BOOST_PYTHON_MODULE(_trainer) {
   
   bind_trainer_pca();
   bind_trainer_lda();
+  bind_trainer_em();
   bind_trainer_gmm();
   bind_trainer_kmeans();
   bind_trainer_mlpbase();
   bind_trainer_backprop();
   bind_trainer_rprop();
   bind_trainer_shuffler();
+  bind_trainer_sampler();
+  bind_trainer_scatter_accumulator();
   bind_trainer_jfa();
   bind_trainer_ivector();
   bind_trainer_plda();
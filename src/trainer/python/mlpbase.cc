@@ -220,6 +220,8 @@ void bind_trainer_mlpbase() {
 
     .add_property("train_biases", &bob::trainer::MLPBaseTrainer::getTrainBiases, &bob::trainer::MLPBaseTrainer::setTrainBiases, "A flag, indicating if this trainer will adjust the biases of the network (``True``) or not (``False``).")
 
+    .add_property("n_threads", &bob::trainer::MLPBaseTrainer::getNThreads, &bob::trainer::MLPBaseTrainer::setNThreads, "The number of threads used by the forward and backward steps (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
+
     .def("is_compatible", &bob::trainer::MLPBaseTrainer::isCompatible, (arg("self"), arg("machine")), "Checks if a given machine is compatible with my inner settings")
 
     .def("initialize", &bob::trainer::MLPBaseTrainer::initialize, (arg("self"), arg("mlp")), "Initialize the training process.")
@@ -14,6 +14,7 @@
 #include <boost/python/stl_iterator.hpp>
 #include <bob/machine/PLDAMachine.h>
 #include <bob/trainer/PLDATrainer.h>
+#include "em.h"
 
 using namespace boost::python;
 
@@ -31,6 +32,19 @@ static void plda_train(EMTrainerPLDA& t, bob::machine::PLDABase& m, object data)
   t.train(m, vdata_ref);
 }
 
+static void plda_resume(EMTrainerPLDA& t, bob::machine::PLDABase& m,
+  object data, const std::string& filename)
+{
+  stl_input_iterator<bob::python::const_ndarray> dbegin(data), dend;
+  std::vector<bob::python::const_ndarray> vdata(dbegin, dend);
+  std::vector<blitz::Array<double,2> > vdata_ref;
+  for(std::vector<bob::python::const_ndarray>::iterator it=vdata.begin();
+      it!=vdata.end(); ++it)
+    vdata_ref.push_back(it->bz<double,2>());
+  // Resumes the training
+  t.resume(m, vdata_ref, filename);
+}
+
 static void plda_initialize(EMTrainerPLDA& t, bob::machine::PLDABase& m, object data)
 {
   stl_input_iterator<bob::python::const_ndarray> dbegin(data), dend;
@@ -105,6 +119,7 @@ void bind_trainer_plda()
     .def("e_step", &plda_eStep, (arg("self"), arg("machine"), arg("data")),
        "Updates the hidden variable distribution (or the sufficient statistics) given the Machine parameters. ")
     .def("m_step", &plda_mStep, (arg("self"), arg("machine"), arg("data")), "Updates the Machine parameters given the hidden variable distribution (or the sufficient statistics)")
+    .def(bind_em_checkpoint(&plda_resume))
   ;
 
   class_<bob::trainer::PLDATrainer, boost::noncopyable, bases<EMTrainerPLDA> > PLDAT("PLDATrainer", "A trainer for Probabilistic Linear Discriminant Analysis (PLDA). The train() method will learn the mu, F, G and Sigma of the model, whereas the enrol() method, will store model information about the enrolment samples for a specific class.\n\nReferences:\n1. 'A Scalable Formulation of Probabilistic Linear Discriminant Analysis: Applied to Face Recognition', Laurent El Shafey, Chris McCool, Roy Wallace, Sebastien Marcel, TPAMI'2013\n2. 'Probabilistic Linear Discriminant Analysis for Inference About Identity', Prince and Elder, ICCV'2007.\n3. 'Probabilistic Models for Inference about Identity', Li, Fu, Mohammed, Elder and Prince, TPAMI'2012.", no_init);
@@ -116,6 +131,7 @@ void bind_trainer_plda()
     .def("is_similar_to", &bob::trainer::PLDATrainer::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this PLDATrainer with the 'other' one to be approximately the same.")
     .def("enrol", &bob::trainer::PLDATrainer::enrol, (arg("self"), arg("plda_machine"), arg("data")), "Enrol a class-specific model (PLDAMachine) given a set of enrolment samples.")
     .add_property("use_sum_second_order", &bob::trainer::PLDATrainer::getUseSumSecondOrder, &bob::trainer::PLDATrainer::setUseSumSecondOrder, "Tells whether the second order statistics are stored during the training procedure, or only their sum.")
+    .add_property("n_threads", &bob::trainer::PLDATrainer::getNThreads, &bob::trainer::PLDATrainer::setNThreads, "The number of threads used by the E- and M-steps (0 means as many threads as hardware threads). The results do not depend on the number of threads.")
     .add_property("z_first_order", &get_z_first_order)
     .add_property("z_second_order", &get_z_second_order)
     .add_property("z_second_order_sum", make_function(&bob::trainer::PLDATrainer::getZSecondOrderSum, return_value_policy<copy_const_reference>()))
@@ -0,0 +1,75 @@
+/**
+ * @file trainer/python/sampler.cc
+ * @date Mon Oct 19 02:52:55 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Python bindings for the HDF5Sampler
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <boost/python.hpp>
+#include <boost/python/stl_iterator.hpp>
+#include <boost/make_shared.hpp>
+#include <bob/python/ndarray.h>
+#include <bob/trainer/HDF5Sampler.h>
+
+using namespace boost::python;
+
+static boost::shared_ptr<bob::trainer::HDF5Sampler> sampler_from_list(
+  object filenames, const std::string& path, const size_t block_size,
+  const size_t n_buffers)
+{
+  stl_input_iterator<std::string> it(filenames), end;
+  std::vector<std::string> filenames_(it, end);
+  return boost::make_shared<bob::trainer::HDF5Sampler>(filenames_, path,
+    block_size, n_buffers);
+}
+
+static tuple get_filenames(const bob::trainer::HDF5Sampler& sampler)
+{
+  list l;
+  const std::vector<std::string>& filenames = sampler.getFilenames();
+  for (size_t i=0; i<filenames.size(); ++i) l.append(filenames[i]);
+  return tuple(l);
+}
+
+static object next_block(bob::trainer::HDF5Sampler& sampler)
+{
+  blitz::Array<double,2> block;
+  if (!sampler.next(block)) return object();
+  // the block is a view on an internal buffer
+  bob::python::ndarray copy(bob::core::array::t_float64, block.extent(0),
+    block.extent(1));
+  blitz::Array<double,2> copy_ = copy.bz<double,2>();
+  copy_ = block;
+  return copy.self();
+}
+
+static object read_sample(bob::trainer::HDF5Sampler& sampler,
+  const size_t index)
+{
+  bob::python::ndarray sample(bob::core::array::t_float64,
+    sampler.getNInputs());
+  blitz::Array<double,1> sample_ = sample.bz<double,1>();
+  sampler.read(index, sample_);
+  return sample.self();
+}
+
+void bind_trainer_sampler()
+{
+  class_<bob::trainer::HDF5Sampler, boost::shared_ptr<bob::trainer::HDF5Sampler>, boost::noncopyable>("HDF5Sampler",
+      "Streams the samples (i.e. the rows) of 2D datasets of double precision values, stored at the same path of a list of HDF5 files, by blocks of a fixed number of samples. The samples of all the files are concatenated, and each pass over the data provides consecutive blocks of block_size samples (except for the last one). The blocks are read ahead by a background thread, such that at most n_buffers blocks are in memory at once. This allows to train machines (e.g. with the KMeansTrainer or the GMMTrainer) on data sets which do not fit in memory.",
+      no_init)
+    .def("__init__", make_constructor(&sampler_from_list, default_call_policies(), (arg("filenames"), arg("path")="/array", arg("block_size")=65536, arg("n_buffers")=2)), "Opens the given list of HDF5 files to determine their number of samples")
+    .add_property("filenames", &get_filenames, "The HDF5 files to read the samples from")
+    .add_property("path", make_function(&bob::trainer::HDF5Sampler::getPath, return_value_policy<copy_const_reference>()), "The path of the dataset in each file")
+    .add_property("n_samples", &bob::trainer::HDF5Sampler::getNSamples, "The total number of samples")
+    .add_property("n_inputs", &bob::trainer::HDF5Sampler::getNInputs, "The dimensionality of the samples")
+    .add_property("block_size", &bob::trainer::HDF5Sampler::getBlockSize, "The number of samples of each block")
+    .add_property("n_blocks", &bob::trainer::HDF5Sampler::getNBlocks, "The number of blocks of a pass over the data")
+    .def("reset", &bob::trainer::HDF5Sampler::reset, (arg("self")), "Starts a new pass over the data, from the first block")
+    .def("next", &next_block, (arg("self")), "Returns (a copy of) the next block of the current pass as a 2D array, starting a new pass if required, or None at the end of the pass")
+    .def("read", &read_sample, (arg("self"), arg("index")), "Reads the sample at the given index. This stops the current pass over the data, if any.")
+  ;
+}
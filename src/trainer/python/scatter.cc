@@ -0,0 +1,71 @@
+/**
+ * @file trainer/python/scatter.cc
+ * @date Mon Oct 19 03:30:35 2026 +0000
+ * @author agent <agent@local>
+ *
+ * @brief Python bindings for the ScatterAccumulator
+ *
+ * Copyright (C) 2011-2013 Idiap Research Institute, Martigny, Switzerland
+ */
+
+#include <boost/python.hpp>
+#include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
+#include <bob/trainer/ScatterAccumulator.h>
+
+using namespace boost::python;
+
+static void py_accumulate(bob::trainer::ScatterAccumulator& acc,
+  const size_t class_id, bob::python::const_ndarray block)
+{
+  const blitz::Array<double,2> block_ = block.bz<double,2>();
+  bob::python::no_gil unlock;
+  acc.accumulate(class_id, block_);
+}
+
+static void py_accumulate_sampler(bob::trainer::ScatterAccumulator& acc,
+  const size_t class_id, bob::trainer::HDF5Sampler& sampler)
+{
+  bob::python::no_gil unlock;
+  acc.accumulate(class_id, sampler);
+}
+
+static object py_scatters(const bob::trainer::ScatterAccumulator& acc)
+{
+  const size_t n_features = acc.getNFeatures();
+  bob::python::ndarray Sw(bob::core::array::t_float64, n_features, n_features);
+  bob::python::ndarray Sb(bob::core::array::t_float64, n_features, n_features);
+  bob::python::ndarray m(bob::core::array::t_float64, n_features);
+  blitz::Array<double,2> Sw_ = Sw.bz<double,2>();
+  blitz::Array<double,2> Sb_ = Sb.bz<double,2>();
+  blitz::Array<double,1> m_ = m.bz<double,1>();
+  acc.scatters(Sw_, Sb_, m_);
+  return make_tuple(Sw, Sb, m);
+}
+
+void bind_trainer_scatter_accumulator()
+{
+  class_<bob::trainer::ScatterAccumulator, boost::shared_ptr<bob::trainer::ScatterAccumulator> >("ScatterAccumulator",
+      "Accumulates the number of samples and the mean of each class, and the within-class scatter :math:`S_w = \\sum_{k} \\sum_{n \\in C_k} (x_n-m_k)(x_n-m_k)^T`, from blocks of samples given in any order. The samples of a class can be split into several blocks, possibly accumulated by different accumulators (e.g. in different processes), which are then merged. The memory used does not depend on the number of samples. The accumulated statistics can be given to the train() method of the :py:class:`bob.trainer.FisherLDATrainer`, the :py:class:`bob.trainer.WCCNTrainer` and the :py:class:`bob.trainer.WhiteningTrainer` instead of the data.",
+      init<optional<const size_t> >((arg("self"), arg("n_features")=0), "Creates an empty accumulator for samples of the given dimensionality"))
+    .def(init<bob::io::HDF5File&>((arg("self"), arg("config")), "Loads an accumulator from a configuration file"))
+    .def(init<const bob::trainer::ScatterAccumulator&>((arg("self"), arg("other")), "Copy constructs a ScatterAccumulator"))
+    .def(self == self)
+    .def(self != self)
+    .def("is_similar_to", &bob::trainer::ScatterAccumulator::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this ScatterAccumulator with the 'other' one to be approximately the same.")
+    .def("reset", &bob::trainer::ScatterAccumulator::reset, (arg("self"), arg("n_features")), "Removes all the statistics, and sets the dimensionality of the samples")
+    .def("accumulate", &py_accumulate, (arg("self"), arg("class_id"), arg("block")), "Adds a block of samples (one per row) of the given class. The classes do not need to be accumulated in order.")
+    .def("accumulate", &py_accumulate_sampler, (arg("self"), arg("class_id"), arg("sampler")), "Adds all the samples of the given :py:class:`bob.trainer.HDF5Sampler` to the given class, by streaming its blocks")
+    .def("merge", &bob::trainer::ScatterAccumulator::merge, (arg("self"), arg("other")), "Adds the statistics of another accumulator")
+    .def("scatters", &py_scatters, (arg("self")), "Returns a tuple with the within-class scatter Sw, the between-class scatter Sb and the overall mean m, as :py:func:`bob.math.scatters` does with all the samples at once")
+    .add_property("n_features", &bob::trainer::ScatterAccumulator::getNFeatures, "The dimensionality of the samples")
+    .add_property("n_classes", &bob::trainer::ScatterAccumulator::getNClasses, "The number of classes which have at least one sample")
+    .add_property("n_samples", &bob::trainer::ScatterAccumulator::getNSamples, "The total number of samples")
+    .add_property("counts", make_function(&bob::trainer::ScatterAccumulator::getCounts, return_value_policy<copy_const_reference>()), "The number of samples of each class (indexed by the class identifiers)")
+    .add_property("means", make_function(&bob::trainer::ScatterAccumulator::getMeans, return_value_policy<copy_const_reference>()), "The mean of each class (one per row)")
+    .add_property("scatter", make_function(&bob::trainer::ScatterAccumulator::getScatter, return_value_policy<copy_const_reference>()), "The within-class scatter")
+    .add_property("n_threads", &bob::trainer::ScatterAccumulator::getNThreads, &bob::trainer::ScatterAccumulator::setNThreads, "The number of threads used to accumulate a block (0 means as many threads as hardware threads). The statistics do not depend on it.")
+    .def("load", &bob::trainer::ScatterAccumulator::load, (arg("self"), arg("config")), "Loads the statistics from a configuration file")
+    .def("save", &bob::trainer::ScatterAccumulator::save, (arg("self"), arg("config")), "Saves the statistics to a configuration file")
+  ;
+}
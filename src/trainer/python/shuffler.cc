@@ -12,6 +12,8 @@
 #include <boost/python/stl_iterator.hpp>
 #include <boost/make_shared.hpp>
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
+#include <bob/core/array_copy.h>
 #include <bob/trainer/DataShuffler.h>
 
 using namespace boost::python;
@@ -47,6 +49,17 @@ static void call_shuffler4(bob::trainer::DataShuffler& s,
   s(data_, target_);
 }
 
+static tuple shuffler_next(bob::trainer::DataShuffler& s) {
+  blitz::Array<double,2> data, target;
+  {
+    bob::python::no_gil unlock;
+    s.next(data, target);
+  }
+  // the views are only valid until the next call: returns copies
+  return make_tuple(bob::core::array::ccopy(data),
+      bob::core::array::ccopy(target));
+}
+
 static tuple stdnorm(bob::trainer::DataShuffler& s) {
   blitz::Array<double,1> mean(s.getDataWidth());
   blitz::Array<double,1> stddev(s.getDataWidth());
@@ -131,5 +144,9 @@ void bind_trainer_shuffler() {
     .def("__call__", &call_shuffler2, (arg("self"), arg("rng"), arg("n")), "Populates the output matrices (data, target) by randomly selecting 'n' arrays from the input arraysets and matching targets in the most possible fair way. The 'data' and 'target' matrices will contain 'n' rows and the number of columns that are dependent on input arraysets and target array widths. In this version you should provide your own random number generator, already initialized.")
     .def("__call__", &call_shuffler3, (arg("self"), arg("rng"), arg("data"), arg("target")), "Populates the output matrices by randomly selecting 'n' arrays from the input arraysets and matching targets in the most possible fair way. The 'data' and 'target' matrices will contain 'n' rows and the number of columns that are dependent on input arraysets and target arrays.\n\nWe check don't 'data' and 'target' for size compatibility and is your responsibility to do so.")
     .def("__call__", call_shuffler4, (arg("self"), arg("data"), arg("target")), "This version is a shortcut to the previous declaration of operator() that actually instantiates its own random number generator and seed it a time-based variable. We guarantee two calls will lead to different results if they are at least 1 microsecond appart (procedure uses the machine clock).")
+    .def("start_prefetching", &bob::trainer::DataShuffler::startPrefetching, (arg("self"), arg("batch_size"), arg("seed"), arg("n_buffers")=2), "Starts a background thread, which draws mini-batches of 'batch_size' samples into a ring of 'n_buffers' buffers, ahead of the calls to next(). The sequence of mini-batches is the same as the one obtained by calling this shuffler repeatedly with a random number generator seeded with 'seed'.")
+    .def("stop_prefetching", &bob::trainer::DataShuffler::stopPrefetching, (arg("self")), "Stops the background thread, if any.")
+    .add_property("prefetching", &bob::trainer::DataShuffler::isPrefetching, "Tells if mini-batches are drawn by a background thread.")
+    .def("next", &shuffler_next, (arg("self")), "Returns the next mini-batch (data, target) drawn by the background thread (see start_prefetching()), waiting for it if required.")
     ;
 }
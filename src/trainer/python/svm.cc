@@ -9,6 +9,7 @@
  */
 
 #include <bob/python/ndarray.h>
+#include <bob/python/gil.h>
 #include <boost/python/stl_iterator.hpp>
 #include <bob/trainer/SVMTrainer.h>
 
@@ -37,8 +38,54 @@ static boost::shared_ptr<bob::machine::SupportVector> train2
   return trainer.train(vdata, sub.bz<double,1>(), div.bz<double,1>());
 }
 
+static boost::shared_ptr<bob::machine::SupportVector> train_gram
+(const bob::trainer::SVMTrainer& trainer,
+ const bob::trainer::SVMGramMatrix& gram) {
+  bob::python::no_gil unlock;
+  return trainer.train(gram);
+}
+
+static boost::shared_ptr<bob::trainer::SVMGramMatrix> gram1
+(object data, const size_t n_threads) {
+  stl_input_iterator<bob::python::const_ndarray> dbegin(data), dend;
+  std::vector<bob::python::const_ndarray> vdata_ref(dbegin, dend);
+  std::vector<blitz::Array<double,2> > vdata;
+  for(std::vector<bob::python::const_ndarray>::iterator it=vdata_ref.begin(); 
+      it!=vdata_ref.end(); ++it)
+    vdata.push_back(it->bz<double,2>());
+  bob::python::no_gil unlock;
+  return boost::shared_ptr<bob::trainer::SVMGramMatrix>(new bob::trainer::SVMGramMatrix(vdata, n_threads));
+}
+
+static boost::shared_ptr<bob::trainer::SVMGramMatrix> gram2
+(object data, bob::python::const_ndarray sub, bob::python::const_ndarray div,
+ const size_t n_threads) {
+  stl_input_iterator<bob::python::const_ndarray> dbegin(data), dend;
+  std::vector<bob::python::const_ndarray> vdata_ref(dbegin, dend);
+  std::vector<blitz::Array<double,2> > vdata;
+  for(std::vector<bob::python::const_ndarray>::iterator it=vdata_ref.begin(); 
+      it!=vdata_ref.end(); ++it)
+    vdata.push_back(it->bz<double,2>());
+  const blitz::Array<double,1> sub_ = sub.bz<double,1>();
+  const blitz::Array<double,1> div_ = div.bz<double,1>();
+  bob::python::no_gil unlock;
+  return boost::shared_ptr<bob::trainer::SVMGramMatrix>(new bob::trainer::SVMGramMatrix(vdata, sub_, div_, n_threads));
+}
+
 void bind_trainer_svm() {
-  class_<bob::trainer::SVMTrainer, boost::shared_ptr<bob::trainer::SVMTrainer> >("SVMTrainer", "This class emulates the behavior of the command line utility called svm-train, from libsvm. These bindings do not support:\n\n * Precomputed Kernels\n * Regression Problems\n * Different weights for every label (-wi option in svm-train)\n\nFell free to implement those and remove these remarks.", no_init)
+  class_<bob::trainer::SVMGramMatrix, boost::shared_ptr<bob::trainer::SVMGramMatrix>, boost::noncopyable>("SVMGramMatrix", "The normalized samples of a training set for an SVM, together with their pairwise inner products, which are computed once with a (blocked) matrix product. They allow to train several machines on the same data (e.g. for a grid search over the cost and the kernel parameters) with libsvm's precomputed kernels: the kernel matrix is derived from the inner products at each training, without any access to the features. The memory required is quadratic in the number of samples.", no_init)
+    .def("__init__", make_constructor(&gram1, default_call_policies(), (arg("data"), arg("n_threads")=0)), "Computes the inner products of the samples of each class (one array per class, one sample per row), with n_threads threads (0 means as many threads as hardware threads).")
+    .def("__init__", make_constructor(&gram2, default_call_policies(), (arg("data"), arg("subtract"), arg("divide"), arg("n_threads")=0)), "This version accepts scaling parameters that will be applied column-wise to the input data.")
+    .add_property("n_samples", &bob::trainer::SVMGramMatrix::getNSamples, "The number of samples")
+    .add_property("n_features", &bob::trainer::SVMGramMatrix::getNFeatures, "The number of features of the samples")
+    .add_property("n_classes", &bob::trainer::SVMGramMatrix::getNClasses, "The number of classes")
+    .add_property("samples", make_function(&bob::trainer::SVMGramMatrix::getSamples, return_value_policy<copy_const_reference>()), "The normalized samples of all the classes (one per row)")
+    .add_property("inner_products", make_function(&bob::trainer::SVMGramMatrix::getInnerProducts, return_value_policy<copy_const_reference>()), "The inner products between all the normalized samples")
+    .add_property("input_subtract", make_function(&bob::trainer::SVMGramMatrix::getInputSubtraction, return_value_policy<copy_const_reference>()), "The values subtracted from the input data")
+    .add_property("input_divide", make_function(&bob::trainer::SVMGramMatrix::getInputDivision, return_value_policy<copy_const_reference>()), "The values the input data is divided by")
+    ;
+
+  class_<bob::trainer::SVMTrainer, boost::shared_ptr<bob::trainer::SVMTrainer> >("SVMTrainer", "This class emulates the behavior of the command line utility called svm-train, from libsvm. These bindings do not support:\n\n * Precomputed Kernels given by the user (the kernel can however be computed from the inner products of an SVMGramMatrix)\n * Regression Problems\n * Different weights for every label (-wi option in svm-train)\n\nFell free to implement those and remove these remarks.", no_init)
     .def(init<optional<bob::machine::SupportVector::svm_t, bob::machine::SupportVector::kernel_t, int, double, double, double, double, double, double, double, bool, bool> >(
           (arg("self"),
            arg("svm_type")=bob::machine::SupportVector::C_SVC,
@@ -68,7 +115,9 @@ void bind_trainer_svm() {
     .add_property("p", &bob::trainer::SVMTrainer::getLossEpsilonSVR, &bob::trainer::SVMTrainer::setLossEpsilonSVR, "for EPSILON_SVR, this is the 'epsilon' value on the equation")
     .add_property("shrinking", &bob::trainer::SVMTrainer::getUseShrinking, &bob::trainer::SVMTrainer::setUseShrinking, "use the shrinking heuristics")
     .add_property("probability", &bob::trainer::SVMTrainer::getProbabilityEstimates, &bob::trainer::SVMTrainer::setProbabilityEstimates, "do probability estimates")
+    .add_property("n_threads", &bob::trainer::SVMTrainer::getNThreads, &bob::trainer::SVMTrainer::setNThreads, "The number of threads used to train the one-vs-one sub-problems of multi-class C_SVC and NU_SVC machines (0 means as many threads as hardware threads). Each thread uses its own kernel cache of cache_size Mb. The sub-problems are trained sequentially if probability estimates are requested. The results do not depend on the number of threads.")
     .def("train", &train1, (arg("self"), arg("data")), "Trains a new machine for multi-class classification. If the number of classes in data is 2, then the assigned labels will be -1 and +1. If the number of classes is greater than 2, labels are picked starting from 1 (i.e., 1, 2, 3, 4, etc.). If what you want is regression, the size of the input data array should be 1.")
     .def("train", &train2, (arg("self"), arg("data"), arg("subtract"), arg("divide")), "This version accepts scaling parameters that will be applied column-wise to the input data.")
+    .def("train", &train_gram, (arg("self"), arg("gram")), "Trains a new machine on the samples of the given SVMGramMatrix, using a kernel matrix computed from their inner products. This avoids recomputing the kernel when several machines are trained on the same data (e.g. for a grid search over the cost). The returned machine uses the kernel of this trainer, as well as the normalization of the SVMGramMatrix.")
     ;
 }
@@ -79,6 +79,20 @@ object py_train2(bob::trainer::WCCNTrainer& t, object data)
   return object(m);
 }
 
+void py_train_acc1(bob::trainer::WCCNTrainer& t,
+  bob::machine::LinearMachine& m, const bob::trainer::ScatterAccumulator& acc)
+{
+  t.train(m, acc);
+}
+
+object py_train_acc2(bob::trainer::WCCNTrainer& t,
+  const bob::trainer::ScatterAccumulator& acc)
+{
+  bob::machine::LinearMachine m(acc.getNFeatures(), acc.getNFeatures());
+  t.train(m, acc);
+  return object(m);
+}
+
 void bind_trainer_wccn()
 {
   class_<bob::trainer::WCCNTrainer, boost::shared_ptr<bob::trainer::WCCNTrainer> >("WCCNTrainer", CLASS_DOC, init<>((arg("self")), "Initializes a new WCCN trainer."))
@@ -88,5 +102,7 @@ void bind_trainer_wccn()
     .def("is_similar_to", &bob::trainer::WCCNTrainer::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this WCCNTrainer with the 'other' one to be approximately the same.")
     .def("train", &py_train1, (arg("self"), arg("machine"), arg("data")), "Trains the LinearMachine to perform the WCCN, given a training set.")
     .def("train", &py_train2, (arg("self"), arg("data")), "Allocates, trains and returns a LinearMachine to perform the WCCN, given a training set.")
+    .def("train", &py_train_acc1, (arg("self"), arg("machine"), arg("accumulator")), "Trains the LinearMachine to perform the WCCN, given the statistics of the classes accumulated in a :py:class:`bob.trainer.ScatterAccumulator`.")
+    .def("train", &py_train_acc2, (arg("self"), arg("accumulator")), "Allocates, trains and returns a LinearMachine to perform the WCCN, given the statistics of the classes accumulated in a :py:class:`bob.trainer.ScatterAccumulator`.")
   ;
 }
@@ -67,6 +67,21 @@ object py_train2(bob::trainer::WhiteningTrainer& t,
   return object(m);
 }
 
+void py_train_acc1(bob::trainer::WhiteningTrainer& t,
+  bob::machine::LinearMachine& m, const bob::trainer::ScatterAccumulator& acc)
+{
+  t.train(m, acc);
+}
+
+object py_train_acc2(bob::trainer::WhiteningTrainer& t,
+  const bob::trainer::ScatterAccumulator& acc)
+{
+  const int n_features = acc.getNFeatures();
+  bob::machine::LinearMachine m(n_features,n_features);
+  t.train(m, acc);
+  return object(m);
+}
+
 
 void bind_trainer_whitening() 
 {
@@ -77,5 +92,7 @@ void bind_trainer_whitening()
     .def("is_similar_to", &bob::trainer::WhiteningTrainer::is_similar_to, (arg("self"), arg("other"), arg("r_epsilon")=1e-5, arg("a_epsilon")=1e-8), "Compares this WhiteningTrainer with the 'other' one to be approximately the same.")
     .def("train", &py_train1, (arg("self"), arg("machine"), arg("data")), "Trains the LinearMachine to perform the Whitening, given a training set.")
     .def("train", &py_train2, (arg("self"), arg("data")), "Allocates, trains and returns a LinearMachine to perform the Whitening, given a training set.")
+    .def("train", &py_train_acc1, (arg("self"), arg("machine"), arg("accumulator")), "Trains the LinearMachine to perform the Whitening, given the statistics accumulated in a :py:class:`bob.trainer.ScatterAccumulator` (the samples of all the classes are whitened together).")
+    .def("train", &py_train_acc2, (arg("self"), arg("accumulator")), "Allocates, trains and returns a LinearMachine to perform the Whitening, given the statistics accumulated in a :py:class:`bob.trainer.ScatterAccumulator` (the samples of all the classes are whitened together).")
   ;
 }